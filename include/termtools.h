@@ -250,11 +250,13 @@ int subStringW(LPWSTR _string, LPWSTR _substring, int _start, int _length)
 }
 
 /**
- * converts a byte-buffer into an wide-string.
+ * converts a byte-buffer into an wide-string of upper-case hex-digits.
+ * the digits of both halves of a byte are looked up in a table.
  * 
  * _IN:
- *      _byteBuffer: the bytes to convert
- *      _size: the size of the output-buffer
+ *      _byteBuffer: the bytes to convert, _size / 2 of them
+ *      _size: the number of hex-digits to write, the output-buffer
+ *              needs room for one more character
  * 
  * _OUT:
  *      _outputBuffer: a wide-character buffer to write the final
@@ -265,12 +267,17 @@ int subStringW(LPWSTR _string, LPWSTR _substring, int _start, int _length)
  */
 int byteToHexStrW(PBYTE _byteBuffer, LPWSTR _outputBuffer, DWORD _size)
 {
+    static const WCHAR pbDigits[] = L"0123456789ABCDEF";
+
     if (!_byteBuffer || !_outputBuffer || _size < 1) return 1;
 
-    for(unsigned int j = 0; j < _size; j++)
-        wsprintfW(&_outputBuffer[2*j], L"%02X", _byteBuffer[j]);
-    
-    _outputBuffer[_size] = '\0';
+    for (DWORD j = 0; j < _size / 2; ++j)
+    {
+        _outputBuffer[2*j] = pbDigits[_byteBuffer[j] >> 4];
+        _outputBuffer[2*j + 1] = pbDigits[_byteBuffer[j] & 0x0F];
+    }
+
+    _outputBuffer[_size] = L'\0';
 
     return 0;
 }
@@ -0,0 +1,120 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * tt_cpu.h - target-architecture and cpu-detection for applications of the TermTools-Project.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _TT_CPU_H
+#define _TT_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define TT_ARCH_X86 1
+#else
+    #define TT_ARCH_X86 0
+#endif
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+    #define TT_ARCH_ARM64 1
+#else
+    #define TT_ARCH_ARM64 0
+#endif
+
+/*
+ * MSVC allows intrinsics of every instruction-set in any function,
+ * GCC and Clang need the target-isa per function.
+ */
+#if defined(_MSC_VER)
+    #define TT_TARGET(_isa)
+    #define TT_ALIGN(_n) __declspec(align(_n))
+#else
+    #define TT_TARGET(_isa) __attribute__((target(_isa)))
+    #define TT_ALIGN(_n) __attribute__((aligned(_n)))
+#endif
+
+#if TT_ARCH_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+
+// register-states in XCR0 the operating system has to save for AVX and AVX-512
+#define TT_XCR0_YMM 0x06
+#define TT_XCR0_ZMM 0xE6
+
+/*
+ * executes the cpuid-instruction for a given leaf/subleaf.
+ * 
+ * _IN:
+ *      _leaf: the value for EAX
+ *      _subleaf: the value for ECX
+ * 
+ * _OUT:
+ *      _regs: the resulting EAX, EBX, ECX and EDX
+ */
+static inline void cpuid(uint32_t _leaf, uint32_t _subleaf, uint32_t _regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)_leaf, (int)_subleaf);
+    for (int i = 0; i < 4; ++i) _regs[i] = (uint32_t)info[i];
+#else
+    __cpuid_count(_leaf, _subleaf, _regs[0], _regs[1], _regs[2], _regs[3]);
+#endif
+}
+
+/*
+ * reads the extended control register XCR0, which tells us which
+ * register-states the operating system saves on a context-switch.
+ * 
+ * _RETURNS: XCR0, 0 if the cpu or the operating system has no XSAVE (OSXSAVE)
+ */
+static inline uint64_t xgetbv0(void)
+{
+    uint32_t regs[4] = {0};
+    cpuid(1, 0, regs);
+    if (!((regs[2] >> 27) & 1)) return 0;
+
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif // TT_ARCH_X86
+
+#endif // _TT_CPU_H
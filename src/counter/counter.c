@@ -25,7 +25,7 @@
  * For more information, please refer to <https://unlicense.org>
  * -----------------------------------------------------------------------
  * 
- * counter - a simple line- and wordcounter for text-files.
+ * counter - a simple line-, word-, character- and bytecounter for text-files.
  * 
  * Author: Holger Dörner <holger.doerner@gmail.com>
  * 
@@ -35,12 +35,98 @@
 
 #include "termtools.h"
 #include "counter_version.h"
+#include "counter_scan.h"
 
-#define CLINES 0
-#define CWORDS 1
+// the counts selected on the command-line, in the order they are printed
+#define CLINES 0x01
+#define CWORDS 0x02
+#define CCHARS 0x04
+#define CBYTES 0x08
+#define CLONGEST 0x10
+#define CALL 0x1F
 
-short parseArgs(int, LPWSTR *, LPWSTR *);
-SIZE_T count(LPCWSTR, short);
+// number of different counts
+#define CMETRICS 5
+
+// width of a column if more than one count is printed
+#define COLUMN_WIDTH 12
+
+// size of one mapped view of the file, a multiple of the allocation granularity
+#define VIEW_SIZE (64 * 1024 * 1024)
+
+// size of one read from files that can not be mapped
+#define READ_SIZE (1024 * 1024)
+
+// smallest part of a file counted by a thread of /J
+#define MIN_CHUNK_SIZE (16 * 1024 * 1024)
+
+/*
+ * the count of one file, only the counts selected by metrics are updated.
+ */
+typedef struct COUNTS {
+    short metrics;          // CLINES, CWORDS, CCHARS, CBYTES and CLONGEST combined
+    TEXT_COUNT text;
+} COUNTS;
+
+/*
+ * the parts of a file counted by the threads of /J. every thread takes
+ * the next part until all are counted, the counts are joined in order
+ * when all threads are done.
+ */
+typedef struct CHUNK_JOB {
+    HANDLE hMapping;
+    LONG cChunks;
+    volatile LONG iNext;    // the next part to count
+    ULONGLONG *pOffsets;    // cChunks + 1 split-offsets, the last one is the size of the file
+    COUNTS *pCounts;        // count of every part
+    DWORD *pdwErrors;       // ERROR_SUCCESS or a win32 error-code of every part
+} CHUNK_JOB;
+
+/*
+ * the files of the command-line, with the wildcards expanded.
+ */
+typedef struct FILE_LIST {
+    LPWSTR *ppszNames;
+    SIZE_T cNames;
+    SIZE_T cCapacity;
+    bool bFailed;           // a pattern did not match any file
+} FILE_LIST;
+
+/*
+ * the files counted by the worker-pool of /J. every thread takes the
+ * next file until all are counted, the main-thread prints the results
+ * in command-line order as soon as they are available.
+ */
+typedef struct FILE_JOB {
+    const FILE_LIST *files;
+    short metrics;
+    volatile LONG iNext;    // the next file to count
+    ULONGLONG *pResults;    // CMETRICS counts of every file
+    DWORD *pdwErrors;       // ERROR_SUCCESS or a win32 error-code of every file
+    bool *pbDone;           // the file is counted
+    SRWLOCK lock;
+    CONDITION_VARIABLE cvDone;
+} FILE_JOB;
+
+short parseArgs(int, LPWSTR *, FILE_LIST *, SCAN_ENGINE *, DWORD *);
+bool addFile(FILE_LIST *, LPCWSTR, SIZE_T, LPCWSTR);
+bool expandPattern(FILE_LIST *, LPCWSTR);
+int compareNames(const void *, const void *);
+void freeFileList(FILE_LIST *);
+int countFiles(const FILE_LIST *, short, DWORD);
+void printCounts(short, const ULONGLONG *, LPCWSTR);
+DWORD WINAPI fileWorker(LPVOID);
+DWORD count(LPCWSTR, short, DWORD, ULONGLONG *);
+void initCounts(COUNTS *, short);
+void mergeCounts(COUNTS *, const COUNTS *);
+void scanSpan(COUNTS *, const BYTE *, SIZE_T);
+DWORD scanMapped(HANDLE, ULONGLONG, COUNTS *);
+DWORD scanParallel(HANDLE, ULONGLONG, DWORD, COUNTS *);
+DWORD WINAPI chunkWorker(LPVOID);
+DWORD findSplitOffset(HANDLE, ULONGLONG, ULONGLONG *);
+DWORD scanRange(HANDLE, ULONGLONG, ULONGLONG, COUNTS *);
+DWORD scanRead(HANDLE, COUNTS *);
+void printSystemError(LPCWSTR, DWORD);
 void usage(void);
 
 int wmain(int argc, LPWSTR *argv)
@@ -53,32 +139,45 @@ int wmain(int argc, LPWSTR *argv)
         exit(0);
     }
 
-    SIZE_T ret;
-    LPWSTR fileName;
+    FILE_LIST files = {0};
+    SCAN_ENGINE engine = SCAN_ENGINE_AUTO;
+    DWORD cThreads = 1;
+    short metrics = parseArgs(argc, argv, &files, &engine, &cThreads);
 
-    switch (parseArgs(argc, argv, &fileName))
+    switch (metrics)
     {
         case -1:
+            freeFileList(&files);
             exit(1);
-        case 1:
-            ret = count(fileName, CLINES);
-            break;
-        case 2:
-            ret = count(fileName, CWORDS);
-            break;
-        default:
+        case 0:
+            freeFileList(&files);
             usage();
             exit(0);
     }
 
-    wprintf(L"%zd\n", ret);
-    
-    return 0;
+    scanSelectEngine(engine);
+
+    int retCode = countFiles(&files, metrics, cThreads);
+
+    freeFileList(&files);
+
+    return retCode;
 }
 
-short parseArgs(int argc, LPWSTR *argv, LPWSTR *fileName)
+/*
+ * reads the command-line.
+ * 
+ * _OUT:
+ *      files: the files to count
+ *      engine: the engine selected by /ENGINE
+ *      cThreads: the number of threads selected by /J
+ * 
+ * _RETURNS: the selected counts (CLINES if none is selected), 0 for the
+ *           help or -1 on an error
+ */
+short parseArgs(int argc, LPWSTR *argv, FILE_LIST *files, SCAN_ENGINE *engine, DWORD *cThreads)
 {
-    int switchCount = 0;
+    short metrics = 0;
     short retCode = 1;
 
     for (int i = 1; i < argc; ++i)
@@ -90,10 +189,40 @@ short parseArgs(int argc, LPWSTR *argv, LPWSTR *fileName)
                 retCode = 0;
                 break;
             }
-            else if (_wcsicmp(argv[i], L"/w") == 0)
+            else if (_wcsicmp(argv[i], L"/L") == 0) metrics |= CLINES;
+            else if (_wcsicmp(argv[i], L"/W") == 0) metrics |= CWORDS;
+            else if (_wcsicmp(argv[i], L"/C") == 0) metrics |= CCHARS;
+            else if (_wcsicmp(argv[i], L"/B") == 0) metrics |= CBYTES;
+            else if (_wcsicmp(argv[i], L"/MAX") == 0) metrics |= CLONGEST;
+            else if (_wcsicmp(argv[i], L"/ALL") == 0) metrics |= CALL;
+            else if (_wcsnicmp(argv[i], L"/ENGINE:", 8) == 0)
+            {
+                LPCWSTR name = argv[i] + 8;
+
+                if (_wcsicmp(name, L"AUTO") == 0) *engine = SCAN_ENGINE_AUTO;
+                else if (_wcsicmp(name, L"SCALAR") == 0) *engine = SCAN_ENGINE_SCALAR;
+                else if (_wcsicmp(name, L"SSE2") == 0) *engine = SCAN_ENGINE_SSE2;
+                else if (_wcsicmp(name, L"AVX2") == 0) *engine = SCAN_ENGINE_AVX2;
+                else if (_wcsicmp(name, L"NEON") == 0) *engine = SCAN_ENGINE_NEON;
+                else
+                {
+                    wprintf(L"Unkown engine '%s'\n", name);
+                    return -1;
+                }
+            }
+            else if (_wcsicmp(argv[i], L"/J") == 0)
+                *cThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            else if (_wcsnicmp(argv[i], L"/J:", 3) == 0)
             {
-                ++switchCount;
-                retCode = 2;
+                long cRequested = wcstol(argv[i] + 3, NULL, 10);
+                if (cRequested < 0 || cRequested > 1024)
+                {
+                    wprintf(L"Invalid number of threads '%s'\n", argv[i]);
+                    return -1;
+                }
+
+                // 0 means one thread per logical processor
+                *cThreads = cRequested ? (DWORD)cRequested : GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
             }
             else
             {
@@ -101,74 +230,744 @@ short parseArgs(int argc, LPWSTR *argv, LPWSTR *fileName)
                 return -1;
             }
         }
-        else
+        else if (!expandPattern(files, argv[i]))
         {
-            *fileName = argv[i];
+            fwprintf_s(stderr, L"* ERROR: allocating memory for the file-names failed\n");
+            return -1;
         }
     }
 
-    if (switchCount > 1)
+    if (retCode > 0 && files->cNames == 0)
     {
+        // only patterns without a match, the errors are printed already
+        if (!files->bFailed) wprintf(L"No file given\n");
         retCode = -1;
     }
 
+    if (retCode > 0) retCode = metrics ? metrics : CLINES;
+
     return retCode;
 }
 
-SIZE_T count(LPCWSTR fileName, short mode)
+/*
+ * appends a file to the list.
+ * 
+ * _IN:
+ *      pszDir: the directory-part of the path, NULL if there is none
+ *      cchDir: the number of characters of pszDir
+ *      pszName: the name of the file
+ * 
+ * _IN_OUT:
+ *      files: the list
+ * 
+ * _RETURNS: false if there is not enough memory
+ */
+bool addFile(FILE_LIST *files, LPCWSTR pszDir, SIZE_T cchDir, LPCWSTR pszName)
 {
-    FILE *pFile;
-    if (_wfopen_s(&pFile, fileName, L"r"))
+    if (files->cNames == files->cCapacity)
     {
-        WCHAR errMsg[BUFSIZ];
-        _wcserror_s((WCHAR *)&errMsg, BUFSIZ, errno);
-        _fwprintf_p(stderr, L"* %s: %s\n", fileName, errMsg);
-        exit(1);
+        SIZE_T cCapacity = files->cCapacity ? files->cCapacity * 2 : 16;
+        LPWSTR *ppszNames = files->ppszNames
+            ? HeapReAlloc(GetProcessHeap(), 0, files->ppszNames, sizeof(LPWSTR) * cCapacity)
+            : HeapAlloc(GetProcessHeap(), 0, sizeof(LPWSTR) * cCapacity);
+        if (!ppszNames) return false;
+
+        files->ppszNames = ppszNames;
+        files->cCapacity = cCapacity;
     }
 
-    SIZE_T counter = 0;
-    LPCWSTR delimeter = L" \t\n";
-    LPWSTR tok, context;
+    SIZE_T cchName = wcslen(pszName);
+    LPWSTR pszPath = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * (cchDir + cchName + 1));
+    if (!pszPath) return false;
+
+    if (cchDir) wmemcpy(pszPath, pszDir, cchDir);
+    wmemcpy(pszPath + cchDir, pszName, cchName + 1);
 
-    WCHAR buffer[BUFSIZ];
-    while (fgetws(buffer, BUFSIZ-1, pFile))
+    files->ppszNames[files->cNames++] = pszPath;
+
+    return true;
+}
+
+/*
+ * adds the files of a command-line argument to the list.
+ * ---------------------------------------------------------
+ * an argument with the wildcards '*' or '?' in its last element is
+ * replaced by the matching files of its directory, sorted by name, so
+ * the order does not depend on the file-system. directories do not
+ * match. a pattern without a match is reported and skipped.
+ * ---------------------------------------------------------
+ * 
+ * _IN:
+ *      pszArg: the file or pattern
+ * 
+ * _IN_OUT:
+ *      files: the list
+ * 
+ * _RETURNS: false if there is not enough memory
+ */
+bool expandPattern(FILE_LIST *files, LPCWSTR pszArg)
+{
+    // the directory-part is kept in front of every match
+    SIZE_T cchDir = 0;
+    for (SIZE_T i = 0; pszArg[i]; ++i)
     {
-        if (isStringBlankW(buffer, BUFSIZ)) continue;
+        if (pszArg[i] == L'\\' || pszArg[i] == L'/' || pszArg[i] == L':') cchDir = i + 1;
+    }
 
-        if (mode == CLINES) ++counter;
-        else //if (mode == CWORDS)
+    // a '?' in the directory-part may be the prefix of a long path (\\?\)
+    if (!wcspbrk(pszArg + cchDir, L"*?")) return addFile(files, NULL, 0, pszArg);
+
+    SIZE_T iFirst = files->cNames;
+    bool bOk = true;
+
+    WIN32_FIND_DATAW data;
+    HANDLE hFind = FindFirstFileExW(pszArg, FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+                                    FIND_FIRST_EX_LARGE_FETCH);
+
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        do
         {
-            tok = wcstok_s(buffer, delimeter, &context);
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
 
-            while (tok)
-            {
-                ++counter;
-                tok = wcstok_s(NULL, delimeter, &context);
-            }
+            if (!(bOk = addFile(files, pszArg, cchDir, data.cFileName))) break;
+        } while (FindNextFileW(hFind, &data));
+
+        FindClose(hFind);
+    }
+
+    if (files->cNames == iFirst)
+    {
+        _fwprintf_p(stderr, L"* %s: no matching file\n", pszArg);
+        files->bFailed = true;
+    }
+    else
+        qsort(&files->ppszNames[iFirst], files->cNames - iFirst, sizeof(LPWSTR), compareNames);
+
+    return bOk;
+}
+
+int compareNames(const void *a, const void *b)
+{
+    return _wcsicmp(*(const LPCWSTR *)a, *(const LPCWSTR *)b);
+}
+
+void freeFileList(FILE_LIST *files)
+{
+    for (SIZE_T i = 0; i < files->cNames; ++i)
+        HeapFree(GetProcessHeap(), 0, files->ppszNames[i]);
+
+    if (files->ppszNames) HeapFree(GetProcessHeap(), 0, files->ppszNames);
+
+    files->ppszNames = NULL;
+    files->cNames = files->cCapacity = 0;
+}
+
+/*
+ * counts the files of the list and prints the results.
+ * ---------------------------------------------------------
+ * a single file is counted by the main-thread, with /J split into
+ * parts counted by several threads, and only its count is printed.
+ * 
+ * of several files the count and the name of each one are printed in
+ * command-line order, followed by the total of all of them. with /J
+ * the files are counted concurrently by a pool of threads, each file
+ * by one thread.
+ * 
+ * the total of the longest line is the longest line of all files.
+ * ---------------------------------------------------------
+ * 
+ * _IN:
+ *      files: the files
+ *      metrics: the selected counts
+ *      cThreads: number of threads
+ * 
+ * _RETURNS: the exit-code, 0 if all files were counted
+ */
+int countFiles(const FILE_LIST *files, short metrics, DWORD cThreads)
+{
+    ULONGLONG results[CMETRICS];
+    DWORD dwError;
+
+    if (files->cNames == 1 && !files->bFailed)
+    {
+        if ((dwError = count(files->ppszNames[0], metrics, cThreads, results)) != ERROR_SUCCESS)
+        {
+            printSystemError(files->ppszNames[0], dwError);
+            return 1;
+        }
+
+        printCounts(metrics, results, NULL);
+        return 0;
+    }
+
+    FILE_JOB job = {0};
+    job.files = files;
+    job.metrics = metrics;
+    job.pResults = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(ULONGLONG) * CMETRICS * files->cNames);
+    job.pdwErrors = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DWORD) * files->cNames);
+    job.pbDone = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(bool) * files->cNames);
+
+    if (cThreads > files->cNames) cThreads = (DWORD)files->cNames;
+    HANDLE *phThreads = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HANDLE) * (cThreads ? cThreads : 1));
+
+    if (!job.pResults || !job.pdwErrors || !job.pbDone || !phThreads)
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the worker-pool failed\n");
+        if (job.pResults) HeapFree(GetProcessHeap(), 0, job.pResults);
+        if (job.pdwErrors) HeapFree(GetProcessHeap(), 0, job.pdwErrors);
+        if (job.pbDone) HeapFree(GetProcessHeap(), 0, job.pbDone);
+        if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+        return 1;
+    }
+
+    InitializeSRWLock(&job.lock);
+    InitializeConditionVariable(&job.cvDone);
+
+    // a single thread counts in the main-thread, file by file
+    DWORD cStarted = 0;
+    if (cThreads > 1)
+    {
+        for (; cStarted < cThreads; ++cStarted)
+        {
+            if (! (phThreads[cStarted] = CreateThread(NULL, 0, fileWorker, &job, 0, NULL)))
+                break;
+        }
+    }
+
+    if (cStarted == 0) fileWorker(&job);
+
+    int retCode = files->bFailed ? 1 : 0;
+    ULONGLONG totals[CMETRICS] = {0};
+
+    // print the results in command-line order as soon as they are available
+    for (SIZE_T i = 0; i < files->cNames; ++i)
+    {
+        AcquireSRWLockExclusive(&job.lock);
+        while (!job.pbDone[i])
+            SleepConditionVariableSRW(&job.cvDone, &job.lock, INFINITE, 0);
+        ReleaseSRWLockExclusive(&job.lock);
+
+        if (job.pdwErrors[i] != ERROR_SUCCESS)
+        {
+            printSystemError(files->ppszNames[i], job.pdwErrors[i]);
+            retCode = 1;
+            continue;
+        }
+
+        const ULONGLONG *pValues = &job.pResults[i * CMETRICS];
+        for (int m = 0; m < CMETRICS; ++m)
+        {
+            if ((1 << m) != CLONGEST)
+                totals[m] += pValues[m];
+            else if (pValues[m] > totals[m])
+                totals[m] = pValues[m];
+        }
+
+        printCounts(metrics, pValues, files->ppszNames[i]);
+    }
+
+    printCounts(metrics, totals, L"total");
+
+    for (DWORD i = 0; i < cStarted; ++i)
+    {
+        WaitForSingleObject(phThreads[i], INFINITE);
+        CloseHandle(phThreads[i]);
+    }
+
+    HeapFree(GetProcessHeap(), 0, phThreads);
+    HeapFree(GetProcessHeap(), 0, job.pResults);
+    HeapFree(GetProcessHeap(), 0, job.pdwErrors);
+    HeapFree(GetProcessHeap(), 0, job.pbDone);
+
+    return retCode;
+}
+
+/*
+ * prints the selected counts of a file in the order of the CLINES ...
+ * CLONGEST bits. a single count is printed as it is, several counts in
+ * right-aligned columns of COLUMN_WIDTH characters.
+ * 
+ * _IN:
+ *      metrics: the selected counts
+ *      pValues: CMETRICS counts, indexed by the bit of the count
+ *      pszName: the name printed behind the counts, NULL for none
+ */
+void printCounts(short metrics, const ULONGLONG *pValues, LPCWSTR pszName)
+{
+    bool bColumns = (metrics & (metrics - 1)) != 0;
+    bool bFirst = true;
+
+    for (int m = 0; m < CMETRICS; ++m)
+    {
+        if (!(metrics & (1 << m))) continue;
+
+        if (bColumns)
+            wprintf(L"%s%*llu", bFirst ? L"" : L" ", COLUMN_WIDTH, pValues[m]);
+        else
+            wprintf(L"%llu", pValues[m]);
+
+        bFirst = false;
+    }
+
+    if (pszName) wprintf(L"  %s", pszName);
+    wprintf(L"\n");
+}
+
+/*
+ * thread of countFiles(), counts the files of a FILE_JOB.
+ */
+DWORD WINAPI fileWorker(LPVOID lpParam)
+{
+    FILE_JOB *job = lpParam;
+
+    for (;;)
+    {
+        LONG i = InterlockedIncrement(&job->iNext) - 1;
+        if ((SIZE_T)i >= job->files->cNames) break;
+
+        DWORD dwError = count(job->files->ppszNames[i], job->metrics, 1, &job->pResults[i * CMETRICS]);
+
+        AcquireSRWLockExclusive(&job->lock);
+        job->pdwErrors[i] = dwError;
+        job->pbDone[i] = true;
+        ReleaseSRWLockExclusive(&job->lock);
+
+        WakeAllConditionVariable(&job->cvDone);
+    }
+
+    return 0;
+}
+
+/*
+ * counts the lines, words, characters and bytes and the longest line of a file.
+ * ---------------------------------------------------------
+ * the bytes are counted as they are, by the vector-engines of
+ * counter_scan.c, without converting them to wide characters.
+ * files on disk are mapped view by view, pipes and devices are
+ * read in blocks. all selected counts are taken in a single pass,
+ * only the bytes of a file on disk are taken from its size.
+ * ---------------------------------------------------------
+ * 
+ * _IN:
+ *      fileName: the name/path of the file
+ *      metrics: the selected counts
+ *      cThreads: number of threads counting a large file on disk
+ * 
+ * _OUT:
+ *      pValues: CMETRICS counts, indexed by the bit of the count
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD count(LPCWSTR fileName, short metrics, DWORD cThreads, ULONGLONG *pValues)
+{
+    HANDLE hFile = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return GetLastError();
+
+    COUNTS counts;
+    initCounts(&counts, metrics);
+
+    LARGE_INTEGER cbFile;
+    DWORD dwError = ERROR_SUCCESS;
+
+    if (GetFileType(hFile) == FILE_TYPE_DISK && GetFileSizeEx(hFile, &cbFile))
+    {
+        // the bytes alone are the size of the file
+        if (metrics == CBYTES)
+            counts.text.cbBytes = (uint64_t)cbFile.QuadPart;
+        else if (cThreads > 1 && cbFile.QuadPart >= 2 * MIN_CHUNK_SIZE)
+            dwError = scanParallel(hFile, (ULONGLONG)cbFile.QuadPart, cThreads, &counts);
+        // an empty file can not be mapped
+        else if (cbFile.QuadPart > 0)
+            dwError = scanMapped(hFile, (ULONGLONG)cbFile.QuadPart, &counts);
+    }
+    else
+        dwError = scanRead(hFile, &counts);
+
+    CloseHandle(hFile);
+
+    if (dwError != ERROR_SUCCESS) return dwError;
+
+    pValues[0] = scanLinesFinal(&counts.text.lines);
+    pValues[1] = scanWordsFinal(&counts.text.words);
+    pValues[2] = counts.text.cChars;
+    pValues[3] = counts.text.cbBytes;
+    pValues[4] = scanLongestFinal(&counts.text.lengths);
+
+    return ERROR_SUCCESS;
+}
+
+void initCounts(COUNTS *counts, short metrics)
+{
+    counts->metrics = metrics;
+    scanTextInit(&counts->text);
+}
+
+/*
+ * joins the count of a part of a file to the count of the part right
+ * before it, see scanLinesMerge(), scanWordsMerge() and scanTextMerge().
+ */
+void mergeCounts(COUNTS *counts, const COUNTS *next)
+{
+    switch (counts->metrics)
+    {
+        case CLINES:
+            scanLinesMerge(&counts->text.lines, &next->text.lines);
+            break;
+        case CWORDS:
+            scanWordsMerge(&counts->text.words, &next->text.words);
+            break;
+        case CBYTES:
+            counts->text.cbBytes += next->text.cbBytes;
+            break;
+        default:
+            scanTextMerge(&counts->text, &next->text);
+    }
+}
+
+/*
+ * feeds the next span of a file to the scanner of the selected counts.
+ * a single count of lines or words uses its own scanner, all others
+ * are taken in one pass by scanText().
+ * 
+ * _IN:
+ *      pbData: the bytes
+ *      cbData: the number of bytes
+ * 
+ * _IN_OUT:
+ *      counts: the count of the file
+ */
+void scanSpan(COUNTS *counts, const BYTE *pbData, SIZE_T cbData)
+{
+    switch (counts->metrics)
+    {
+        case CLINES:
+            scanLines(&counts->text.lines, pbData, cbData);
+            break;
+        case CWORDS:
+            scanWords(&counts->text.words, pbData, cbData);
+            break;
+        case CBYTES:
+            counts->text.cbBytes += cbData;
+            break;
+        default:
+            scanText(&counts->text, pbData, cbData);
+    }
+}
+
+/*
+ * scans a file through mapped views of VIEW_SIZE bytes. files that can
+ * not be mapped are read instead.
+ * 
+ * _IN:
+ *      hFile: the file
+ *      cbFile: the size of the file in bytes
+ * 
+ * _IN_OUT:
+ *      counts: the count of the file
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD scanMapped(HANDLE hFile, ULONGLONG cbFile, COUNTS *counts)
+{
+    HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping) return scanRead(hFile, counts);
+
+    DWORD dwError = scanRange(hMapping, 0, cbFile, counts);
+
+    CloseHandle(hMapping);
+
+    return dwError;
+}
+
+/*
+ * counts a large file on disk with several threads (/J).
+ * ---------------------------------------------------------
+ * the file is split into parts of at least MIN_CHUNK_SIZE bytes, four
+ * per thread, so a thread that is done early takes on more of them.
+ * the parts are counted independently and joined in order, a line or
+ * a word going on from one part into the next is counted once.
+ * ---------------------------------------------------------
+ * 
+ * _IN:
+ *      hFile: the file
+ *      cbFile: the size of the file in bytes
+ *      cThreads: number of threads to count with
+ * 
+ * _IN_OUT:
+ *      counts: the count of the file
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD scanParallel(HANDLE hFile, ULONGLONG cbFile, DWORD cThreads, COUNTS *counts)
+{
+    HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping) return scanRead(hFile, counts);
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    // the parts start at a multiple of the allocation granularity, where views can be mapped
+    ULONGLONG cbChunk = cbFile / ((ULONGLONG)cThreads * 4);
+    if (cbChunk < MIN_CHUNK_SIZE) cbChunk = MIN_CHUNK_SIZE;
+    cbChunk += info.dwAllocationGranularity - 1;
+    cbChunk -= cbChunk % info.dwAllocationGranularity;
+
+    CHUNK_JOB job = {0};
+    job.hMapping = hMapping;
+    job.cChunks = (LONG)((cbFile + cbChunk - 1) / cbChunk);
+    job.pOffsets = HeapAlloc(GetProcessHeap(), 0, sizeof(ULONGLONG) * (job.cChunks + 1));
+    job.pCounts = HeapAlloc(GetProcessHeap(), 0, sizeof(COUNTS) * job.cChunks);
+    job.pdwErrors = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DWORD) * job.cChunks);
+    HANDLE *phThreads = HeapAlloc(GetProcessHeap(), 0, sizeof(HANDLE) * cThreads);
+
+    DWORD dwError = ERROR_SUCCESS;
+
+    if (!job.pOffsets || !job.pCounts || !job.pdwErrors || !phThreads)
+        dwError = ERROR_NOT_ENOUGH_MEMORY;
+
+    for (LONG i = 0; i <= job.cChunks && dwError == ERROR_SUCCESS; ++i)
+    {
+        job.pOffsets[i] = min(i * cbChunk, cbFile);
+
+        if (i > 0 && i < job.cChunks)
+            dwError = findSplitOffset(hMapping, cbFile, &job.pOffsets[i]);
+
+        if (i < job.cChunks) initCounts(&job.pCounts[i], counts->metrics);
+    }
+
+    if (dwError == ERROR_SUCCESS)
+    {
+        if (cThreads > (DWORD)job.cChunks) cThreads = (DWORD)job.cChunks;
+
+        DWORD cStarted = 0;
+        for (; cStarted < cThreads; ++cStarted)
+        {
+            if (! (phThreads[cStarted] = CreateThread(NULL, 0, chunkWorker, &job, 0, NULL)))
+                break;
         }
 
+        // without a worker the main-thread counts all parts
+        if (cStarted == 0) chunkWorker(&job);
 
+        for (DWORD i = 0; i < cStarted; ++i)
+        {
+            WaitForSingleObject(phThreads[i], INFINITE);
+            CloseHandle(phThreads[i]);
+        }
 
-        if (feof(pFile)) break;
+        for (LONG i = 0; i < job.cChunks && dwError == ERROR_SUCCESS; ++i)
+        {
+            dwError = job.pdwErrors[i];
+            mergeCounts(counts, &job.pCounts[i]);
+        }
     }
 
-    if (fclose(pFile))
+    if (job.pOffsets) HeapFree(GetProcessHeap(), 0, job.pOffsets);
+    if (job.pCounts) HeapFree(GetProcessHeap(), 0, job.pCounts);
+    if (job.pdwErrors) HeapFree(GetProcessHeap(), 0, job.pdwErrors);
+    if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+    CloseHandle(hMapping);
+
+    return dwError;
+}
+
+/*
+ * thread of scanParallel(), counts the parts of a CHUNK_JOB.
+ */
+DWORD WINAPI chunkWorker(LPVOID lpParam)
+{
+    CHUNK_JOB *job = lpParam;
+
+    for (;;)
+    {
+        LONG i = InterlockedIncrement(&job->iNext) - 1;
+        if (i >= job->cChunks) break;
+
+        job->pdwErrors[i] = scanRange(job->hMapping, job->pOffsets[i],
+                                        job->pOffsets[i+1] - job->pOffsets[i], &job->pCounts[i]);
+    }
+
+    return 0;
+}
+
+/*
+ * moves the offset a file is split at behind the end of a character,
+ * see scanSplitOffset().
+ * 
+ * _IN:
+ *      hMapping: the mapping of the file
+ *      cbFile: the size of the file in bytes
+ * 
+ * _IN_OUT:
+ *      pOffset: the offset to split the file at, a multiple of the
+ *              allocation granularity
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD findSplitOffset(HANDLE hMapping, ULONGLONG cbFile, ULONGLONG *pOffset)
+{
+    SIZE_T cbView = (SIZE_T)min(cbFile - *pOffset, 2);
+
+    const BYTE *pbView = MapViewOfFile(hMapping, FILE_MAP_READ, (DWORD)(*pOffset >> 32), (DWORD)*pOffset, cbView);
+    if (!pbView) return GetLastError();
+
+    DWORD dwError = ERROR_SUCCESS;
+
+    __try
     {
-        perror("* ERROR");
-        exit(1);
+        *pOffset += scanSplitOffset(pbView, cbView);
     }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        dwError = ERROR_READ_FAULT;
+    }
+
+    UnmapViewOfFile(pbView);
+
+    return dwError;
+}
+
+/*
+ * scans a range of a file through mapped views of VIEW_SIZE bytes.
+ * 
+ * _IN:
+ *      hMapping: the mapping of the file
+ *      offset: the first byte of the range
+ *      cbRange: the number of bytes in the range
+ * 
+ * _IN_OUT:
+ *      counts: the count of the range
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD scanRange(HANDLE hMapping, ULONGLONG offset, ULONGLONG cbRange, COUNTS *counts)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    // views have to start at a multiple of the allocation granularity, VIEW_SIZE is one
+    ULONGLONG end = offset + cbRange;
+    ULONGLONG viewOffset = offset - offset % info.dwAllocationGranularity;
+    DWORD dwError = ERROR_SUCCESS;
+
+    for (; viewOffset < end && dwError == ERROR_SUCCESS; viewOffset += VIEW_SIZE)
+    {
+        SIZE_T cbView = (SIZE_T)min(end - viewOffset, VIEW_SIZE);
+
+        const BYTE *pbView = MapViewOfFile(hMapping, FILE_MAP_READ, (DWORD)(viewOffset >> 32), (DWORD)viewOffset, cbView);
+        if (!pbView)
+        {
+            dwError = GetLastError();
+            break;
+        }
+
+        // the range may start inside of the first view
+        SIZE_T cbSkip = viewOffset < offset ? (SIZE_T)(offset - viewOffset) : 0;
+
+        __try
+        {
+            scanSpan(counts, pbView + cbSkip, cbView - cbSkip);
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            // I/O-error while accessing the mapped view
+            dwError = ERROR_READ_FAULT;
+        }
+
+        UnmapViewOfFile(pbView);
+    }
+
+    return dwError;
+}
+
+/*
+ * scans a file, a pipe or a device with reads of READ_SIZE bytes.
+ * 
+ * _IN:
+ *      hFile: the file
+ * 
+ * _IN_OUT:
+ *      counts: the count of the file
+ * 
+ * _RETURNS: ERROR_SUCCESS or a win32 error-code
+ */
+DWORD scanRead(HANDLE hFile, COUNTS *counts)
+{
+    PBYTE pbBuffer = HeapAlloc(GetProcessHeap(), 0, READ_SIZE);
+    if (!pbBuffer) return ERROR_NOT_ENOUGH_MEMORY;
+
+    DWORD dwError = ERROR_SUCCESS;
+    DWORD cbRead;
+
+    for (;;)
+    {
+        if (!ReadFile(hFile, pbBuffer, READ_SIZE, &cbRead, NULL))
+        {
+            // the writing end of a pipe was closed
+            dwError = GetLastError();
+            if (dwError == ERROR_BROKEN_PIPE) dwError = ERROR_SUCCESS;
+            break;
+        }
+
+        if (cbRead == 0) break;
+
+        scanSpan(counts, pbBuffer, cbRead);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pbBuffer);
+
+    return dwError;
+}
+
+/*
+ * prints the message of a win32 error-code to stderr.
+ * 
+ * _IN:
+ *      fileName: the name/path of the file the error belongs to
+ *      dwError: the error-code, as returned by GetLastError()
+ */
+void printSystemError(LPCWSTR fileName, DWORD dwError)
+{
+    WCHAR errMsg[BUFSIZ] = {0};
+
+    DWORD cchMsg = FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                                    NULL, dwError, 0, errMsg, BUFSIZ, NULL);
+
+    // system-messages end with a line-break
+    while (cchMsg > 0 && iswspace(errMsg[cchMsg-1]))
+        errMsg[--cchMsg] = L'\0';
+
+    if (cchMsg == 0)
+        swprintf_s(errMsg, BUFSIZ, L"error %lu", dwError);
 
-    return counter;
+    _fwprintf_p(stderr, L"* %s: %s\n", fileName, errMsg);
 }
 
 void usage()
 {
-    wprintf(L"counter - Counts Lines or Words\n");
+    wprintf(L"counter - Counts Lines, Words, Characters or Bytes\n");
     wprintf(L"\n");
     wprintf(L"Usage:\n");
-    wprintf(L"\tcounter.exe [/W] <filename>\n");
+    wprintf(L"\tcounter.exe [/L] [/W] [/C] [/B] [/MAX] [/ALL] [/J[:<n>]] [/ENGINE:<name>]\n");
+    wprintf(L"\t            <filename> [filenames ...]\n");
     wprintf(L"\n");
     wprintf(L"Parameter:\n");
-    wprintf(L"\t/W            = counts words instead of lines\n");
-    wprintf(L"\t<filename>    = path/name of the file to read\n");
+    wprintf(L"\t/L            = counts lines (default)\n");
+    wprintf(L"\t/W            = counts words\n");
+    wprintf(L"\t/C            = counts characters (UTF-8 code points)\n");
+    wprintf(L"\t/B            = counts bytes\n");
+    wprintf(L"\t/MAX          = length of the longest line, in characters\n");
+    wprintf(L"\t/ALL          = all of the above. the counts are combinable, several\n");
+    wprintf(L"\t                are printed in columns in this order\n");
+    wprintf(L"\t/J[:<n>]      = counts a large file, or several files at once, with <n>\n");
+    wprintf(L"\t                threads, one per logical processor if <n> is 0 or\n");
+    wprintf(L"\t                omitted\n");
+    wprintf(L"\t/ENGINE:<name>\n");
+    wprintf(L"\t              = engine counting the file: AUTO (default), SCALAR,\n");
+    wprintf(L"\t                SSE2, AVX2 or NEON\n");
+    wprintf(L"\t<filename>    = path/name of the file to read, wildcards (* and ?) are\n");
+    wprintf(L"\t                expanded. of several files every count is printed\n");
+    wprintf(L"\t                with the name, followed by the total\n");
 }
\ No newline at end of file
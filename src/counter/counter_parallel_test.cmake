@@ -0,0 +1,75 @@
+# counts a file of 48 MB + a few bytes with /J:2 and with a single thread,
+# all counts have to be the same and /ALL has to match the expected counts.
+#
+# /J splits the file into parts of 16 MB (MIN_CHUNK_SIZE), the boundaries
+# are placed across a word, across a line of white-space only and inside
+# of the UTF-8 white-space U+3000 (E3 80 80).
+#
+# run with: cmake -DCOUNTER=<counter.exe> -DTEST_FILE=<file> -P counter_parallel_test.cmake
+
+set(PART_SIZE 16777216)
+
+# 16 bytes, doubled up to the size of a part
+set(filler "lorem ipsum sit\n")
+foreach(i RANGE 1 20)
+    set(filler "${filler}${filler}")
+endforeach()
+
+# U+3000 is split behind its second byte
+set(ideographicSpace "　")
+string(SUBSTRING "${ideographicSpace}" 0 2 spaceStart)
+string(SUBSTRING "${ideographicSpace}" 2 1 spaceEnd)
+
+# the bytes in front of and behind every boundary
+set(tail1 "\nhal")
+set(head2 "f word\n")
+set(tail2 "\n  ")
+set(head3 "  \n\n")
+set(tail3 "\nword${spaceStart}")
+set(head4 "${spaceEnd}word\nend\n")
+
+function(writeFiller bytes)
+    string(SUBSTRING "${filler}" 0 ${bytes} part)
+    file(APPEND "${TEST_FILE}" "${part}")
+endfunction()
+
+string(LENGTH "${tail1}" cbTail1)
+string(LENGTH "${head2}" cbHead2)
+string(LENGTH "${tail2}" cbTail2)
+string(LENGTH "${head3}" cbHead3)
+string(LENGTH "${tail3}" cbTail3)
+
+file(WRITE "${TEST_FILE}" "")
+math(EXPR cbFiller "${PART_SIZE} - ${cbTail1}")
+writeFiller(${cbFiller})
+file(APPEND "${TEST_FILE}" "${tail1}${head2}")
+math(EXPR cbFiller "${PART_SIZE} - ${cbHead2} - ${cbTail2}")
+writeFiller(${cbFiller})
+file(APPEND "${TEST_FILE}" "${tail2}${head3}")
+math(EXPR cbFiller "${PART_SIZE} - ${cbHead3} - ${cbTail3}")
+writeFiller(${cbFiller})
+file(APPEND "${TEST_FILE}" "${tail3}${head4}")
+
+foreach(metrics "/L" "/W" "/ALL")
+    execute_process(COMMAND "${COUNTER}" ${metrics} "${TEST_FILE}"
+                    OUTPUT_VARIABLE single RESULT_VARIABLE singleResult)
+    execute_process(COMMAND "${COUNTER}" ${metrics} /J:2 "${TEST_FILE}"
+                    OUTPUT_VARIABLE parallel RESULT_VARIABLE parallelResult)
+
+    if(NOT singleResult EQUAL 0 OR NOT parallelResult EQUAL 0)
+        message(FATAL_ERROR "counter ${metrics} failed: ${singleResult}, /J:2: ${parallelResult}")
+    endif()
+
+    if(NOT single STREQUAL parallel)
+        message(FATAL_ERROR "counter ${metrics}: ${single}counter ${metrics} /J:2: ${parallel}")
+    endif()
+
+    message(STATUS "counter ${metrics}: ${single}")
+endforeach()
+
+# lines, words, characters, bytes and the longest line of the test-file
+if(NOT parallel MATCHES "^ *3145731 +9437184 +50331656 +50331658 +15[\r\n]*$")
+    message(FATAL_ERROR "counter /ALL /J:2: ${parallel}")
+endif()
+
+file(REMOVE "${TEST_FILE}")
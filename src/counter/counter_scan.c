@@ -0,0 +1,1351 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * counter_scan.c - vectorized scanners counting the lines, words and characters of raw bytes.
+ * 
+ * the bytes of a file are scanned as they are, without converting them
+ * to wide characters. every block of 64 bytes is turned into bit-masks
+ * by vector-compares, bit n for byte n of the block:
+ * 
+ *      scalar  - portable C, one byte at a time, also used for the tails
+ *      sse2    - four 16-byte compares per block
+ *      avx2    - two 32-byte compares per block
+ *      neon    - four 16-byte compares per block, the masks are built
+ *                with pairwise additions (ARM64 has no movemask)
+ * 
+ * the lines with a visible character are then counted with one
+ * addition and a popcount per block, see countLineEnds(). words are
+ * counted from the mask of the white-space characters, a word starts
+ * at every other character following a white-space, see
+ * countWordStarts(). the characters (UTF-8 code points) are the bytes
+ * that are no continuation-bytes, the longest line is found by counting
+ * them between the line-feeds. scanText() gets all counts out of one
+ * pass over the bytes. the fastest engine supported by the cpu is
+ * selected at runtime.
+ * 
+ * the scan works on UTF-8 and on every single-byte code-page: a byte
+ * above 0x20 (except DEL) is visible, bytes of multibyte characters are
+ * all above 0x7F and therefore visible as well. the multibyte white-spaces
+ * of UTF-8 are rare, they are looked up only in blocks holding one of
+ * their first bytes.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "counter_scan.h"
+#include "tt_cpu.h"
+
+#include <string.h>
+
+#if TT_ARCH_X86
+    #include <immintrin.h>
+#elif TT_ARCH_ARM64
+    #include <arm_neon.h>
+#endif
+
+// the scanners process blocks of this many bytes
+#define SCAN_BLOCK_SIZE 64
+
+typedef void (*SCAN_LINES_FN)(LINE_COUNT *, const uint8_t *, size_t);
+typedef void (*SCAN_WORDS_FN)(WORD_COUNT *, const uint8_t *, size_t);
+typedef void (*SCAN_TEXT_FN)(TEXT_COUNT *, const uint8_t *, size_t);
+
+static void scanLinesScalar(LINE_COUNT *, const uint8_t *, size_t);
+static void scanWordsScalar(WORD_COUNT *, const uint8_t *, size_t);
+static void scanLengthsScalar(LENGTH_COUNT *, const uint8_t *, size_t);
+static void scanTextScalar(TEXT_COUNT *, const uint8_t *, size_t);
+#if TT_ARCH_X86
+static void scanLinesSse2(LINE_COUNT *, const uint8_t *, size_t);
+static void scanLinesAvx2(LINE_COUNT *, const uint8_t *, size_t);
+static void scanWordsSse2(WORD_COUNT *, const uint8_t *, size_t);
+static void scanWordsAvx2(WORD_COUNT *, const uint8_t *, size_t);
+static void scanTextSse2(TEXT_COUNT *, const uint8_t *, size_t);
+static void scanTextAvx2(TEXT_COUNT *, const uint8_t *, size_t);
+#elif TT_ARCH_ARM64
+static void scanLinesNeon(LINE_COUNT *, const uint8_t *, size_t);
+static void scanWordsNeon(WORD_COUNT *, const uint8_t *, size_t);
+static void scanTextNeon(TEXT_COUNT *, const uint8_t *, size_t);
+#endif
+
+static SCAN_LINES_FN g_scanLines = NULL;
+static SCAN_WORDS_FN g_scanWords = NULL;
+static SCAN_TEXT_FN g_scanText = NULL;
+
+/*
+ * checks if the cpu supports an engine.
+ * 
+ * _IN:
+ *      _engine: the engine, not SCAN_ENGINE_AUTO
+ * 
+ * _RETURNS: true if the engine can be used
+ */
+static bool isEngineSupported(SCAN_ENGINE _engine)
+{
+    switch (_engine)
+    {
+        case SCAN_ENGINE_SCALAR:
+            return true;
+#if TT_ARCH_X86
+        case SCAN_ENGINE_SSE2:
+        {
+            uint32_t regs[4] = {0};
+            cpuid(1, 0, regs);
+            return (regs[3] >> 26) & 1;
+        }
+        case SCAN_ENGINE_AVX2:
+        {
+            uint32_t regs[4] = {0};
+            cpuid(0, 0, regs);
+            if (regs[0] < 7) return false;
+
+            // AVX needs the operating system to save the ymm-registers
+            cpuid(1, 0, regs);
+            bool avx = (regs[2] >> 28) & 1;
+            if (!avx || (xgetbv0() & TT_XCR0_YMM) != TT_XCR0_YMM) return false;
+
+            cpuid(7, 0, regs);
+            return (regs[1] >> 5) & 1;
+        }
+#elif TT_ARCH_ARM64
+        case SCAN_ENGINE_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+/*
+ * selects the engine used by scanLines(), scanWords() and scanText().
+ * 
+ * _IN:
+ *      _engine: the requested engine, SCAN_ENGINE_AUTO for the fastest one
+ * 
+ * _RETURNS: the selected engine, the fastest supported one if _engine
+ *          is not supported by the cpu
+ */
+SCAN_ENGINE scanSelectEngine(SCAN_ENGINE _engine)
+{
+    if (_engine == SCAN_ENGINE_AUTO || !isEngineSupported(_engine))
+    {
+        _engine = SCAN_ENGINE_SCALAR;
+
+        for (int e = SCAN_ENGINE_NEON; e > SCAN_ENGINE_SCALAR; --e)
+        {
+            if (isEngineSupported((SCAN_ENGINE)e))
+            {
+                _engine = (SCAN_ENGINE)e;
+                break;
+            }
+        }
+    }
+
+    switch (_engine)
+    {
+#if TT_ARCH_X86
+        case SCAN_ENGINE_SSE2:
+            g_scanLines = scanLinesSse2;
+            g_scanWords = scanWordsSse2;
+            g_scanText = scanTextSse2;
+            break;
+        case SCAN_ENGINE_AVX2:
+            g_scanLines = scanLinesAvx2;
+            g_scanWords = scanWordsAvx2;
+            g_scanText = scanTextAvx2;
+            break;
+#elif TT_ARCH_ARM64
+        case SCAN_ENGINE_NEON:
+            g_scanLines = scanLinesNeon;
+            g_scanWords = scanWordsNeon;
+            g_scanText = scanTextNeon;
+            break;
+#endif
+        default:
+            g_scanLines = scanLinesScalar;
+            g_scanWords = scanWordsScalar;
+            g_scanText = scanTextScalar;
+            break;
+    }
+
+    return _engine;
+}
+
+/*
+ * _RETURNS: the name of an engine, as accepted by /ENGINE
+ */
+const char *scanEngineName(SCAN_ENGINE _engine)
+{
+    switch (_engine)
+    {
+        case SCAN_ENGINE_SCALAR: return "SCALAR";
+        case SCAN_ENGINE_SSE2: return "SSE2";
+        case SCAN_ENGINE_AVX2: return "AVX2";
+        case SCAN_ENGINE_NEON: return "NEON";
+        default: return "AUTO";
+    }
+}
+
+void scanLinesInit(LINE_COUNT *_count)
+{
+    _count->cLines = 0;
+    _count->bVisible = false;
+    _count->bLineEnd = false;
+    _count->bHeadVisible = false;
+}
+
+/*
+ * counts the lines of a span of bytes. the spans of a file are fed in
+ * order, a line may go on from one span to the next.
+ * 
+ * _IN:
+ *      _data: the bytes
+ *      _cbData: the number of bytes
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ */
+void scanLines(LINE_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    if (!g_scanLines) scanSelectEngine(SCAN_ENGINE_AUTO);
+
+    if (!_count->bLineEnd)
+    {
+        // the first line is scanned up to its line-feed, for scanLinesMerge()
+        const uint8_t *pbLineEnd = memchr(_data, '\n', _cbData);
+        size_t cbHead = pbLineEnd ? (size_t)(pbLineEnd - _data) : _cbData;
+
+        g_scanLines(_count, _data, cbHead);
+        _count->bHeadVisible = _count->bVisible;
+        if (!pbLineEnd) return;
+
+        _count->bLineEnd = true;
+        _data += cbHead;
+        _cbData -= cbHead;
+    }
+
+    g_scanLines(_count, _data, _cbData);
+}
+
+/*
+ * _RETURNS: the number of lines, including a last line without a line-feed
+ */
+uint64_t scanLinesFinal(const LINE_COUNT *_count)
+{
+    return _count->cLines + (_count->bVisible ? 1 : 0);
+}
+
+/*
+ * joins the count of a part of a stream to the count of the part
+ * right before it.
+ * 
+ * _IN:
+ *      _next: the count of the following part
+ * 
+ * _IN_OUT:
+ *      _count: the count of the part before, the count of both parts
+ *              after the call
+ */
+void scanLinesMerge(LINE_COUNT *_count, const LINE_COUNT *_next)
+{
+    if (!_next->bLineEnd)
+    {
+        // the line of _count just goes on
+        _count->bVisible |= _next->bVisible;
+        if (!_count->bLineEnd) _count->bHeadVisible = _count->bVisible;
+        return;
+    }
+
+    // the first line-feed of _next ends the line of _count
+    _count->cLines += _next->cLines + (_count->bVisible && !_next->bHeadVisible ? 1 : 0);
+
+    if (!_count->bLineEnd)
+    {
+        _count->bHeadVisible = _count->bVisible || _next->bHeadVisible;
+        _count->bLineEnd = true;
+    }
+
+    _count->bVisible = _next->bVisible;
+}
+
+void scanWordsInit(WORD_COUNT *_count)
+{
+    _count->cWords = 0;
+    _count->bInWord = false;
+    _count->cbPrefix = 0;
+    _count->bHeadKnown = false;
+    _count->bHeadWord = false;
+}
+
+/*
+ * counts the words of a span of bytes. the spans of a file are fed in
+ * order, a word or a multibyte white-space may go on from one span to
+ * the next.
+ * 
+ * _IN:
+ *      _data: the bytes
+ *      _cbData: the number of bytes
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ */
+void scanWords(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    if (!g_scanWords) scanSelectEngine(SCAN_ENGINE_AUTO);
+
+    // the first character is scanned on its own, for scanWordsMerge()
+    while (_cbData > 0 && !_count->bHeadKnown)
+    {
+        scanWordsScalar(_count, _data++, 1);
+        --_cbData;
+
+        // a word was started by the first character, or it was a white-space
+        if (_count->cWords > 0 || _count->cbPrefix == 0)
+        {
+            _count->bHeadKnown = true;
+            _count->bHeadWord = _count->cWords > 0;
+        }
+    }
+
+    g_scanWords(_count, _data, _cbData);
+}
+
+/*
+ * _RETURNS: the number of words, including one started by the first
+ *          bytes of a multibyte character the stream ended in
+ */
+uint64_t scanWordsFinal(const WORD_COUNT *_count)
+{
+    return _count->cWords + (_count->cbPrefix > 0 && !_count->bInWord ? 1 : 0);
+}
+
+/*
+ * joins the count of a part of a stream to the count of the part
+ * right before it. the parts have to be split at an offset returned by
+ * scanSplitOffset(), so no multibyte white-space spans both of them.
+ * 
+ * _IN:
+ *      _next: the count of the following part
+ * 
+ * _IN_OUT:
+ *      _count: the count of the part before, the count of both parts
+ *              after the call
+ */
+void scanWordsMerge(WORD_COUNT *_count, const WORD_COUNT *_next)
+{
+    // an empty part
+    if (!_next->bHeadKnown && _next->cbPrefix == 0) return;
+
+    // the pending bytes of _count can not be completed by _next, they are part of a word
+    bool bInWord = _count->bInWord || _count->cbPrefix > 0;
+    _count->cWords = scanWordsFinal(_count);
+
+    if (!_count->bHeadKnown)
+    {
+        _count->bHeadKnown = bInWord || _next->bHeadKnown;
+        _count->bHeadWord = bInWord || _next->bHeadWord;
+    }
+
+    if (_next->bHeadKnown)
+    {
+        // a word going on into _next was counted by both
+        _count->cWords += _next->cWords - (bInWord && _next->bHeadWord ? 1 : 0);
+        _count->bInWord = _next->bInWord;
+    }
+    else
+        _count->bInWord = bInWord;
+
+    _count->cbPrefix = _next->cbPrefix;
+    _count->abPrefix[0] = _next->abPrefix[0];
+    _count->abPrefix[1] = _next->abPrefix[1];
+}
+
+/*
+ * finds an offset to split a stream at, for scanWordsMerge(). the last
+ * bytes of a multibyte white-space are UTF-8 continuation-bytes
+ * (0x80..0xBF), so a split in front of a byte that is none of them does
+ * not cut one in two. up to two of them are skipped.
+ * 
+ * _IN:
+ *      _data: the bytes at the desired split-offset
+ *      _cbData: the number of bytes available there
+ * 
+ * _RETURNS: the number of bytes to move the split-offset forward, 0..2
+ */
+size_t scanSplitOffset(const uint8_t *_data, size_t _cbData)
+{
+    size_t i = 0;
+
+    while (i < 2 && i < _cbData && (_data[i] & 0xC0) == 0x80)
+        ++i;
+
+    return i;
+}
+
+void scanTextInit(TEXT_COUNT *_count)
+{
+    scanLinesInit(&_count->lines);
+    scanWordsInit(&_count->words);
+    memset(&_count->lengths, 0, sizeof(LENGTH_COUNT));
+    _count->cChars = 0;
+    _count->cbBytes = 0;
+}
+
+/*
+ * counts the lines, words, characters and bytes and finds the longest
+ * line of a span of bytes, in one pass. the spans of a file are fed in
+ * order.
+ * 
+ * _IN:
+ *      _data: the bytes
+ *      _cbData: the number of bytes
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ */
+void scanText(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    if (!g_scanText) scanSelectEngine(SCAN_ENGINE_AUTO);
+
+    if (!_count->lengths.bLineEnd)
+    {
+        /*
+         * the first line is scanned by the single scanners, which keep
+         * it apart for the merges. its line-feed ends the first
+         * character as well, the engines go on from there.
+         */
+        const uint8_t *pbLineEnd = memchr(_data, '\n', _cbData);
+        size_t cbHead = pbLineEnd ? (size_t)(pbLineEnd - _data) + 1 : _cbData;
+
+        scanLines(&_count->lines, _data, cbHead);
+        scanWords(&_count->words, _data, cbHead);
+        scanLengthsScalar(&_count->lengths, _data, cbHead);
+
+        for (size_t i = 0; i < cbHead; ++i)
+            _count->cChars += (_data[i] & 0xC0) != 0x80;
+        _count->cbBytes += cbHead;
+
+        _data += cbHead;
+        _cbData -= cbHead;
+    }
+
+    g_scanText(_count, _data, _cbData);
+}
+
+/*
+ * _RETURNS: the length of the longest line, including a last line
+ *          without a line-feed
+ */
+uint64_t scanLongestFinal(const LENGTH_COUNT *_count)
+{
+    uint64_t cchLine = _count->cchLine - (_count->bCarriageReturn ? 1 : 0);
+
+    return cchLine > _count->cchLongest ? cchLine : _count->cchLongest;
+}
+
+/*
+ * joins the longest line of a part of a stream to the one of the part
+ * right before it, see scanLinesMerge().
+ */
+static void scanLengthsMerge(LENGTH_COUNT *_count, const LENGTH_COUNT *_next)
+{
+    // an empty part
+    if (!_next->bLineEnd && !_next->bHeadBytes) return;
+
+    if (!_next->bLineEnd)
+    {
+        // the line of _count just goes on
+        _count->cchLine += _next->cchLine;
+        _count->bCarriageReturn = _next->bCarriageReturn;
+        if (!_count->bLineEnd) _count->bHeadBytes = true;
+        return;
+    }
+
+    // the first line-feed of _next ends the line of _count
+    bool bCR = _next->bHeadBytes ? _next->bHeadCR : _count->bCarriageReturn;
+    uint64_t cchLine = _count->cchLine + _next->cchHead;
+
+    if (cchLine - (bCR ? 1 : 0) > _count->cchLongest) _count->cchLongest = cchLine - (bCR ? 1 : 0);
+    if (_next->cchLongest > _count->cchLongest) _count->cchLongest = _next->cchLongest;
+
+    if (!_count->bLineEnd)
+    {
+        _count->bLineEnd = true;
+        _count->bHeadBytes |= _next->bHeadBytes;
+        _count->bHeadCR = bCR;
+        _count->cchHead = cchLine;
+    }
+
+    _count->cchLine = _next->cchLine;
+    _count->bCarriageReturn = _next->bCarriageReturn;
+}
+
+/*
+ * joins the counts of a part of a stream to the counts of the part
+ * right before it. the parts have to be split at an offset returned by
+ * scanSplitOffset().
+ * 
+ * _IN:
+ *      _next: the counts of the following part
+ * 
+ * _IN_OUT:
+ *      _count: the counts of the part before, the counts of both parts
+ *              after the call
+ */
+void scanTextMerge(TEXT_COUNT *_count, const TEXT_COUNT *_next)
+{
+    scanLinesMerge(&_count->lines, &_next->lines);
+    scanWordsMerge(&_count->words, &_next->words);
+    scanLengthsMerge(&_count->lengths, &_next->lengths);
+    _count->cChars += _next->cChars;
+    _count->cbBytes += _next->cbBytes;
+}
+
+static inline bool isVisible(uint8_t _c)
+{
+    return _c > 0x20 && _c != 0x7F;
+}
+
+static inline unsigned popcount64(uint64_t _x)
+{
+    _x = _x - ((_x >> 1) & 0x5555555555555555ULL);
+    _x = (_x & 0x3333333333333333ULL) + ((_x >> 2) & 0x3333333333333333ULL);
+    _x = (_x + (_x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+    return (unsigned)((_x * 0x0101010101010101ULL) >> 56);
+}
+
+/*
+ * finds the line-feeds of a block that end a line with a visible character.
+ * -------------------------------------------------------------------------
+ * adding _visible to the inverted _newlines starts a carry at every
+ * visible character, which runs up to the next line-feed and sets it
+ * in the sum. a line-feed is only set if a carry reached it, so if its
+ * line has a visible character. a carry out of the block belongs to the
+ * line going on in the next block and is added there at bit 0.
+ * -------------------------------------------------------------------------
+ * 
+ * _IN:
+ *      _newlines: the line-feeds of the block, bit n for byte n
+ *      _visible: the visible characters of the block
+ * 
+ * _IN_OUT:
+ *      _pbCarry: in: the line going on has a visible character,
+ *              out: the same for the line going on in the next block
+ * 
+ * _RETURNS: the line-feeds ending a line with a visible character
+ */
+static inline uint64_t countLineEnds(uint64_t _newlines, uint64_t _visible, bool *_pbCarry)
+{
+    uint64_t others = ~_newlines;
+    uint64_t sum = others + _visible;
+    bool bCarry = sum < others;
+
+    uint64_t total = sum + (*_pbCarry ? 1 : 0);
+    bCarry |= total < sum;
+
+    *_pbCarry = bCarry;
+
+    return total & _newlines;
+}
+
+/*
+ * the white-spaces of ASCII: tab, line-feed, vertical tab, form-feed,
+ * carriage-return and space
+ */
+static inline bool isAsciiSpace(uint8_t _c)
+{
+    return _c == 0x20 || (uint8_t)(_c - 0x09) <= 0x04;
+}
+
+/*
+ * the first bytes of the multibyte white-spaces of UTF-8
+ */
+static inline bool isUtf8SpaceLead(uint8_t _c)
+{
+    return _c == 0xC2 || (uint8_t)(_c - 0xE1) <= 0x02;
+}
+
+/*
+ * matches the bytes of a character against the multibyte white-spaces
+ * of UTF-8, the characters of Unicode with the White_Space property:
+ * 
+ *      U+0085 (NEL), U+00A0 (NBSP)                 C2 85, C2 A0
+ *      U+1680 (OGHAM SPACE MARK)                   E1 9A 80
+ *      U+2000..U+200A (EN QUAD..HAIR SPACE)        E2 80 80..8A
+ *      U+2028, U+2029 (LINE/PARAGRAPH SEPARATOR)   E2 80 A8, E2 80 A9
+ *      U+202F (NARROW NBSP)                        E2 80 AF
+ *      U+205F (MEDIUM MATHEMATICAL SPACE)          E2 81 9F
+ *      U+3000 (IDEOGRAPHIC SPACE)                  E3 80 80
+ * 
+ * _IN:
+ *      _seq: the bytes, _seq[0] is one of isUtf8SpaceLead()
+ *      _cbSeq: the number of bytes available, at least 1
+ * 
+ * _RETURNS: the length of the white-space, 0 if it is none or -1 if
+ *          more bytes are needed to tell
+ */
+static int matchUtf8Space(const uint8_t *_seq, size_t _cbSeq)
+{
+    if (_cbSeq < 2) return -1;
+
+    if (_seq[0] == 0xC2) return (_seq[1] == 0x85 || _seq[1] == 0xA0) ? 2 : 0;
+
+    // all the others are three bytes long
+    bool bCandidate = (_seq[0] == 0xE1 && _seq[1] == 0x9A) ||
+                        (_seq[0] == 0xE2 && (_seq[1] == 0x80 || _seq[1] == 0x81)) ||
+                        (_seq[0] == 0xE3 && _seq[1] == 0x80);
+    if (!bCandidate) return 0;
+    if (_cbSeq < 3) return -1;
+
+    uint8_t c = _seq[2];
+    bool bSpace;
+
+    switch (_seq[0])
+    {
+        case 0xE2:
+            if (_seq[1] == 0x80)
+                bSpace = (c >= 0x80 && c <= 0x8A) || c == 0xA8 || c == 0xA9 || c == 0xAF;
+            else
+                bSpace = c == 0x9F;
+            break;
+        default:
+            // E1 9A 80 and E3 80 80
+            bSpace = c == 0x80;
+            break;
+    }
+
+    return bSpace ? 3 : 0;
+}
+
+/*
+ * counts the words starting in a block of 64 bytes.
+ * -------------------------------------------------------------------------
+ * the multibyte white-spaces are looked up at their first bytes and
+ * added to the mask. one of them at the end of the block is read on
+ * into the next block, so two more bytes have to follow the block. the
+ * bits of its last bytes are handed to the next block in _pSpill.
+ * 
+ * a word starts at every byte that is not a white-space and follows one,
+ * the last byte of the previous block is passed in _pbInWord.
+ * -------------------------------------------------------------------------
+ * 
+ * _IN:
+ *      _block: the bytes of the block
+ *      _spaces: the ASCII white-spaces of the block
+ *      _leads: the bytes of the block isUtf8SpaceLead() is true for
+ * 
+ * _IN_OUT:
+ *      _pSpill: in: white-space bytes at the start of the block,
+ *              out: the same for the next block
+ *      _pbInWord: in: the previous block ended in a word,
+ *              out: the same for the next block
+ * 
+ * _RETURNS: the number of words starting in the block
+ */
+static inline unsigned countWordStarts(const uint8_t *_block, uint64_t _spaces, uint64_t _leads,
+                                        uint64_t *_pSpill, bool *_pbInWord)
+{
+    _spaces |= *_pSpill;
+    *_pSpill = 0;
+
+    while (_leads)
+    {
+        // index of the lowest bit
+        unsigned pos = popcount64((_leads & (~_leads + 1)) - 1);
+        _leads &= _leads - 1;
+
+        int cbSpace = matchUtf8Space(&_block[pos], 3);
+        if (cbSpace <= 0) continue;
+
+        uint64_t bits = (1ULL << cbSpace) - 1;
+        _spaces |= bits << pos;
+
+        if (pos + cbSpace > SCAN_BLOCK_SIZE)
+            *_pSpill = bits >> (SCAN_BLOCK_SIZE - pos);
+    }
+
+    uint64_t words = ~_spaces;
+    uint64_t starts = words & ~((words << 1) | (*_pbInWord ? 1 : 0));
+
+    *_pbInWord = (words >> 63) != 0;
+
+    return popcount64(starts);
+}
+
+/*
+ * hands the state of the vector-loop of a word-scanner back to the count.
+ * 
+ * _IN:
+ *      _cWords: the words counted
+ *      _bInWord: the last block ended in a word
+ *      _spill: the white-space bytes at the start of the next block
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ * 
+ * _RETURNS: the number of white-space bytes at the start of the next
+ *          block, the scalar scanner has to skip them
+ */
+static inline size_t finishWordBlocks(WORD_COUNT *_count, uint64_t _cWords, bool _bInWord, uint64_t _spill)
+{
+    _count->cWords = _cWords;
+    _count->bInWord = _spill ? false : _bInWord;
+
+    return popcount64(_spill);
+}
+
+/*
+ * feeds the bytes completing a multibyte character, split by the end
+ * of the last span, to the scalar scanner. the vector-loops start with
+ * no pending bytes.
+ * 
+ * _RETURNS: the number of bytes fed
+ */
+static inline size_t finishWordPrefix(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    size_t i = 0;
+
+    while (i < _cbData && _count->cbPrefix > 0)
+        scanWordsScalar(_count, &_data[i++], 1);
+
+    return i;
+}
+
+/*
+ * ends a line in the search for the longest one.
+ * 
+ * _IN:
+ *      _bCR: the line-feed follows a carriage-return
+ * 
+ * _IN_OUT:
+ *      _count: the lengths of the stream
+ */
+static inline void endLine(LENGTH_COUNT *_count, bool _bCR)
+{
+    uint64_t cchLine = _count->cchLine - (_bCR ? 1 : 0);
+    if (cchLine > _count->cchLongest) _count->cchLongest = cchLine;
+
+    if (!_count->bLineEnd)
+    {
+        _count->bLineEnd = true;
+        _count->bHeadCR = _bCR;
+        _count->cchHead = _count->cchLine;
+    }
+
+    _count->cchLine = 0;
+    _count->bCarriageReturn = false;
+}
+
+/*
+ * measures the lines of a block of 64 bytes. the first line-feed of the
+ * stream is scanned already, see scanText().
+ * 
+ * _IN:
+ *      _block: the bytes of the block
+ *      _newlines: the line-feeds of the block
+ *      _chars: the bytes of the block that start a character
+ * 
+ * _IN_OUT:
+ *      _count: the lengths of the stream
+ */
+static inline void countLineLengths(LENGTH_COUNT *_count, const uint8_t *_block, uint64_t _newlines, uint64_t _chars)
+{
+    unsigned start = 0;
+
+    while (_newlines)
+    {
+        // index of the lowest bit
+        unsigned pos = popcount64((_newlines & (~_newlines + 1)) - 1);
+        _newlines &= _newlines - 1;
+
+        // the characters from the start of the line up to the line-feed
+        if (pos > start)
+            _count->cchLine += popcount64((_chars >> start) & (~0ULL >> (SCAN_BLOCK_SIZE - (pos - start))));
+
+        endLine(_count, pos > 0 ? _block[pos - 1] == '\r' : _count->bCarriageReturn);
+        start = pos + 1;
+    }
+
+    if (start < SCAN_BLOCK_SIZE)
+    {
+        _count->cchLine += popcount64(_chars >> start);
+        _count->bCarriageReturn = _block[SCAN_BLOCK_SIZE - 1] == '\r';
+    }
+}
+
+/*
+ * counts a block of 64 bytes in all the ways of scanText().
+ * 
+ * _IN:
+ *      _block: the bytes of the block
+ *      _newlines: the line-feeds of the block
+ *      _visible: the visible characters of the block
+ *      _spaces: the ASCII white-spaces of the block
+ *      _leads: the bytes of the block isUtf8SpaceLead() is true for
+ *      _chars: the bytes of the block that start a character
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ *      _pSpill: see countWordStarts()
+ */
+static inline void countTextBlock(TEXT_COUNT *_count, const uint8_t *_block, uint64_t _newlines, uint64_t _visible,
+                                    uint64_t _spaces, uint64_t _leads, uint64_t _chars, uint64_t *_pSpill)
+{
+    _count->lines.cLines += popcount64(countLineEnds(_newlines, _visible, &_count->lines.bVisible));
+    _count->words.cWords += countWordStarts(_block, _spaces, _leads, _pSpill, &_count->words.bInWord);
+    _count->cChars += popcount64(_chars);
+    countLineLengths(&_count->lengths, _block, _newlines, _chars);
+}
+
+static void scanLinesScalar(LINE_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    uint64_t cLines = _count->cLines;
+    bool bVisible = _count->bVisible;
+
+    for (size_t i = 0; i < _cbData; ++i)
+    {
+        if (_data[i] == '\n')
+        {
+            cLines += bVisible ? 1 : 0;
+            bVisible = false;
+        }
+        else if (isVisible(_data[i]))
+            bVisible = true;
+    }
+
+    _count->cLines = cLines;
+    _count->bVisible = bVisible;
+}
+
+static void scanWordsScalar(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    uint64_t cWords = _count->cWords;
+    bool bInWord = _count->bInWord;
+    size_t cbSeq = _count->cbPrefix;
+    uint8_t seq[3] = { _count->abPrefix[0], _count->abPrefix[1], 0 };
+
+    for (size_t i = 0; i < _cbData; ++i)
+    {
+        uint8_t c = _data[i];
+
+        if (cbSeq > 0)
+        {
+            seq[cbSeq] = c;
+
+            int cbSpace = matchUtf8Space(seq, cbSeq + 1);
+            if (cbSpace < 0)
+            {
+                ++cbSeq;
+                continue;
+            }
+
+            cbSeq = 0;
+
+            if (cbSpace > 0)
+            {
+                bInWord = false;
+                continue;
+            }
+
+            // the bytes before c are no white-space, c is looked at below
+            if (!bInWord) ++cWords;
+            bInWord = true;
+        }
+
+        if (isUtf8SpaceLead(c))
+        {
+            seq[0] = c;
+            cbSeq = 1;
+        }
+        else if (isAsciiSpace(c))
+            bInWord = false;
+        else
+        {
+            if (!bInWord) ++cWords;
+            bInWord = true;
+        }
+    }
+
+    _count->cWords = cWords;
+    _count->bInWord = bInWord;
+    _count->cbPrefix = (uint8_t)cbSeq;
+    _count->abPrefix[0] = seq[0];
+    _count->abPrefix[1] = seq[1];
+}
+
+static void scanLengthsScalar(LENGTH_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    for (size_t i = 0; i < _cbData; ++i)
+    {
+        uint8_t c = _data[i];
+
+        if (c == '\n')
+        {
+            endLine(_count, _count->bCarriageReturn);
+            continue;
+        }
+
+        if ((c & 0xC0) != 0x80) ++_count->cchLine;
+        _count->bCarriageReturn = c == '\r';
+        if (!_count->bLineEnd) _count->bHeadBytes = true;
+    }
+}
+
+/*
+ * scans the bytes after the vector-loop of a text-scanner.
+ * 
+ * _IN:
+ *      _data: the bytes
+ *      _cbData: the number of bytes
+ *      _cbSkipWords: the number of bytes at the start already counted
+ *              as a white-space, see finishWordBlocks()
+ * 
+ * _IN_OUT:
+ *      _count: the count of the stream
+ */
+static void scanTextTail(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData, size_t _cbSkipWords)
+{
+    scanLinesScalar(&_count->lines, _data, _cbData);
+    scanWordsScalar(&_count->words, _data + _cbSkipWords, _cbData - _cbSkipWords);
+    scanLengthsScalar(&_count->lengths, _data, _cbData);
+
+    for (size_t i = 0; i < _cbData; ++i)
+        _count->cChars += (_data[i] & 0xC0) != 0x80;
+    _count->cbBytes += _cbData;
+}
+
+static void scanTextScalar(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    scanTextTail(_count, _data, _cbData, 0);
+}
+
+#if TT_ARCH_X86
+TT_TARGET("sse2")
+static void scanLinesSse2(LINE_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i zero = _mm_setzero_si128();
+
+    uint64_t cLines = _count->cLines;
+    bool bCarry = _count->bVisible;
+    size_t i = 0;
+
+    for (; i + SCAN_BLOCK_SIZE <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint64_t newlines = 0, blanks = 0;
+
+        for (int j = 0; j < 4; ++j)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)&_data[i + j * 16]);
+
+            // the saturating subtraction leaves 0 for every byte up to 0x20
+            __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(_mm_subs_epu8(v, space), zero), _mm_cmpeq_epi8(v, del));
+
+            newlines |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (j * 16);
+            blanks |= (uint64_t)(uint32_t)_mm_movemask_epi8(blank) << (j * 16);
+        }
+
+        cLines += popcount64(countLineEnds(newlines, ~blanks, &bCarry));
+    }
+
+    _count->cLines = cLines;
+    _count->bVisible = bCarry;
+
+    scanLinesScalar(_count, &_data[i], _cbData - i);
+}
+
+TT_TARGET("sse2")
+static void scanWordsSse2(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i c2 = _mm_set1_epi8((char)0xC2);
+    const __m128i e1 = _mm_set1_epi8((char)0xE1);
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = finishWordPrefix(_count, _data, _cbData);
+
+    uint64_t cWords = _count->cWords;
+    bool bInWord = _count->bInWord;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint64_t spaces = 0, leads = 0;
+
+        for (int j = 0; j < 4; ++j)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)&_data[i + j * 16]);
+
+            // 0x09..0x0D, the saturating subtraction leaves 0 for all of them
+            __m128i ctrl = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, tab), four), zero);
+            __m128i lead = _mm_or_si128(_mm_cmpeq_epi8(v, c2),
+                                        _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, e1), two), zero));
+
+            spaces |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(v, space))) << (j * 16);
+            leads |= (uint64_t)(uint32_t)_mm_movemask_epi8(lead) << (j * 16);
+        }
+
+        cWords += countWordStarts(&_data[i], spaces, leads, &spill, &bInWord);
+    }
+
+    i += finishWordBlocks(_count, cWords, bInWord, spill);
+
+    scanWordsScalar(_count, &_data[i], _cbData - i);
+}
+
+TT_TARGET("sse2")
+static void scanTextSse2(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i c2 = _mm_set1_epi8((char)0xC2);
+    const __m128i e1 = _mm_set1_epi8((char)0xE1);
+    const __m128i cont = _mm_set1_epi8((char)0xC0);
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i zero = _mm_setzero_si128();
+
+    // the vector-loop starts with no pending bytes of a multibyte character
+    size_t i = 0;
+    while (i < _cbData && _count->words.cbPrefix > 0)
+        scanTextScalar(_count, &_data[i++], 1);
+
+    size_t iFirst = i;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint64_t newlines = 0, blanks = 0, spaces = 0, leads = 0, conts = 0;
+
+        for (int j = 0; j < 4; ++j)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)&_data[i + j * 16]);
+
+            __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(_mm_subs_epu8(v, space), zero), _mm_cmpeq_epi8(v, del));
+            __m128i ctrl = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, tab), four), zero);
+            __m128i lead = _mm_or_si128(_mm_cmpeq_epi8(v, c2),
+                                        _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(v, e1), two), zero));
+
+            newlines |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (j * 16);
+            blanks |= (uint64_t)(uint32_t)_mm_movemask_epi8(blank) << (j * 16);
+            spaces |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(v, space))) << (j * 16);
+            leads |= (uint64_t)(uint32_t)_mm_movemask_epi8(lead) << (j * 16);
+
+            // continuation-bytes are 0x80..0xBF, below 0xC0 as signed bytes
+            conts |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(v, cont)) << (j * 16);
+        }
+
+        countTextBlock(_count, &_data[i], newlines, ~blanks, spaces, leads, ~conts, &spill);
+    }
+
+    _count->cbBytes += i - iFirst;
+
+    size_t cbSkip = finishWordBlocks(&_count->words, _count->words.cWords, _count->words.bInWord, spill);
+
+    scanTextTail(_count, &_data[i], _cbData - i, cbSkip);
+}
+
+TT_TARGET("avx2")
+static void scanLinesAvx2(LINE_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    uint64_t cLines = _count->cLines;
+    bool bCarry = _count->bVisible;
+    size_t i = 0;
+
+    for (; i + SCAN_BLOCK_SIZE <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)&_data[i]);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)&_data[i + 32]);
+
+        __m256i blankLo = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(lo, space), zero), _mm256_cmpeq_epi8(lo, del));
+        __m256i blankHi = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(hi, space), zero), _mm256_cmpeq_epi8(hi, del));
+
+        uint64_t newlines = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)) |
+                            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+        uint64_t blanks = (uint64_t)(uint32_t)_mm256_movemask_epi8(blankLo) |
+                            (uint64_t)(uint32_t)_mm256_movemask_epi8(blankHi) << 32;
+
+        cLines += popcount64(countLineEnds(newlines, ~blanks, &bCarry));
+    }
+
+    _count->cLines = cLines;
+    _count->bVisible = bCarry;
+
+    scanLinesScalar(_count, &_data[i], _cbData - i);
+}
+TT_TARGET("avx2")
+static void scanWordsAvx2(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i tab = _mm256_set1_epi8(0x09);
+    const __m256i c2 = _mm256_set1_epi8((char)0xC2);
+    const __m256i e1 = _mm256_set1_epi8((char)0xE1);
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = finishWordPrefix(_count, _data, _cbData);
+
+    uint64_t cWords = _count->cWords;
+    bool bInWord = _count->bInWord;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint64_t spaces = 0, leads = 0;
+
+        for (int j = 0; j < 2; ++j)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)&_data[i + j * 32]);
+
+            // 0x09..0x0D, the saturating subtraction leaves 0 for all of them
+            __m256i ctrl = _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(v, tab), four), zero);
+            __m256i lead = _mm256_or_si256(_mm256_cmpeq_epi8(v, c2),
+                                            _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(v, e1), two), zero));
+
+            spaces |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, space))) << (j * 32);
+            leads |= (uint64_t)(uint32_t)_mm256_movemask_epi8(lead) << (j * 32);
+        }
+
+        cWords += countWordStarts(&_data[i], spaces, leads, &spill, &bInWord);
+    }
+
+    i += finishWordBlocks(_count, cWords, bInWord, spill);
+
+    scanWordsScalar(_count, &_data[i], _cbData - i);
+}
+TT_TARGET("avx2")
+static void scanTextAvx2(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i tab = _mm256_set1_epi8(0x09);
+    const __m256i c2 = _mm256_set1_epi8((char)0xC2);
+    const __m256i e1 = _mm256_set1_epi8((char)0xE1);
+    const __m256i cont = _mm256_set1_epi8((char)0xC0);
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i zero = _mm256_setzero_si256();
+
+    // the vector-loop starts with no pending bytes of a multibyte character
+    size_t i = 0;
+    while (i < _cbData && _count->words.cbPrefix > 0)
+        scanTextScalar(_count, &_data[i++], 1);
+
+    size_t iFirst = i;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint64_t newlines = 0, blanks = 0, spaces = 0, leads = 0, conts = 0;
+
+        for (int j = 0; j < 2; ++j)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)&_data[i + j * 32]);
+
+            __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(v, space), zero), _mm256_cmpeq_epi8(v, del));
+            __m256i ctrl = _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(v, tab), four), zero);
+            __m256i lead = _mm256_or_si256(_mm256_cmpeq_epi8(v, c2),
+                                            _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(v, e1), two), zero));
+
+            newlines |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)) << (j * 32);
+            blanks |= (uint64_t)(uint32_t)_mm256_movemask_epi8(blank) << (j * 32);
+            spaces |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, space))) << (j * 32);
+            leads |= (uint64_t)(uint32_t)_mm256_movemask_epi8(lead) << (j * 32);
+
+            // continuation-bytes are 0x80..0xBF, below 0xC0 as signed bytes
+            conts |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(cont, v)) << (j * 32);
+        }
+
+        countTextBlock(_count, &_data[i], newlines, ~blanks, spaces, leads, ~conts, &spill);
+    }
+
+    _count->cbBytes += i - iFirst;
+
+    size_t cbSkip = finishWordBlocks(&_count->words, _count->words.cWords, _count->words.bInWord, spill);
+
+    scanTextTail(_count, &_data[i], _cbData - i, cbSkip);
+}
+#elif TT_ARCH_ARM64
+/*
+ * packs the compare-results of 64 bytes into a bit-mask, bit n for
+ * byte n, by weighting the bytes and adding them up pairwise.
+ */
+static inline uint64_t neonMask(uint8x16_t _m0, uint8x16_t _m1, uint8x16_t _m2, uint8x16_t _m3)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t w = vld1q_u8(weights);
+
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(_m0, w), vandq_u8(_m1, w));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(_m2, w), vandq_u8(_m3, w));
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+static void scanLinesNeon(LINE_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t del = vdupq_n_u8(0x7F);
+
+    uint64_t cLines = _count->cLines;
+    bool bCarry = _count->bVisible;
+    size_t i = 0;
+
+    for (; i + SCAN_BLOCK_SIZE <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint8x16_t v0 = vld1q_u8(&_data[i]);
+        uint8x16_t v1 = vld1q_u8(&_data[i + 16]);
+        uint8x16_t v2 = vld1q_u8(&_data[i + 32]);
+        uint8x16_t v3 = vld1q_u8(&_data[i + 48]);
+
+        uint64_t newlines = neonMask(vceqq_u8(v0, newline), vceqq_u8(v1, newline),
+                                    vceqq_u8(v2, newline), vceqq_u8(v3, newline));
+        uint64_t visible = neonMask(vbicq_u8(vcgtq_u8(v0, space), vceqq_u8(v0, del)),
+                                    vbicq_u8(vcgtq_u8(v1, space), vceqq_u8(v1, del)),
+                                    vbicq_u8(vcgtq_u8(v2, space), vceqq_u8(v2, del)),
+                                    vbicq_u8(vcgtq_u8(v3, space), vceqq_u8(v3, del)));
+
+        cLines += popcount64(countLineEnds(newlines, visible, &bCarry));
+    }
+
+    _count->cLines = cLines;
+    _count->bVisible = bCarry;
+
+    scanLinesScalar(_count, &_data[i], _cbData - i);
+}
+
+static void scanWordsNeon(WORD_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t tab = vdupq_n_u8(0x09);
+    const uint8x16_t c2 = vdupq_n_u8(0xC2);
+    const uint8x16_t e1 = vdupq_n_u8(0xE1);
+    const uint8x16_t four = vdupq_n_u8(4);
+    const uint8x16_t two = vdupq_n_u8(2);
+
+    size_t i = finishWordPrefix(_count, _data, _cbData);
+
+    uint64_t cWords = _count->cWords;
+    bool bInWord = _count->bInWord;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint8x16_t spaces[4], leads[4];
+
+        for (int j = 0; j < 4; ++j)
+        {
+            uint8x16_t v = vld1q_u8(&_data[i + j * 16]);
+
+            // 0x09..0x0D, the wrapping subtraction moves all others above 4
+            spaces[j] = vorrq_u8(vceqq_u8(v, space), vcleq_u8(vsubq_u8(v, tab), four));
+            leads[j] = vorrq_u8(vceqq_u8(v, c2), vcleq_u8(vsubq_u8(v, e1), two));
+        }
+
+        cWords += countWordStarts(&_data[i],
+                                    neonMask(spaces[0], spaces[1], spaces[2], spaces[3]),
+                                    neonMask(leads[0], leads[1], leads[2], leads[3]),
+                                    &spill, &bInWord);
+    }
+
+    i += finishWordBlocks(_count, cWords, bInWord, spill);
+
+    scanWordsScalar(_count, &_data[i], _cbData - i);
+}
+
+static void scanTextNeon(TEXT_COUNT *_count, const uint8_t *_data, size_t _cbData)
+{
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t del = vdupq_n_u8(0x7F);
+    const uint8x16_t tab = vdupq_n_u8(0x09);
+    const uint8x16_t c2 = vdupq_n_u8(0xC2);
+    const uint8x16_t e1 = vdupq_n_u8(0xE1);
+    const int8x16_t cont = vdupq_n_s8(-64);
+    const uint8x16_t four = vdupq_n_u8(4);
+    const uint8x16_t two = vdupq_n_u8(2);
+
+    // the vector-loop starts with no pending bytes of a multibyte character
+    size_t i = 0;
+    while (i < _cbData && _count->words.cbPrefix > 0)
+        scanTextScalar(_count, &_data[i++], 1);
+
+    size_t iFirst = i;
+    uint64_t spill = 0;
+
+    for (; i + SCAN_BLOCK_SIZE + 2 <= _cbData; i += SCAN_BLOCK_SIZE)
+    {
+        uint8x16_t newlines[4], visible[4], spaces[4], leads[4], chars[4];
+
+        for (int j = 0; j < 4; ++j)
+        {
+            uint8x16_t v = vld1q_u8(&_data[i + j * 16]);
+
+            newlines[j] = vceqq_u8(v, newline);
+            visible[j] = vbicq_u8(vcgtq_u8(v, space), vceqq_u8(v, del));
+            spaces[j] = vorrq_u8(vceqq_u8(v, space), vcleq_u8(vsubq_u8(v, tab), four));
+            leads[j] = vorrq_u8(vceqq_u8(v, c2), vcleq_u8(vsubq_u8(v, e1), two));
+
+            // continuation-bytes are 0x80..0xBF, below 0xC0 as signed bytes
+            chars[j] = vcgeq_s8(vreinterpretq_s8_u8(v), cont);
+        }
+
+        countTextBlock(_count, &_data[i],
+                        neonMask(newlines[0], newlines[1], newlines[2], newlines[3]),
+                        neonMask(visible[0], visible[1], visible[2], visible[3]),
+                        neonMask(spaces[0], spaces[1], spaces[2], spaces[3]),
+                        neonMask(leads[0], leads[1], leads[2], leads[3]),
+                        neonMask(chars[0], chars[1], chars[2], chars[3]),
+                        &spill);
+    }
+
+    _count->cbBytes += i - iFirst;
+
+    size_t cbSkip = finishWordBlocks(&_count->words, _count->words.cWords, _count->words.bInWord, spill);
+
+    scanTextTail(_count, &_data[i], _cbData - i, cbSkip);
+}
+#endif
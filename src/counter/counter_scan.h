@@ -0,0 +1,135 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * counter_scan.h - vectorized scanners counting the lines, words and characters of raw bytes.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _COUNTER_SCAN_H
+#define _COUNTER_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * implementations of the scanner, from slowest to fastest.
+ * SCAN_ENGINE_AUTO picks the fastest one supported by the cpu.
+ */
+typedef enum SCAN_ENGINE {
+    SCAN_ENGINE_AUTO = 0,
+    SCAN_ENGINE_SCALAR,
+    SCAN_ENGINE_SSE2,
+    SCAN_ENGINE_AVX2,
+    SCAN_ENGINE_NEON
+} SCAN_ENGINE;
+
+/*
+ * the count of a stream of bytes, fed in any number of spans. a line
+ * counts if it holds at least one visible character, like the counter
+ * always did: blank lines and lines of white-space only are skipped.
+ * 
+ * the counts of consecutive parts of a stream are joined with
+ * scanLinesMerge(), for that the first line of every part is kept
+ * apart: its line-feed is counted only if the part before does not
+ * end in a visible character already.
+ */
+typedef struct LINE_COUNT {
+    uint64_t cLines;        // completed lines with a visible character
+    bool bVisible;          // the line being scanned has a visible character
+    bool bLineEnd;          // a line-feed was scanned
+    bool bHeadVisible;      // the first line has a visible character
+} LINE_COUNT;
+
+/*
+ * the word count of a stream of bytes, fed in any number of spans. words
+ * are separated by the white-space characters of Unicode, ASCII ones and
+ * UTF-8 encoded ones. a UTF-8 white-space split by the end of a span is
+ * kept in abPrefix until the next span completes it.
+ * 
+ * the counts of consecutive parts of a stream are joined with
+ * scanWordsMerge(), a word going on from one part into the next is
+ * counted once. the parts have to be split in front of a byte that is
+ * no UTF-8 continuation-byte, see scanSplitOffset().
+ */
+typedef struct WORD_COUNT {
+    uint64_t cWords;        // words started so far
+    bool bInWord;           // the last character was not a white-space
+    uint8_t cbPrefix;       // number of bytes in abPrefix
+    uint8_t abPrefix[2];    // start of a multibyte white-space, or not
+    bool bHeadKnown;        // the first character was scanned
+    bool bHeadWord;         // the first character was not a white-space
+} WORD_COUNT;
+
+/*
+ * the length of the longest line of a stream, in UTF-8 code points
+ * without the line-break (a carriage-return in front of the line-feed
+ * is part of the line-break). the first line of every part of a stream
+ * is kept apart for scanLengthsMerge(), like in LINE_COUNT.
+ */
+typedef struct LENGTH_COUNT {
+    uint64_t cchLongest;    // the longest completed line
+    uint64_t cchLine;       // code points of the line being scanned, with a carriage-return
+    bool bCarriageReturn;   // the last byte was a carriage-return
+    bool bLineEnd;          // a line-feed was scanned
+    bool bHeadBytes;        // bytes were scanned before the first line-feed
+    bool bHeadCR;           // the first line-feed follows a carriage-return
+    uint64_t cchHead;       // code points of the first line, with a carriage-return
+} LENGTH_COUNT;
+
+/*
+ * all counts of a stream, scanned in a single pass by scanText().
+ */
+typedef struct TEXT_COUNT {
+    LINE_COUNT lines;
+    WORD_COUNT words;
+    LENGTH_COUNT lengths;
+    uint64_t cChars;        // UTF-8 code points, all bytes that are no continuation-byte
+    uint64_t cbBytes;
+} TEXT_COUNT;
+
+SCAN_ENGINE scanSelectEngine(SCAN_ENGINE);
+const char *scanEngineName(SCAN_ENGINE);
+void scanLinesInit(LINE_COUNT *);
+void scanLines(LINE_COUNT *, const uint8_t *, size_t);
+uint64_t scanLinesFinal(const LINE_COUNT *);
+void scanLinesMerge(LINE_COUNT *, const LINE_COUNT *);
+void scanWordsInit(WORD_COUNT *);
+void scanWords(WORD_COUNT *, const uint8_t *, size_t);
+uint64_t scanWordsFinal(const WORD_COUNT *);
+void scanWordsMerge(WORD_COUNT *, const WORD_COUNT *);
+size_t scanSplitOffset(const uint8_t *, size_t);
+void scanTextInit(TEXT_COUNT *);
+void scanText(TEXT_COUNT *, const uint8_t *, size_t);
+uint64_t scanLongestFinal(const LENGTH_COUNT *);
+void scanTextMerge(TEXT_COUNT *, const TEXT_COUNT *);
+
+#endif // _COUNTER_SCAN_H
\ No newline at end of file
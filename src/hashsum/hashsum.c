@@ -34,37 +34,223 @@
  */
 
 #include "hashsum_version.h"
+#include "hashsum_hash.h"
 #include "termtools.h"
+#include "hashsum_reader.h"
+#include "hashsum_cache.h"
+#include "hashsum_manifest.h"
+#include "hashsum_walk.h"
+#include "hashsum_merkle.h"
+#include "hashsum_dupes.h"
+#include "hashsum_resume.h"
+#include "hashsum_stats.h"
+#include "hashsum_output.h"
 
-#include <bcrypt.h>
-
-#pragma comment(lib, "bcrypt.lib")
-
-#define STATUS_SUCCESSFUL 0x00000000L
-#define STATUS_UNSUCCESSFUL 0xC0000001L
 #define MODE_NORMAL 0
 #define MODE_CHECK 1
 
+// smaller spans are not worth waking the helper-threads of /SPLIT
+#define FANOUT_THRESHOLD (256 * 1024)
+
+/*
+ * files up to this size are read whole and hashed with the multi-buffer
+ * SHA256-engine, a group of them is read into the block-buffer of the
+ * reader at once.
+ */
+#define SMALL_FILE_THRESHOLD (64 * 1024)
+#define SMALL_FILE_GROUP 64
+
+#if SMALL_FILE_THRESHOLD * SMALL_FILE_GROUP > READER_BLOCK_SIZE * READER_QUEUE_DEPTH
+    #error "a group of small files does not fit into the read-buffer"
+#endif
+
+// megabytes of synthetic data hashed per measurement of /BENCH
+#define BENCH_DEFAULT_SIZE 64
+#define BENCH_MAX_SIZE 4096
+
+// the spans /BENCH feeds into the hashes, the columns of its matrix
+#define BENCH_BLOCK_SIZES 4
+static const DWORD BENCH_BLOCKS[BENCH_BLOCK_SIZES] = { 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+
+// one row per algorithm and engine
+#define BENCH_MAX_RESULTS 32
+
+/*
+ * the state of one in-tree engine in a checkpoint of /RESUME. the
+ * engines keep no pointers, so the state can be copied as it is.
+ */
+typedef struct SAVED_HASH {
+    NATIVE_ALG nativeAlg;
+    NATIVE_HASH native;
+} SAVED_HASH;
+
+struct HASH_FANOUT;
+
 typedef struct SETTINGS {
-    BCRYPT_ALG_HANDLE hAlg;
-    BCRYPT_HASH_HANDLE hHash;
-    LPCWSTR pszAlgId;
-    DWORD cbData;
-    DWORD cbHash;
-    DWORD cbHashObject;
-    PBYTE pbHashObject;
-    PBYTE pbHash;
+    HASH_STATE hashes[MAX_HASHES];
+    SIZE_T cHashes;
     NTSTATUS status;
     short mode;
+    SHA_ENGINE engine;
+    DWORD cThreads;
+    bool bSplit;
+    READER_MODE ioMode;
+    FILE_READER reader;
+    struct HASH_FANOUT *pFanout;
+    LPCWSTR pszCacheFile;
+    DIGEST_CACHE *pCache;
+    bool bRecursive;
+    WALK_FILTER filter;
+    bool bMerkle;
+    bool bDupes;
+    LPCWSTR pszResumeFile;
+    RESUME_STATE *pResume;
+    bool bStats;
+    bool bJson;
+    FILE_STATS fileStats;   // of the file hashed last with these settings
+    RUN_STATS run;
+    SIZE_T cbBench;         // bytes per measurement of /BENCH, 0 without it
 } SETTINGS;
 
+/*
+ * one row of the matrix of /BENCH, a throughput below 0 marks a
+ * block-size the engine does not hash.
+ */
+typedef struct BENCH_RESULT {
+    LPCWSTR pszAlgId;
+    char szEngine[16];
+    double pGBs[BENCH_BLOCK_SIZES];
+    double pCyclesPerByte[BENCH_BLOCK_SIZES];
+} BENCH_RESULT;
+
+/*
+ * shared state of the worker-pool used by calculateFilehashBatch().
+ */
+typedef struct HASH_BATCH {
+    const SETTINGS *pSettings;
+    LPWSTR *pvFileNames;
+    LPWSTR *pvOutput;
+    bool *pbDone;
+    FILE_STATS *pStats;     // NULL without /STATS
+    SIZE_T cvFileNames;
+    SIZE_T cGroup;
+    DWORD cTreeThreads;
+    volatile LONG nNext;
+    SRWLOCK lock;
+    CONDITION_VARIABLE cvDone;
+} HASH_BATCH;
+
+// result of one line of a hash-file, VERIFY_PENDING until it is verified
+typedef enum VERIFY_RESULT {
+    VERIFY_PENDING = 0,
+    VERIFY_OK,
+    VERIFY_FAILED,
+    VERIFY_MISSING,
+    VERIFY_BAD_LINE,    // the tag names no supported algorithm
+    VERIFY_UNKNOWN      // the algorithm could not be determined
+} VERIFY_RESULT;
+
+/*
+ * the state of one thread verifying hash-files. the hash-object of
+ * an algorithm is created the first time the thread needs it and
+ * kept until all hash-files are verified.
+ */
+typedef struct VERIFY_CONTEXT {
+    const SETTINGS *pShared;
+    SETTINGS settings;
+    HASH_STATE states[MAX_HASHES];
+    DWORD cTreeThreads;
+    bool bReady;
+} VERIFY_CONTEXT;
+
+/*
+ * shared state of the worker-pool used by checkHashValues(). the
+ * workers stay alive for all hash-files, the main-thread hands them
+ * one batch of entries at a time.
+ */
+typedef struct VERIFY_POOL {
+    const SETTINGS *pSettings;
+    MANIFEST_ENTRY *pEntries;
+    SIZE_T *pAlgIndex;
+    VERIFY_RESULT *pResults;
+    SIZE_T cEntries;
+    SIZE_T nNext;
+    DWORD cTreeThreads;
+    bool bQuit;
+    SRWLOCK lock;
+    CONDITION_VARIABLE cvWork;
+    CONDITION_VARIABLE cvDone;
+} VERIFY_POOL;
+
+/*
+ * one helper-thread of a HASH_FANOUT and the algorithm it calculates.
+ */
+typedef struct FANOUT_LANE {
+    struct HASH_FANOUT *pFanout;
+    HASH_STATE *pState;
+    HANDLE hThread;
+    NTSTATUS status;
+    bool bFault;
+} FANOUT_LANE;
+
+/*
+ * hashes every span of a file with all algorithms at once (/SPLIT).
+ * the calling thread calculates the first algorithm, every other
+ * algorithm has its own helper-thread. the threads meet at the
+ * barrier before and after each span.
+ */
+typedef struct HASH_FANOUT {
+    FANOUT_LANE *pLanes;
+    SIZE_T cLanes;
+    SYNCHRONIZATION_BARRIER barrier;
+    const BYTE *pbData;
+    DWORD cbData;
+    bool bQuit;
+} HASH_FANOUT;
+
+
 int parseArgs(SETTINGS *, LPWSTR **, SIZE_T *, SIZE_T, LPWSTR *);
+bool addAlgorithm(SETTINGS *, LPCWSTR);
 NTSTATUS initializeCryptoAPI(SETTINGS *);
-void checkHashValues(SETTINGS *, LPWSTR *, SIZE_T);
-SIZE_T readHashFile(LPWSTR **, LPWSTR **, LPWSTR);
-LPWSTR *calculateFilehashBatch(SETTINGS *, LPWSTR *, SIZE_T);
+bool checkHashValues(SETTINGS *, LPWSTR *, SIZE_T);
+VERIFY_RESULT resolveEntry(SETTINGS *, const MANIFEST_ENTRY *, SIZE_T *);
+bool initVerifyContext(VERIFY_CONTEXT *, const SETTINGS *, DWORD);
+VERIFY_RESULT verifyEntry(VERIFY_CONTEXT *, const MANIFEST_ENTRY *, SIZE_T);
+void freeVerifyContext(VERIFY_CONTEXT *);
+DWORD WINAPI verifyWorker(LPVOID);
+void printVerifyResult(LPCWSTR, const MANIFEST_ENTRY *, VERIFY_RESULT);
+bool writeMerkleManifest(SETTINGS *, LPWSTR *, SIZE_T);
+bool checkMerkleManifest(SETTINGS *, LPWSTR *, SIZE_T);
+bool walkMerkleTree(SETTINGS *, LPCWSTR, TREE_WALK *, MERKLE_FILE **);
+bool hashMerkleFiles(SETTINGS *, MERKLE_FILE **, SIZE_T);
+void printMerkleEntry(void *, LPCWSTR, SIZE_T, const BYTE *, const MERKLE_FILE *);
+bool findDuplicates(SETTINGS *, LPWSTR *, SIZE_T);
+bool runBenchmark(SETTINGS *);
+const char *selectBenchEngine(NATIVE_ALG, int);
+bool benchAlgorithm(LPCWSTR, const BYTE *, SIZE_T, BENCH_RESULT *, SIZE_T *);
+bool benchMemory(HASH_STATE *, const BYTE *, SIZE_T, DWORD, BENCH_RESULT *, SIZE_T);
+bool benchMultiBuffer(const BYTE *, SIZE_T, BENCH_RESULT *);
+bool benchFile(SETTINGS *, const BYTE *, SIZE_T);
+void printBenchMatrix(LPCWSTR, const BENCH_RESULT *, SIZE_T, bool);
+LPWSTR *calculateFilehashBatch(SETTINGS *, LPWSTR *, SIZE_T, bool);
+DWORD WINAPI hashBatchWorker(LPVOID);
+void printFileResult(SETTINGS *, LPCWSTR, LPCWSTR, const FILE_STATS *);
+void printFileHash(const SETTINGS *, LPCWSTR, LPCWSTR);
+void printJsonResult(const SETTINGS *, LPCWSTR, LPCWSTR, const FILE_STATS *);
+void calculateFileGroup(SETTINGS *, LPWSTR *, SIZE_T, LPWSTR *, FILE_STATS *);
+bool useMultiBuffer(const SETTINGS *);
+bool readSmallFile(LPCWSTR, PBYTE, DWORD *, bool);
 LPWSTR calculateFileHash(SETTINGS *, LPWSTR);
-LPCWSTR getHashType(LPWSTR);
+bool hashFile(SETTINGS *, LPWSTR);
+ULONGLONG loadCheckpoint(SETTINGS *, const CACHE_KEY *);
+bool saveCheckpoint(SETTINGS *, const CACHE_KEY *, ULONGLONG);
+LPWSTR formatDigests(const SETTINGS *);
+NTSTATUS hashSpan(SETTINGS *, const BYTE *, DWORD);
+HASH_FANOUT *createFanout(SETTINGS *);
+DWORD WINAPI fanoutWorker(LPVOID);
+void destroyFanout(HASH_FANOUT *);
+void printSystemError(LPCWSTR, DWORD);
+LPCWSTR getHashType(LPWSTR, LPCWSTR);
 void cleanupCryptoAPI(SETTINGS *);
 void printHelp(void);
 
@@ -73,16 +259,25 @@ int wmain(int argc, LPWSTR *argv)
     setUnicodeLocale();
 
     SETTINGS settings = {
-        .hAlg = NULL,
-        .hHash = NULL,
-        .pszAlgId = BCRYPT_SHA256_ALGORITHM,
-        .cbData = 0,
-        .cbHash = 0,
-        .cbHashObject = 0,
-        .pbHashObject = NULL,
-        .pbHash = NULL,
+        .cHashes = 0,
         .status = STATUS_SUCCESSFUL,
-        .mode = MODE_NORMAL
+        .mode = MODE_NORMAL,
+        .engine = SHA_ENGINE_AUTO,
+        .cThreads = 1,
+        .bSplit = false,
+        .ioMode = READER_AUTO,
+        .pFanout = NULL,
+        .pszCacheFile = NULL,
+        .pCache = NULL,
+        .bRecursive = false,
+        .filter = { .cInclude = 0, .cExclude = 0 },
+        .bMerkle = false,
+        .bDupes = false,
+        .pszResumeFile = NULL,
+        .pResume = NULL,
+        .bStats = false,
+        .bJson = false,
+        .cbBench = 0
     };
 
     SIZE_T cbArgs = 0;
@@ -90,6 +285,86 @@ int wmain(int argc, LPWSTR *argv)
     if (parseArgs(&settings, &pbArgs, &cbArgs, argc, argv))
         return EXIT_FAILURE;
 
+    // SHA256 is the default if no algorithm was given
+    if (settings.cHashes == 0)
+        addAlgorithm(&settings, BCRYPT_SHA256_ALGORITHM);
+
+    // the trees of /MERKLE are hashed with SHA256 only
+    if (settings.bMerkle && (settings.cHashes != 1 || _wcsicmp(settings.hashes[0].pszAlgId, BCRYPT_SHA256_ALGORITHM) != 0))
+    {
+        fwprintf_s(stderr, L"* ERROR: /MERKLE calculates SHA256 only\n");
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        return EXIT_FAILURE;
+    }
+
+    if (settings.bDupes && settings.cHashes != 1)
+    {
+        fwprintf_s(stderr, L"* ERROR: /DUPES compares the digests of one algorithm only\n");
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        return EXIT_FAILURE;
+    }
+
+    if (settings.pszResumeFile)
+    {
+        // only the in-tree engines can write their state to a checkpoint
+        bool bNative = true;
+        for (SIZE_T i = 0; i < settings.cHashes; ++i)
+            bNative = bNative && getNativeAlgorithm(settings.hashes[i].pszAlgId) != NATIVE_NONE;
+
+        if (!bNative)
+        {
+            fwprintf_s(stderr, L"* ERROR: /RESUME needs algorithms calculated in-tree (SHA1, SHA256, BLAKE3, XXH3, CRC32C)\n");
+            HeapFree(GetProcessHeap(), 0, pbArgs);
+            return EXIT_FAILURE;
+        }
+
+        // the state-file holds the checkpoint of one file, so the files are hashed one after the other
+        if (settings.cThreads > 1 || settings.mode == MODE_CHECK)
+        {
+            fwprintf_s(stderr, L"* ERROR: /RESUME can not be combined with /J or /C\n");
+            HeapFree(GetProcessHeap(), 0, pbArgs);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // the statistics and the JSON-output are of hashed files only
+    if ((settings.bStats || settings.bJson) && (settings.mode == MODE_CHECK || settings.bMerkle || settings.bDupes))
+    {
+        fwprintf_s(stderr, L"* ERROR: /STATS and /JSON can not be combined with /C, /MERKLE or /DUPES\n");
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        return EXIT_FAILURE;
+    }
+
+    // the benchmark hashes synthetic data with every engine, it selects them itself
+    if (settings.cbBench)
+    {
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        return runBenchmark(&settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    SHA_ENGINE selectedEngine = shaSelectEngine(settings.engine);
+    if (settings.engine != SHA_ENGINE_AUTO && selectedEngine != settings.engine)
+        fwprintf_s(stderr, L"* WARNING: engine '%hs' not supported by this cpu, using '%hs'\n",
+                    shaEngineName(settings.engine), shaEngineName(selectedEngine));
+
+    // BLAKE3 has no SHA-extensions, SHANI selects its fastest engine
+    switch (settings.engine)
+    {
+        case SHA_ENGINE_SCALAR: blake3SelectEngine(BLAKE3_ENGINE_PORTABLE); break;
+        case SHA_ENGINE_SSE4: blake3SelectEngine(BLAKE3_ENGINE_SSE41); break;
+        case SHA_ENGINE_AVX2: blake3SelectEngine(BLAKE3_ENGINE_AVX2); break;
+        default: blake3SelectEngine(BLAKE3_ENGINE_AUTO); break;
+    }
+
+    // SSE4 selects SSE2 for XXH3, the crc32-instruction is part of SSE4.2
+    switch (settings.engine)
+    {
+        case SHA_ENGINE_SCALAR: checksumSelectEngine(CHECKSUM_ENGINE_SCALAR); break;
+        case SHA_ENGINE_SSE4: checksumSelectEngine(CHECKSUM_ENGINE_SSE); break;
+        case SHA_ENGINE_AVX2: checksumSelectEngine(CHECKSUM_ENGINE_AVX2); break;
+        default: checksumSelectEngine(CHECKSUM_ENGINE_AUTO); break;
+    }
+
     if (initializeCryptoAPI(&settings) != STATUS_SUCCESSFUL)
     {
         HeapFree(GetProcessHeap(), 0, pbArgs);
@@ -97,21 +372,170 @@ int wmain(int argc, LPWSTR *argv)
         exit(EXIT_FAILURE);
     }
 
+    if (!readerInit(&settings.reader, settings.ioMode))
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the read-buffer failed\n");
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        cleanupCryptoAPI(&settings);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!outputInit())
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the output-buffer failed\n");
+        outputFree();
+        HeapFree(GetProcessHeap(), 0, pbArgs);
+        readerFree(&settings.reader);
+        cleanupCryptoAPI(&settings);
+        exit(EXIT_FAILURE);
+    }
+
+    DIGEST_CACHE cache;
+    if (settings.pszCacheFile)
+    {
+        if (!cacheOpen(&cache, settings.pszCacheFile))
+        {
+            fwprintf_s(stderr, L"* ERROR: allocating memory for the cache failed\n");
+            cacheFree(&cache);
+            outputFree();
+            HeapFree(GetProcessHeap(), 0, pbArgs);
+            readerFree(&settings.reader);
+            cleanupCryptoAPI(&settings);
+            exit(EXIT_FAILURE);
+        }
+
+        settings.pCache = &cache;
+    }
+
+    RESUME_STATE resume;
+    if (settings.pszResumeFile)
+    {
+        if (!resumeOpen(&resume, settings.pszResumeFile))
+        {
+            fwprintf_s(stderr, L"* ERROR: allocating memory for the checkpoint failed\n");
+            resumeFree(&resume);
+            if (settings.pCache) cacheFree(settings.pCache);
+            outputFree();
+            HeapFree(GetProcessHeap(), 0, pbArgs);
+            readerFree(&settings.reader);
+            cleanupCryptoAPI(&settings);
+            exit(EXIT_FAILURE);
+        }
+
+        settings.pResume = &resume;
+    }
+
+    int exitCode = EXIT_SUCCESS;
+
+    // the time of the run includes walking the directories
+    settings.run.startTicks = statsNow();
+
+    if (settings.bJson)
+        outputString(L"{\"files\": [");
+
+    // with /R the directories on the command-line are replaced by their files
+    TREE_WALK walk;
+    walkInit(&walk, &settings.filter, printSystemError);
+
+    if (settings.bRecursive && !settings.bMerkle && settings.mode == MODE_NORMAL)
+    {
+        for (SIZE_T i = 0; i < cbArgs; ++i)
+        {
+            DWORD dwAttributes = GetFileAttributesW(pbArgs[i]);
+            bool bDirectory = dwAttributes != INVALID_FILE_ATTRIBUTES && (dwAttributes & FILE_ATTRIBUTE_DIRECTORY);
+
+            if (bDirectory ? !walkTree(&walk, pbArgs[i], WALK_THREADS) : !walkAddFile(&walk, pbArgs[i]))
+            {
+                fwprintf_s(stderr, L"* ERROR: allocating memory for the list of files failed\n");
+                exitCode = EXIT_FAILURE;
+                break;
+            }
+        }
+    }
+
+    LPWSTR *pvOutput = NULL;
+
     switch (settings.mode)
     {
         // TODO: error handling
         case MODE_CHECK:
-            checkHashValues(&settings, pbArgs, cbArgs);
+            if (settings.bMerkle ? !checkMerkleManifest(&settings, pbArgs, cbArgs) : !checkHashValues(&settings, pbArgs, cbArgs))
+                exitCode = EXIT_FAILURE;
             break;
         default:
-            calculateFilehashBatch(&settings, pbArgs, cbArgs);
+            if (settings.bMerkle)
+            {
+                if (!writeMerkleManifest(&settings, pbArgs, cbArgs))
+                    exitCode = EXIT_FAILURE;
+            }
+            else if (!settings.bRecursive)
+                pvOutput = calculateFilehashBatch(&settings, pbArgs, cbArgs, true);
+            else if (exitCode == EXIT_SUCCESS && settings.bDupes)
+            {
+                if (!findDuplicates(&settings, walk.pvFileNames, walk.cFileNames))
+                    exitCode = EXIT_FAILURE;
+            }
+            else if (exitCode == EXIT_SUCCESS)
+                pvOutput = calculateFilehashBatch(&settings, walk.pvFileNames, walk.cFileNames, true);
             break;
     }
+
+    // the digests were freed as they were printed
+    if (pvOutput) HeapFree(GetProcessHeap(), 0, pvOutput);
+
+    if (settings.bJson)
+    {
+        outputPrintf(L"\n], \"summary\": {\"files\": %zu, \"failed\": %zu", settings.run.cFiles, settings.run.cFailed);
+
+        if (settings.bStats)
+        {
+            FILE_STATS total = settings.run.total;
+            total.wallTicks = statsNow() - settings.run.startTicks;
+
+            outputString(L", ");
+            jsonPrintStats(&total);
+            outputPrintf(L", \"bound\": \"%s\"", total.ioTicks > total.hashTicks ? L"io" : L"cpu");
+        }
+
+        outputString(L"}}\n");
+    }
+    else if (settings.bStats)
+        statsPrintRun(&settings.run);
     
+    if (settings.pCache)
+    {
+        DWORD dwError = cacheSave(settings.pCache);
+        if (dwError != ERROR_SUCCESS)
+            printSystemError(settings.pszCacheFile, dwError);
+
+        cacheFree(settings.pCache);
+    }
+
+    if (settings.pResume)
+    {
+        // all files were hashed, the checkpoint is of no use anymore
+        DWORD dwError = exitCode == EXIT_SUCCESS ? resumeClear(settings.pResume) : ERROR_SUCCESS;
+        if (dwError != ERROR_SUCCESS)
+            printSystemError(settings.pszResumeFile, dwError);
+
+        resumeFree(settings.pResume);
+    }
+
+    // a closed pipe (e.g. "| more" quit early) is no error
+    DWORD dwOutputError = outputFree();
+    if (dwOutputError != ERROR_SUCCESS && dwOutputError != ERROR_NO_DATA)
+    {
+        printSystemError(L"stdout", dwOutputError);
+        exitCode = EXIT_FAILURE;
+    }
+
     HeapFree(GetProcessHeap(), 0, pbArgs);
+    walkFree(&walk);
+    destroyFanout(settings.pFanout);
+    readerFree(&settings.reader);
     cleanupCryptoAPI(&settings);
 
-    return 0;
+    return exitCode;
 }
 
 /*
@@ -158,15 +582,143 @@ int parseArgs(SETTINGS *_settings, LPWSTR **_pvFileNames, SIZE_T *_cvFileNames,
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/C") == 0)
                 (*_settings).mode = MODE_CHECK;
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/SHA1") == 0)
-                (*_settings).pszAlgId = BCRYPT_SHA1_ALGORITHM;
+                addAlgorithm(_settings, BCRYPT_SHA1_ALGORITHM);
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/SHA256") == 0)
-                (*_settings).pszAlgId = BCRYPT_SHA256_ALGORITHM;
+                addAlgorithm(_settings, BCRYPT_SHA256_ALGORITHM);
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/SHA384") == 0)
-                (*_settings).pszAlgId = BCRYPT_SHA384_ALGORITHM;
+                addAlgorithm(_settings, BCRYPT_SHA384_ALGORITHM);
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/SHA512") == 0)
-                (*_settings).pszAlgId = BCRYPT_SHA512_ALGORITHM;
+                addAlgorithm(_settings, BCRYPT_SHA512_ALGORITHM);
             else if (_wcsicmp((LPCWSTR)_argv[i], L"/MD5") == 0)
-                (*_settings).pszAlgId = BCRYPT_MD5_ALGORITHM;
+                addAlgorithm(_settings, BCRYPT_MD5_ALGORITHM);
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/BLAKE3") == 0)
+                addAlgorithm(_settings, BLAKE3_ALGORITHM);
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/XXH3") == 0)
+                addAlgorithm(_settings, XXH3_ALGORITHM);
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/CRC32C") == 0)
+                addAlgorithm(_settings, CRC32C_ALGORITHM);
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/ALL") == 0)
+            {
+                for (int j = 0; j < MAX_HASHES; ++j)
+                    addAlgorithm(_settings, ALL_ALGORITHMS[j]);
+            }
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/SPLIT") == 0)
+                (*_settings).bSplit = true;
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/J") == 0)
+                (*_settings).cThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/J:", 3) == 0)
+            {
+                long cThreads = wcstol(&_argv[i][3], NULL, 10);
+                if (cThreads < 0 || cThreads > 1024)
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Invalid number of threads: %s\n", _argv[i]);
+                    printHelp();
+                    return 1;
+                }
+
+                // 0 means one thread per logical processor
+                (*_settings).cThreads = cThreads ? (DWORD)cThreads : GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            }
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/IO:", 4) == 0)
+            {
+                LPCWSTR pszMode = &_argv[i][4];
+
+                if (_wcsicmp(pszMode, L"AUTO") == 0) (*_settings).ioMode = READER_AUTO;
+                else if (_wcsicmp(pszMode, L"MAP") == 0) (*_settings).ioMode = READER_MAP;
+                else if (_wcsicmp(pszMode, L"BLOCK") == 0) (*_settings).ioMode = READER_BLOCK;
+                else
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Unknown I/O-mode: %s\n", pszMode);
+                    printHelp();
+                    return 1;
+                }
+            }
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/NOCACHE") == 0)
+                (*_settings).ioMode = READER_NOCACHE;
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/CACHE:", 7) == 0)
+            {
+                if (_argv[i][7] == L'\0')
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Missing name of the cache-file: %s\n", _argv[i]);
+                    printHelp();
+                    return 1;
+                }
+
+                (*_settings).pszCacheFile = &_argv[i][7];
+            }
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/RESUME:", 8) == 0)
+            {
+                if (_argv[i][8] == L'\0')
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Missing name of the state-file: %s\n", _argv[i]);
+                    printHelp();
+                    return 1;
+                }
+
+                (*_settings).pszResumeFile = &_argv[i][8];
+            }
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/STATS") == 0)
+                (*_settings).bStats = true;
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/JSON") == 0)
+                (*_settings).bJson = true;
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/BENCH") == 0)
+                (*_settings).cbBench = (SIZE_T)BENCH_DEFAULT_SIZE * 1024 * 1024;
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/BENCH:", 7) == 0)
+            {
+                long cMegabytes = wcstol(&_argv[i][7], NULL, 10);
+                if (cMegabytes < 1 || cMegabytes > BENCH_MAX_SIZE)
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Invalid size of the benchmark: %s\n", _argv[i]);
+                    printHelp();
+                    return 1;
+                }
+
+                (*_settings).cbBench = (SIZE_T)cMegabytes * 1024 * 1024;
+            }
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/R") == 0)
+                (*_settings).bRecursive = true;
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/DUPES") == 0)
+            {
+                (*_settings).bDupes = true;
+                (*_settings).bRecursive = true;
+            }
+            else if (_wcsicmp((LPCWSTR)_argv[i], L"/MERKLE") == 0)
+            {
+                (*_settings).bMerkle = true;
+                (*_settings).bRecursive = true;
+            }
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/INCLUDE:", 9) == 0 ||
+                    _wcsnicmp((LPCWSTR)_argv[i], L"/EXCLUDE:", 9) == 0)
+            {
+                bool bInclude = _wcsnicmp((LPCWSTR)_argv[i], L"/INCLUDE:", 9) == 0;
+                LPCWSTR *ppszPatterns = bInclude ? _settings->filter.ppszInclude : _settings->filter.ppszExclude;
+                SIZE_T *pcPatterns = bInclude ? &_settings->filter.cInclude : &_settings->filter.cExclude;
+
+                if (_argv[i][9] == L'\0' || *pcPatterns >= WALK_MAX_PATTERNS)
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Missing or too many patterns: %s\n", _argv[i]);
+                    printHelp();
+                    return 1;
+                }
+
+                ppszPatterns[(*pcPatterns)++] = &_argv[i][9];
+            }
+            else if (_wcsnicmp((LPCWSTR)_argv[i], L"/ENGINE:", 8) == 0)
+            {
+                LPCWSTR pszEngine = &_argv[i][8];
+
+                if (_wcsicmp(pszEngine, L"AUTO") == 0) (*_settings).engine = SHA_ENGINE_AUTO;
+                else if (_wcsicmp(pszEngine, L"SCALAR") == 0) (*_settings).engine = SHA_ENGINE_SCALAR;
+                else if (_wcsicmp(pszEngine, L"SSE4") == 0) (*_settings).engine = SHA_ENGINE_SSE4;
+                else if (_wcsicmp(pszEngine, L"AVX2") == 0) (*_settings).engine = SHA_ENGINE_AVX2;
+                else if (_wcsicmp(pszEngine, L"SHANI") == 0) (*_settings).engine = SHA_ENGINE_SHANI;
+                else
+                {
+                    _fwprintf_p(stderr, L"* ERROR: Unknown engine: %s\n", pszEngine);
+                    printHelp();
+                    return 1;
+                }
+            }
             else
             {
                 _fwprintf_p(stderr, L"* ERROR: Unknown parameter: %s\n", _argv[i]);
@@ -184,55 +736,50 @@ int parseArgs(SETTINGS *_settings, LPWSTR **_pvFileNames, SIZE_T *_cvFileNames,
 }
 
 /*
- * initializes the Windows Crypto API (CNG).
+ * adds an algorithm to the list of digests calculated for every file.
+ * algorithms already in the list are ignored, so the digests are
+ * printed in the order the switches were given.
+ * 
+ * _IN:
+ *      _pszAlgId: the CNG-name of the algorithm
  * 
  * _IN_OUT:
  *      _settings: an SETTINGS-object
  * 
- * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ * _RETURNS: true if the algorithm was added, false if it was already selected
  */
-NTSTATUS initializeCryptoAPI(SETTINGS *_settings)
+bool addAlgorithm(SETTINGS *_settings, LPCWSTR _pszAlgId)
 {
-    if(((*_settings).status = BCryptOpenAlgorithmProvider(&_settings->hAlg, _settings->pszAlgId, NULL, BCRYPT_HASH_REUSABLE_FLAG)))
-    {
-        fwprintf(stderr, L"* Error: open algorythm provider failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
-    }
-
-    // calculate size of buffer for the hash
-    if(((*_settings).status = BCryptGetProperty(_settings->hAlg, BCRYPT_OBJECT_LENGTH, (PBYTE)&_settings->cbHashObject, sizeof(DWORD), &_settings->cbData, 0)))
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
     {
-        fwprintf(stderr, L"* Error: getting crypto properties failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
+        if (_wcsicmp(_settings->hashes[i].pszAlgId, _pszAlgId) == 0)
+            return false;
     }
 
-    (*_settings).pbHashObject = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(BYTE) * _settings->cbHashObject);
-    if(!_settings->pbHashObject)
-    {
-        (*_settings).status = STATUS_UNSUCCESSFUL;
-        fwprintf(stderr, L"* Error: allocating memory for hash object failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
-    }
+    if (_settings->cHashes >= MAX_HASHES) return false;
 
-   // calculate length of hash
-    if(((*_settings).status = BCryptGetProperty(_settings->hAlg, BCRYPT_HASH_LENGTH, (PBYTE)&_settings->cbHash, sizeof(DWORD), &_settings->cbData, 0)))
-    {
-        fwprintf(stderr, L"* Error: getting crypto properties failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
-    }
+    HASH_STATE *state = &_settings->hashes[(*_settings).cHashes++];
+    ZeroMemory(state, sizeof(HASH_STATE));
+    state->pszAlgId = _pszAlgId;
 
-    (*_settings).pbHash = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(PBYTE) * _settings->cbHash);
-    if(!_settings->pbHash)
-    {
-        (*_settings).status = STATUS_UNSUCCESSFUL;
-        fwprintf(stderr, L"* Error: allocating memory for hash failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
-    }
+    return true;
+}
 
-    if(((*_settings).status = BCryptCreateHash(_settings->hAlg, &_settings->hHash, _settings->pbHashObject, _settings->cbHashObject, NULL, 0, 0)))
+/*
+ * initializes the Windows Crypto API (CNG) for all selected algorithms.
+ * 
+ * _IN_OUT:
+ *      _settings: an SETTINGS-object
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ */
+NTSTATUS initializeCryptoAPI(SETTINGS *_settings)
+{
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
     {
-        fwprintf(stderr, L"* Error: creating pbHash failed with status: 0x%x\n", _settings->status);
-        return _settings->status;
+        if (((*_settings).status = openHashAlgorithm(&_settings->hashes[i])) ||
+            ((*_settings).status = createHashObject(&_settings->hashes[i])))
+            return _settings->status;
     }
 
     return STATUS_SUCCESSFUL;
@@ -243,7 +790,16 @@ NTSTATUS initializeCryptoAPI(SETTINGS *_settings)
  * this function can handle multiple hash-files and processes them in the same order
  * as given on the command-line.
  * it tries to guess which algorithem is used by calculating the length of the given
- * hash and skips files whose algorithen could not be determined with a warning.
+ * hash (or takes it from the tag of a "TAG (file) = hash"-line) and skips files
+ * whose algorithen could not be determined with a warning.
+ * the hash-files are parsed in batches from a mapped view (hashsum_manifest.c),
+ * so even manifests with millions of lines are verified with bounded memory
+ * while they are still being read.
+ * ---------------------------------------------------------------------------------
+ * with more than one thread configured (/J), the entries of a batch are verified
+ * by a pool of workers. every worker keeps a hash-object for each algorithm it
+ * came across, so mixed hash-files never reopen an algorithm provider. the
+ * results are still printed in the order of the hash-file, followed by a summary.
  * ---------------------------------------------------------------------------------
  * 
  * _IN:
@@ -251,246 +807,2327 @@ NTSTATUS initializeCryptoAPI(SETTINGS *_settings)
  *      _cvHashFiles: the size of _pvHashFiles
  * 
  * _IN_OUT:
- *      _settings: the application SETTINGS-object
+ *      _settings: the application SETTINGS-object, afterwards it holds the
+ *              providers of all algorithms used by the hash-files
+ * 
+ * _RETURNS: true if every entry was verified OK, false otherwise
  */
-void checkHashValues(SETTINGS *_settings, LPWSTR *_pvHashFiles, SIZE_T _cvHashFiles)
+bool checkHashValues(SETTINGS *_settings, LPWSTR *_pvHashFiles, SIZE_T _cvHashFiles)
 {
+    // the providers are opened on first use, see resolveEntry()
+    cleanupCryptoAPI(_settings);
+    (*_settings).cHashes = 0;
+
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+        addAlgorithm(_settings, ALL_ALGORITHMS[i]);
+
+    MANIFEST_BATCH batch;
+    VERIFY_POOL pool = {
+        .pSettings = _settings,
+        .cEntries = 0,
+        .nNext = 0,
+        .bQuit = false
+    };
+
+    pool.pAlgIndex = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(SIZE_T) * MANIFEST_BATCH_ENTRIES);
+    pool.pResults = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(VERIFY_RESULT) * MANIFEST_BATCH_ENTRIES);
+
+    if (!manifestBatchInit(&batch) || !pool.pAlgIndex || !pool.pResults)
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the hash-file parser failed\n");
+        if (pool.pAlgIndex) HeapFree(GetProcessHeap(), 0, pool.pAlgIndex);
+        if (pool.pResults) HeapFree(GetProcessHeap(), 0, pool.pResults);
+        manifestBatchFree(&batch);
+        return false;
+    }
+
+    InitializeSRWLock(&pool.lock);
+    InitializeConditionVariable(&pool.cvWork);
+    InitializeConditionVariable(&pool.cvDone);
+
+    DWORD cThreads = _settings->cThreads;
+    HANDLE *phThreads = NULL;
+    DWORD cStarted = 0;
+
+    if (cThreads > 1 && (phThreads = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HANDLE) * cThreads)))
+    {
+        // the processors not used by the workers are left to BLAKE3
+        pool.cTreeThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS) / cThreads;
+        if (pool.cTreeThreads < 1) pool.cTreeThreads = 1;
+
+        for (; cStarted < cThreads; ++cStarted)
+        {
+            if (! (phThreads[cStarted] = CreateThread(NULL, 0, verifyWorker, &pool, 0, NULL)))
+                break;
+        }
+
+        if (cStarted == 0)
+            fwprintf_s(stderr, L"* WARNING: creating worker-threads failed, verifying sequential\n");
+    }
+
+    // without workers the main-thread verifies the entries itself
+    VERIFY_CONTEXT context = { .bReady = false };
+    if (cStarted == 0)
+        initVerifyContext(&context, _settings, GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+
+    SIZE_T cResults[VERIFY_UNKNOWN + 1] = { 0 };
+    bool bErrors = false;
+
     for (SIZE_T i = 0; i < _cvHashFiles; ++i)
     {
-        LPWSTR *pbFileNames, *pbFileOutput;
+        MANIFEST_READER manifest;
 
-        SIZE_T cPairs = readHashFile(&pbFileNames, &pbFileOutput, _pvHashFiles[i]);
-        if (cPairs <= 0 || !pbFileNames || !pbFileOutput) continue;
+        DWORD dwError = manifestOpen(&manifest, _pvHashFiles[i]);
+        if (dwError != ERROR_SUCCESS)
+        {
+            printSystemError(_pvHashFiles[i], dwError);
+            bErrors = true;
+            continue;
+        }
 
-        for (SIZE_T j = 0; j < cPairs; ++j)
+        // the entries are verified batch by batch while the manifest is parsed
+        while (manifestRead(&manifest, &batch))
         {
-            LPCWSTR newPszLastAlgId = getHashType(pbFileOutput[j]);
-            if (!newPszLastAlgId) 
+            for (SIZE_T j = 0; j < batch.cEntries; ++j)
+                pool.pResults[j] = resolveEntry(_settings, &batch.pEntries[j], &pool.pAlgIndex[j]);
+
+            if (cStarted > 0)
             {
-                wprintf_s(L"* WARNING: %s: Unknown Hash-Algorithem\n", pbFileNames[j]);
-                continue;
+                AcquireSRWLockExclusive(&pool.lock);
+                pool.pEntries = batch.pEntries;
+                pool.cEntries = batch.cEntries;
+                pool.nNext = 0;
+                ReleaseSRWLockExclusive(&pool.lock);
+
+                WakeAllConditionVariable(&pool.cvWork);
             }
-            else if (_wcsicmp(_settings->pszAlgId, newPszLastAlgId) != 0)
+
+            // print the results in the order of the hash-file as soon as they are available
+            for (SIZE_T j = 0; j < batch.cEntries; ++j)
             {
-                (*_settings).pszAlgId = newPszLastAlgId;
+                if (cStarted == 0 && pool.pResults[j] == VERIFY_PENDING)
+                    pool.pResults[j] = verifyEntry(&context, &batch.pEntries[j], pool.pAlgIndex[j]);
 
-                if (initializeCryptoAPI(_settings) != STATUS_SUCCESSFUL)
-                {
-                    fwprintf_s(stderr, L"* ERROR: Re-Initialisation of Crypto-API failed\n");
-                    cleanupCryptoAPI(_settings);
-                    exit(EXIT_FAILURE);
-                }
-            }
+                AcquireSRWLockExclusive(&pool.lock);
+                while (pool.pResults[j] == VERIFY_PENDING)
+                    SleepConditionVariableSRW(&pool.cvDone, &pool.lock, INFINITE, 0);
+                ReleaseSRWLockExclusive(&pool.lock);
 
-            LPWSTR lpwCalculatedOutput = calculateFileHash(_settings, pbFileNames[j]);
-            LPCWSTR cmpResult = _wcsicmp(lpwCalculatedOutput, pbFileOutput[j]) ? L"FAILED" : L"OK";
+                printVerifyResult(_pvHashFiles[i], &batch.pEntries[j], pool.pResults[j]);
+                ++cResults[pool.pResults[j]];
+            }
 
-            wprintf_s(L"%s: %s\n", pbFileNames[j], cmpResult);
+            // the workers must not look at the results while the next batch is resolved
+            AcquireSRWLockExclusive(&pool.lock);
+            pool.cEntries = 0;
+            pool.nNext = 0;
+            ReleaseSRWLockExclusive(&pool.lock);
+        }
 
-            HeapFree(GetProcessHeap(), 0, pbFileNames[j]);
-            HeapFree(GetProcessHeap(), 0, pbFileOutput[j]);
-            HeapFree(GetProcessHeap(), 0, lpwCalculatedOutput);
+        if (manifest.dwError != ERROR_SUCCESS)
+        {
+            printSystemError(_pvHashFiles[i], manifest.dwError);
+            bErrors = true;
         }
 
-        HeapFree(GetProcessHeap(), 0, pbFileNames);
-        HeapFree(GetProcessHeap(), 0, pbFileOutput);
+        manifestClose(&manifest);
+    }
+
+    AcquireSRWLockExclusive(&pool.lock);
+    pool.bQuit = true;
+    ReleaseSRWLockExclusive(&pool.lock);
+
+    WakeAllConditionVariable(&pool.cvWork);
+
+    for (DWORD i = 0; i < cStarted; ++i)
+    {
+        WaitForSingleObject(phThreads[i], INFINITE);
+        CloseHandle(phThreads[i]);
     }
+
+    SIZE_T cSkipped = cResults[VERIFY_BAD_LINE] + cResults[VERIFY_UNKNOWN];
+
+    outputPrintf(L"%zu OK, %zu failed, %zu missing, %zu skipped\n",
+            cResults[VERIFY_OK], cResults[VERIFY_FAILED], cResults[VERIFY_MISSING], cSkipped);
+
+    if (cStarted == 0) freeVerifyContext(&context);
+    if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+    HeapFree(GetProcessHeap(), 0, pool.pAlgIndex);
+    HeapFree(GetProcessHeap(), 0, pool.pResults);
+    manifestBatchFree(&batch);
+
+    return !bErrors && cResults[VERIFY_FAILED] == 0 && cResults[VERIFY_MISSING] == 0 && cSkipped == 0;
 }
 
 /*
- * parses a hash-files for hash-filename-pairs.
- * 
- * skips linecomments starting with '#'.
- * --------------------------------------------
+ * determines the algorithm of one entry of a hash-file.
+ * -----------------------------------------------------
+ * called by the main-thread before the entry is handed to the
+ * workers. the algorithm provider is opened the first time an
+ * algorithm is seen and stays open for all further entries.
+ * -----------------------------------------------------
  * 
  * _IN:
- *      _fileName: the name/path of the hash-pbFile
+ *      _entry: the parsed line of the hash-file
  * 
  * _IN_OUT:
- *      _pvFileNames: the parsed filenames
- *      _pvFileHashes: the parsed hash-strings
+ *      _settings: the application SETTINGS-object holding all algorithms
  * 
- * _RETURNS: the size of the _pvFile*-vectors
+ * _OUT:
+ *      _pAlgIndex: the index of the algorithm in _settings->hashes
+ * 
+ * _RETURNS: VERIFY_PENDING if the entry can be verified, otherwise the
+ *          result of the entry
  */
-SIZE_T readHashFile(LPWSTR **_pvFileNames, LPWSTR **_pvFileHashes, LPWSTR _fileName)
+VERIFY_RESULT resolveEntry(SETTINGS *_settings, const MANIFEST_ENTRY *_entry, SIZE_T *_pAlgIndex)
 {
-    int allocCount = 2;
-    SIZE_T counter = 0;
-
-    if (! ((*_pvFileNames) = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR))) ||
-        ! ((*_pvFileHashes) = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR))))
-    {
-        // we have to guard the calls to HeapFree() to make sure we don't call it with NULL
-        if ((*_pvFileNames)) HeapFree(GetProcessHeap(), 0, (*_pvFileNames));
-        if ((*_pvFileHashes)) HeapFree(GetProcessHeap(), 0, (*_pvFileHashes));
+    LPCWSTR pszAlgId = NULL;
 
-        (*_pvFileNames) = NULL;
-        (*_pvFileHashes) = NULL;
+    if (_entry->pszTag && ! (pszAlgId = findAlgorithm(_entry->pszTag)))
+        return VERIFY_BAD_LINE;
 
-        return counter;
-    }
-    
-    FILE *pHashFile;
-    if (_wfopen_s(&pHashFile, _fileName, L"r"))
-    {
-        WCHAR errMsg[BUFSIZ];
-        _wcserror_s((WCHAR *)&errMsg, BUFSIZ, errno);
-        _fwprintf_p(stderr, L"* %s: %s\n", _fileName, errMsg);
-
-        HeapFree(GetProcessHeap(), 0, (*_pvFileNames));
-        HeapFree(GetProcessHeap(), 0, (*_pvFileHashes));
-        (*_pvFileNames) = NULL;
-        (*_pvFileHashes) = NULL;
-        
-        return counter;
-    }
+    if (! (pszAlgId = getHashType(_entry->pszHash, pszAlgId)))
+        return VERIFY_UNKNOWN;
 
-    WCHAR inBuff[BUFSIZ*2];
-    while (fgetws(inBuff, (BUFSIZ*2)-1, pHashFile))
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
     {
-        if (inBuff[0] == '#') continue; // TODO: better handling
-        else if (isStringBlankW(inBuff, BUFSIZ*2)) continue;
+        HASH_STATE *state = &_settings->hashes[i];
 
-        LPWSTR pbContext;
-        LPWSTR pbHash;
-        LPWSTR pbFile;
+        if (_wcsicmp(state->pszAlgId, pszAlgId) != 0) continue;
 
-        if ((pbHash = wcstok_s(inBuff, L" \t", &pbContext)) &&
-            (pbFile = wcstok_s(NULL, L" \t", &pbContext)))
+        // the length of the digest is only known once the provider is open
+        if (state->cbHash == 0 && ((*_settings).status = openHashAlgorithm(state)))
         {
-            pbFile[wcsnlen(pbFile, BUFSIZ)-1] = '\0';
+            if (state->hAlg) BCryptCloseAlgorithmProvider(state->hAlg, 0);
+            state->hAlg = NULL;
+            state->cbHash = 0;
+            return VERIFY_FAILED;
         }
-        else
-        {
-            wprintf_s(L"* WARNING: Maleformatted Line: %zd\n", counter+1);
-            continue;
+
+        *_pAlgIndex = i;
+        return VERIFY_PENDING;
+    }
+
+    return VERIFY_UNKNOWN;
+}
+
+/*
+ * prepares the state of a thread verifying hash-files.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object holding the providers
+ *      _cTreeThreads: the number of threads BLAKE3 may use
+ * 
+ * _OUT:
+ *      _context: the context to initialize
+ * 
+ * _RETURNS: true on success, false if the read-buffer could not be allocated
+ */
+bool initVerifyContext(VERIFY_CONTEXT *_context, const SETTINGS *_settings, DWORD _cTreeThreads)
+{
+    ZeroMemory(_context->states, sizeof(_context->states));
+
+    (*_context).pShared = _settings;
+    (*_context).settings = *_settings;
+    (*_context).settings.cHashes = 0;
+    (*_context).settings.pFanout = NULL;
+    (*_context).cTreeThreads = _cTreeThreads;
+
+    return ((*_context).bReady = readerInit(&_context->settings.reader, _settings->ioMode));
+}
+
+/*
+ * verifies the digest of one entry of a hash-file.
+ * ------------------------------------------------
+ * the hash-object of the algorithm is taken from the context,
+ * it is only created if the thread did not need it before.
+ * ------------------------------------------------
+ * 
+ * _IN:
+ *      _entry: the parsed line of the hash-file
+ *      _iAlg: the index of the algorithm, see resolveEntry()
+ * 
+ * _IN_OUT:
+ *      _context: the state of the calling thread
+ * 
+ * _RETURNS: VERIFY_OK, VERIFY_FAILED or VERIFY_MISSING
+ */
+VERIFY_RESULT verifyEntry(VERIFY_CONTEXT *_context, const MANIFEST_ENTRY *_entry, SIZE_T _iAlg)
+{
+    HASH_STATE *state = &_context->states[_iAlg];
+    SETTINGS *settings = &_context->settings;
+
+    if (!_context->bReady) return VERIFY_FAILED;
+
+    if (!state->pbHash)
+    {
+        // the provider is shared, the hash-object belongs to this thread
+        *state = _context->pShared->hashes[_iAlg];
+        state->cTreeThreads = _context->cTreeThreads;
+
+        if (createHashObject(state) != STATUS_SUCCESSFUL)
+        {
+            destroyHashObject(state);
+            return VERIFY_FAILED;
+        }
+    }
+
+    // calculateFileHash() hashes with the first HASH_STATE of the settings
+    (*settings).hashes[0] = *state;
+    (*settings).cHashes = 1;
+    (*settings).reader.dwError = ERROR_SUCCESS;
+
+    LPWSTR lpwDigest = calculateFileHash(settings, _entry->pszFile);
+    DWORD dwError = settings->reader.dwError;
+
+    if (!lpwDigest)
+        return dwError == ERROR_FILE_NOT_FOUND || dwError == ERROR_PATH_NOT_FOUND ? VERIFY_MISSING : VERIFY_FAILED;
+
+    VERIFY_RESULT result = _wcsicmp(lpwDigest, _entry->pszHash) == 0 ? VERIFY_OK : VERIFY_FAILED;
+    HeapFree(GetProcessHeap(), 0, lpwDigest);
+
+    return result;
+}
+
+/*
+ * destroys the hash-objects and the reader of a verifying thread.
+ * the algorithm providers are not closed, they are shared.
+ * 
+ * _IN_OUT:
+ *      _context: the state of the calling thread
+ */
+void freeVerifyContext(VERIFY_CONTEXT *_context)
+{
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+        destroyHashObject(&_context->states[i]);
+
+    readerFree(&_context->settings.reader);
+}
+
+/*
+ * worker-thread of checkHashValues().
+ * -----------------------------------
+ * takes the next unverified entry of the current batch until the
+ * batch is done, then waits for the next batch or the end.
+ * -----------------------------------
+ * 
+ * _IN_OUT:
+ *      _param: the VERIFY_POOL to work for
+ * 
+ * _RETURNS: 0 on success, 1 if the read-buffer could not be allocated
+ */
+DWORD WINAPI verifyWorker(LPVOID _param)
+{
+    VERIFY_POOL *pool = (VERIFY_POOL *)_param;
+
+    VERIFY_CONTEXT context;
+    initVerifyContext(&context, pool->pSettings, pool->cTreeThreads);
+
+    AcquireSRWLockExclusive(&pool->lock);
+
+    for (;;)
+    {
+        // entries rejected by resolveEntry() already have their result
+        while (pool->nNext < pool->cEntries && pool->pResults[pool->nNext] != VERIFY_PENDING)
+            ++(*pool).nNext;
+
+        if (pool->bQuit) break;
+
+        if (pool->nNext >= pool->cEntries)
+        {
+            SleepConditionVariableSRW(&pool->cvWork, &pool->lock, INFINITE, 0);
+            continue;
+        }
+
+        SIZE_T i = (*pool).nNext++;
+        ReleaseSRWLockExclusive(&pool->lock);
+
+        VERIFY_RESULT result = verifyEntry(&context, &pool->pEntries[i], pool->pAlgIndex[i]);
+
+        AcquireSRWLockExclusive(&pool->lock);
+        (*pool).pResults[i] = result;
+        WakeAllConditionVariable(&pool->cvDone);
+    }
+
+    ReleaseSRWLockExclusive(&pool->lock);
+    freeVerifyContext(&context);
+
+    return context.bReady ? 0 : 1;
+}
+
+/*
+ * prints the result of one entry of a hash-file.
+ * 
+ * _IN:
+ *      _hashFile: the name/path of the hash-file
+ *      _entry: the parsed line of the hash-file
+ *      _result: the result of the entry
+ */
+void printVerifyResult(LPCWSTR _hashFile, const MANIFEST_ENTRY *_entry, VERIFY_RESULT _result)
+{
+    switch (_result)
+    {
+        case VERIFY_BAD_LINE:
+            outputPrintf(L"* WARNING: %s: Maleformatted Line: %zu\n", _hashFile, _entry->line);
+            break;
+        case VERIFY_UNKNOWN:
+            outputPrintf(L"* WARNING: %s: Unknown Hash-Algorithem\n", _entry->pszFile);
+            break;
+        case VERIFY_OK:
+            outputPrintf(L"%s: OK\n", _entry->pszFile);
+            break;
+        case VERIFY_MISSING:
+            outputPrintf(L"%s: MISSING\n", _entry->pszFile);
+            break;
+        default:
+            outputPrintf(L"%s: FAILED\n", _entry->pszFile);
+            break;
+    }
+}
+
+/*
+ * writes a Merkle-manifest of directory-trees (/MERKLE).
+ * ------------------------------------------------------
+ * every file-line is preceded by "#M size write-time", every directory
+ * is followed by "#D digest  path" and every tree ends with
+ * "#R digest  root". the file-lines themselves are ordinary
+ * "hash  file"-lines, so /C without /MERKLE still reads every file.
+ * ------------------------------------------------------
+ * 
+ * _IN:
+ *      _pvRoots: the names/paths of the directories
+ *      _cvRoots: the size of the _pvRoots vector
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: true on success, false if a tree could not be hashed
+ */
+bool writeMerkleManifest(SETTINGS *_settings, LPWSTR *_pvRoots, SIZE_T _cvRoots)
+{
+    bool bSuccess = true;
+
+    for (SIZE_T i = 0; i < _cvRoots; ++i)
+    {
+        TREE_WALK walk;
+        MERKLE_FILE *pFiles = NULL;
+        MERKLE_FILE **ppFiles = NULL;
+        BYTE digest[MERKLE_DIGEST_LENGTH];
+        WCHAR hex[MERKLE_DIGEST_LENGTH * 2 + 1];
+
+        if (!walkMerkleTree(_settings, _pvRoots[i], &walk, &pFiles) ||
+            ! (ppFiles = HeapAlloc(GetProcessHeap(), 0, sizeof(MERKLE_FILE *) * (walk.cFileNames + 1))))
+        {
+            bSuccess = false;
+        }
+        else
+        {
+            for (SIZE_T j = 0; j < walk.cFileNames; ++j)
+                ppFiles[j] = &pFiles[j];
+
+            if (!hashMerkleFiles(_settings, ppFiles, walk.cFileNames) ||
+                !merkleRollup(_pvRoots[i], pFiles, walk.cFileNames, digest, printMerkleEntry, NULL))
+            {
+                fwprintf_s(stderr, L"* ERROR: allocating memory for the tree of %s failed\n", _pvRoots[i]);
+                bSuccess = false;
+            }
+            else
+            {
+                byteToHexStrW(digest, hex, MERKLE_DIGEST_LENGTH * 2);
+                outputPrintf(L"#R %s  %s\n", hex, _pvRoots[i]);
+            }
+
+            // files that could not be read are not part of the tree
+            for (SIZE_T j = 0; j < walk.cFileNames; ++j)
+            {
+                if (!pFiles[j].bHashed) bSuccess = false;
+            }
+        }
+
+        if (ppFiles) HeapFree(GetProcessHeap(), 0, ppFiles);
+        if (pFiles) HeapFree(GetProcessHeap(), 0, pFiles);
+        walkFree(&walk);
+    }
+
+    return bSuccess;
+}
+
+/*
+ * checks directory-trees against Merkle-manifests (/C /MERKLE).
+ * -------------------------------------------------------------
+ * the trees are listed again, which costs no reads. only files whose
+ * size or write-time differ from the manifest, and new files, are
+ * hashed, the digests of all other files are taken from the manifest.
+ * then the root-hash is calculated again and compared. changed, new
+ * and removed files are printed, followed by the root-hash of every
+ * tree and a summary.
+ * -------------------------------------------------------------
+ * 
+ * _IN:
+ *      _pvManifests: the names/paths of the manifests
+ *      _cvManifests: the size of the _pvManifests vector
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: true if every tree has the root-hash of its manifest
+ */
+bool checkMerkleManifest(SETTINGS *_settings, LPWSTR *_pvManifests, SIZE_T _cvManifests)
+{
+    bool bIntact = true;
+    SIZE_T cUnchanged = 0, cHashed = 0, cChanged = 0, cNew = 0, cRemoved = 0;
+
+    for (SIZE_T m = 0; m < _cvManifests; ++m)
+    {
+        MERKLE_MANIFEST manifest;
+
+        DWORD dwError = merkleLoadManifest(_pvManifests[m], &manifest);
+        if (dwError != ERROR_SUCCESS)
+        {
+            printSystemError(_pvManifests[m], dwError);
+            merkleFreeManifest(&manifest);
+            bIntact = false;
+            continue;
+        }
+
+        if (manifest.cRoots == 0)
+        {
+            fwprintf_s(stderr, L"* WARNING: %s: no tree written with /MERKLE found\n", _pvManifests[m]);
+            bIntact = false;
+        }
+
+        for (SIZE_T r = 0; r < manifest.cRoots; ++r)
+        {
+            const MERKLE_ROOT *root = &manifest.pRoots[r];
+            MERKLE_FILE *pOld = &manifest.pFiles[root->iFirst];
+            TREE_WALK walk;
+            MERKLE_FILE *pFiles = NULL;
+            MERKLE_FILE **ppPending = NULL;
+            const MERKLE_FILE **ppOld = NULL;
+            SIZE_T cPending = 0;
+
+            merkleSortFiles(pOld, root->cFiles);
+
+            if (!walkMerkleTree(_settings, root->pszPath, &walk, &pFiles) ||
+                ! (ppPending = HeapAlloc(GetProcessHeap(), 0, sizeof(MERKLE_FILE *) * (walk.cFileNames + 1))) ||
+                ! (ppOld = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(MERKLE_FILE *) * (walk.cFileNames + 1))))
+            {
+                if (ppPending) HeapFree(GetProcessHeap(), 0, ppPending);
+                if (pFiles) HeapFree(GetProcessHeap(), 0, pFiles);
+                walkFree(&walk);
+                bIntact = false;
+                continue;
+            }
+
+            // both lists are in the order of the walk
+            SIZE_T i = 0, j = 0;
+            while (i < root->cFiles || j < walk.cFileNames)
+            {
+                int cmp = i >= root->cFiles ? 1 : j >= walk.cFileNames ? -1 : walkComparePaths(pOld[i].pszPath, pFiles[j].pszPath);
+
+                if (cmp < 0)
+                {
+                    outputPrintf(L"%s: REMOVED\n", pOld[i++].pszPath);
+                    ++cRemoved;
+                    continue;
+                }
+
+                if (cmp == 0)
+                {
+                    const MERKLE_FILE *old = &pOld[i++];
+                    ppOld[j] = old;
+
+                    // the metadata did not change, the file is not read
+                    if (old->bHashed && old->ftLastWrite != 0 &&
+                        old->cbFile == pFiles[j].cbFile && old->ftLastWrite == pFiles[j].ftLastWrite)
+                    {
+                        CopyMemory(pFiles[j].digest, old->digest, MERKLE_DIGEST_LENGTH);
+                        pFiles[j++].bHashed = true;
+                        ++cUnchanged;
+                        continue;
+                    }
+                }
+
+                ppPending[cPending++] = &pFiles[j++];
+            }
+
+            if (!hashMerkleFiles(_settings, ppPending, cPending))
+                bIntact = false;
+
+            cHashed += cPending;
+
+            for (SIZE_T k = 0; k < cPending; ++k)
+            {
+                const MERKLE_FILE *file = ppPending[k];
+                const MERKLE_FILE *old = ppOld[file - pFiles];
+
+                if (!file->bHashed)
+                {
+                    outputPrintf(L"%s: FAILED\n", file->pszPath);
+                    ++cChanged;
+                }
+                else if (!old)
+                {
+                    outputPrintf(L"%s: NEW\n", file->pszPath);
+                    ++cNew;
+                }
+                else if (!old->bHashed || memcmp(old->digest, file->digest, MERKLE_DIGEST_LENGTH) != 0)
+                {
+                    outputPrintf(L"%s: CHANGED\n", file->pszPath);
+                    ++cChanged;
+                }
+            }
+
+            BYTE digest[MERKLE_DIGEST_LENGTH];
+            WCHAR hex[MERKLE_DIGEST_LENGTH * 2 + 1];
+
+            if (!merkleRollup(root->pszPath, pFiles, walk.cFileNames, digest, NULL, NULL))
+            {
+                fwprintf_s(stderr, L"* ERROR: allocating memory for the tree of %s failed\n", root->pszPath);
+                bIntact = false;
+            }
+            else
+            {
+                bool bSame = memcmp(digest, root->digest, MERKLE_DIGEST_LENGTH) == 0;
+                if (!bSame) bIntact = false;
+
+                byteToHexStrW(digest, hex, MERKLE_DIGEST_LENGTH * 2);
+                outputPrintf(L"%s: %s, root %s\n", root->pszPath, bSame ? L"OK" : L"CHANGED", hex);
+            }
+
+            HeapFree(GetProcessHeap(), 0, ppOld);
+            HeapFree(GetProcessHeap(), 0, ppPending);
+            HeapFree(GetProcessHeap(), 0, pFiles);
+            walkFree(&walk);
+        }
+
+        merkleFreeManifest(&manifest);
+    }
+
+    outputPrintf(L"%zu unchanged, %zu hashed, %zu changed, %zu new, %zu removed\n", cUnchanged, cHashed, cChanged, cNew, cRemoved);
+
+    return bIntact;
+}
+
+/*
+ * lists a directory-tree for /MERKLE and queries the metadata of its
+ * files. the metadata is queried before the files are read, so a
+ * change while hashing is seen by the next check.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _root: the name/path of the directory
+ * 
+ * _OUT:
+ *      _walk: the walk, free it with walkFree()
+ *      _ppFiles: the files in the order of the walk, NULL on error
+ * 
+ * _RETURNS: true on success, false on error (the error is printed)
+ */
+bool walkMerkleTree(SETTINGS *_settings, LPCWSTR _root, TREE_WALK *_walk, MERKLE_FILE **_ppFiles)
+{
+    *_ppFiles = NULL;
+    walkInit(_walk, &_settings->filter, printSystemError);
+
+    DWORD dwAttributes = GetFileAttributesW(_root);
+    if (dwAttributes == INVALID_FILE_ATTRIBUTES || !(dwAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        fwprintf_s(stderr, L"* ERROR: /MERKLE needs a directory: %s\n", _root);
+        return false;
+    }
+
+    if (!walkTree(_walk, _root, WALK_THREADS) ||
+        ! (*_ppFiles = HeapAlloc(GetProcessHeap(), 0, sizeof(MERKLE_FILE) * (_walk->cFileNames + 1))))
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the list of files failed\n");
+        return false;
+    }
+
+    // without metadata (write-time 0) the file is read again by every check
+    for (SIZE_T i = 0; i < _walk->cFileNames; ++i)
+        merkleQueryFile(_walk->pvFileNames[i], &(*_ppFiles)[i]);
+
+    return true;
+}
+
+/*
+ * hashes files of a tree with calculateFilehashBatch(), so /J and
+ * /CACHE apply.
+ * 
+ * _IN:
+ *      _ppFiles: the files to hash
+ *      _cFiles: the number of files
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool hashMerkleFiles(SETTINGS *_settings, MERKLE_FILE **_ppFiles, SIZE_T _cFiles)
+{
+    if (_cFiles == 0) return true;
+
+    LPWSTR *pvFileNames = HeapAlloc(GetProcessHeap(), 0, sizeof(LPWSTR) * _cFiles);
+    if (!pvFileNames) return false;
+
+    for (SIZE_T i = 0; i < _cFiles; ++i)
+        pvFileNames[i] = _ppFiles[i]->pszPath;
+
+    LPWSTR *pvOutput = calculateFilehashBatch(_settings, pvFileNames, _cFiles, false);
+
+    for (SIZE_T i = 0; i < _cFiles; ++i)
+    {
+        (*_ppFiles[i]).bHashed = pvOutput && pvOutput[i] && merkleParseDigest(pvOutput[i], _ppFiles[i]->digest);
+
+        if (pvOutput && pvOutput[i]) HeapFree(GetProcessHeap(), 0, pvOutput[i]);
+    }
+
+    if (pvOutput) HeapFree(GetProcessHeap(), 0, pvOutput);
+    HeapFree(GetProcessHeap(), 0, pvFileNames);
+
+    return pvOutput != NULL;
+}
+
+/*
+ * prints a line of a Merkle-manifest, called by merkleRollup().
+ * 
+ * _IN:
+ *      _context: unused
+ *      _path: the path of the file or directory
+ *      _cchPath: the length of _path
+ *      _digest: the digest of the file or directory
+ *      _file: the file, NULL for a directory
+ */
+void printMerkleEntry(void *_context, LPCWSTR _path, SIZE_T _cchPath, const BYTE *_digest, const MERKLE_FILE *_file)
+{
+    WCHAR hex[MERKLE_DIGEST_LENGTH * 2 + 1];
+
+    byteToHexStrW((PBYTE)_digest, hex, MERKLE_DIGEST_LENGTH * 2);
+
+    if (_file)
+    {
+        outputPrintf(L"#M %llu %016llX\n", _file->cbFile, _file->ftLastWrite);
+        outputPrintf(L"%s  %s\n", hex, _file->pszPath);
+    }
+    else
+        outputPrintf(L"#D %s  %.*s\n", hex, (int)_cchPath, _path);
+}
+
+/*
+ * finds files with the same content (/DUPES).
+ * -------------------------------------------
+ * the files are narrowed down in stages: only files of the same size
+ * are candidates, of those only files with the same first few KB, and
+ * only the remaining candidates are hashed in full, by the worker-pool
+ * of /J. the duplicates are printed in groups, largest files first,
+ * followed by the number of bytes that deleting them would free.
+ * -------------------------------------------
+ * 
+ * _IN:
+ *      _pvFileNames: a vector containing the names/paths of the files
+ *      _cvFileNames: the size of the _pvFileNames vector
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool findDuplicates(SETTINGS *_settings, LPWSTR *_pvFileNames, SIZE_T _cvFileNames)
+{
+    DUPE_FILE *pFiles = HeapAlloc(GetProcessHeap(), 0, sizeof(DUPE_FILE) * (_cvFileNames + 1));
+    LPWSTR *pvCandidates = HeapAlloc(GetProcessHeap(), 0, sizeof(LPWSTR) * (_cvFileNames + 1));
+    LPWSTR *pvOutput = NULL;
+
+    if (!pFiles || !pvCandidates)
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the list of files failed\n");
+        if (pFiles) HeapFree(GetProcessHeap(), 0, pFiles);
+        if (pvCandidates) HeapFree(GetProcessHeap(), 0, pvCandidates);
+        return false;
+    }
+
+    SIZE_T cFiles = dupesQuerySizes(pFiles, _pvFileNames, _cvFileNames, printSystemError);
+    cFiles = dupesKeepDuplicates(pFiles, cFiles, DUPES_BY_SIZE);
+
+    // reading the prefixes waits on the disk, so it always runs on several threads
+    cFiles = dupesHashPrefixes(pFiles, cFiles, _settings->cThreads > 1 ? _settings->cThreads : DUPES_THREADS,
+                                printSystemError);
+    cFiles = dupesKeepDuplicates(pFiles, cFiles, DUPES_BY_PREFIX);
+
+    if (cFiles > 0)
+    {
+        for (SIZE_T i = 0; i < cFiles; ++i)
+            pvCandidates[i] = pFiles[i].pszPath;
+
+        if (! (pvOutput = calculateFilehashBatch(_settings, pvCandidates, cFiles, false)))
+            cFiles = 0;
+
+        for (SIZE_T i = 0; i < cFiles; ++i)
+            pFiles[i].pszDigests = pvOutput[i];
+
+        cFiles = dupesKeepDuplicates(pFiles, cFiles, DUPES_BY_DIGEST);
+    }
+
+    SIZE_T cGroups = 0;
+    SIZE_T cDuplicates = 0;
+    ULONGLONG cbReclaimable = 0;
+
+    for (SIZE_T i = 0; i < cFiles; ++i)
+    {
+        // the first file of a group is kept, the others could be deleted
+        if (i == 0 || !dupesSameGroup(&pFiles[i-1], &pFiles[i], DUPES_BY_DIGEST))
+        {
+            if (i > 0) outputString(L"\n");
+            ++cGroups;
+        }
+        else
+        {
+            ++cDuplicates;
+            cbReclaimable += pFiles[i].cbFile;
+        }
+
+        printFileHash(_settings, pFiles[i].pszDigests, pFiles[i].pszPath);
+        HeapFree(GetProcessHeap(), 0, pFiles[i].pszDigests);
+    }
+
+    if (cGroups > 0) outputString(L"\n");
+    outputPrintf(L"%zu groups, %zu duplicates, %llu bytes reclaimable\n", cGroups, cDuplicates, cbReclaimable);
+
+    if (pvOutput) HeapFree(GetProcessHeap(), 0, pvOutput);
+    HeapFree(GetProcessHeap(), 0, pvCandidates);
+    HeapFree(GetProcessHeap(), 0, pFiles);
+
+    return true;
+}
+
+/*
+ * measures the throughput of every algorithm and engine (/BENCH).
+ * ---------------------------------------------------------------
+ * synthetic data is hashed in memory on one thread, with every
+ * engine the cpu supports and with the Crypto-API, fed in spans of
+ * every size of BENCH_BLOCKS. all engines of an algorithm have to
+ * calculate the same digest, otherwise the benchmark fails. then
+ * the data is written to a temp-file, which is hashed with the
+ * fastest engine of every algorithm in each mode of the reader.
+ * ---------------------------------------------------------------
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: true on success, false if an engine calculated a wrong
+ *          digest or the benchmark could not be run
+ */
+bool runBenchmark(SETTINGS *_settings)
+{
+    SIZE_T cbData = _settings->cbBench;
+    PBYTE pbData = VirtualAlloc(NULL, cbData, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    BENCH_RESULT *pResults = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(BENCH_RESULT) * BENCH_MAX_RESULTS);
+
+    if (!pbData || !pResults || !outputInit())
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the benchmark failed\n");
+        if (pbData) VirtualFree(pbData, 0, MEM_RELEASE);
+        if (pResults) HeapFree(GetProcessHeap(), 0, pResults);
+        outputFree();
+        return false;
+    }
+
+    // xorshift64*, the data must neither repeat nor compress
+    ULONGLONG seed = 0x9E3779B97F4A7C15ULL;
+    for (SIZE_T i = 0; i + sizeof(ULONGLONG) <= cbData; i += sizeof(ULONGLONG))
+    {
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+
+        ULONGLONG value = seed * 0x2545F4914F6CDD1DULL;
+        CopyMemory(&pbData[i], &value, sizeof(value));
+    }
+
+    outputPrintf(L"HASHSUM.EXE v%hs benchmark, %zu MB per measurement, one thread\n\n",
+                HASHSUM_VERSION, cbData / (1024 * 1024));
+
+    SIZE_T cResults = 0;
+    bool bOk = true;
+
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+    {
+        if (!benchAlgorithm(ALL_ALGORITHMS[i], pbData, cbData, pResults, &cResults))
+            bOk = false;
+
+        // many small files of SHA256 are hashed side by side
+        if (_wcsicmp(ALL_ALGORITHMS[i], BCRYPT_SHA256_ALGORITHM) == 0 && sha256MultiLanes() > 1 &&
+            cResults < BENCH_MAX_RESULTS && !benchMultiBuffer(pbData, cbData, &pResults[cResults++]))
+            bOk = false;
+    }
+
+    printBenchMatrix(L"GB/s", pResults, cResults, false);
+    outputString(L"\n");
+    printBenchMatrix(L"cycles/byte", pResults, cResults, true);
+    outputString(L"\n");
+
+    if (!benchFile(_settings, pbData, cbData))
+        bOk = false;
+
+    outputFree();
+    HeapFree(GetProcessHeap(), 0, pResults);
+    VirtualFree(pbData, 0, MEM_RELEASE);
+
+    return bOk;
+}
+
+/*
+ * selects an engine of an in-tree algorithm.
+ * 
+ * _IN:
+ *      _nativeAlg: the in-tree algorithm
+ *      _engine: the SHA_ENGINE, BLAKE3_ENGINE or CHECKSUM_ENGINE to select,
+ *              0 for the fastest one
+ * 
+ * _RETURNS: the name of the selected engine, NULL if the cpu does not
+ *          support _engine
+ */
+const char *selectBenchEngine(NATIVE_ALG _nativeAlg, int _engine)
+{
+    switch (_nativeAlg)
+    {
+        case NATIVE_SHA1:
+        case NATIVE_SHA256:
+        {
+            SHA_ENGINE selected = shaSelectEngine((SHA_ENGINE)_engine);
+            return !_engine || (int)selected == _engine ? shaEngineName(selected) : NULL;
+        }
+        case NATIVE_BLAKE3:
+        {
+            BLAKE3_ENGINE selected = blake3SelectEngine((BLAKE3_ENGINE)_engine);
+            return !_engine || (int)selected == _engine ? blake3EngineName(selected) : NULL;
+        }
+        case NATIVE_XXH3:
+        case NATIVE_CRC32C:
+        {
+            CHECKSUM_ENGINE selected = checksumSelectEngine((CHECKSUM_ENGINE)_engine);
+            return !_engine || (int)selected == _engine ? checksumEngineName(selected) : NULL;
+        }
+        default:
+            return "CNG";
+    }
+}
+
+/*
+ * measures an algorithm with every engine, one row per engine.
+ * 
+ * _IN:
+ *      _pszAlgId: the CNG-name of the algorithm
+ *      _pbData: the synthetic data
+ *      _cbData: the size of _pbData in bytes
+ * 
+ * _IN_OUT:
+ *      _pResults: the rows of the matrix, room for BENCH_MAX_RESULTS
+ *      _pcResults: the number of rows
+ * 
+ * _RETURNS: true on success, false if an engine failed or calculated
+ *          another digest than the first one
+ */
+bool benchAlgorithm(LPCWSTR _pszAlgId, const BYTE *_pbData, SIZE_T _cbData, BENCH_RESULT *_pResults, SIZE_T *_pcResults)
+{
+    NATIVE_ALG nativeAlg = getNativeAlgorithm(_pszAlgId);
+    BYTE reference[MAX_DIGEST_LENGTH];
+    const char *pszReference = NULL;
+    bool bOk = true;
+
+    // the in-tree engines first, CNG also calculates MD5, SHA1 and SHA2 but none of the others
+    int cEngines = 0;
+    switch (nativeAlg)
+    {
+        case NATIVE_SHA1:
+        case NATIVE_SHA256: cEngines = SHA_ENGINE_SHANI; break;
+        case NATIVE_BLAKE3: cEngines = BLAKE3_ENGINE_AVX2; break;
+        case NATIVE_XXH3:
+        case NATIVE_CRC32C: cEngines = CHECKSUM_ENGINE_AVX2; break;
+        default: break;
+    }
+
+    bool bCng = nativeAlg == NATIVE_NONE || nativeAlg == NATIVE_SHA1 || nativeAlg == NATIVE_SHA256;
+
+    for (int engine = 1; engine <= cEngines + (bCng ? 1 : 0) && *_pcResults < BENCH_MAX_RESULTS; ++engine)
+    {
+        // the AVX2-engine of CRC32C is the one of SSE4.2
+        if (nativeAlg == NATIVE_CRC32C && engine == CHECKSUM_ENGINE_AVX2) continue;
+
+        bool bLibrary = engine > cEngines;
+        const char *pszEngine = bLibrary ? "CNG" : selectBenchEngine(nativeAlg, engine);
+        if (!pszEngine) continue;
+
+        HASH_STATE state = { .pszAlgId = _pszAlgId };
+        NTSTATUS status = bLibrary ? openCngAlgorithm(&state) : openHashAlgorithm(&state);
+        if (status == STATUS_SUCCESSFUL)
+            status = createHashObject(&state);
+
+        state.cTreeThreads = 1;
+
+        BENCH_RESULT *result = &_pResults[(*_pcResults)++];
+        result->pszAlgId = _pszAlgId;
+        strcpy_s(result->szEngine, sizeof(result->szEngine), pszEngine);
+
+        for (SIZE_T i = 0; i < BENCH_BLOCK_SIZES && status == STATUS_SUCCESSFUL; ++i)
+        {
+            if (!benchMemory(&state, _pbData, _cbData, BENCH_BLOCKS[i], result, i))
+                status = STATUS_UNSUCCESSFUL;
+            else if (!pszReference)
+            {
+                CopyMemory(reference, state.pbHash, state.cbHash);
+                pszReference = pszEngine;
+            }
+            else if (memcmp(reference, state.pbHash, state.cbHash) != 0)
+            {
+                fwprintf_s(stderr, L"* ERROR: the %s-digest of engine %hs differs from the one of %hs\n",
+                            _pszAlgId, pszEngine, pszReference);
+                bOk = false;
+                break;
+            }
+        }
+
+        if (status != STATUS_SUCCESSFUL)
+        {
+            fwprintf_s(stderr, L"* ERROR: benchmark of %s (%hs) failed with status: 0x%x\n", _pszAlgId, pszEngine, status);
+            bOk = false;
+        }
+
+        hashFree(&state);
+    }
+
+    // the temp-file and the multi-buffer engine are measured with the fastest engines
+    selectBenchEngine(nativeAlg, 0);
+
+    return bOk;
+}
+
+/*
+ * hashes the synthetic data once, in spans of _cbBlock bytes.
+ * 
+ * _IN:
+ *      _pbData: the synthetic data
+ *      _cbData: the size of _pbData in bytes
+ *      _cbBlock: the size of the spans
+ *      _iBlock: the column of the matrix
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm, receives the digest
+ *      _result: the row of the matrix
+ * 
+ * _RETURNS: true on success, false if hashing failed
+ */
+bool benchMemory(HASH_STATE *_state, const BYTE *_pbData, SIZE_T _cbData, DWORD _cbBlock, BENCH_RESULT *_result, SIZE_T _iBlock)
+{
+    NTSTATUS status = STATUS_SUCCESSFUL;
+
+    // warms up the caches and the provider
+    hashBegin(_state);
+    hashData(_state, (PBYTE)_pbData, _cbData < _cbBlock ? (DWORD)_cbData : _cbBlock);
+    hashFinish(_state);
+
+    LONGLONG start = statsNow();
+    uint64_t cycles = readCycleCounter();
+
+    hashBegin(_state);
+
+    for (SIZE_T offset = 0; offset < _cbData && status == STATUS_SUCCESSFUL; offset += _cbBlock)
+    {
+        DWORD cbSpan = _cbData - offset < _cbBlock ? (DWORD)(_cbData - offset) : _cbBlock;
+        status = hashData(_state, (PBYTE)&_pbData[offset], cbSpan);
+    }
+
+    if (status == STATUS_SUCCESSFUL)
+        status = hashFinish(_state);
+
+    cycles = readCycleCounter() - cycles;
+    double seconds = statsSeconds(statsNow() - start);
+
+    _result->pGBs[_iBlock] = seconds > 0.0 ? (double)_cbData / seconds / (1024.0 * 1024.0 * 1024.0) : 0.0;
+    _result->pCyclesPerByte[_iBlock] = (double)cycles / (double)_cbData;
+
+    return status == STATUS_SUCCESSFUL;
+}
+
+/*
+ * hashes the synthetic data as files of the size of each block with
+ * the multi-buffer engine of SHA256, one row of the matrix. blocks
+ * larger than SMALL_FILE_THRESHOLD are not hashed this way.
+ * 
+ * _IN:
+ *      _pbData: the synthetic data
+ *      _cbData: the size of _pbData in bytes
+ * 
+ * _OUT:
+ *      _result: the row of the matrix
+ * 
+ * _RETURNS: true on success, false if a digest differs from the one
+ *          of the selected single-buffer engine
+ */
+bool benchMultiBuffer(const BYTE *_pbData, SIZE_T _cbData, BENCH_RESULT *_result)
+{
+    _result->pszAlgId = BCRYPT_SHA256_ALGORITHM;
+    sprintf_s(_result->szEngine, sizeof(_result->szEngine), "MULTI-%zu", sha256MultiLanes());
+
+    for (SIZE_T i = 0; i < BENCH_BLOCK_SIZES; ++i)
+    {
+        DWORD cbBlock = BENCH_BLOCKS[i];
+        SIZE_T cMessages = _cbData / cbBlock;
+
+        if (cbBlock > SMALL_FILE_THRESHOLD || cMessages == 0)
+        {
+            _result->pGBs[i] = _result->pCyclesPerByte[i] = -1.0;
+            continue;
+        }
+
+        const uint8_t *ppData[SMALL_FILE_GROUP];
+        size_t pcbData[SMALL_FILE_GROUP];
+        uint8_t digests[SMALL_FILE_GROUP][SHA256_DIGEST_LENGTH];
+
+        LONGLONG start = statsNow();
+        uint64_t cycles = readCycleCounter();
+
+        for (SIZE_T n = 0; n < cMessages; n += SMALL_FILE_GROUP)
+        {
+            SIZE_T cGroup = cMessages - n < SMALL_FILE_GROUP ? cMessages - n : SMALL_FILE_GROUP;
+
+            for (SIZE_T m = 0; m < cGroup; ++m)
+            {
+                ppData[m] = &_pbData[(n + m) * cbBlock];
+                pcbData[m] = cbBlock;
+            }
+
+            sha256Multi(ppData, pcbData, cGroup, digests);
+        }
+
+        cycles = readCycleCounter() - cycles;
+        double seconds = statsSeconds(statsNow() - start);
+        SIZE_T cbHashed = cMessages * cbBlock;
+
+        _result->pGBs[i] = seconds > 0.0 ? (double)cbHashed / seconds / (1024.0 * 1024.0 * 1024.0) : 0.0;
+        _result->pCyclesPerByte[i] = (double)cycles / (double)cbHashed;
+
+        // the first file of the last group is checked against the single-buffer engine
+        SHA256_CTX ctx;
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        sha256Init(&ctx);
+        sha256Update(&ctx, ppData[0], pcbData[0]);
+        sha256Final(&ctx, digest);
+
+        if (memcmp(digest, digests[0], SHA256_DIGEST_LENGTH) != 0)
+        {
+            fwprintf_s(stderr, L"* ERROR: the SHA256-digest of engine %hs differs from the one of %hs\n",
+                        _result->szEngine, shaEngineName(shaGetEngine()));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * writes the synthetic data to a temp-file and hashes it with the
+ * fastest engine of every algorithm, in each mode of the reader. the
+ * file was just written, so MAP and BLOCK read it from the page-cache
+ * and NOCACHE from the disk.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _pbData: the synthetic data
+ *      _cbData: the size of _pbData in bytes
+ * 
+ * _RETURNS: true on success, false if the file could not be written or
+ *          hashed, or a digest differs from the one of the data in memory
+ */
+bool benchFile(SETTINGS *_settings, const BYTE *_pbData, SIZE_T _cbData)
+{
+    static const READER_MODE modes[] = { READER_MAP, READER_BLOCK, READER_NOCACHE };
+    static const LPCWSTR modeNames[] = { L"MAP", L"BLOCK", L"NOCACHE" };
+
+    WCHAR szTempPath[MAX_PATH], szTempFile[MAX_PATH];
+    if (!GetTempPathW(MAX_PATH, szTempPath) || !GetTempFileNameW(szTempPath, L"hsb", 0, szTempFile))
+    {
+        printSystemError(L"temp-file", GetLastError());
+        return false;
+    }
+
+    HANDLE hFile = CreateFileW(szTempFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD dwError = hFile == INVALID_HANDLE_VALUE ? GetLastError() : ERROR_SUCCESS;
+
+    for (SIZE_T offset = 0; offset < _cbData && dwError == ERROR_SUCCESS; offset += READER_BLOCK_SIZE)
+    {
+        DWORD cbWrite = _cbData - offset < READER_BLOCK_SIZE ? (DWORD)(_cbData - offset) : READER_BLOCK_SIZE;
+        DWORD cbWritten;
+
+        if (!WriteFile(hFile, &_pbData[offset], cbWrite, &cbWritten, NULL))
+            dwError = GetLastError();
+    }
+
+    // NOCACHE has to find the data on the disk
+    if (dwError == ERROR_SUCCESS && !FlushFileBuffers(hFile))
+        dwError = GetLastError();
+
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+
+    if (dwError != ERROR_SUCCESS)
+    {
+        printSystemError(szTempFile, dwError);
+        DeleteFileW(szTempFile);
+        return false;
+    }
+
+    SETTINGS settings = *_settings;
+    settings.cHashes = 1;
+    settings.pCache = NULL;
+    settings.pResume = NULL;
+    settings.pFanout = NULL;
+    settings.bSplit = false;
+
+    outputPrintf(L"%-21s", L"temp-file, GB/s");
+    for (SIZE_T m = 0; m < _countof(modes); ++m)
+        outputPrintf(L"%10s", modeNames[m]);
+    outputString(L"\n");
+
+    bool bOk = true;
+    for (SIZE_T i = 0; i < MAX_HASHES && bOk; ++i)
+    {
+        HASH_STATE *state = &settings.hashes[0];
+        ZeroMemory(state, sizeof(HASH_STATE));
+        state->pszAlgId = ALL_ALGORITHMS[i];
+
+        BYTE reference[MAX_DIGEST_LENGTH];
+        NTSTATUS status = openHashAlgorithm(state);
+        if (status == STATUS_SUCCESSFUL)
+            status = createHashObject(state);
+
+        state->cTreeThreads = 1;
+
+        if (status == STATUS_SUCCESSFUL)
+        {
+            hashBegin(state);
+
+            // in spans, 4096 MB do not fit into the DWORD of hashData()
+            for (SIZE_T offset = 0; offset < _cbData && status == STATUS_SUCCESSFUL; offset += READER_BLOCK_SIZE)
+            {
+                DWORD cbSpan = _cbData - offset < READER_BLOCK_SIZE ? (DWORD)(_cbData - offset) : READER_BLOCK_SIZE;
+                status = hashData(state, (PBYTE)&_pbData[offset], cbSpan);
+            }
+
+            if (status == STATUS_SUCCESSFUL) status = hashFinish(state);
+            CopyMemory(reference, state->pbHash, state->cbHash);
+        }
+
+        if (status != STATUS_SUCCESSFUL)
+        {
+            fwprintf_s(stderr, L"* ERROR: benchmark of %s failed with status: 0x%x\n", state->pszAlgId, status);
+            bOk = false;
+        }
+        else
+            outputPrintf(L"%-8s %-12hs", state->pszAlgId, selectBenchEngine(state->nativeAlg, 0));
+
+        for (SIZE_T m = 0; m < _countof(modes) && bOk; ++m)
+        {
+            if (!readerInit(&settings.reader, modes[m]))
+            {
+                fwprintf_s(stderr, L"* ERROR: allocating memory for the read-buffer failed\n");
+                bOk = false;
+                break;
+            }
+
+            settings.ioMode = modes[m];
+
+            LONGLONG start = statsNow();
+            bool bHashed = hashFile(&settings, szTempFile);
+            double seconds = statsSeconds(statsNow() - start);
+
+            readerFree(&settings.reader);
+
+            if (!bHashed)
+                bOk = false;
+            else if (memcmp(reference, state->pbHash, state->cbHash) != 0)
+            {
+                fwprintf_s(stderr, L"* ERROR: the %s-digest of the temp-file read with %s differs from the one in memory\n",
+                            state->pszAlgId, modeNames[m]);
+                bOk = false;
+            }
+            else
+                outputPrintf(L"%10.2f", seconds > 0.0 ? (double)_cbData / seconds / (1024.0 * 1024.0 * 1024.0) : 0.0);
+        }
+
+        outputString(L"\n");
+
+        hashFree(state);
+    }
+
+    DeleteFileW(szTempFile);
+
+    return bOk;
+}
+
+/*
+ * prints the throughput or the cycles per byte of the rows of /BENCH,
+ * one column per block-size.
+ * 
+ * _IN:
+ *      _title: the heading of the first column
+ *      _pResults: the rows of the matrix
+ *      _cResults: the number of rows
+ *      _bCycles: print cycles per byte instead of GB/s
+ */
+void printBenchMatrix(LPCWSTR _title, const BENCH_RESULT *_pResults, SIZE_T _cResults, bool _bCycles)
+{
+    outputPrintf(L"%-21s", _title);
+
+    for (SIZE_T i = 0; i < BENCH_BLOCK_SIZES; ++i)
+    {
+        WCHAR szBlock[16];
+        if (BENCH_BLOCKS[i] >= 1024 * 1024)
+            swprintf_s(szBlock, _countof(szBlock), L"%lu MB", BENCH_BLOCKS[i] / (1024 * 1024));
+        else
+            swprintf_s(szBlock, _countof(szBlock), L"%lu KB", BENCH_BLOCKS[i] / 1024);
+
+        outputPrintf(L"%10s", szBlock);
+    }
+
+    outputString(L"\n");
+
+    for (SIZE_T n = 0; n < _cResults; ++n)
+    {
+        outputPrintf(L"%-8s %-12hs", _pResults[n].pszAlgId, _pResults[n].szEngine);
+
+        for (SIZE_T i = 0; i < BENCH_BLOCK_SIZES; ++i)
+        {
+            double value = _bCycles ? _pResults[n].pCyclesPerByte[i] : _pResults[n].pGBs[i];
+
+            if (value < 0.0)
+                outputPrintf(L"%10s", L"-");
+            else
+                outputPrintf(L"%10.2f", value);
+        }
+
+        outputString(L"\n");
+    }
+}
+
+/*
+ * calculates hash-digests for files in a batch.
+ * ---------------------------------------------
+ * with more than one thread configured (/J), the files are hashed
+ * by a pool of workers. the results are still printed in the order
+ * of the _pvFileNames-vector.
+ * ---------------------------------------------
+ * TODO: error checking/handling
+ * ---------------------------------------------
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _pvFileNames: a vector containing the names/paths of the files to hash
+ *      _cvFileNames: the size of the _pvFileNames vector
+ *      _bPrint: print the digests, false if the caller prints them itself
+ * 
+ * _RETURNS: a vector containing the calculated hashes, order matches the
+ *          _pvFileNames-vector. with _bPrint the digests are freed as
+ *          soon as they are printed and the vector holds NULLs only
+ */
+LPWSTR *calculateFilehashBatch(SETTINGS *_settings, LPWSTR *_pvFileNames, SIZE_T _cvFileNames, bool _bPrint)
+{
+    LPWSTR *pbOutput;
+    if (! (pbOutput = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR) * _cvFileNames)))
+        return pbOutput;
+
+    DWORD cThreads = _settings->cThreads;
+    if (cThreads > _cvFileNames) cThreads = (DWORD)_cvFileNames;
+
+    if (cThreads <= 1)
+    {
+        if (_settings->bSplit && !_settings->pFanout)
+            (*_settings).pFanout = createFanout(_settings);
+
+        for (SIZE_T i = 0; i < _cvFileNames; i += SMALL_FILE_GROUP)
+        {
+            SIZE_T cGroup = _cvFileNames - i;
+            if (cGroup > SMALL_FILE_GROUP) cGroup = SMALL_FILE_GROUP;
+
+            FILE_STATS stats[SMALL_FILE_GROUP];
+            calculateFileGroup(_settings, &_pvFileNames[i], cGroup, &pbOutput[i], stats);
+
+            for (SIZE_T j = i; j < i + cGroup && _bPrint; ++j)
+            {
+                printFileResult(_settings, pbOutput[j], _pvFileNames[j], _settings->bStats ? &stats[j - i] : NULL);
+                if (pbOutput[j]) HeapFree(GetProcessHeap(), 0, pbOutput[j]);
+                pbOutput[j] = NULL;
+            }
+        }
+
+        return pbOutput;
+    }
+
+    HASH_BATCH batch = {
+        .pSettings = _settings,
+        .pvFileNames = _pvFileNames,
+        .pvOutput = pbOutput,
+        .pStats = NULL,
+        .cvFileNames = _cvFileNames,
+        .nNext = 0
+    };
+
+    /*
+     * the workers take groups of small files for the multi-buffer engine,
+     * but every worker should still get several groups, so a few large
+     * files are not hashed one after the other by a single worker.
+     */
+    batch.cGroup = 1;
+    if (useMultiBuffer(_settings))
+    {
+        batch.cGroup = _cvFileNames / (cThreads * 4);
+        if (batch.cGroup > SMALL_FILE_GROUP) batch.cGroup = SMALL_FILE_GROUP;
+        if (batch.cGroup < 1) batch.cGroup = 1;
+    }
+
+    // the processors not used by the workers are left to BLAKE3
+    batch.cTreeThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS) / cThreads;
+    if (batch.cTreeThreads < 1) batch.cTreeThreads = 1;
+
+    batch.pbDone = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(bool) * _cvFileNames);
+    HANDLE *phThreads = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HANDLE) * cThreads);
+    if (_settings->bStats)
+        batch.pStats = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(FILE_STATS) * _cvFileNames);
+
+    if (!batch.pbDone || !phThreads || (_settings->bStats && !batch.pStats))
+    {
+        fwprintf_s(stderr, L"* ERROR: allocating memory for the worker-pool failed\n");
+        if (batch.pbDone) HeapFree(GetProcessHeap(), 0, batch.pbDone);
+        if (batch.pStats) HeapFree(GetProcessHeap(), 0, batch.pStats);
+        if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+        HeapFree(GetProcessHeap(), 0, pbOutput);
+        return NULL;
+    }
+
+    InitializeSRWLock(&batch.lock);
+    InitializeConditionVariable(&batch.cvDone);
+
+    DWORD cStarted = 0;
+    for (; cStarted < cThreads; ++cStarted)
+    {
+        if (! (phThreads[cStarted] = CreateThread(NULL, 0, hashBatchWorker, &batch, 0, NULL)))
+            break;
+    }
+
+    if (cStarted == 0)
+    {
+        // no worker could be started, so the main-thread does all the work
+        fwprintf_s(stderr, L"* WARNING: creating worker-threads failed, hashing sequential\n");
+        hashBatchWorker(&batch);
+    }
+
+    // print the results in command-line order as soon as they are available
+    for (SIZE_T i = 0; i < _cvFileNames; ++i)
+    {
+        AcquireSRWLockExclusive(&batch.lock);
+        while (!batch.pbDone[i])
+            SleepConditionVariableSRW(&batch.cvDone, &batch.lock, INFINITE, 0);
+        ReleaseSRWLockExclusive(&batch.lock);
+
+        if (_bPrint)
+        {
+            printFileResult(_settings, pbOutput[i], _pvFileNames[i], batch.pStats ? &batch.pStats[i] : NULL);
+            if (pbOutput[i]) HeapFree(GetProcessHeap(), 0, pbOutput[i]);
+            pbOutput[i] = NULL;
+        }
+    }
+
+    for (DWORD i = 0; i < cStarted; ++i)
+    {
+        WaitForSingleObject(phThreads[i], INFINITE);
+        CloseHandle(phThreads[i]);
+    }
+
+    HeapFree(GetProcessHeap(), 0, phThreads);
+    HeapFree(GetProcessHeap(), 0, batch.pbDone);
+    if (batch.pStats) HeapFree(GetProcessHeap(), 0, batch.pStats);
+
+    return pbOutput;
+}
+
+/*
+ * worker-thread of calculateFilehashBatch().
+ * ------------------------------------------
+ * takes the next group of unprocessed files from the batch until
+ * all files are done. every worker has its own hash-objects, only the
+ * algorithm providers are shared with the main-thread.
+ * ------------------------------------------
+ * 
+ * _IN_OUT:
+ *      _param: the HASH_BATCH to process
+ * 
+ * _RETURNS: 0 on success, 1 if the hash-object could not be created
+ */
+DWORD WINAPI hashBatchWorker(LPVOID _param)
+{
+    HASH_BATCH *batch = (HASH_BATCH *)_param;
+
+    SETTINGS settings = *batch->pSettings;
+    bool bReady = readerInit(&settings.reader, settings.ioMode);
+
+    for (SIZE_T i = 0; i < settings.cHashes; ++i)
+    {
+        if (createHashObject(&settings.hashes[i]) != STATUS_SUCCESSFUL)
+            bReady = false;
+
+        settings.hashes[i].cTreeThreads = batch->cTreeThreads;
+    }
+
+    settings.pFanout = bReady && settings.bSplit ? createFanout(&settings) : NULL;
+
+    for (;;)
+    {
+        LONG i = InterlockedAdd(&batch->nNext, (LONG)batch->cGroup) - (LONG)batch->cGroup;
+        if (i >= (LONG)batch->cvFileNames) break;
+
+        SIZE_T cGroup = batch->cvFileNames - i;
+        if (cGroup > batch->cGroup) cGroup = batch->cGroup;
+        LPWSTR lpwOutput[SMALL_FILE_GROUP] = { NULL };
+
+        // the statistics of the group are read by the main-thread after it is done
+        if (bReady)
+            calculateFileGroup(&settings, &batch->pvFileNames[i], cGroup, lpwOutput,
+                                batch->pStats ? &batch->pStats[i] : NULL);
+
+        AcquireSRWLockExclusive(&batch->lock);
+        for (SIZE_T j = 0; j < cGroup; ++j)
+        {
+            batch->pvOutput[i + j] = lpwOutput[j];
+            batch->pbDone[i + j] = true;
+        }
+        ReleaseSRWLockExclusive(&batch->lock);
+
+        WakeAllConditionVariable(&batch->cvDone);
+    }
+
+    destroyFanout(settings.pFanout);
+    readerFree(&settings.reader);
+
+    for (SIZE_T i = 0; i < settings.cHashes; ++i)
+        destroyHashObject(&settings.hashes[i]);
+
+    return bReady ? 0 : 1;
+}
+
+/*
+ * prints the result of a file in the selected output-format and adds
+ * its statistics to the ones of the run.
+ * 
+ * _IN:
+ *      _digests: the digests as returned by calculateFileHash(), NULL if
+ *              hashing failed
+ *      _fileName: the name/path of the hashed file
+ *      _stats: the statistics of the file, NULL without /STATS
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ */
+void printFileResult(SETTINGS *_settings, LPCWSTR _digests, LPCWSTR _fileName, const FILE_STATS *_stats)
+{
+    statsAdd(&_settings->run, _stats, !_digests);
+
+    if (_settings->bJson)
+        printJsonResult(_settings, _digests, _fileName, _stats);
+    else
+    {
+        printFileHash(_settings, _digests, _fileName);
+
+        if (_stats && _digests) statsPrintFile(_fileName, _stats);
+    }
+}
+
+/*
+ * prints the calculated digests in the default output-format,
+ * one line per algorithm.
+ * ---------------------------------------------------------------
+ * algorithms whose digest can not be told apart by its length
+ * are printed as "TAG (file) = digest".
+ * ---------------------------------------------------------------
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _digests: the digests as multi-string (one NUL-terminated digest
+ *              per algorithm, terminated by an empty string), NULL if
+ *              hashing failed
+ *      _fileName: the name/path of the hashed file
+ */
+void printFileHash(const SETTINGS *_settings, LPCWSTR _digests, LPCWSTR _fileName)
+{
+    if (!_digests) return;
+
+    LPCWSTR digest = _digests;
+    for (SIZE_T i = 0; i < _settings->cHashes && *digest; ++i, digest += wcslen(digest) + 1)
+    {
+        LPCWSTR pszAlgId = _settings->hashes[i].pszAlgId;
+
+        // the lines are put together without parsing a format, there are millions of them
+        if (isTaggedAlgorithm(pszAlgId))
+        {
+            outputString(pszAlgId);
+            outputWrite(L" (", 2);
+            outputString(_fileName);
+            outputWrite(L") = ", 4);
+            outputString(digest);
+        }
+        else
+        {
+            outputString(digest);
+            outputWrite(L"  ", 2);
+            outputString(_fileName);
+        }
+
+        outputWrite(L"\n", 1);
+    }
+}
+
+/*
+ * prints the result of a file as an element of the "files"-array of
+ * the JSON-output (/JSON), the digests are null if hashing failed.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _digests: the digests as returned by calculateFileHash()
+ *      _fileName: the name/path of the hashed file
+ *      _stats: the statistics of the file, NULL without /STATS
+ */
+void printJsonResult(const SETTINGS *_settings, LPCWSTR _digests, LPCWSTR _fileName, const FILE_STATS *_stats)
+{
+    // the file was already counted by printFileResult()
+    outputString(_settings->run.cFiles > 1 ? L",\n  {\"path\": " : L"\n  {\"path\": ");
+    jsonPrintString(_fileName);
+    outputString(L", \"digests\": ");
+
+    if (!_digests)
+        outputString(L"null");
+    else
+    {
+        LPCWSTR digest = _digests;
+        for (SIZE_T i = 0; i < _settings->cHashes && *digest; ++i, digest += wcslen(digest) + 1)
+            outputPrintf(L"%s\"%s\": \"%s\"", i ? L", " : L"{", _settings->hashes[i].pszAlgId, digest);
+
+        outputString(L"}");
+    }
+
+    if (_stats)
+    {
+        outputString(L", \"stats\": {");
+        jsonPrintStats(_stats);
+        outputString(L"}");
+    }
+
+    outputString(L"}");
+}
+
+/*
+ * calculates the hash-digests of a group of files.
+ * ------------------------------------------------
+ * if SHA256 is the only algorithm and the cpu has a multi-buffer
+ * engine, the small files of the group are read whole into the
+ * read-buffer and hashed side by side in the lanes of the engine.
+ * larger files, files that are cached and files that could not be
+ * read whole are hashed one by one with calculateFileHash().
+ * ------------------------------------------------
+ * 
+ * _IN:
+ *      _pvFileNames: the names/paths of the files, at most SMALL_FILE_GROUP
+ *      _cvFileNames: the size of the _pvFileNames vector
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _OUT:
+ *      _pvOutput: the digests of every file as returned by calculateFileHash()
+ *      _pvStats: the statistics of every file, may be NULL
+ */
+void calculateFileGroup(SETTINGS *_settings, LPWSTR *_pvFileNames, SIZE_T _cvFileNames, LPWSTR *_pvOutput, FILE_STATS *_pvStats)
+{
+    HASH_STATE *state = &_settings->hashes[0];
+
+    if (!useMultiBuffer(_settings))
+    {
+        for (SIZE_T i = 0; i < _cvFileNames; ++i)
+        {
+            _pvOutput[i] = calculateFileHash(_settings, _pvFileNames[i]);
+            if (_pvStats) _pvStats[i] = _settings->fileStats;
+        }
+
+        return;
+    }
+
+    FILE_STATS stats[SMALL_FILE_GROUP] = { 0 };
+
+    const uint8_t *ppData[SMALL_FILE_GROUP];
+    size_t pcbData[SMALL_FILE_GROUP];
+    SIZE_T pIndex[SMALL_FILE_GROUP];
+    uint8_t digests[SMALL_FILE_GROUP][SHA256_DIGEST_LENGTH];
+    bool pbDeferred[SMALL_FILE_GROUP];
+    SIZE_T cMessages = 0;
+
+    // no file is open, so the read-buffer of the reader is free
+    PBYTE pbArena = _settings->reader.pbBuffer;
+    bool bNoCache = _settings->ioMode == READER_NOCACHE;
+
+    for (SIZE_T i = 0; i < _cvFileNames; ++i)
+    {
+        CACHE_KEY key;
+        DWORD cbFile = 0;
+        LONGLONG start = statsNow();
+
+        pbDeferred[i] = true;
+        _pvOutput[i] = NULL;
+
+        // cached files are not read at all
+        if (_settings->pCache && cacheQueryFile(_pvFileNames[i], &key))
+        {
+            bool bCached = cacheLookup(_settings->pCache, &key, state->pszAlgId, state->pbHash, state->cbHash);
+            cacheFreeKey(&key);
+
+            if (bCached)
+            {
+                _pvOutput[i] = formatDigests(_settings);
+                pbDeferred[i] = false;
+                stats[i].wallTicks = statsNow() - start;
+                continue;
+            }
         }
 
-        SIZE_T cFile = wcsnlen(pbFile, BUFSIZ) + 1;
-        SIZE_T cHash = wcsnlen(pbHash, 128) + 1;
-        (*_pvFileNames)[counter] = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(WCHAR) * cFile); 
-        (*_pvFileHashes)[counter] = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(WCHAR) * cHash);
-        swprintf_s((*_pvFileNames)[counter], cFile, L"%s", pbFile);
-        swprintf_s((*_pvFileHashes)[counter], cHash, L"%s", pbHash);
+        // unbuffered reads need an aligned buffer, a file still takes at most SMALL_FILE_THRESHOLD bytes
+        if (bNoCache)
+            pbArena = (PBYTE)(((ULONG_PTR)pbArena + READER_SECTOR_SIZE - 1) & ~(ULONG_PTR)(READER_SECTOR_SIZE - 1));
+
+        if (!readSmallFile(_pvFileNames[i], pbArena, &cbFile, bNoCache))
+            continue;
+
+        ppData[cMessages] = pbArena;
+        pcbData[cMessages] = cbFile;
+        pIndex[cMessages++] = i;
+        pbDeferred[i] = false;
+        pbArena += cbFile;
+
+        stats[i].cbRead = cbFile;
+        stats[i].ioTicks = stats[i].wallTicks = statsNow() - start;
+    }
+
+    LONGLONG start = statsNow();
+    sha256Multi(ppData, pcbData, cMessages, digests);
+    LONGLONG hashTicks = statsNow() - start;
+
+    // the files were hashed side by side, each gets its share of the time by its size
+    ULONGLONG cbMessages = 0;
+    for (SIZE_T n = 0; n < cMessages; ++n)
+        cbMessages += pcbData[n];
 
-        if (feof(pHashFile)) break;
+    for (SIZE_T n = 0; n < cMessages; ++n)
+    {
+        FILE_STATS *fileStats = &stats[pIndex[n]];
+        fileStats->hashTicks = cbMessages ? (LONGLONG)((double)hashTicks * pcbData[n] / cbMessages) : hashTicks / (LONGLONG)cMessages;
+        fileStats->wallTicks += fileStats->hashTicks;
+    }
+
+    for (SIZE_T n = 0; n < cMessages; ++n)
+    {
+        CACHE_KEY key;
+        LPWSTR fileName = _pvFileNames[pIndex[n]];
 
-        (*_pvFileNames) = HeapReAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (*_pvFileNames), sizeof(LPWSTR) * allocCount);
-        (*_pvFileHashes) = HeapReAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (*_pvFileHashes), sizeof(LPWSTR) * allocCount);
+        CopyMemory(state->pbHash, digests[n], SHA256_DIGEST_LENGTH);
 
-        ++allocCount;
-        ++counter;
+        if (_settings->pCache && cacheQueryFile(fileName, &key))
+        {
+            cacheStore(_settings->pCache, &key, state->pszAlgId, state->pbHash, state->cbHash);
+            cacheFreeKey(&key);
+        }
+
+        _pvOutput[pIndex[n]] = formatDigests(_settings);
     }
 
-    fclose(pHashFile);
+    for (SIZE_T i = 0; i < _cvFileNames; ++i)
+    {
+        if (pbDeferred[i])
+        {
+            _pvOutput[i] = calculateFileHash(_settings, _pvFileNames[i]);
+            stats[i] = _settings->fileStats;
+        }
+    }
 
-    return counter;
+    if (_pvStats) CopyMemory(_pvStats, stats, sizeof(FILE_STATS) * _cvFileNames);
 }
 
 /*
- * calculates hash-digests for files in a batch.
- * ---------------------------------------------
- * TODO: error checking/handling
- * ---------------------------------------------
+ * checks if the files can be hashed with the multi-buffer engine,
+ * which calculates SHA256 only.
  * 
  * _IN:
  *      _settings: the application SETTINGS-object
- *      _pvFileNames: a vector containing the names/paths of the files to hash
- *      _cvFileNames: the size of the _pvFileNames vector
  * 
- * _RETURNS: a vector containing the calculated hashes, order matches the
- *          _pvFileNames-vector
+ * _RETURNS: true if SHA256 is the only algorithm and the cpu has a
+ *          multi-buffer engine
  */
-LPWSTR *calculateFilehashBatch(SETTINGS *_settings, LPWSTR *_pvFileNames, SIZE_T _cvFileNames)
+bool useMultiBuffer(const SETTINGS *_settings)
 {
-    LPWSTR *pbOutput;
-    if (! (pbOutput = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR) * _cvFileNames)))
-        return pbOutput;
+    return _settings->cHashes == 1
+            && _settings->hashes[0].nativeAlg == NATIVE_SHA256
+            && sha256MultiLanes() > 1;
+}
+
+/*
+ * reads a small file with a single read.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file to read
+ *      _bNoCache: bypass the page-cache, _pbData has to be aligned to
+ *              READER_SECTOR_SIZE
+ * 
+ * _OUT:
+ *      _pbData: receives the data, room for SMALL_FILE_THRESHOLD bytes
+ *      _pcbData: the size of the file
+ * 
+ * _RETURNS: true if the file was read whole, false if it is no regular
+ *          file, larger than SMALL_FILE_THRESHOLD or could not be read
+ */
+bool readSmallFile(LPCWSTR _fileName, PBYTE _pbData, DWORD *_pcbData, bool _bNoCache)
+{
+    HANDLE hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                                _bNoCache ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
 
-    for (int i = 0; i < _cvFileNames; ++i)
-        pbOutput[i] = calculateFileHash(_settings, _pvFileNames[i]);
+    LARGE_INTEGER cbFile;
+    DWORD cbRead = 0;
+    bool bRead = GetFileType(hFile) == FILE_TYPE_DISK
+                && GetFileSizeEx(hFile, &cbFile)
+                && cbFile.QuadPart <= SMALL_FILE_THRESHOLD;
 
-    return pbOutput;
+    // unbuffered reads are a multiple of the sector-size, the read ends at the end of the file
+    DWORD cbRequest = bRead ? (DWORD)cbFile.QuadPart : 0;
+    if (_bNoCache) cbRequest = (cbRequest + READER_SECTOR_SIZE - 1) & ~(DWORD)(READER_SECTOR_SIZE - 1);
+
+    bRead = bRead
+            && (cbFile.QuadPart == 0 || ReadFile(hFile, _pbData, cbRequest, &cbRead, NULL))
+            && cbRead == cbFile.QuadPart;
+
+    CloseHandle(hFile);
+
+    *_pcbData = cbRead;
+
+    return bRead;
 }
 
 /*
- * calculate the hash-digest of a single file.
- * -------------------------------------------
+ * calculate the hash-digests of a single file.
+ * --------------------------------------------
+ * with /CACHE the identity of the file is looked up first, if it
+ * did not change since the digests were cached the file is not
+ * read at all. otherwise the digests are calculated and cached.
+ * --------------------------------------------
  * 
  * _IN:
  *      _fileName: the name/path of the file to hash
  * 
  * _ON_OUT:
- *      _settings: the application SETTINGS-object
+ *      _settings: the application SETTINGS-object, the statistics of the
+ *              file are written to fileStats
  * 
- * _RETURNS: a string containing the calculated digest
+ * _RETURNS: a multi-string containing the calculated digests in the order
+ *          of _settings->hashes, or NULL on error
  */
 LPWSTR calculateFileHash(SETTINGS *_settings, LPWSTR _fileName)
 {
-    LPWSTR lpwOutput = NULL;
+    LONGLONG start = statsNow();
+    ZeroMemory(&_settings->fileStats, sizeof(FILE_STATS));
+
+    CACHE_KEY key;
+    bool bCacheable = _settings->pCache && cacheQueryFile(_fileName, &key);
+    bool bCached = bCacheable;
 
-    FILE *pFile;
-    if (_wfopen_s(&pFile, (LPCWSTR)_fileName, L"rb"))
+    for (SIZE_T i = 0; i < _settings->cHashes && bCached; ++i)
     {
-        WCHAR errMsg[BUFSIZ];
-        _wcserror_s((WCHAR *)&errMsg, BUFSIZ, errno);
-        _fwprintf_p(stderr, L"* %s: %s\n", _fileName, errMsg);
-        return lpwOutput;
+        HASH_STATE *state = &_settings->hashes[i];
+        bCached = cacheLookup(_settings->pCache, &key, state->pszAlgId, state->pbHash, state->cbHash);
     }
 
-    PBYTE buff;
-    if (! (buff = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR) * BUFSIZ)))
-        return lpwOutput;
+    if (!bCached && !hashFile(_settings, _fileName))
+    {
+        if (bCacheable) cacheFreeKey(&key);
+        (*_settings).fileStats.wallTicks = statsNow() - start;
+        return NULL;
+    }
+
+    if (bCacheable && !bCached)
+    {
+        for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        {
+            HASH_STATE *state = &_settings->hashes[i];
+            cacheStore(_settings->pCache, &key, state->pszAlgId, state->pbHash, state->cbHash);
+        }
+    }
+
+    if (bCacheable) cacheFreeKey(&key);
+
+    (*_settings).fileStats.wallTicks = statsNow() - start;
+
+    return formatDigests(_settings);
+}
+
+/*
+ * reads a file and calculates its digests.
+ * ----------------------------------------
+ * the file is read only once, every span is hashed with all
+ * selected algorithms before the next one is read. with /RESUME
+ * a checkpoint is written every RESUME_INTERVAL milliseconds, and
+ * a file with a checkpoint is read from there.
+ * 
+ * the time spent waiting for readerNext() and in the hashes is
+ * added to the statistics of the file. a mapped view is read by
+ * page-faults while it is hashed, which counts as hashing.
+ * ----------------------------------------
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file to hash
+ * 
+ * _ON_OUT:
+ *      _settings: the application SETTINGS-object, the digests are
+ *              written to pbHash of every HASH_STATE, the times and
+ *              bytes to fileStats
+ * 
+ * _RETURNS: true on success, false on error (the error is printed)
+ */
+bool hashFile(SETTINGS *_settings, LPWSTR _fileName)
+{
+    FILE_READER *reader = &_settings->reader;
+
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        hashBegin(&_settings->hashes[i]);
+
+    CACHE_KEY key;
+    bool bResumable = _settings->pResume && cacheQueryFile(_fileName, &key);
+    bool bCheckpoints = bResumable;
+    ULONGLONG offset = bResumable ? loadCheckpoint(_settings, &key) : 0;
+
+    FILE_STATS *stats = &_settings->fileStats;
+    LONGLONG ticks = statsNow();
+
+    DWORD dwError = readerOpen(reader, _fileName, offset);
+    if (dwError != ERROR_SUCCESS)
+    {
+        if (bResumable) cacheFreeKey(&key);
+        printSystemError(_fileName, dwError);
+        return false;
+    }
 
-    while (fread_s(buff, BUFSIZ, sizeof(BYTE), BUFSIZ, pFile))
+    (*_settings).status = STATUS_SUCCESSFUL;
+
+    const BYTE *pbData;
+    SIZE_T cbData;
+
+    __try
     {
-        // pbHash the data
-        if(((*_settings).status = BCryptHashData(_settings->hHash, buff, BUFSIZ, 0)))
+        while (readerNext(reader, &pbData, &cbData))
         {
-            fwprintf(stderr, L"* ERROR: hashing %s failed with code: %#x\n", _fileName, _settings->status);
-            return lpwOutput;
+            LONGLONG now = statsNow();
+            (*stats).ioTicks += now - ticks;
+
+            // pbHash the data
+            if(((*_settings).status = hashSpan(_settings, pbData, (DWORD)cbData)))
+                break;
+
+            ticks = statsNow();
+            (*stats).hashTicks += ticks - now;
+            (*stats).cbRead += cbData;
+
+            offset += cbData;
+
+            if (bCheckpoints && resumeDue(_settings->pResume))
+            {
+                bCheckpoints = saveCheckpoint(_settings, &key, offset);
+                ticks = statsNow();
+            }
         }
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        // I/O-error while accessing a mapped view of the file
+        (*reader).dwError = ERROR_READ_FAULT;
+    }
 
-        if (feof(pFile)) break;
+    // a helper-thread ran into an I/O-error
+    if (_settings->status == STATUS_IN_PAGE_ERROR)
+    {
+        (*_settings).status = STATUS_SUCCESSFUL;
+        (*reader).dwError = ERROR_READ_FAULT;
     }
-    
-    // close the pbHash
-    if(((*_settings).status = BCryptFinishHash(_settings->hHash, _settings->pbHash, _settings->cbHash, 0)))
+
+    dwError = reader->dwError;
+    readerClose(reader);
+
+    if (bResumable) cacheFreeKey(&key);
+
+    if (_settings->status)
     {
-        fwprintf(stderr, L"* ERROR: finishing pbHash failed with code: %#x\n", _settings->status);
-        return lpwOutput;
+        fwprintf(stderr, L"* ERROR: hashing %s failed with code: %#x\n", _fileName, _settings->status);
+        return false;
+    }
+    else if (dwError != ERROR_SUCCESS)
+    {
+        printSystemError(_fileName, dwError);
+        return false;
     }
 
-    if (! (lpwOutput = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LPWSTR) * _settings->cbHash+1)))
-        return lpwOutput;
+    ticks = statsNow();
+
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+    {
+        // close the pbHash
+        if(((*_settings).status = hashFinish(&_settings->hashes[i])))
+        {
+            fwprintf(stderr, L"* ERROR: finishing pbHash failed with code: %#x\n", _settings->status);
+            return false;
+        }
+    }
+
+    (*stats).hashTicks += statsNow() - ticks;
+
+    return true;
+}
+
+/*
+ * restores the states of the hashes from the checkpoint of a file (/RESUME).
+ * 
+ * _IN:
+ *      _key: the identity of the file
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object, the hashes have to be
+ *              reset with hashBegin()
+ * 
+ * _RETURNS: the offset to read the file from, 0 if it has no checkpoint
+ */
+ULONGLONG loadCheckpoint(SETTINGS *_settings, const CACHE_KEY *_key)
+{
+    SAVED_HASH saved[MAX_HASHES];
+    DWORD cbSaved = (DWORD)(sizeof(SAVED_HASH) * _settings->cHashes);
+
+    ULONGLONG offset = resumeFind(_settings->pResume, _key, (PBYTE)saved, cbSaved);
+    if (offset == 0) return 0;
+
+    // a checkpoint written with other algorithms is of no use
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+    {
+        if (saved[i].nativeAlg != _settings->hashes[i].nativeAlg) return 0;
+    }
+
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        (*_settings).hashes[i].native = saved[i].native;
+
+    fwprintf_s(stderr, L"* RESUMED: %s at %llu of %llu bytes\n", _key->pszPath, offset, _key->cbFile);
+
+    return offset;
+}
+
+/*
+ * writes the states of the hashes to the state-file of /RESUME.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ *      _key: the identity of the file being hashed
+ *      _offset: the number of bytes hashed so far
+ * 
+ * _RETURNS: true on success, false on error (the error is printed)
+ */
+bool saveCheckpoint(SETTINGS *_settings, const CACHE_KEY *_key, ULONGLONG _offset)
+{
+    SAVED_HASH saved[MAX_HASHES];
+    DWORD cbSaved = (DWORD)(sizeof(SAVED_HASH) * _settings->cHashes);
+
+    // the smaller engines leave parts of the union undefined
+    ZeroMemory(saved, cbSaved);
+
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+    {
+        saved[i].nativeAlg = _settings->hashes[i].nativeAlg;
+        saved[i].native = _settings->hashes[i].native;
+    }
 
-    if (byteToHexStrW(_settings->pbHash, lpwOutput, _settings->cbHash * 2))
+    DWORD dwError = resumeSave(_settings->pResume, _key, _offset, (const BYTE *)saved, cbSaved);
+    if (dwError != ERROR_SUCCESS)
     {
-        HeapFree(GetProcessHeap(), 0, lpwOutput);
-        return (lpwOutput = NULL);
+        printSystemError(_settings->pszResumeFile, dwError);
+        return false;
     }
 
-    if (_settings->mode == MODE_NORMAL)
-        wprintf(L"%s  %s\n", lpwOutput, _fileName);
+    return true;
+}
+
+/*
+ * converts the digests in pbHash of every HASH_STATE to hex.
+ * 
+ * _IN:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: a multi-string containing the digests in the order of
+ *          _settings->hashes, or NULL on error
+ */
+LPWSTR formatDigests(const SETTINGS *_settings)
+{
+    LPWSTR lpwOutput = NULL;
+
+    // room for all digests and their terminators
+    SIZE_T cchOutput = 1;
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        cchOutput += _settings->hashes[i].cbHash * 2 + 1;
+
+    if (! (lpwOutput = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(WCHAR) * cchOutput)))
+        return lpwOutput;
+
+    LPWSTR lpwDigest = lpwOutput;
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+    {
+        const HASH_STATE *state = &_settings->hashes[i];
+
+        if (byteToHexStrW(state->pbHash, lpwDigest, state->cbHash * 2))
+        {
+            HeapFree(GetProcessHeap(), 0, lpwOutput);
+            return (lpwOutput = NULL);
+        }
+
+        lpwDigest += state->cbHash * 2 + 1;
+    }
 
-    HeapFree(GetProcessHeap(), 0, buff);
+    // terminates the multi-string
+    *lpwDigest = L'\0';
 
     return lpwOutput;
 }
 
+/*
+ * feeds one span of a file into all selected algorithms.
+ * ------------------------------------------------------
+ * with /SPLIT and a large enough span, every algorithm is
+ * calculated on its own thread, otherwise one after the other.
+ * ------------------------------------------------------
+ * 
+ * _IN:
+ *      _data: the span to hash
+ *      _cbData: the size of _data in bytes
+ * 
+ * _IN_OUT:
+ *      _settings: the application SETTINGS-object
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes),
+ *          STATUS_IN_PAGE_ERROR if a helper-thread could not read the span
+ */
+NTSTATUS hashSpan(SETTINGS *_settings, const BYTE *_data, DWORD _cbData)
+{
+    NTSTATUS status;
+    HASH_FANOUT *fanout = _settings->pFanout;
+
+    if (!fanout || _cbData < FANOUT_THRESHOLD)
+    {
+        for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        {
+            if ((status = hashData(&_settings->hashes[i], (PBYTE)_data, _cbData)))
+                return status;
+        }
+
+        return STATUS_SUCCESSFUL;
+    }
+
+    (*fanout).pbData = _data;
+    (*fanout).cbData = _cbData;
+
+    // start the helpers, then calculate the first algorithm on this thread
+    EnterSynchronizationBarrier(&fanout->barrier, 0);
+    status = hashData(&_settings->hashes[0], (PBYTE)_data, _cbData);
+    EnterSynchronizationBarrier(&fanout->barrier, 0);
+
+    for (SIZE_T i = 0; i < fanout->cLanes && !status; ++i)
+    {
+        if (fanout->pLanes[i].bFault) status = STATUS_IN_PAGE_ERROR;
+        else status = fanout->pLanes[i].status;
+    }
+
+    return status;
+}
+
+/*
+ * starts one helper-thread for every algorithm but the first one.
+ * ---------------------------------------------------------------
+ * the helpers use the hash-objects of _settings, so the fanout
+ * belongs to the thread owning _settings.
+ * ---------------------------------------------------------------
+ * 
+ * _IN_OUT:
+ *      _settings: the SETTINGS of the thread calculating the hashes
+ * 
+ * _RETURNS: the new HASH_FANOUT, NULL if there is only one algorithm or
+ *          the threads could not be started (the spans are then hashed
+ *          sequential)
+ */
+HASH_FANOUT *createFanout(SETTINGS *_settings)
+{
+    if (_settings->cHashes < 2) return NULL;
+
+    HASH_FANOUT *fanout = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HASH_FANOUT));
+    if (!fanout) return NULL;
+
+    (*fanout).cLanes = _settings->cHashes - 1;
+    (*fanout).pLanes = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(FANOUT_LANE) * fanout->cLanes);
+    if (!fanout->pLanes ||
+        !InitializeSynchronizationBarrier(&fanout->barrier, (LONG)_settings->cHashes, -1))
+    {
+        if (fanout->pLanes) HeapFree(GetProcessHeap(), 0, fanout->pLanes);
+        HeapFree(GetProcessHeap(), 0, fanout);
+        return NULL;
+    }
+
+    for (SIZE_T i = 0; i < fanout->cLanes; ++i)
+    {
+        FANOUT_LANE *lane = &fanout->pLanes[i];
+        lane->pFanout = fanout;
+        lane->pState = &_settings->hashes[i+1];
+
+        // the helpers are started suspended, so the barrier can still be
+        // changed if not all of them could be created
+        if (! (lane->hThread = CreateThread(NULL, 0, fanoutWorker, lane, CREATE_SUSPENDED, NULL)))
+        {
+            fwprintf_s(stderr, L"* WARNING: creating helper-threads failed, hashing algorithms sequential\n");
+
+            (*fanout).cLanes = i;
+            DeleteSynchronizationBarrier(&fanout->barrier);
+            InitializeSynchronizationBarrier(&fanout->barrier, (LONG)i + 1, -1);
+
+            for (SIZE_T j = 0; j < i; ++j)
+                ResumeThread(fanout->pLanes[j].hThread);
+
+            destroyFanout(fanout);
+            return NULL;
+        }
+    }
+
+    for (SIZE_T i = 0; i < fanout->cLanes; ++i)
+        ResumeThread(fanout->pLanes[i].hThread);
+
+    return fanout;
+}
+
+/*
+ * helper-thread of a HASH_FANOUT.
+ * -------------------------------
+ * waits at the barrier for the next span, hashes it with the
+ * algorithm of its lane and meets the other threads again when
+ * done. an I/O-error on a mapped view only marks the lane.
+ * -------------------------------
+ * 
+ * _IN_OUT:
+ *      _param: the FANOUT_LANE of this thread
+ * 
+ * _RETURNS: always 0
+ */
+DWORD WINAPI fanoutWorker(LPVOID _param)
+{
+    FANOUT_LANE *lane = (FANOUT_LANE *)_param;
+    HASH_FANOUT *fanout = lane->pFanout;
+
+    for (;;)
+    {
+        EnterSynchronizationBarrier(&fanout->barrier, 0);
+        if (fanout->bQuit) break;
+
+        lane->bFault = false;
+
+        __try
+        {
+            lane->status = hashData(lane->pState, (PBYTE)fanout->pbData, fanout->cbData);
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            lane->bFault = true;
+        }
+
+        EnterSynchronizationBarrier(&fanout->barrier, 0);
+    }
+
+    return 0;
+}
+
+/*
+ * stops the helper-threads and frees a HASH_FANOUT.
+ * 
+ * _IN_OUT:
+ *      _fanout: the fanout to destroy, can be NULL
+ */
+void destroyFanout(HASH_FANOUT *_fanout)
+{
+    if (!_fanout) return;
+
+    // the helpers leave their loop after the next barrier
+    if (_fanout->cLanes > 0)
+    {
+        (*_fanout).bQuit = true;
+        EnterSynchronizationBarrier(&_fanout->barrier, 0);
+    }
+
+    for (SIZE_T i = 0; i < _fanout->cLanes; ++i)
+    {
+        WaitForSingleObject(_fanout->pLanes[i].hThread, INFINITE);
+        CloseHandle(_fanout->pLanes[i].hThread);
+    }
+
+    DeleteSynchronizationBarrier(&_fanout->barrier);
+    HeapFree(GetProcessHeap(), 0, _fanout->pLanes);
+    HeapFree(GetProcessHeap(), 0, _fanout);
+}
+
+/*
+ * prints the message of a win32 error-code to stderr.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file the error belongs to
+ *      _dwError: the error-code, as returned by GetLastError()
+ */
+void printSystemError(LPCWSTR _fileName, DWORD _dwError)
+{
+    WCHAR errMsg[BUFSIZ] = {0};
+
+    DWORD cchMsg = FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                                    NULL, _dwError, 0, errMsg, BUFSIZ, NULL);
+
+    // system-messages end with a line-break
+    while (cchMsg > 0 && iswspace(errMsg[cchMsg-1]))
+        errMsg[--cchMsg] = L'\0';
+
+    if (cchMsg == 0)
+        swprintf_s(errMsg, BUFSIZ, L"error %lu", _dwError);
+
+    _fwprintf_p(stderr, L"* %s: %s\n", _fileName, errMsg);
+}
+
 /*
  * determines the type of the hash-algorithem for a given hHash-string.
  * -------------------------------------------------------------------
+ * the tag of a "TAG (file) = hash"-line names the algorithm, untagged
+ * hashes are guessed by their length. BLAKE3 has the same length as
+ * SHA256, so it is only recognized by its tag, as are XXH3 and CRC32C.
+ * -------------------------------------------------------------------
  * 
  * _IN:
  *      _hash: a string containing a hash
+ *      _tag: the algorithm named by the line, or NULL
  * 
  * _RETURNS: a constant string containing the name of the algorithem,
  *          or NULL if algorithem could not be determined
  */
-LPCWSTR getHashType(LPWSTR _hash)
+LPCWSTR getHashType(LPWSTR _hash, LPCWSTR _tag)
 {
-    switch (wcsnlen(_hash, 128))
+    SIZE_T cchHash = wcsnlen(_hash, 129);
+
+    if (_tag)
+        return cchHash == getDigestLength(_tag) * 2 ? _tag : NULL;
+
+    switch (cchHash)
     {
         case 32: return BCRYPT_MD5_ALGORITHM;
         case 40: return BCRYPT_SHA1_ALGORITHM;
@@ -501,7 +3138,6 @@ LPCWSTR getHashType(LPWSTR _hash)
     }
 }
 
-
 /*
  * cleans up objects and heap-space used by the Crypto-API.
  * --------------------------------------------------------
@@ -511,17 +3147,8 @@ LPCWSTR getHashType(LPWSTR _hash)
  */
 void cleanupCryptoAPI(SETTINGS *_settings)
 {
-    if(_settings->hAlg)
-        BCryptCloseAlgorithmProvider(_settings->hAlg,0);
-
-    if (_settings->hHash)    
-        BCryptDestroyHash(_settings->hHash);
-
-    if(_settings->pbHashObject)
-        HeapFree(GetProcessHeap(), 0, (*_settings).pbHashObject);
-
-    if(_settings->pbHash)
-        HeapFree(GetProcessHeap(), 0, (*_settings).pbHash);
+    for (SIZE_T i = 0; i < _settings->cHashes; ++i)
+        hashFree(&_settings->hashes[i]);
 }
 
 /*
@@ -533,8 +3160,11 @@ void printHelp()
     wprintf(L"HASHSUM.EXE v%hs\n", HASHSUM_VERSION);
     wprintf(L"\n");
     wprintf(L"Usage:\n");
-    wprintf(L"\tHASHSUM.EXE [/MD5 /SHA1 /SHA256 /SHA384 /SHA512] <file> [files ...]\n");
-    wprintf(L"\tHASHSUM.EXE [/C] <hash-file> [hash-files ...]\n");
+    wprintf(L"\tHASHSUM.EXE [/MD5 /SHA1 /SHA256 /SHA384 /SHA512 /BLAKE3 /XXH3 /CRC32C | /ALL] [/SPLIT] [/J[:<n>]] [/IO:<mode>] [/NOCACHE] [/ENGINE:<name>] [/CACHE:<file>] [/RESUME:<file>] [/STATS] [/JSON] [/R [/INCLUDE:<glob>] [/EXCLUDE:<glob>]] <file> [files ...]\n");
+    wprintf(L"\tHASHSUM.EXE [/C] [/J[:<n>]] [/IO:<mode>] [/NOCACHE] [/CACHE:<file>] <hash-file> [hash-files ...]\n");
+    wprintf(L"\tHASHSUM.EXE /DUPES [<algorithm>] [/J[:<n>]] [/INCLUDE:<glob>] [/EXCLUDE:<glob>] <file|directory> [...]\n");
+    wprintf(L"\tHASHSUM.EXE [/C] /MERKLE [/J[:<n>]] [/INCLUDE:<glob>] [/EXCLUDE:<glob>] <directory|manifest> [...]\n");
+    wprintf(L"\tHASHSUM.EXE /BENCH[:<MB>]\n");
     wprintf(L"\n");
     wprintf(L"Options:\n");
     wprintf(L"\t/?          = shows usage info\n");
@@ -544,4 +3174,48 @@ void printHelp()
     wprintf(L"\t/SHA256     = generate SHA256-Digest (default)\n");
     wprintf(L"\t/SHA385     = generate SHA384-Digest\n");
     wprintf(L"\t/SHA512     = generate SHA512-Digest\n");
+    wprintf(L"\t/BLAKE3     = generate BLAKE3-Digest\n");
+    wprintf(L"\t/XXH3       = generate XXH3-Checksum (64 bit, not cryptographic)\n");
+    wprintf(L"\t/CRC32C     = generate CRC32C-Checksum (not cryptographic)\n");
+    wprintf(L"\t/ALL        = generate all of the above Digests\n");
+    wprintf(L"\t              (algorithms can be combined, every file is read once)\n");
+    wprintf(L"\t/SPLIT      = calculate the algorithms of a file on separate threads\n");
+    wprintf(L"\t/J[:<n>]    = hash or verify files with <n> threads, one per logical\n");
+    wprintf(L"\t              processor if <n> is omitted or 0\n");
+    wprintf(L"\t/IO:<mode>  = how files are read: AUTO (default, maps large files),\n");
+    wprintf(L"\t              MAP (always map) or BLOCK (overlapped block-reads)\n");
+    wprintf(L"\t/NOCACHE    = read with block-reads that bypass the page-cache, so hashing\n");
+    wprintf(L"\t              large files does not evict the data of other programs\n");
+    wprintf(L"\t/ENGINE:<name>\n");
+    wprintf(L"\t            = engine for the in-tree algorithms: AUTO (default), SCALAR,\n");
+    wprintf(L"\t              SSE4, AVX2 or SHANI\n");
+    wprintf(L"\t/CACHE:<file>\n");
+    wprintf(L"\t            = keep the digests in <file>, unchanged files (same path,\n");
+    wprintf(L"\t              volume, file-index, size and write-time) are not read\n");
+    wprintf(L"\t/RESUME:<file>\n");
+    wprintf(L"\t            = write a checkpoint of the file being hashed to <file>\n");
+    wprintf(L"\t              every 10 seconds, after a crash the file is read on\n");
+    wprintf(L"\t              from there (SHA1, SHA256, BLAKE3, XXH3 and CRC32C)\n");
+    wprintf(L"\t/STATS      = print bytes, time, time waiting for reads and hashing\n");
+    wprintf(L"\t              and MB/s of every file and of the run to stderr\n");
+    wprintf(L"\t/JSON       = print the digests (and statistics) of the files as one\n");
+    wprintf(L"\t              JSON-document\n");
+    wprintf(L"\t/R          = hash the files of the given directories and all\n");
+    wprintf(L"\t              subdirectories, sorted by path\n");
+    wprintf(L"\t/INCLUDE:<glob>\n");
+    wprintf(L"\t            = with /R only hash files whose name matches <glob>\n");
+    wprintf(L"\t              (* and ?), can be given more than once\n");
+    wprintf(L"\t/EXCLUDE:<glob>\n");
+    wprintf(L"\t            = with /R skip files and directories whose name matches\n");
+    wprintf(L"\t              <glob>, can be given more than once\n");
+    wprintf(L"\t/DUPES      = find files with the same content in the given files and\n");
+    wprintf(L"\t              directories, only files of the same size and with the\n");
+    wprintf(L"\t              same first 4 KB are hashed in full\n");
+    wprintf(L"\t/MERKLE     = write a Merkle-manifest of the given directories (SHA256,\n");
+    wprintf(L"\t              with directory- and root-hashes), with /C check the trees\n");
+    wprintf(L"\t              of a manifest, only files with changed size or write-time\n");
+    wprintf(L"\t              are read\n");
+    wprintf(L"\t/BENCH[:<MB>]\n");
+    wprintf(L"\t            = measure GB/s and cycles/byte of every algorithm and engine\n");
+    wprintf(L"\t              on <MB> (default 64) of data in memory and in a temp-file\n");
 }
\ No newline at end of file
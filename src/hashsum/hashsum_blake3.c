@@ -0,0 +1,1032 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_blake3.c - in-tree BLAKE3 engine.
+ * 
+ * the compression-function has three implementations:
+ * 
+ *      portable - one input at a time, used on every platform
+ *      sse41    - 4 inputs at once, one in each 32-bit lane (SSSE3/SSE4.1)
+ *      avx2     - 8 inputs at once, one in each 32-bit lane
+ * 
+ * an input is either a chunk of 1024 bytes or a parent-node of two
+ * chaining values. complete subtrees of the chunk-tree are independent
+ * of each other, so blake3UpdateParallel() hands them to the caller to
+ * be hashed on several threads.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_blake3.h"
+
+#include <string.h>
+
+#define BLAKE3_CHUNK_START (1 << 0)
+#define BLAKE3_CHUNK_END (1 << 1)
+#define BLAKE3_PARENT (1 << 2)
+#define BLAKE3_ROOT (1 << 3)
+
+// the widest engine compresses 8 inputs at once
+#define BLAKE3_MAX_SIMD_DEGREE 8
+
+// smaller subtrees are not worth the hand-off to another thread
+#define BLAKE3_MIN_TASK_CHUNKS 128
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+typedef void (*BLAKE3_HASH_MANY_FN)(const uint8_t *const *, size_t, size_t, uint64_t, bool,
+                                    uint8_t, uint8_t, uint8_t, uint8_t *);
+
+/*
+ * everything needed to compress the last block of a chunk or parent-node,
+ * either into a chaining value or into the root digest.
+ */
+typedef struct BLAKE3_OUTPUT {
+    uint32_t cv[8];
+    uint8_t block[BLAKE3_BLOCK_LENGTH];
+    uint8_t cbBlock;
+    uint64_t counter;
+    uint8_t flags;
+} BLAKE3_OUTPUT;
+
+static const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t MSG_SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 }
+};
+
+static BLAKE3_ENGINE activeEngine = BLAKE3_ENGINE_AUTO;
+static BLAKE3_HASH_MANY_FN pfnHashMany = NULL;
+static size_t simdDegree = 1;
+
+static uint32_t loadLE32(const uint8_t *_p)
+{
+    return (uint32_t)_p[0] | ((uint32_t)_p[1] << 8) | ((uint32_t)_p[2] << 16) | ((uint32_t)_p[3] << 24);
+}
+
+static void storeLE32(uint8_t *_p, uint32_t _v)
+{
+    _p[0] = (uint8_t)_v;
+    _p[1] = (uint8_t)(_v >> 8);
+    _p[2] = (uint8_t)(_v >> 16);
+    _p[3] = (uint8_t)(_v >> 24);
+}
+
+static void storeCv(uint8_t _out[BLAKE3_DIGEST_LENGTH], const uint32_t _cv[8])
+{
+    for (int i = 0; i < 8; ++i) storeLE32(&_out[4 * i], _cv[i]);
+}
+
+/* ==== portable compression ==== */
+
+#define BLAKE3_G(v, a, b, c, d, x, y) \
+    do { \
+        v[a] = v[a] + v[b] + (x); v[d] = ROR32(v[d] ^ v[a], 16); \
+        v[c] = v[c] + v[d];       v[b] = ROR32(v[b] ^ v[c], 12); \
+        v[a] = v[a] + v[b] + (y); v[d] = ROR32(v[d] ^ v[a], 8); \
+        v[c] = v[c] + v[d];       v[b] = ROR32(v[b] ^ v[c], 7); \
+    } while (0)
+
+/*
+ * runs the 7 rounds of the compression-function and leaves the
+ * full 16-word state, the callers derive their output from it.
+ */
+static void compressPre(uint32_t _v[16], const uint32_t _cv[8], const uint8_t _block[BLAKE3_BLOCK_LENGTH],
+                        uint8_t _cbBlock, uint64_t _counter, uint8_t _flags)
+{
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) m[i] = loadLE32(&_block[4 * i]);
+
+    for (int i = 0; i < 8; ++i) _v[i] = _cv[i];
+    _v[8] = IV[0];
+    _v[9] = IV[1];
+    _v[10] = IV[2];
+    _v[11] = IV[3];
+    _v[12] = (uint32_t)_counter;
+    _v[13] = (uint32_t)(_counter >> 32);
+    _v[14] = _cbBlock;
+    _v[15] = _flags;
+
+    for (int r = 0; r < 7; ++r)
+    {
+        const uint8_t *s = MSG_SCHEDULE[r];
+
+        BLAKE3_G(_v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        BLAKE3_G(_v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        BLAKE3_G(_v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        BLAKE3_G(_v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        BLAKE3_G(_v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        BLAKE3_G(_v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        BLAKE3_G(_v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        BLAKE3_G(_v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+}
+
+static void compressInPlace(uint32_t _cv[8], const uint8_t _block[BLAKE3_BLOCK_LENGTH],
+                            uint8_t _cbBlock, uint64_t _counter, uint8_t _flags)
+{
+    uint32_t v[16];
+    compressPre(v, _cv, _block, _cbBlock, _counter, _flags);
+
+    for (int i = 0; i < 8; ++i) _cv[i] = v[i] ^ v[i + 8];
+}
+
+/*
+ * hashes one input of _cBlocks complete blocks into a chaining value.
+ */
+static void hashOne(const uint8_t *_input, size_t _cBlocks, uint64_t _counter, uint8_t _flags,
+                    uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t _out[BLAKE3_DIGEST_LENGTH])
+{
+    uint32_t cv[8];
+    memcpy(cv, IV, sizeof(cv));
+
+    uint8_t blockFlags = _flags | _flagsStart;
+    for (; _cBlocks > 0; --_cBlocks, _input += BLAKE3_BLOCK_LENGTH)
+    {
+        if (_cBlocks == 1) blockFlags |= _flagsEnd;
+
+        compressInPlace(cv, _input, BLAKE3_BLOCK_LENGTH, _counter, blockFlags);
+        blockFlags = _flags;
+    }
+
+    storeCv(_out, cv);
+}
+
+static void hashManyPortable(const uint8_t *const *_inputs, size_t _cInputs, size_t _cBlocks, uint64_t _counter,
+                            bool _bIncrement, uint8_t _flags, uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t *_out)
+{
+    for (; _cInputs > 0; --_cInputs, ++_inputs, _out += BLAKE3_DIGEST_LENGTH)
+    {
+        hashOne(*_inputs, _cBlocks, _counter, _flags, _flagsStart, _flagsEnd, _out);
+        if (_bIncrement) ++_counter;
+    }
+}
+
+#if TT_ARCH_X86
+
+/* ==== SSE4.1: 4 inputs at once ==== */
+
+TT_TARGET("ssse3,sse4.1")
+static inline __m128i ror16Sse41(__m128i _x)
+{
+    return _mm_shuffle_epi8(_x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+TT_TARGET("ssse3,sse4.1")
+static inline __m128i ror8Sse41(__m128i _x)
+{
+    return _mm_shuffle_epi8(_x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+#define BLAKE3_G_SSE41(v, a, b, c, d, x, y) \
+    do { \
+        v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), x); \
+        v[d] = ror16Sse41(_mm_xor_si128(v[d], v[a])); \
+        v[c] = _mm_add_epi32(v[c], v[d]); \
+        v[b] = _mm_xor_si128(v[b], v[c]); \
+        v[b] = _mm_or_si128(_mm_srli_epi32(v[b], 12), _mm_slli_epi32(v[b], 20)); \
+        v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), y); \
+        v[d] = ror8Sse41(_mm_xor_si128(v[d], v[a])); \
+        v[c] = _mm_add_epi32(v[c], v[d]); \
+        v[b] = _mm_xor_si128(v[b], v[c]); \
+        v[b] = _mm_or_si128(_mm_srli_epi32(v[b], 7), _mm_slli_epi32(v[b], 25)); \
+    } while (0)
+
+/*
+ * transposes four rows of four words, afterwards _r[j] holds
+ * word j of every row.
+ */
+TT_TARGET("ssse3,sse4.1")
+static inline void transpose4Sse41(__m128i _r[4])
+{
+    __m128i t0 = _mm_unpacklo_epi32(_r[0], _r[1]);
+    __m128i t1 = _mm_unpacklo_epi32(_r[2], _r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(_r[0], _r[1]);
+    __m128i t3 = _mm_unpackhi_epi32(_r[2], _r[3]);
+
+    _r[0] = _mm_unpacklo_epi64(t0, t1);
+    _r[1] = _mm_unpackhi_epi64(t0, t1);
+    _r[2] = _mm_unpacklo_epi64(t2, t3);
+    _r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+TT_TARGET("ssse3,sse4.1")
+static void hash4Sse41(const uint8_t *const *_inputs, size_t _cBlocks, uint64_t _counter, bool _bIncrement,
+                        uint8_t _flags, uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t *_out)
+{
+    __m128i h[8], m[16], v[16];
+    for (int i = 0; i < 8; ++i) h[i] = _mm_set1_epi32((int)IV[i]);
+
+    uint64_t c[4];
+    for (int i = 0; i < 4; ++i) c[i] = _counter + (_bIncrement ? (uint64_t)i : 0);
+
+    __m128i counterLow = _mm_set_epi32((int)c[3], (int)c[2], (int)c[1], (int)c[0]);
+    __m128i counterHigh = _mm_set_epi32((int)(c[3] >> 32), (int)(c[2] >> 32), (int)(c[1] >> 32), (int)(c[0] >> 32));
+
+    uint8_t blockFlags = _flags | _flagsStart;
+    for (size_t b = 0; b < _cBlocks; ++b)
+    {
+        if (b + 1 == _cBlocks) blockFlags |= _flagsEnd;
+
+        for (int g = 0; g < 4; ++g)
+        {
+            for (int l = 0; l < 4; ++l)
+                m[4 * g + l] = _mm_loadu_si128((const __m128i *)&_inputs[l][b * BLAKE3_BLOCK_LENGTH + 16 * g]);
+
+            transpose4Sse41(&m[4 * g]);
+        }
+
+        for (int i = 0; i < 8; ++i) v[i] = h[i];
+        for (int i = 0; i < 4; ++i) v[8 + i] = _mm_set1_epi32((int)IV[i]);
+        v[12] = counterLow;
+        v[13] = counterHigh;
+        v[14] = _mm_set1_epi32(BLAKE3_BLOCK_LENGTH);
+        v[15] = _mm_set1_epi32(blockFlags);
+
+        for (int r = 0; r < 7; ++r)
+        {
+            const uint8_t *s = MSG_SCHEDULE[r];
+
+            BLAKE3_G_SSE41(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            BLAKE3_G_SSE41(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            BLAKE3_G_SSE41(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            BLAKE3_G_SSE41(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            BLAKE3_G_SSE41(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            BLAKE3_G_SSE41(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            BLAKE3_G_SSE41(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            BLAKE3_G_SSE41(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int i = 0; i < 8; ++i) h[i] = _mm_xor_si128(v[i], v[i + 8]);
+        blockFlags = _flags;
+    }
+
+    // back from one word of every input per register to one input per row
+    transpose4Sse41(&h[0]);
+    transpose4Sse41(&h[4]);
+
+    for (int l = 0; l < 4; ++l)
+    {
+        _mm_storeu_si128((__m128i *)&_out[l * BLAKE3_DIGEST_LENGTH], h[l]);
+        _mm_storeu_si128((__m128i *)&_out[l * BLAKE3_DIGEST_LENGTH + 16], h[4 + l]);
+    }
+}
+
+TT_TARGET("ssse3,sse4.1")
+static void hashManySse41(const uint8_t *const *_inputs, size_t _cInputs, size_t _cBlocks, uint64_t _counter,
+                            bool _bIncrement, uint8_t _flags, uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t *_out)
+{
+    for (; _cInputs >= 4; _cInputs -= 4, _inputs += 4, _out += 4 * BLAKE3_DIGEST_LENGTH)
+    {
+        hash4Sse41(_inputs, _cBlocks, _counter, _bIncrement, _flags, _flagsStart, _flagsEnd, _out);
+        if (_bIncrement) _counter += 4;
+    }
+
+    hashManyPortable(_inputs, _cInputs, _cBlocks, _counter, _bIncrement, _flags, _flagsStart, _flagsEnd, _out);
+}
+
+/* ==== AVX2: 8 inputs at once ==== */
+
+TT_TARGET("avx2")
+static inline __m256i ror16Avx2(__m256i _x)
+{
+    return _mm256_shuffle_epi8(_x, _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                                    13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+TT_TARGET("avx2")
+static inline __m256i ror8Avx2(__m256i _x)
+{
+    return _mm256_shuffle_epi8(_x, _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+                                                    12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+#define BLAKE3_G_AVX2(v, a, b, c, d, x, y) \
+    do { \
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x); \
+        v[d] = ror16Avx2(_mm256_xor_si256(v[d], v[a])); \
+        v[c] = _mm256_add_epi32(v[c], v[d]); \
+        v[b] = _mm256_xor_si256(v[b], v[c]); \
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 12), _mm256_slli_epi32(v[b], 20)); \
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y); \
+        v[d] = ror8Avx2(_mm256_xor_si256(v[d], v[a])); \
+        v[c] = _mm256_add_epi32(v[c], v[d]); \
+        v[b] = _mm256_xor_si256(v[b], v[c]); \
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 7), _mm256_slli_epi32(v[b], 25)); \
+    } while (0)
+
+/*
+ * transposes eight rows of eight words, afterwards _r[j] holds
+ * word j of every row.
+ */
+TT_TARGET("avx2")
+static inline void transpose8Avx2(__m256i _r[8])
+{
+    __m256i t0 = _mm256_unpacklo_epi32(_r[0], _r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(_r[0], _r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(_r[2], _r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(_r[2], _r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(_r[4], _r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(_r[4], _r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(_r[6], _r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(_r[6], _r[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    _r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    _r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    _r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    _r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    _r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    _r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    _r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    _r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+TT_TARGET("avx2")
+static void hash8Avx2(const uint8_t *const *_inputs, size_t _cBlocks, uint64_t _counter, bool _bIncrement,
+                        uint8_t _flags, uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t *_out)
+{
+    __m256i h[8], m[16], v[16];
+    for (int i = 0; i < 8; ++i) h[i] = _mm256_set1_epi32((int)IV[i]);
+
+    uint64_t c[8];
+    for (int i = 0; i < 8; ++i) c[i] = _counter + (_bIncrement ? (uint64_t)i : 0);
+
+    __m256i counterLow = _mm256_set_epi32((int)c[7], (int)c[6], (int)c[5], (int)c[4],
+                                            (int)c[3], (int)c[2], (int)c[1], (int)c[0]);
+    __m256i counterHigh = _mm256_set_epi32((int)(c[7] >> 32), (int)(c[6] >> 32), (int)(c[5] >> 32), (int)(c[4] >> 32),
+                                            (int)(c[3] >> 32), (int)(c[2] >> 32), (int)(c[1] >> 32), (int)(c[0] >> 32));
+
+    uint8_t blockFlags = _flags | _flagsStart;
+    for (size_t b = 0; b < _cBlocks; ++b)
+    {
+        if (b + 1 == _cBlocks) blockFlags |= _flagsEnd;
+
+        for (int g = 0; g < 2; ++g)
+        {
+            for (int l = 0; l < 8; ++l)
+                m[8 * g + l] = _mm256_loadu_si256((const __m256i *)&_inputs[l][b * BLAKE3_BLOCK_LENGTH + 32 * g]);
+
+            transpose8Avx2(&m[8 * g]);
+        }
+
+        for (int i = 0; i < 8; ++i) v[i] = h[i];
+        for (int i = 0; i < 4; ++i) v[8 + i] = _mm256_set1_epi32((int)IV[i]);
+        v[12] = counterLow;
+        v[13] = counterHigh;
+        v[14] = _mm256_set1_epi32(BLAKE3_BLOCK_LENGTH);
+        v[15] = _mm256_set1_epi32(blockFlags);
+
+        for (int r = 0; r < 7; ++r)
+        {
+            const uint8_t *s = MSG_SCHEDULE[r];
+
+            BLAKE3_G_AVX2(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            BLAKE3_G_AVX2(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            BLAKE3_G_AVX2(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            BLAKE3_G_AVX2(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            BLAKE3_G_AVX2(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            BLAKE3_G_AVX2(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            BLAKE3_G_AVX2(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            BLAKE3_G_AVX2(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int i = 0; i < 8; ++i) h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+        blockFlags = _flags;
+    }
+
+    // back from one word of every input per register to one input per row
+    transpose8Avx2(h);
+
+    for (int l = 0; l < 8; ++l)
+        _mm256_storeu_si256((__m256i *)&_out[l * BLAKE3_DIGEST_LENGTH], h[l]);
+}
+
+TT_TARGET("avx2")
+static void hashManyAvx2(const uint8_t *const *_inputs, size_t _cInputs, size_t _cBlocks, uint64_t _counter,
+                            bool _bIncrement, uint8_t _flags, uint8_t _flagsStart, uint8_t _flagsEnd, uint8_t *_out)
+{
+    for (; _cInputs >= 8; _cInputs -= 8, _inputs += 8, _out += 8 * BLAKE3_DIGEST_LENGTH)
+    {
+        hash8Avx2(_inputs, _cBlocks, _counter, _bIncrement, _flags, _flagsStart, _flagsEnd, _out);
+        if (_bIncrement) _counter += 8;
+    }
+
+    hashManySse41(_inputs, _cInputs, _cBlocks, _counter, _bIncrement, _flags, _flagsStart, _flagsEnd, _out);
+}
+
+#endif // TT_ARCH_X86
+
+/* ==== engine selection ==== */
+
+/*
+ * selects the compression-functions used by all BLAKE3 contexts.
+ * ---------------------------------------------------------------
+ * BLAKE3_ENGINE_AUTO, or an engine not supported by the cpu, selects
+ * the fastest available one. must be called before any hashing is
+ * done in other threads.
+ * ---------------------------------------------------------------
+ * 
+ * _IN:
+ *      _engine: the wanted engine
+ * 
+ * _RETURNS: the engine which is actually used
+ */
+BLAKE3_ENGINE blake3SelectEngine(BLAKE3_ENGINE _engine)
+{
+    const CPU_FEATURES *cpu = getCpuFeatures();
+    bool bSse41 = cpu->ssse3 && cpu->sse41;
+    bool bAvx2 = bSse41 && cpu->avx2;
+
+    if (_engine == BLAKE3_ENGINE_AUTO ||
+        (_engine == BLAKE3_ENGINE_SSE41 && !bSse41) ||
+        (_engine == BLAKE3_ENGINE_AVX2 && !bAvx2))
+    {
+        if (bAvx2) _engine = BLAKE3_ENGINE_AVX2;
+        else if (bSse41) _engine = BLAKE3_ENGINE_SSE41;
+        else _engine = BLAKE3_ENGINE_PORTABLE;
+    }
+
+    switch (_engine)
+    {
+#if TT_ARCH_X86
+        case BLAKE3_ENGINE_AVX2:
+            pfnHashMany = hashManyAvx2;
+            simdDegree = 8;
+            break;
+        case BLAKE3_ENGINE_SSE41:
+            pfnHashMany = hashManySse41;
+            simdDegree = 4;
+            break;
+#endif
+        default:
+            _engine = BLAKE3_ENGINE_PORTABLE;
+            pfnHashMany = hashManyPortable;
+            simdDegree = 1;
+            break;
+    }
+
+    return (activeEngine = _engine);
+}
+
+/*
+ * returns the currently used engine.
+ */
+BLAKE3_ENGINE blake3GetEngine(void)
+{
+    if (activeEngine == BLAKE3_ENGINE_AUTO) blake3SelectEngine(BLAKE3_ENGINE_AUTO);
+
+    return activeEngine;
+}
+
+/*
+ * returns a printable name for an engine.
+ */
+const char *blake3EngineName(BLAKE3_ENGINE _engine)
+{
+    switch (_engine)
+    {
+        case BLAKE3_ENGINE_PORTABLE: return "portable";
+        case BLAKE3_ENGINE_SSE41: return "sse41";
+        case BLAKE3_ENGINE_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+/* ==== chunks and parent-nodes ==== */
+
+static void chunkInit(BLAKE3_CHUNK *_chunk, uint64_t _chunkCounter)
+{
+    memcpy(_chunk->cv, IV, sizeof(_chunk->cv));
+    memset(_chunk->buffer, 0, sizeof(_chunk->buffer));
+    _chunk->chunkCounter = _chunkCounter;
+    _chunk->cbBuffer = 0;
+    _chunk->cBlocks = 0;
+}
+
+static size_t chunkLength(const BLAKE3_CHUNK *_chunk)
+{
+    return (size_t)_chunk->cBlocks * BLAKE3_BLOCK_LENGTH + _chunk->cbBuffer;
+}
+
+static uint8_t chunkStartFlag(const BLAKE3_CHUNK *_chunk)
+{
+    return _chunk->cBlocks == 0 ? BLAKE3_CHUNK_START : 0;
+}
+
+/*
+ * feeds data into a chunk. the last block is always kept in the
+ * buffer, it needs the CHUNK_END-flag once the chunk is complete.
+ */
+static void chunkUpdate(BLAKE3_CHUNK *_chunk, const uint8_t *_input, size_t _cbInput)
+{
+    if (_chunk->cbBuffer > 0)
+    {
+        size_t cbTake = BLAKE3_BLOCK_LENGTH - _chunk->cbBuffer;
+        if (cbTake > _cbInput) cbTake = _cbInput;
+
+        memcpy(&_chunk->buffer[_chunk->cbBuffer], _input, cbTake);
+        _chunk->cbBuffer += (uint8_t)cbTake;
+        _input += cbTake;
+        _cbInput -= cbTake;
+
+        if (_cbInput == 0) return;
+
+        compressInPlace(_chunk->cv, _chunk->buffer, BLAKE3_BLOCK_LENGTH, _chunk->chunkCounter, chunkStartFlag(_chunk));
+        _chunk->cBlocks++;
+        _chunk->cbBuffer = 0;
+        memset(_chunk->buffer, 0, sizeof(_chunk->buffer));
+    }
+
+    for (; _cbInput > BLAKE3_BLOCK_LENGTH; _input += BLAKE3_BLOCK_LENGTH, _cbInput -= BLAKE3_BLOCK_LENGTH)
+    {
+        compressInPlace(_chunk->cv, _input, BLAKE3_BLOCK_LENGTH, _chunk->chunkCounter, chunkStartFlag(_chunk));
+        _chunk->cBlocks++;
+    }
+
+    memcpy(_chunk->buffer, _input, _cbInput);
+    _chunk->cbBuffer = (uint8_t)_cbInput;
+}
+
+static BLAKE3_OUTPUT chunkOutput(const BLAKE3_CHUNK *_chunk)
+{
+    BLAKE3_OUTPUT output;
+
+    memcpy(output.cv, _chunk->cv, sizeof(output.cv));
+    memcpy(output.block, _chunk->buffer, sizeof(output.block));
+    output.cbBlock = _chunk->cbBuffer;
+    output.counter = _chunk->chunkCounter;
+    output.flags = chunkStartFlag(_chunk) | BLAKE3_CHUNK_END;
+
+    return output;
+}
+
+static BLAKE3_OUTPUT parentOutput(const uint8_t _block[BLAKE3_BLOCK_LENGTH])
+{
+    BLAKE3_OUTPUT output;
+
+    memcpy(output.cv, IV, sizeof(output.cv));
+    memcpy(output.block, _block, sizeof(output.block));
+    output.cbBlock = BLAKE3_BLOCK_LENGTH;
+    output.counter = 0;
+    output.flags = BLAKE3_PARENT;
+
+    return output;
+}
+
+static void outputCv(const BLAKE3_OUTPUT *_output, uint8_t _cv[BLAKE3_DIGEST_LENGTH])
+{
+    uint32_t cv[8];
+    memcpy(cv, _output->cv, sizeof(cv));
+
+    compressInPlace(cv, _output->block, _output->cbBlock, _output->counter, _output->flags);
+    storeCv(_cv, cv);
+}
+
+static void outputRoot(const BLAKE3_OUTPUT *_output, uint8_t _digest[BLAKE3_DIGEST_LENGTH])
+{
+    uint32_t cv[8];
+    memcpy(cv, _output->cv, sizeof(cv));
+
+    // the first output-block of the root always has the counter 0
+    compressInPlace(cv, _output->block, _output->cbBlock, 0, _output->flags | BLAKE3_ROOT);
+    storeCv(_digest, cv);
+}
+
+/* ==== subtrees ==== */
+
+/*
+ * the largest power of two less than or equal to _x (_x > 0).
+ */
+static uint64_t roundDownPow2(uint64_t _x)
+{
+    uint64_t pow2 = 1;
+    while (pow2 <= _x / 2) pow2 *= 2;
+
+    return pow2;
+}
+
+static unsigned popcount64(uint64_t _x)
+{
+    unsigned count = 0;
+    for (; _x; _x &= _x - 1) ++count;
+
+    return count;
+}
+
+/*
+ * hashes up to simdDegree chunks at once, the last one may be incomplete.
+ * returns the number of chaining values written to _out.
+ */
+static size_t compressChunks(const uint8_t *_input, size_t _cbInput, uint64_t _chunkCounter, uint8_t *_out)
+{
+    const uint8_t *chunks[BLAKE3_MAX_SIMD_DEGREE];
+    size_t cChunks = 0;
+
+    for (; _cbInput >= BLAKE3_CHUNK_LENGTH; _input += BLAKE3_CHUNK_LENGTH, _cbInput -= BLAKE3_CHUNK_LENGTH)
+        chunks[cChunks++] = _input;
+
+    pfnHashMany(chunks, cChunks, BLAKE3_CHUNK_LENGTH / BLAKE3_BLOCK_LENGTH, _chunkCounter, true,
+                0, BLAKE3_CHUNK_START, BLAKE3_CHUNK_END, _out);
+
+    if (_cbInput == 0) return cChunks;
+
+    BLAKE3_CHUNK chunk;
+    chunkInit(&chunk, _chunkCounter + cChunks);
+    chunkUpdate(&chunk, _input, _cbInput);
+
+    BLAKE3_OUTPUT output = chunkOutput(&chunk);
+    outputCv(&output, &_out[cChunks * BLAKE3_DIGEST_LENGTH]);
+
+    return cChunks + 1;
+}
+
+/*
+ * combines pairs of chaining values into their parents, an odd one
+ * is passed through. returns the number of chaining values in _out.
+ */
+static size_t compressParents(const uint8_t *_cvs, size_t _cCvs, uint8_t *_out)
+{
+    const uint8_t *parents[BLAKE3_MAX_SIMD_DEGREE];
+    size_t cParents = _cCvs / 2;
+
+    for (size_t i = 0; i < cParents; ++i)
+        parents[i] = &_cvs[2 * i * BLAKE3_DIGEST_LENGTH];
+
+    pfnHashMany(parents, cParents, 1, 0, false, BLAKE3_PARENT, 0, 0, _out);
+
+    if (_cCvs % 2 == 0) return cParents;
+
+    memcpy(&_out[cParents * BLAKE3_DIGEST_LENGTH], &_cvs[2 * cParents * BLAKE3_DIGEST_LENGTH], BLAKE3_DIGEST_LENGTH);
+
+    return cParents + 1;
+}
+
+/*
+ * hashes a subtree down to at most max(simdDegree, 2) chaining values,
+ * so that every call of the engine is fed with simdDegree inputs.
+ */
+static size_t compressSubtreeWide(const uint8_t *_input, size_t _cbInput, uint64_t _chunkCounter, uint8_t *_out)
+{
+    if (_cbInput <= simdDegree * BLAKE3_CHUNK_LENGTH)
+        return compressChunks(_input, _cbInput, _chunkCounter, _out);
+
+    // the left subtree holds the largest power of two of complete chunks
+    size_t cbLeft = (size_t)roundDownPow2((_cbInput - 1) / BLAKE3_CHUNK_LENGTH) * BLAKE3_CHUNK_LENGTH;
+    // the right side starts after the chaining values of the left one
+    size_t degree = simdDegree;
+    if (cbLeft > BLAKE3_CHUNK_LENGTH && degree == 1) degree = 2;
+
+    uint8_t cvs[2 * BLAKE3_MAX_SIMD_DEGREE * BLAKE3_DIGEST_LENGTH];
+    size_t cLeft = compressSubtreeWide(_input, cbLeft, _chunkCounter, cvs);
+    size_t cRight = compressSubtreeWide(&_input[cbLeft], _cbInput - cbLeft,
+                                        _chunkCounter + cbLeft / BLAKE3_CHUNK_LENGTH,
+                                        &cvs[degree * BLAKE3_DIGEST_LENGTH]);
+
+    // with only one chaining value per side, they are already the result
+    if (cLeft == 1)
+    {
+        memcpy(_out, cvs, 2 * BLAKE3_DIGEST_LENGTH);
+        return 2;
+    }
+
+    return compressParents(cvs, cLeft + cRight, _out);
+}
+
+/*
+ * hashes a subtree of more than one chunk down to the two chaining
+ * values of its top node. the top node itself is not compressed,
+ * it might be the root.
+ */
+static void compressSubtreeToParentNode(const uint8_t *_input, size_t _cbInput, uint64_t _chunkCounter,
+                                        uint8_t _out[2 * BLAKE3_DIGEST_LENGTH])
+{
+    uint8_t cvs[2 * BLAKE3_MAX_SIMD_DEGREE * BLAKE3_DIGEST_LENGTH];
+    uint8_t parents[BLAKE3_MAX_SIMD_DEGREE * BLAKE3_DIGEST_LENGTH];
+
+    size_t cCvs = compressSubtreeWide(_input, _cbInput, _chunkCounter, cvs);
+    while (cCvs > 2)
+    {
+        cCvs = compressParents(cvs, cCvs, parents);
+        memcpy(cvs, parents, cCvs * BLAKE3_DIGEST_LENGTH);
+    }
+
+    memcpy(_out, cvs, 2 * BLAKE3_DIGEST_LENGTH);
+}
+
+/*
+ * hashes a complete subtree of a BLAKE3_SUBTREE-task into its chaining
+ * value. safe to call from any thread, the subtree is never the root.
+ * 
+ * _IN_OUT:
+ *      _task: the subtree, the chaining value is written to _task->cv
+ */
+void blake3HashSubtree(BLAKE3_SUBTREE *_task)
+{
+    if (_task->cbInput <= BLAKE3_CHUNK_LENGTH)
+    {
+        compressChunks(_task->pbInput, _task->cbInput, _task->chunkCounter, _task->cv);
+        return;
+    }
+
+    uint8_t block[BLAKE3_BLOCK_LENGTH];
+    compressSubtreeToParentNode(_task->pbInput, _task->cbInput, _task->chunkCounter, block);
+
+    BLAKE3_OUTPUT output = parentOutput(block);
+    outputCv(&output, _task->cv);
+}
+
+/* ==== streaming interface ==== */
+
+/*
+ * merges completed subtrees on the stack of chaining values. the
+ * number of entries equals the number of 1-bits in the count of
+ * chunks hashed so far. the top entry is merged lazily, as it
+ * might belong to the root.
+ */
+static void mergeCvStack(BLAKE3_CTX *_ctx, uint64_t _cChunks)
+{
+    size_t cPostMerge = popcount64(_cChunks);
+
+    while (_ctx->cCvStack > cPostMerge)
+    {
+        uint8_t *pbPair = &_ctx->cvStack[(_ctx->cCvStack - 2) * BLAKE3_DIGEST_LENGTH];
+
+        BLAKE3_OUTPUT output = parentOutput(pbPair);
+        outputCv(&output, pbPair);
+        _ctx->cCvStack--;
+    }
+}
+
+static void pushCv(BLAKE3_CTX *_ctx, const uint8_t _cv[BLAKE3_DIGEST_LENGTH], uint64_t _chunkCounter)
+{
+    mergeCvStack(_ctx, _chunkCounter);
+
+    memcpy(&_ctx->cvStack[_ctx->cCvStack * BLAKE3_DIGEST_LENGTH], _cv, BLAKE3_DIGEST_LENGTH);
+    _ctx->cCvStack++;
+}
+
+/*
+ * completes a partial chunk from a previous update. returns the number
+ * of bytes taken from _input, the subtrees after it start at a chunk
+ * boundary.
+ */
+static size_t finishChunk(BLAKE3_CTX *_ctx, const uint8_t *_input, size_t _cbInput)
+{
+    if (chunkLength(&_ctx->chunk) == 0) return 0;
+
+    size_t cbTake = BLAKE3_CHUNK_LENGTH - chunkLength(&_ctx->chunk);
+    if (cbTake > _cbInput) cbTake = _cbInput;
+
+    chunkUpdate(&_ctx->chunk, _input, cbTake);
+
+    // a complete chunk is only closed if more input follows, it might be the root
+    if (cbTake < _cbInput)
+    {
+        uint8_t cv[BLAKE3_DIGEST_LENGTH];
+        BLAKE3_OUTPUT output = chunkOutput(&_ctx->chunk);
+
+        outputCv(&output, cv);
+        pushCv(_ctx, cv, _ctx->chunk.chunkCounter);
+        chunkInit(&_ctx->chunk, _ctx->chunk.chunkCounter + 1);
+    }
+
+    return cbTake;
+}
+
+/*
+ * the largest subtree at the current position: a power of two of
+ * chunks, aligned to its own size and smaller than the input left.
+ */
+static size_t nextSubtreeLength(const BLAKE3_CTX *_ctx, size_t _cbInput)
+{
+    uint64_t cbSubtree = roundDownPow2(_cbInput);
+    uint64_t cbSoFar = _ctx->chunk.chunkCounter * BLAKE3_CHUNK_LENGTH;
+
+    while (((cbSubtree - 1) & cbSoFar) != 0) cbSubtree /= 2;
+
+    return (size_t)cbSubtree;
+}
+
+/*
+ * hashes one subtree on the calling thread and pushes its chaining
+ * values. a single chunk is pushed as it is, larger subtrees as the
+ * two children of their top node.
+ */
+static void updateSubtree(BLAKE3_CTX *_ctx, const uint8_t *_input, size_t _cbSubtree)
+{
+    uint64_t cChunks = _cbSubtree / BLAKE3_CHUNK_LENGTH;
+
+    if (cChunks <= 1)
+    {
+        BLAKE3_CHUNK chunk;
+        chunkInit(&chunk, _ctx->chunk.chunkCounter);
+        chunkUpdate(&chunk, _input, _cbSubtree);
+
+        uint8_t cv[BLAKE3_DIGEST_LENGTH];
+        BLAKE3_OUTPUT output = chunkOutput(&chunk);
+        outputCv(&output, cv);
+        pushCv(_ctx, cv, chunk.chunkCounter);
+    }
+    else
+    {
+        uint8_t pair[2 * BLAKE3_DIGEST_LENGTH];
+        compressSubtreeToParentNode(_input, _cbSubtree, _ctx->chunk.chunkCounter, pair);
+
+        pushCv(_ctx, pair, _ctx->chunk.chunkCounter);
+        pushCv(_ctx, &pair[BLAKE3_DIGEST_LENGTH], _ctx->chunk.chunkCounter + cChunks / 2);
+    }
+
+    _ctx->chunk.chunkCounter += cChunks;
+}
+
+void blake3Init(BLAKE3_CTX *_ctx)
+{
+    if (!pfnHashMany) blake3SelectEngine(BLAKE3_ENGINE_AUTO);
+
+    chunkInit(&_ctx->chunk, 0);
+    _ctx->cCvStack = 0;
+}
+
+void blake3Update(BLAKE3_CTX *_ctx, const void *_data, size_t _cbData)
+{
+    const uint8_t *input = (const uint8_t *)_data;
+
+    size_t cbTaken = finishChunk(_ctx, input, _cbData);
+    input += cbTaken;
+    _cbData -= cbTaken;
+
+    while (_cbData > BLAKE3_CHUNK_LENGTH)
+    {
+        size_t cbSubtree = nextSubtreeLength(_ctx, _cbData);
+
+        updateSubtree(_ctx, input, cbSubtree);
+        input += cbSubtree;
+        _cbData -= cbSubtree;
+    }
+
+    if (_cbData > 0)
+    {
+        chunkUpdate(&_ctx->chunk, input, _cbData);
+        mergeCvStack(_ctx, _ctx->chunk.chunkCounter);
+    }
+}
+
+/*
+ * feeds data into a BLAKE3_CTX, hashing large subtrees in parallel.
+ * -----------------------------------------------------------------
+ * every subtree is split into up to _cMaxTasks equal parts, which
+ * _pfnRun has to hash with blake3HashSubtree() before it returns.
+ * the result is the same as with blake3Update().
+ * -----------------------------------------------------------------
+ * 
+ * _IN:
+ *      _data: the data to hash
+ *      _cbData: the size of _data in bytes
+ *      _cMaxTasks: the most parts a subtree is split into, usually the
+ *                  number of threads
+ *      _pfnRun: runs blake3HashSubtree() for every task of an array
+ *      _pvContext: passed on to _pfnRun
+ * 
+ * _IN_OUT:
+ *      _ctx: the BLAKE3_CTX
+ */
+void blake3UpdateParallel(BLAKE3_CTX *_ctx, const void *_data, size_t _cbData, size_t _cMaxTasks,
+                            BLAKE3_RUN_FN _pfnRun, void *_pvContext)
+{
+    const uint8_t *input = (const uint8_t *)_data;
+    BLAKE3_SUBTREE tasks[BLAKE3_MAX_TASKS];
+
+    if (_cMaxTasks > BLAKE3_MAX_TASKS) _cMaxTasks = BLAKE3_MAX_TASKS;
+    _cMaxTasks = _cMaxTasks > 0 ? (size_t)roundDownPow2(_cMaxTasks) : 1;
+
+    size_t cbTaken = finishChunk(_ctx, input, _cbData);
+    input += cbTaken;
+    _cbData -= cbTaken;
+
+    while (_cbData > BLAKE3_CHUNK_LENGTH)
+    {
+        size_t cbSubtree = nextSubtreeLength(_ctx, _cbData);
+        uint64_t cChunks = cbSubtree / BLAKE3_CHUNK_LENGTH;
+
+        size_t cTasks = _cMaxTasks;
+        while (cTasks > 1 && cChunks / cTasks < BLAKE3_MIN_TASK_CHUNKS) cTasks /= 2;
+
+        if (cTasks < 2)
+        {
+            updateSubtree(_ctx, input, cbSubtree);
+        }
+        else
+        {
+            size_t cbTask = cbSubtree / cTasks;
+
+            for (size_t i = 0; i < cTasks; ++i)
+            {
+                tasks[i].pbInput = &input[i * cbTask];
+                tasks[i].cbInput = cbTask;
+                tasks[i].chunkCounter = _ctx->chunk.chunkCounter + i * (cbTask / BLAKE3_CHUNK_LENGTH);
+            }
+
+            _pfnRun(tasks, cTasks, _pvContext);
+
+            // the parts are aligned subtrees of equal size, so they merge like chunks
+            for (size_t i = 0; i < cTasks; ++i)
+                pushCv(_ctx, tasks[i].cv, tasks[i].chunkCounter);
+
+            _ctx->chunk.chunkCounter += cChunks;
+        }
+
+        input += cbSubtree;
+        _cbData -= cbSubtree;
+    }
+
+    if (_cbData > 0)
+    {
+        chunkUpdate(&_ctx->chunk, input, _cbData);
+        mergeCvStack(_ctx, _ctx->chunk.chunkCounter);
+    }
+}
+
+/*
+ * computes the 32 byte digest. the context is not modified, so more
+ * data can be added afterwards.
+ */
+void blake3Final(const BLAKE3_CTX *_ctx, uint8_t _digest[BLAKE3_DIGEST_LENGTH])
+{
+    BLAKE3_OUTPUT output;
+    size_t cRemaining;
+
+    if (_ctx->cCvStack == 0)
+    {
+        output = chunkOutput(&_ctx->chunk);
+        outputRoot(&output, _digest);
+        return;
+    }
+
+    // with an empty chunk the top two chaining values form the last node
+    if (chunkLength(&_ctx->chunk) > 0)
+    {
+        cRemaining = _ctx->cCvStack;
+        output = chunkOutput(&_ctx->chunk);
+    }
+    else
+    {
+        cRemaining = _ctx->cCvStack - 2;
+        output = parentOutput(&_ctx->cvStack[cRemaining * BLAKE3_DIGEST_LENGTH]);
+    }
+
+    while (cRemaining > 0)
+    {
+        uint8_t block[BLAKE3_BLOCK_LENGTH];
+
+        --cRemaining;
+        memcpy(block, &_ctx->cvStack[cRemaining * BLAKE3_DIGEST_LENGTH], BLAKE3_DIGEST_LENGTH);
+        outputCv(&output, &block[BLAKE3_DIGEST_LENGTH]);
+        output = parentOutput(block);
+    }
+
+    outputRoot(&output, _digest);
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_blake3.h - in-tree BLAKE3 engine.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_BLAKE3_H
+#define _HASHSUM_BLAKE3_H
+
+#include "hashsum_cpu.h"
+
+#define BLAKE3_BLOCK_LENGTH 64
+#define BLAKE3_CHUNK_LENGTH 1024
+#define BLAKE3_DIGEST_LENGTH 32
+
+// one chaining value per level of the tree, enough for 2^54 chunks
+#define BLAKE3_MAX_DEPTH 54
+
+// the most subtrees blake3UpdateParallel() hashes at once
+#define BLAKE3_MAX_TASKS 64
+
+/*
+ * implementations of the compression-function, from slowest to fastest.
+ * the SIMD-engines compress 4 or 8 chunks (or parent-nodes) at once.
+ */
+typedef enum BLAKE3_ENGINE {
+    BLAKE3_ENGINE_AUTO = 0,
+    BLAKE3_ENGINE_PORTABLE,
+    BLAKE3_ENGINE_SSE41,
+    BLAKE3_ENGINE_AVX2
+} BLAKE3_ENGINE;
+
+typedef struct BLAKE3_CHUNK {
+    uint32_t cv[8];
+    uint64_t chunkCounter;
+    uint8_t buffer[BLAKE3_BLOCK_LENGTH];
+    uint8_t cbBuffer;
+    uint8_t cBlocks;
+} BLAKE3_CHUNK;
+
+typedef struct BLAKE3_CTX {
+    BLAKE3_CHUNK chunk;
+    uint8_t cCvStack;
+    uint8_t cvStack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_DIGEST_LENGTH];
+} BLAKE3_CTX;
+
+/*
+ * a complete subtree of the chunk-tree, hashed by one thread.
+ * the caller of blake3UpdateParallel() runs blake3HashSubtree()
+ * for every task, in any order and on any thread.
+ */
+typedef struct BLAKE3_SUBTREE {
+    const uint8_t *pbInput;
+    size_t cbInput;
+    uint64_t chunkCounter;
+    uint8_t cv[BLAKE3_DIGEST_LENGTH];
+} BLAKE3_SUBTREE;
+
+typedef void (*BLAKE3_RUN_FN)(BLAKE3_SUBTREE *, size_t, void *);
+
+BLAKE3_ENGINE blake3SelectEngine(BLAKE3_ENGINE);
+BLAKE3_ENGINE blake3GetEngine(void);
+const char *blake3EngineName(BLAKE3_ENGINE);
+
+void blake3Init(BLAKE3_CTX *);
+void blake3Update(BLAKE3_CTX *, const void *, size_t);
+void blake3UpdateParallel(BLAKE3_CTX *, const void *, size_t, size_t, BLAKE3_RUN_FN, void *);
+void blake3HashSubtree(BLAKE3_SUBTREE *);
+void blake3Final(const BLAKE3_CTX *, uint8_t[BLAKE3_DIGEST_LENGTH]);
+
+#endif // _HASHSUM_BLAKE3_H
\ No newline at end of file
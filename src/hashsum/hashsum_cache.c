@@ -0,0 +1,570 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_cache.c - persistent cache of digests, keyed by file-identity.
+ * 
+ * before a file is read its identity is queried (an open without read-
+ * access and GetFileInformationByHandle(), the equivalent of a stat()).
+ * if the volume, file-index, size, last write-time and full path match
+ * a cached record, the stored digest is used instead of reading the
+ * file. the cache-file is memory-mapped and indexed without copying,
+ * so loading it costs one pass over the records (and one CRC32C over
+ * the whole file, which runs at memory-bandwidth). new digests are
+ * written to a temporary file which then atomically replaces the old
+ * cache-file.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_cache.h"
+#include "hashsum_checksum.h"
+
+#include <wchar.h>
+#include <wctype.h>
+
+static const CACHE_RECORD *EMPTY_SLOT = NULL;
+
+static LPCWSTR recordAlgId(const CACHE_RECORD *_record)
+{
+    return (LPCWSTR)(_record + 1);
+}
+
+static LPCWSTR recordPath(const CACHE_RECORD *_record)
+{
+    return recordAlgId(_record) + _record->cchAlgId;
+}
+
+static const BYTE *recordDigest(const CACHE_RECORD *_record)
+{
+    return (const BYTE *)(recordPath(_record) + _record->cchPath);
+}
+
+static DWORD recordLength(SIZE_T _cchAlgId, SIZE_T _cchPath, SIZE_T _cbDigest)
+{
+    SIZE_T cbRecord = sizeof(CACHE_RECORD) + (_cchAlgId + _cchPath) * sizeof(WCHAR) + _cbDigest;
+
+    return (DWORD)((cbRecord + 7) & ~(SIZE_T)7);
+}
+
+static SIZE_T hashIdentity(DWORD _dwVolume, ULONGLONG _fileIndex, LPCWSTR _pszAlgId, SIZE_T _cchAlgId)
+{
+    ULONGLONG h = (_fileIndex ^ ((ULONGLONG)_dwVolume << 32)) * 0x9E3779B97F4A7C15ULL;
+
+    for (SIZE_T i = 0; i < _cchAlgId; ++i)
+        h = (h ^ towupper(_pszAlgId[i])) * 0x100000001B3ULL;
+
+    return (SIZE_T)(h ^ (h >> 29));
+}
+
+/*
+ * returns the slot of the record with the given identity and algorithm,
+ * or the empty slot where it belongs.
+ */
+static SIZE_T findSlot(const DIGEST_CACHE *_cache, DWORD _dwVolume, ULONGLONG _fileIndex, LPCWSTR _pszAlgId, SIZE_T _cchAlgId)
+{
+    SIZE_T mask = _cache->cSlots - 1;
+    SIZE_T i = hashIdentity(_dwVolume, _fileIndex, _pszAlgId, _cchAlgId) & mask;
+
+    for (;; i = (i + 1) & mask)
+    {
+        const CACHE_RECORD *record = _cache->ppSlots[i];
+
+        if (record == EMPTY_SLOT) return i;
+
+        if (record->dwVolume == _dwVolume && record->fileIndex == _fileIndex && record->cchAlgId == _cchAlgId &&
+            _wcsnicmp(recordAlgId(record), _pszAlgId, _cchAlgId) == 0)
+            return i;
+    }
+}
+
+/*
+ * resizes the table to _cSlots (a power of 2) and re-inserts all records.
+ */
+static bool resizeTable(DIGEST_CACHE *_cache, SIZE_T _cSlots)
+{
+    const CACHE_RECORD **ppOld = _cache->ppSlots;
+    SIZE_T cOld = _cache->cSlots;
+
+    _cache->ppSlots = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(CACHE_RECORD *) * _cSlots);
+    if (!_cache->ppSlots)
+    {
+        _cache->ppSlots = ppOld;
+        return false;
+    }
+
+    _cache->cSlots = _cSlots;
+
+    for (SIZE_T i = 0; i < cOld; ++i)
+    {
+        const CACHE_RECORD *record = ppOld[i];
+        if (record == EMPTY_SLOT) continue;
+
+        _cache->ppSlots[findSlot(_cache, record->dwVolume, record->fileIndex, recordAlgId(record), record->cchAlgId)] = record;
+    }
+
+    if (ppOld) HeapFree(GetProcessHeap(), 0, ppOld);
+
+    return true;
+}
+
+/*
+ * adds a record to the table, a record of the same file and algorithm
+ * is replaced. the table is kept at most half full.
+ */
+static bool insertRecord(DIGEST_CACHE *_cache, const CACHE_RECORD *_record)
+{
+    if ((_cache->cUsed + 1) * 2 > _cache->cSlots && !resizeTable(_cache, _cache->cSlots * 2))
+        return false;
+
+    SIZE_T i = findSlot(_cache, _record->dwVolume, _record->fileIndex, recordAlgId(_record), _record->cchAlgId);
+    if (_cache->ppSlots[i] == EMPTY_SLOT) ++_cache->cUsed;
+
+    _cache->ppSlots[i] = _record;
+
+    return true;
+}
+
+/*
+ * allocates a new record from the current block, records never move.
+ */
+static CACHE_RECORD *allocRecord(DIGEST_CACHE *_cache, DWORD _cbRecord)
+{
+    CACHE_BLOCK *block = _cache->pBlocks;
+
+    if (!block || block->cbBlock - block->cbUsed < _cbRecord)
+    {
+        ULONGLONG cbBlock = _cbRecord > CACHE_BLOCK_SIZE ? _cbRecord : CACHE_BLOCK_SIZE;
+
+        if (! (block = HeapAlloc(GetProcessHeap(), 0, sizeof(CACHE_BLOCK) + (SIZE_T)cbBlock)))
+            return NULL;
+
+        block->pNext = _cache->pBlocks;
+        block->cbUsed = 0;
+        block->cbBlock = cbBlock;
+        _cache->pBlocks = block;
+    }
+
+    CACHE_RECORD *record = (CACHE_RECORD *)((PBYTE)block->data + block->cbUsed);
+    block->cbUsed += _cbRecord;
+
+    return record;
+}
+
+static void unmapCacheFile(DIGEST_CACHE *_cache)
+{
+    if (_cache->pbView) UnmapViewOfFile(_cache->pbView);
+    if (_cache->hMapping) CloseHandle(_cache->hMapping);
+    if (_cache->hFile != INVALID_HANDLE_VALUE) CloseHandle(_cache->hFile);
+
+    _cache->pbView = NULL;
+    _cache->hMapping = NULL;
+    _cache->hFile = INVALID_HANDLE_VALUE;
+}
+
+/*
+ * maps the cache-file and puts its records into the table.
+ * 
+ * _RETURNS: false if the file is damaged
+ */
+static bool loadCacheFile(DIGEST_CACHE *_cache)
+{
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_cache->hFile, &size) || (ULONGLONG)size.QuadPart < sizeof(CACHE_HEADER) ||
+        (ULONGLONG)size.QuadPart > (SIZE_T)-1)
+        return false;
+
+    if (! (_cache->hMapping = CreateFileMappingW(_cache->hFile, NULL, PAGE_READONLY, 0, 0, NULL)) ||
+        ! (_cache->pbView = MapViewOfFile(_cache->hMapping, FILE_MAP_READ, 0, 0, 0)))
+        return false;
+
+    const CACHE_HEADER *header = (const CACHE_HEADER *)_cache->pbView;
+    SIZE_T cbView = (SIZE_T)size.QuadPart;
+
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->cRecords > (cbView - sizeof(CACHE_HEADER)) / sizeof(CACHE_RECORD))
+        return false;
+
+    CRC32C_CTX crc;
+    crc32cInit(&crc);
+    crc32cUpdate(&crc, _cache->pbView + sizeof(CACHE_HEADER), cbView - sizeof(CACHE_HEADER));
+    if (~crc.crc != header->crcRecords)
+        return false;
+
+    // the table is sized once, so loading does not rehash
+    SIZE_T cSlots = _cache->cSlots;
+    while (cSlots < header->cRecords * 2 + 2) cSlots *= 2;
+    if (cSlots != _cache->cSlots && !resizeTable(_cache, cSlots))
+        return false;
+
+    SIZE_T offset = sizeof(CACHE_HEADER);
+    for (ULONGLONG i = 0; i < header->cRecords; ++i)
+    {
+        const CACHE_RECORD *record = (const CACHE_RECORD *)(_cache->pbView + offset);
+
+        if (cbView - offset < sizeof(CACHE_RECORD) || record->cbRecord > cbView - offset ||
+            record->cbRecord != recordLength(record->cchAlgId, record->cchPath, record->cbDigest) ||
+            record->cchAlgId == 0)
+            return false;
+
+        if (!insertRecord(_cache, record)) return false;
+
+        offset += record->cbRecord;
+    }
+
+    return true;
+}
+
+/*
+ * opens a cache-file. a missing file is an empty cache, a damaged file
+ * is ignored and replaced when the cache is saved.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the cache-file
+ * 
+ * _OUT:
+ *      _cache: the cache to initialize
+ * 
+ * _RETURNS: true on success, false if memory could not be allocated
+ */
+bool cacheOpen(DIGEST_CACHE *_cache, LPCWSTR _fileName)
+{
+    ZeroMemory(_cache, sizeof(DIGEST_CACHE));
+    InitializeSRWLock(&_cache->lock);
+
+    _cache->hFile = INVALID_HANDLE_VALUE;
+
+    SIZE_T cchFileName = wcslen(_fileName) + 1;
+    if (! (_cache->pszFileName = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * cchFileName)))
+        return false;
+
+    wcscpy_s(_cache->pszFileName, cchFileName, _fileName);
+
+    if (!resizeTable(_cache, 1024)) return false;
+
+    _cache->hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (_cache->hFile == INVALID_HANDLE_VALUE)
+        return true;
+
+    if (!loadCacheFile(_cache))
+    {
+        fwprintf(stderr, L"* WARNING: cache-file %s is damaged and will be rebuilt\n", _fileName);
+
+        unmapCacheFile(_cache);
+        ZeroMemory(_cache->ppSlots, sizeof(CACHE_RECORD *) * _cache->cSlots);
+        _cache->cUsed = 0;
+        _cache->bDirty = true;
+    }
+
+    return true;
+}
+
+/*
+ * queries the identity of a file without reading it.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file
+ * 
+ * _OUT:
+ *      _key: the identity, release it with cacheFreeKey()
+ * 
+ * _RETURNS: true for regular files, false if the file can not be cached
+ */
+bool cacheQueryFile(LPCWSTR _fileName, CACHE_KEY *_key)
+{
+    ZeroMemory(_key, sizeof(CACHE_KEY));
+
+    HANDLE hFile = CreateFileW(_fileName, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    bool bRegular = GetFileType(hFile) == FILE_TYPE_DISK && GetFileInformationByHandle(hFile, &info) &&
+                    !(info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+
+    CloseHandle(hFile);
+
+    if (!bRegular) return false;
+
+    DWORD cchPath = GetFullPathNameW(_fileName, 0, NULL, NULL);
+    if (cchPath == 0 || cchPath > 0xFFFF ||
+        ! (_key->pszPath = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * cchPath)))
+        return false;
+
+    _key->cchPath = GetFullPathNameW(_fileName, cchPath, _key->pszPath, NULL);
+    if (_key->cchPath == 0 || _key->cchPath >= cchPath)
+    {
+        cacheFreeKey(_key);
+        return false;
+    }
+
+    _key->dwVolume = info.dwVolumeSerialNumber;
+    _key->fileIndex = ((ULONGLONG)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    _key->cbFile = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    _key->mtime = ((ULONGLONG)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+
+    // a write in the same tick as the last one would not change the write-time
+    FILETIME ftNow;
+    GetSystemTimeAsFileTime(&ftNow);
+    ULONGLONG now = ((ULONGLONG)ftNow.dwHighDateTime << 32) | ftNow.dwLowDateTime;
+    _key->bRacy = now < _key->mtime + CACHE_RACY_WINDOW;
+
+    return true;
+}
+
+void cacheFreeKey(CACHE_KEY *_key)
+{
+    if (_key->pszPath) HeapFree(GetProcessHeap(), 0, _key->pszPath);
+
+    _key->pszPath = NULL;
+}
+
+/*
+ * looks up the digest of a file.
+ * 
+ * _IN:
+ *      _key: the identity of the file
+ *      _pszAlgId: the algorithm
+ *      _cbDigest: the length of the digest
+ * 
+ * _IN_OUT:
+ *      _cache: the cache
+ * 
+ * _OUT:
+ *      _pbDigest: the cached digest
+ * 
+ * _RETURNS: true if the file is unchanged since its digest was cached
+ */
+bool cacheLookup(DIGEST_CACHE *_cache, const CACHE_KEY *_key, LPCWSTR _pszAlgId, PBYTE _pbDigest, DWORD _cbDigest)
+{
+    bool bHit = false;
+
+    AcquireSRWLockShared(&_cache->lock);
+
+    const CACHE_RECORD *record = _cache->ppSlots[findSlot(_cache, _key->dwVolume, _key->fileIndex, _pszAlgId, wcslen(_pszAlgId))];
+
+    if (record != EMPTY_SLOT && record->cbFile == _key->cbFile && record->mtime == _key->mtime &&
+        record->cbDigest == _cbDigest && record->cchPath == _key->cchPath &&
+        CompareStringOrdinal(recordPath(record), record->cchPath, _key->pszPath, _key->cchPath, TRUE) == CSTR_EQUAL)
+    {
+        memcpy(_pbDigest, recordDigest(record), _cbDigest);
+        bHit = true;
+    }
+
+    ReleaseSRWLockShared(&_cache->lock);
+
+    return bHit;
+}
+
+/*
+ * stores the digest of a file, replacing an older one of the same file
+ * and algorithm. files that were modified just before are not stored.
+ * 
+ * _IN:
+ *      _key: the identity of the file, queried before it was hashed
+ *      _pszAlgId: the algorithm
+ *      _pbDigest: the digest
+ *      _cbDigest: the length of the digest
+ * 
+ * _IN_OUT:
+ *      _cache: the cache
+ */
+void cacheStore(DIGEST_CACHE *_cache, const CACHE_KEY *_key, LPCWSTR _pszAlgId, const BYTE *_pbDigest, DWORD _cbDigest)
+{
+    SIZE_T cchAlgId = wcslen(_pszAlgId);
+
+    if (_key->bRacy || cchAlgId > 0xFF || _cbDigest > 0xFF) return;
+
+    AcquireSRWLockExclusive(&_cache->lock);
+
+    DWORD cbRecord = recordLength(cchAlgId, _key->cchPath, _cbDigest);
+    CACHE_RECORD *record = allocRecord(_cache, cbRecord);
+
+    if (record)
+    {
+        ZeroMemory(record, cbRecord);
+
+        record->cbRecord = cbRecord;
+        record->dwVolume = _key->dwVolume;
+        record->fileIndex = _key->fileIndex;
+        record->cbFile = _key->cbFile;
+        record->mtime = _key->mtime;
+        record->cchAlgId = (BYTE)cchAlgId;
+        record->cbDigest = (BYTE)_cbDigest;
+        record->cchPath = (WORD)_key->cchPath;
+
+        memcpy((LPWSTR)recordAlgId(record), _pszAlgId, cchAlgId * sizeof(WCHAR));
+        memcpy((LPWSTR)recordPath(record), _key->pszPath, _key->cchPath * sizeof(WCHAR));
+        memcpy((PBYTE)recordDigest(record), _pbDigest, _cbDigest);
+
+        _cache->bDirty |= insertRecord(_cache, record);
+    }
+
+    ReleaseSRWLockExclusive(&_cache->lock);
+}
+
+static bool writeAll(HANDLE _hFile, const void *_data, DWORD _cbData)
+{
+    DWORD cbWritten;
+
+    return WriteFile(_hFile, _data, _cbData, &cbWritten, NULL) && cbWritten == _cbData;
+}
+
+/*
+ * writes the cache to a temporary file next to the cache-file, which
+ * then replaces it. nothing is written if no digest was added. the
+ * records of the old file can not be looked up afterwards.
+ * 
+ * _IN_OUT:
+ *      _cache: the cache
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD cacheSave(DIGEST_CACHE *_cache)
+{
+    if (!_cache->bDirty) return ERROR_SUCCESS;
+
+    SIZE_T cchTemp = wcslen(_cache->pszFileName) + 5;
+    LPWSTR pszTemp = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * cchTemp);
+    PBYTE pbBuffer = HeapAlloc(GetProcessHeap(), 0, CACHE_BLOCK_SIZE);
+
+    if (!pszTemp || !pbBuffer)
+    {
+        if (pszTemp) HeapFree(GetProcessHeap(), 0, pszTemp);
+        if (pbBuffer) HeapFree(GetProcessHeap(), 0, pbBuffer);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    swprintf_s(pszTemp, cchTemp, L"%s.tmp", _cache->pszFileName);
+
+    DWORD dwError = ERROR_SUCCESS;
+    HANDLE hTemp = CreateFileW(pszTemp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (hTemp == INVALID_HANDLE_VALUE)
+        dwError = GetLastError();
+    else
+    {
+        CACHE_HEADER header = { .cRecords = _cache->cUsed };
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+
+        CRC32C_CTX crc;
+        crc32cInit(&crc);
+
+        // the header is written again with the crc when all records are written
+        memcpy(pbBuffer, &header, sizeof(header));
+        DWORD cbBuffer = sizeof(header);
+
+        // small records are collected in the buffer, huge ones are written directly
+        for (SIZE_T i = 0; i < _cache->cSlots && dwError == ERROR_SUCCESS; ++i)
+        {
+            const CACHE_RECORD *record = _cache->ppSlots[i];
+            if (record == EMPTY_SLOT) continue;
+
+            if (cbBuffer + record->cbRecord > CACHE_BLOCK_SIZE)
+            {
+                if (!writeAll(hTemp, pbBuffer, cbBuffer)) dwError = GetLastError();
+                cbBuffer = 0;
+            }
+
+            crc32cUpdate(&crc, record, record->cbRecord);
+
+            if (record->cbRecord > CACHE_BLOCK_SIZE)
+            {
+                if (dwError == ERROR_SUCCESS && !writeAll(hTemp, record, record->cbRecord)) dwError = GetLastError();
+            }
+            else
+            {
+                memcpy(pbBuffer + cbBuffer, record, record->cbRecord);
+                cbBuffer += record->cbRecord;
+            }
+        }
+
+        if (dwError == ERROR_SUCCESS && cbBuffer > 0 && !writeAll(hTemp, pbBuffer, cbBuffer))
+            dwError = GetLastError();
+
+        header.crcRecords = ~crc.crc;
+
+        LARGE_INTEGER start = { 0 };
+        if (dwError == ERROR_SUCCESS &&
+            (!SetFilePointerEx(hTemp, start, NULL, FILE_BEGIN) || !writeAll(hTemp, &header, sizeof(header))))
+            dwError = GetLastError();
+
+        if (dwError == ERROR_SUCCESS && !FlushFileBuffers(hTemp))
+            dwError = GetLastError();
+
+        CloseHandle(hTemp);
+    }
+
+    // a mapped file can not be replaced
+    unmapCacheFile(_cache);
+    ZeroMemory(_cache->ppSlots, sizeof(CACHE_RECORD *) * _cache->cSlots);
+    _cache->cUsed = 0;
+
+    if (dwError == ERROR_SUCCESS &&
+        !MoveFileExW(pszTemp, _cache->pszFileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        dwError = GetLastError();
+
+    if (dwError != ERROR_SUCCESS)
+        DeleteFileW(pszTemp);
+    else
+        _cache->bDirty = false;
+
+    HeapFree(GetProcessHeap(), 0, pbBuffer);
+    HeapFree(GetProcessHeap(), 0, pszTemp);
+
+    return dwError;
+}
+
+/*
+ * unmaps the cache-file and frees all memory of the cache.
+ * 
+ * _IN_OUT:
+ *      _cache: the cache
+ */
+void cacheFree(DIGEST_CACHE *_cache)
+{
+    unmapCacheFile(_cache);
+
+    while (_cache->pBlocks)
+    {
+        CACHE_BLOCK *pNext = _cache->pBlocks->pNext;
+        HeapFree(GetProcessHeap(), 0, _cache->pBlocks);
+        _cache->pBlocks = pNext;
+    }
+
+    if (_cache->ppSlots) HeapFree(GetProcessHeap(), 0, _cache->ppSlots);
+    if (_cache->pszFileName) HeapFree(GetProcessHeap(), 0, _cache->pszFileName);
+
+    _cache->ppSlots = NULL;
+    _cache->pszFileName = NULL;
+    _cache->cSlots = 0;
+    _cache->cUsed = 0;
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_cache.h - persistent cache of digests, keyed by file-identity.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_CACHE_H
+#define _HASHSUM_CACHE_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+// first bytes of a cache-file, the last character is the version of the format
+#define CACHE_MAGIC "HSCACHE1"
+
+// size of the blocks new records are allocated from
+#define CACHE_BLOCK_SIZE (1024 * 1024)
+
+// files modified less than 2 seconds (in 100ns) before they were hashed are not cached
+#define CACHE_RACY_WINDOW (2 * 10000000ULL)
+
+/*
+ * a cache-file is a CACHE_HEADER followed by cRecords records. every
+ * record is a CACHE_RECORD followed by the name of the algorithm, the
+ * full path (both UTF-16, not terminated) and the digest, padded to a
+ * multiple of 8 bytes. a damaged file must not produce wrong digests,
+ * so the records are protected by a CRC32C.
+ */
+typedef struct CACHE_HEADER {
+    char magic[8];
+    ULONGLONG cRecords;
+    DWORD crcRecords;
+    DWORD dwReserved;
+} CACHE_HEADER;
+
+typedef struct CACHE_RECORD {
+    DWORD cbRecord;
+    DWORD dwVolume;
+    ULONGLONG fileIndex;
+    ULONGLONG cbFile;
+    ULONGLONG mtime;
+    BYTE cchAlgId;
+    BYTE cbDigest;
+    WORD cchPath;
+} CACHE_RECORD;
+
+/*
+ * identity of a file on disk, the Windows counterpart of
+ * (path, device, inode, size, mtime).
+ */
+typedef struct CACHE_KEY {
+    LPWSTR pszPath;
+    DWORD cchPath;
+    DWORD dwVolume;
+    ULONGLONG fileIndex;
+    ULONGLONG cbFile;
+    ULONGLONG mtime;
+    bool bRacy;
+} CACHE_KEY;
+
+typedef struct CACHE_BLOCK {
+    struct CACHE_BLOCK *pNext;
+    ULONGLONG cbUsed;
+    ULONGLONG cbBlock;
+    ULONGLONG data[];
+} CACHE_BLOCK;
+
+/*
+ * the records of the cache-file stay in its mapped view, new records
+ * are allocated from blocks. both are found through an open-addressing
+ * table keyed by (volume, file-index, algorithm).
+ */
+typedef struct DIGEST_CACHE {
+    LPWSTR pszFileName;
+    HANDLE hFile;
+    HANDLE hMapping;
+    const BYTE *pbView;
+    const CACHE_RECORD **ppSlots;
+    SIZE_T cSlots;
+    SIZE_T cUsed;
+    CACHE_BLOCK *pBlocks;
+    bool bDirty;
+    SRWLOCK lock;
+} DIGEST_CACHE;
+
+bool cacheOpen(DIGEST_CACHE *, LPCWSTR);
+bool cacheQueryFile(LPCWSTR, CACHE_KEY *);
+void cacheFreeKey(CACHE_KEY *);
+bool cacheLookup(DIGEST_CACHE *, const CACHE_KEY *, LPCWSTR, PBYTE, DWORD);
+void cacheStore(DIGEST_CACHE *, const CACHE_KEY *, LPCWSTR, const BYTE *, DWORD);
+DWORD cacheSave(DIGEST_CACHE *);
+void cacheFree(DIGEST_CACHE *);
+
+#endif // _HASHSUM_CACHE_H
\ No newline at end of file
@@ -0,0 +1,807 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_checksum.c - in-tree engines for XXH3 (64 bit) and CRC32C.
+ * 
+ * both checksums are not cryptographic, they are meant for integrity-
+ * scans of large amounts of data and should run at memory-bandwidth:
+ * 
+ *      XXH3   - 8 accumulators of 64 bit, updated with SSE2 (2 per
+ *               register) or AVX2 (4 per register)
+ *      CRC32C - the crc32-instruction of SSE4.2 on three independent
+ *               streams, which are combined by multiplication in GF(2)
+ *               with PCLMUL (or a portable loop without it)
+ * 
+ * without those instruction-sets portable C is used, slicing-by-8
+ * tables for CRC32C.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_checksum.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define HS_CRC32C_HW 1
+#else
+    #define HS_CRC32C_HW 0
+#endif
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH3_SECRET_SIZE 192
+#define XXH3_SECRET_CONSUME_RATE 8
+#define XXH3_STRIPES_PER_BLOCK ((XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH) / XXH3_SECRET_CONSUME_RATE)
+#define XXH3_SECRET_LASTACC_START 7
+#define XXH3_SECRET_MERGEACCS_START 11
+#define XXH3_MIDSIZE_MAX 240
+
+// CRC32C, bit-reflected
+#define CRC32C_POLY 0x82F63B78U
+
+// length of each of the three streams, long and short variant
+#define CRC32C_LONG 8192
+#define CRC32C_SHORT 256
+
+typedef void (*XXH3_ACCUMULATE_FN)(uint64_t[8], const uint8_t *, const uint8_t *, size_t);
+typedef void (*XXH3_SCRAMBLE_FN)(uint64_t[8], const uint8_t *);
+typedef uint32_t (*CRC32C_UPDATE_FN)(uint32_t, const uint8_t *, size_t);
+
+static const uint8_t XXH3_SECRET[XXH3_SECRET_SIZE] = {
+    0xB8, 0xFE, 0x6C, 0x39, 0x23, 0xA4, 0x4B, 0xBE, 0x7C, 0x01, 0x81, 0x2C, 0xF7, 0x21, 0xAD, 0x1C,
+    0xDE, 0xD4, 0x6D, 0xE9, 0x83, 0x90, 0x97, 0xDB, 0x72, 0x40, 0xA4, 0xA4, 0xB7, 0xB3, 0x67, 0x1F,
+    0xCB, 0x79, 0xE6, 0x4E, 0xCC, 0xC0, 0xE5, 0x78, 0x82, 0x5A, 0xD0, 0x7D, 0xCC, 0xFF, 0x72, 0x21,
+    0xB8, 0x08, 0x46, 0x74, 0xF7, 0x43, 0x24, 0x8E, 0xE0, 0x35, 0x90, 0xE6, 0x81, 0x3A, 0x26, 0x4C,
+    0x3C, 0x28, 0x52, 0xBB, 0x91, 0xC3, 0x00, 0xCB, 0x88, 0xD0, 0x65, 0x8B, 0x1B, 0x53, 0x2E, 0xA3,
+    0x71, 0x64, 0x48, 0x97, 0xA2, 0x0D, 0xF9, 0x4E, 0x38, 0x19, 0xEF, 0x46, 0xA9, 0xDE, 0xAC, 0xD8,
+    0xA8, 0xFA, 0x76, 0x3F, 0xE3, 0x9C, 0x34, 0x3F, 0xF9, 0xDC, 0xBB, 0xC7, 0xC7, 0x0B, 0x4F, 0x1D,
+    0x8A, 0x51, 0xE0, 0x4B, 0xCD, 0xB4, 0x59, 0x31, 0xC8, 0x9F, 0x7E, 0xC9, 0xD9, 0x78, 0x73, 0x64,
+    0xEA, 0xC5, 0xAC, 0x83, 0x34, 0xD3, 0xEB, 0xC3, 0xC5, 0x81, 0xA0, 0xFF, 0xFA, 0x13, 0x63, 0xEB,
+    0x17, 0x0D, 0xDD, 0x51, 0xB7, 0xF0, 0xDA, 0x49, 0xD3, 0x16, 0x55, 0x26, 0x29, 0xD4, 0x68, 0x9E,
+    0x2B, 0x16, 0xBE, 0x58, 0x7D, 0x47, 0xA1, 0xFC, 0x8F, 0xF8, 0xB8, 0xD1, 0x7A, 0xD0, 0x31, 0xCE,
+    0x45, 0xCB, 0x3A, 0x8F, 0x95, 0x16, 0x04, 0x28, 0xAF, 0xD7, 0xFB, 0xCA, 0xBB, 0x4B, 0x40, 0x7E
+};
+
+static CHECKSUM_ENGINE activeEngine = CHECKSUM_ENGINE_AUTO;
+static XXH3_ACCUMULATE_FN pfnAccumulate = NULL;
+static XXH3_SCRAMBLE_FN pfnScramble = NULL;
+static CRC32C_UPDATE_FN pfnCrc32c = NULL;
+
+static uint32_t crc32cTable[8][256];
+
+// x^(8 * stream-length) mod P, to append the zeros of a stream to a crc
+static uint32_t crc32cShiftLong;
+static uint32_t crc32cShiftShort;
+
+// the same for PCLMUL, minus the 33 bits added by the multiplication and the crc32-instruction
+static uint32_t crc32cClmulLong;
+static uint32_t crc32cClmulShort;
+static bool bClmul = false;
+
+static uint32_t loadLE32(const uint8_t *_p)
+{
+    return (uint32_t)_p[0] | ((uint32_t)_p[1] << 8) | ((uint32_t)_p[2] << 16) | ((uint32_t)_p[3] << 24);
+}
+
+static uint64_t loadLE64(const uint8_t *_p)
+{
+    return (uint64_t)loadLE32(_p) | ((uint64_t)loadLE32(_p + 4) << 32);
+}
+
+static void storeBE64(uint8_t *_p, uint64_t _v)
+{
+    for (int i = 7; i >= 0; --i, _v >>= 8) _p[i] = (uint8_t)_v;
+}
+
+static uint32_t swap32(uint32_t _v)
+{
+    return (_v >> 24) | ((_v >> 8) & 0xFF00) | ((_v << 8) & 0xFF0000) | (_v << 24);
+}
+
+static uint64_t swap64(uint64_t _v)
+{
+    return ((uint64_t)swap32((uint32_t)_v) << 32) | swap32((uint32_t)(_v >> 32));
+}
+
+static uint64_t rotl64(uint64_t _v, int _n)
+{
+    return (_v << _n) | (_v >> (64 - _n));
+}
+
+/*
+ * multiplies two 64-bit values to 128 bit and folds the halves with xor.
+ */
+static uint64_t mul128Fold64(uint64_t _a, uint64_t _b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)_a * _b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(_a, _b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t loLo = (_a & 0xFFFFFFFF) * (_b & 0xFFFFFFFF);
+    uint64_t hiLo = (_a >> 32) * (_b & 0xFFFFFFFF);
+    uint64_t loHi = (_a & 0xFFFFFFFF) * (_b >> 32);
+    uint64_t hiHi = (_a >> 32) * (_b >> 32);
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+    uint64_t upper = (hiLo >> 32) + (cross >> 32) + hiHi;
+    uint64_t lower = (cross << 32) | (loLo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+/* ==== XXH3: short inputs ==== */
+
+static uint64_t xxh64Avalanche(uint64_t _h)
+{
+    _h ^= _h >> 33;
+    _h *= XXH_PRIME64_2;
+    _h ^= _h >> 29;
+    _h *= XXH_PRIME64_3;
+    return _h ^ (_h >> 32);
+}
+
+static uint64_t xxh3Avalanche(uint64_t _h)
+{
+    _h ^= _h >> 37;
+    _h *= XXH_PRIME_MX1;
+    return _h ^ (_h >> 32);
+}
+
+static uint64_t xxh3Rrmxmx(uint64_t _h, uint64_t _cbInput)
+{
+    _h ^= rotl64(_h, 49) ^ rotl64(_h, 24);
+    _h *= XXH_PRIME_MX2;
+    _h ^= (_h >> 35) + _cbInput;
+    _h *= XXH_PRIME_MX2;
+    return _h ^ (_h >> 28);
+}
+
+static uint64_t xxh3Mix16(const uint8_t *_input, const uint8_t *_secret)
+{
+    return mul128Fold64(loadLE64(_input) ^ loadLE64(_secret), loadLE64(_input + 8) ^ loadLE64(_secret + 8));
+}
+
+/*
+ * inputs of up to XXH3_MIDSIZE_MAX bytes are hashed in one go, with a
+ * different formula for each range of lengths.
+ */
+static uint64_t xxh3HashShort(const uint8_t *_input, size_t _cbInput)
+{
+    const uint8_t *secret = XXH3_SECRET;
+
+    if (_cbInput == 0)
+        return xxh64Avalanche(loadLE64(secret + 56) ^ loadLE64(secret + 64));
+
+    if (_cbInput <= 3)
+    {
+        uint32_t combined = ((uint32_t)_input[0] << 16) | ((uint32_t)_input[_cbInput >> 1] << 24) |
+                            (uint32_t)_input[_cbInput - 1] | ((uint32_t)_cbInput << 8);
+        uint64_t bitflip = loadLE32(secret) ^ loadLE32(secret + 4);
+
+        return xxh64Avalanche((uint64_t)combined ^ bitflip);
+    }
+
+    if (_cbInput <= 8)
+    {
+        uint64_t bitflip = loadLE64(secret + 8) ^ loadLE64(secret + 16);
+        uint64_t input = loadLE32(_input + _cbInput - 4) + ((uint64_t)loadLE32(_input) << 32);
+
+        return xxh3Rrmxmx(input ^ bitflip, _cbInput);
+    }
+
+    if (_cbInput <= 16)
+    {
+        uint64_t lo = loadLE64(_input) ^ (loadLE64(secret + 24) ^ loadLE64(secret + 32));
+        uint64_t hi = loadLE64(_input + _cbInput - 8) ^ (loadLE64(secret + 40) ^ loadLE64(secret + 48));
+
+        return xxh3Avalanche(_cbInput + swap64(lo) + hi + mul128Fold64(lo, hi));
+    }
+
+    uint64_t acc = _cbInput * XXH_PRIME64_1;
+
+    if (_cbInput <= 128)
+    {
+        if (_cbInput > 32)
+        {
+            if (_cbInput > 64)
+            {
+                if (_cbInput > 96)
+                {
+                    acc += xxh3Mix16(_input + 48, secret + 96);
+                    acc += xxh3Mix16(_input + _cbInput - 64, secret + 112);
+                }
+                acc += xxh3Mix16(_input + 32, secret + 64);
+                acc += xxh3Mix16(_input + _cbInput - 48, secret + 80);
+            }
+            acc += xxh3Mix16(_input + 16, secret + 32);
+            acc += xxh3Mix16(_input + _cbInput - 32, secret + 48);
+        }
+        acc += xxh3Mix16(_input, secret);
+        acc += xxh3Mix16(_input + _cbInput - 16, secret + 16);
+
+        return xxh3Avalanche(acc);
+    }
+
+    for (size_t i = 0; i < 8; ++i) acc += xxh3Mix16(_input + 16 * i, secret + 16 * i);
+    acc = xxh3Avalanche(acc);
+
+    for (size_t i = 8; i < _cbInput / 16; ++i) acc += xxh3Mix16(_input + 16 * i, secret + 16 * (i - 8) + 3);
+    acc += xxh3Mix16(_input + _cbInput - 16, secret + 136 - 17);
+
+    return xxh3Avalanche(acc);
+}
+
+/* ==== XXH3: stripes of long inputs ==== */
+
+/*
+ * adds _cStripes stripes of 64 bytes to the accumulators, the secret
+ * moves by 8 bytes per stripe.
+ */
+static void accumulateScalar(uint64_t _acc[8], const uint8_t *_input, const uint8_t *_secret, size_t _cStripes)
+{
+    for (size_t n = 0; n < _cStripes; ++n, _input += XXH3_STRIPE_LENGTH, _secret += XXH3_SECRET_CONSUME_RATE)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            uint64_t data = loadLE64(_input + 8 * i);
+            uint64_t key = data ^ loadLE64(_secret + 8 * i);
+
+            _acc[i ^ 1] += data;
+            _acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+        }
+    }
+}
+
+static void scrambleScalar(uint64_t _acc[8], const uint8_t *_secret)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        uint64_t acc = _acc[i];
+        acc ^= acc >> 47;
+        acc ^= loadLE64(_secret + 8 * i);
+        _acc[i] = acc * XXH_PRIME32_1;
+    }
+}
+
+#if TT_ARCH_X86
+
+TT_TARGET("sse2")
+static void accumulateSse2(uint64_t _acc[8], const uint8_t *_input, const uint8_t *_secret, size_t _cStripes)
+{
+    __m128i acc[4];
+    for (int i = 0; i < 4; ++i) acc[i] = _mm_loadu_si128((const __m128i *)&_acc[2 * i]);
+
+    for (size_t n = 0; n < _cStripes; ++n, _input += XXH3_STRIPE_LENGTH, _secret += XXH3_SECRET_CONSUME_RATE)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            __m128i data = _mm_loadu_si128((const __m128i *)(_input + 16 * i));
+            __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i *)(_secret + 16 * i)));
+
+            // low half of every lane times its high half
+            __m128i product = _mm_mul_epu32(key, _mm_srli_epi64(key, 32));
+
+            // the data of a lane goes into its neighbour
+            __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+            acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) _mm_storeu_si128((__m128i *)&_acc[2 * i], acc[i]);
+}
+
+TT_TARGET("sse2")
+static void scrambleSse2(uint64_t _acc[8], const uint8_t *_secret)
+{
+    const __m128i prime = _mm_set1_epi32((int)XXH_PRIME32_1);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i acc = _mm_loadu_si128((const __m128i *)&_acc[2 * i]);
+        acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+        acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i *)(_secret + 16 * i)));
+
+        // 64 x 32 bit multiplication out of two 32 x 32 bit ones
+        __m128i lo = _mm_mul_epu32(acc, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+
+        _mm_storeu_si128((__m128i *)&_acc[2 * i], _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+TT_TARGET("avx2")
+static void accumulateAvx2(uint64_t _acc[8], const uint8_t *_input, const uint8_t *_secret, size_t _cStripes)
+{
+    __m256i acc0 = _mm256_loadu_si256((const __m256i *)&_acc[0]);
+    __m256i acc1 = _mm256_loadu_si256((const __m256i *)&_acc[4]);
+
+    for (size_t n = 0; n < _cStripes; ++n, _input += XXH3_STRIPE_LENGTH, _secret += XXH3_SECRET_CONSUME_RATE)
+    {
+        __m256i data0 = _mm256_loadu_si256((const __m256i *)_input);
+        __m256i data1 = _mm256_loadu_si256((const __m256i *)(_input + 32));
+        __m256i key0 = _mm256_xor_si256(data0, _mm256_loadu_si256((const __m256i *)_secret));
+        __m256i key1 = _mm256_xor_si256(data1, _mm256_loadu_si256((const __m256i *)(_secret + 32)));
+
+        __m256i product0 = _mm256_mul_epu32(key0, _mm256_srli_epi64(key0, 32));
+        __m256i product1 = _mm256_mul_epu32(key1, _mm256_srli_epi64(key1, 32));
+
+        acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(product0, _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2))));
+        acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(product1, _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    _mm256_storeu_si256((__m256i *)&_acc[0], acc0);
+    _mm256_storeu_si256((__m256i *)&_acc[4], acc1);
+}
+
+TT_TARGET("avx2")
+static void scrambleAvx2(uint64_t _acc[8], const uint8_t *_secret)
+{
+    const __m256i prime = _mm256_set1_epi32((int)XXH_PRIME32_1);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)&_acc[4 * i]);
+        acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+        acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *)(_secret + 32 * i)));
+
+        __m256i lo = _mm256_mul_epu32(acc, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+
+        _mm256_storeu_si256((__m256i *)&_acc[4 * i], _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif // TT_ARCH_X86
+
+/*
+ * consumes stripes and scrambles the accumulators at the end of every
+ * block. stripes are only consumed while more input follows them, so a
+ * full block is always followed by data and has to be scrambled.
+ */
+static void xxh3ConsumeStripes(XXH3_CTX *_ctx, const uint8_t *_input, size_t _cStripes)
+{
+    while (_cStripes > 0)
+    {
+        size_t cStripes = XXH3_STRIPES_PER_BLOCK - _ctx->cStripes;
+        if (cStripes > _cStripes) cStripes = _cStripes;
+
+        pfnAccumulate(_ctx->acc, _input, XXH3_SECRET + _ctx->cStripes * XXH3_SECRET_CONSUME_RATE, cStripes);
+
+        _ctx->cStripes += cStripes;
+        _input += cStripes * XXH3_STRIPE_LENGTH;
+        _cStripes -= cStripes;
+
+        if (_ctx->cStripes == XXH3_STRIPES_PER_BLOCK)
+        {
+            pfnScramble(_ctx->acc, XXH3_SECRET + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH);
+            _ctx->cStripes = 0;
+        }
+    }
+}
+
+/* ==== CRC32C ==== */
+
+/*
+ * multiplies two polynomials modulo P, both bit-reflected.
+ */
+static uint32_t crc32cMultiply(uint32_t _a, uint32_t _b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+
+    for (;;)
+    {
+        if (_a & m)
+        {
+            p ^= _b;
+            if ((_a & (m - 1)) == 0) break;
+        }
+
+        m >>= 1;
+        _b = _b & 1 ? (_b >> 1) ^ CRC32C_POLY : _b >> 1;
+    }
+
+    return p;
+}
+
+/*
+ * returns x^_n modulo P, bit-reflected.
+ */
+static uint32_t crc32cPower(uint64_t _n)
+{
+    uint32_t p = (uint32_t)1 << 31;     // x^0
+    uint32_t square = (uint32_t)1 << 30; // x^1
+
+    for (; _n; _n >>= 1)
+    {
+        if (_n & 1) p = crc32cMultiply(square, p);
+        square = crc32cMultiply(square, square);
+    }
+
+    return p;
+}
+
+static void crc32cInitTables(void)
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; ++k) crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        crc32cTable[0][n] = crc;
+    }
+
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        for (int k = 1; k < 8; ++k)
+            crc32cTable[k][n] = (crc32cTable[k - 1][n] >> 8) ^ crc32cTable[0][crc32cTable[k - 1][n] & 0xFF];
+    }
+
+    crc32cShiftLong = crc32cPower(8 * (uint64_t)CRC32C_LONG);
+    crc32cShiftShort = crc32cPower(8 * (uint64_t)CRC32C_SHORT);
+    crc32cClmulLong = crc32cPower(8 * (uint64_t)CRC32C_LONG - 33);
+    crc32cClmulShort = crc32cPower(8 * (uint64_t)CRC32C_SHORT - 33);
+}
+
+/*
+ * slicing-by-8, works on the raw crc-register (no pre- or post-inversion).
+ */
+static uint32_t crc32cScalar(uint32_t _crc, const uint8_t *_input, size_t _cbInput)
+{
+    while (_cbInput >= 8)
+    {
+        uint32_t lo = _crc ^ loadLE32(_input);
+        uint32_t hi = loadLE32(_input + 4);
+
+        _crc = crc32cTable[7][lo & 0xFF] ^ crc32cTable[6][(lo >> 8) & 0xFF] ^
+               crc32cTable[5][(lo >> 16) & 0xFF] ^ crc32cTable[4][lo >> 24] ^
+               crc32cTable[3][hi & 0xFF] ^ crc32cTable[2][(hi >> 8) & 0xFF] ^
+               crc32cTable[1][(hi >> 16) & 0xFF] ^ crc32cTable[0][hi >> 24];
+
+        _input += 8;
+        _cbInput -= 8;
+    }
+
+    while (_cbInput--) _crc = (_crc >> 8) ^ crc32cTable[0][(_crc ^ *_input++) & 0xFF];
+
+    return _crc;
+}
+
+#if HS_CRC32C_HW
+
+/*
+ * appends as many zero-bits to _crc as _k stands for, with a carry-less
+ * multiplication and a reduction by the crc32-instruction.
+ */
+TT_TARGET("sse4.2,pclmul")
+static uint32_t crc32cShiftClmul(uint32_t _crc, uint32_t _k)
+{
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)_crc), _mm_cvtsi32_si128((int)_k), 0);
+
+    return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(product));
+}
+
+/*
+ * the crc32-instruction has a latency of 3 cycles, but a throughput of
+ * one per cycle. three streams of the input are therefore processed at
+ * once and their crcs combined afterwards:
+ * crc(A|B) = crc(A) * x^(8 * |B|) + crc(B)
+ */
+TT_TARGET("sse4.2")
+static uint32_t crc32cSse42(uint32_t _crc, const uint8_t *_input, size_t _cbInput)
+{
+    uint64_t crc = _crc;
+
+    for (; _cbInput > 0 && ((uintptr_t)_input & 7); --_cbInput)
+        crc = _mm_crc32_u8((uint32_t)crc, *_input++);
+
+    static const size_t STREAMS[2] = { CRC32C_LONG, CRC32C_SHORT };
+
+    for (int s = 0; s < 2; ++s)
+    {
+        size_t cbStream = STREAMS[s];
+        uint32_t shift = s == 0 ? crc32cShiftLong : crc32cShiftShort;
+        uint32_t clmul = s == 0 ? crc32cClmulLong : crc32cClmulShort;
+
+        while (_cbInput >= 3 * cbStream)
+        {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+
+            for (size_t i = 0; i < cbStream; i += 8)
+            {
+                uint64_t v0, v1, v2;
+                memcpy(&v0, _input + i, 8);
+                memcpy(&v1, _input + cbStream + i, 8);
+                memcpy(&v2, _input + 2 * cbStream + i, 8);
+
+                crc = _mm_crc32_u64(crc, v0);
+                crc1 = _mm_crc32_u64(crc1, v1);
+                crc2 = _mm_crc32_u64(crc2, v2);
+            }
+
+            if (bClmul)
+            {
+                crc = crc32cShiftClmul((uint32_t)crc, clmul) ^ crc1;
+                crc = crc32cShiftClmul((uint32_t)crc, clmul) ^ crc2;
+            }
+            else
+            {
+                crc = crc32cMultiply(shift, (uint32_t)crc) ^ crc1;
+                crc = crc32cMultiply(shift, (uint32_t)crc) ^ crc2;
+            }
+
+            _input += 3 * cbStream;
+            _cbInput -= 3 * cbStream;
+        }
+    }
+
+    for (; _cbInput >= 8; _input += 8, _cbInput -= 8)
+    {
+        uint64_t v;
+        memcpy(&v, _input, 8);
+        crc = _mm_crc32_u64(crc, v);
+    }
+
+    for (; _cbInput > 0; --_cbInput)
+        crc = _mm_crc32_u8((uint32_t)crc, *_input++);
+
+    return (uint32_t)crc;
+}
+
+#endif // HS_CRC32C_HW
+
+/* ==== engine selection ==== */
+
+/*
+ * selects the engine for both checksums. if the requested engine is not
+ * supported by the cpu, the fastest supported engine is used instead.
+ * 
+ * _IN:
+ *      _engine: the requested engine
+ * 
+ * _RETURNS: the engine actually used
+ */
+CHECKSUM_ENGINE checksumSelectEngine(CHECKSUM_ENGINE _engine)
+{
+    const CPU_FEATURES *cpu = getCpuFeatures();
+    bool bSse = cpu->sse2 && cpu->sse42;
+    bool bAvx2 = bSse && cpu->avx2;
+
+    if (_engine == CHECKSUM_ENGINE_AUTO ||
+        (_engine == CHECKSUM_ENGINE_SSE && !bSse) ||
+        (_engine == CHECKSUM_ENGINE_AVX2 && !bAvx2))
+    {
+        if (bAvx2) _engine = CHECKSUM_ENGINE_AVX2;
+        else if (bSse) _engine = CHECKSUM_ENGINE_SSE;
+        else _engine = CHECKSUM_ENGINE_SCALAR;
+    }
+
+    crc32cInitTables();
+
+    pfnAccumulate = accumulateScalar;
+    pfnScramble = scrambleScalar;
+    pfnCrc32c = crc32cScalar;
+    bClmul = false;
+
+    switch (_engine)
+    {
+#if TT_ARCH_X86
+        case CHECKSUM_ENGINE_AVX2:
+            pfnAccumulate = accumulateAvx2;
+            pfnScramble = scrambleAvx2;
+    #if HS_CRC32C_HW
+            pfnCrc32c = crc32cSse42;
+            bClmul = cpu->pclmul;
+    #endif
+            break;
+        case CHECKSUM_ENGINE_SSE:
+            pfnAccumulate = accumulateSse2;
+            pfnScramble = scrambleSse2;
+    #if HS_CRC32C_HW
+            pfnCrc32c = crc32cSse42;
+            bClmul = cpu->pclmul;
+    #endif
+            break;
+#endif
+        default:
+            _engine = CHECKSUM_ENGINE_SCALAR;
+            break;
+    }
+
+    return (activeEngine = _engine);
+}
+
+/*
+ * returns the currently used engine.
+ */
+CHECKSUM_ENGINE checksumGetEngine(void)
+{
+    if (activeEngine == CHECKSUM_ENGINE_AUTO) checksumSelectEngine(CHECKSUM_ENGINE_AUTO);
+
+    return activeEngine;
+}
+
+/*
+ * returns a printable name for an engine.
+ */
+const char *checksumEngineName(CHECKSUM_ENGINE _engine)
+{
+    switch (_engine)
+    {
+        case CHECKSUM_ENGINE_SCALAR: return "scalar";
+        case CHECKSUM_ENGINE_SSE: return "sse";
+        case CHECKSUM_ENGINE_AVX2: return "avx2";
+        default: return "auto";
+    }
+}
+
+/* ==== XXH3 ==== */
+
+void xxh3Init(XXH3_CTX *_ctx)
+{
+    static const uint64_t INIT_ACC[8] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+    };
+
+    if (!pfnAccumulate) checksumSelectEngine(CHECKSUM_ENGINE_AUTO);
+
+    memcpy(_ctx->acc, INIT_ACC, sizeof(_ctx->acc));
+    _ctx->cbTotal = 0;
+    _ctx->cStripes = 0;
+    _ctx->cbBuffer = 0;
+}
+
+/*
+ * short inputs are hashed differently than long ones, so everything is
+ * buffered until more than XXH3_BUFFER_SIZE bytes are known. afterwards
+ * whole stripes are consumed directly from the input, only the tail
+ * (which may be the last stripe) stays in the buffer.
+ */
+void xxh3Update(XXH3_CTX *_ctx, const void *_data, size_t _cbData)
+{
+    const uint8_t *input = (const uint8_t *)_data;
+
+    _ctx->cbTotal += _cbData;
+
+    if (_ctx->cbBuffer + _cbData <= XXH3_BUFFER_SIZE)
+    {
+        memcpy(_ctx->buffer + _ctx->cbBuffer, input, _cbData);
+        _ctx->cbBuffer += _cbData;
+        return;
+    }
+
+    if (_ctx->cbBuffer > 0)
+    {
+        size_t cbLoad = XXH3_BUFFER_SIZE - _ctx->cbBuffer;
+        memcpy(_ctx->buffer + _ctx->cbBuffer, input, cbLoad);
+        input += cbLoad;
+        _cbData -= cbLoad;
+
+        xxh3ConsumeStripes(_ctx, _ctx->buffer, XXH3_BUFFER_SIZE / XXH3_STRIPE_LENGTH);
+        memcpy(_ctx->lastStripe, _ctx->buffer + XXH3_BUFFER_SIZE - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+        _ctx->cbBuffer = 0;
+    }
+
+    // at least one byte is left over for the buffer
+    size_t cStripes = (_cbData - 1) / XXH3_STRIPE_LENGTH;
+    if (cStripes > 0)
+    {
+        xxh3ConsumeStripes(_ctx, input, cStripes);
+        input += cStripes * XXH3_STRIPE_LENGTH;
+        _cbData -= cStripes * XXH3_STRIPE_LENGTH;
+        memcpy(_ctx->lastStripe, input - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+    }
+
+    memcpy(_ctx->buffer, input, _cbData);
+    _ctx->cbBuffer = _cbData;
+}
+
+/*
+ * the digest is the canonical (big-endian) form of the 64-bit hash.
+ * the context is not changed, so more data can be added afterwards.
+ */
+void xxh3Final(const XXH3_CTX *_ctx, uint8_t _out[XXH3_DIGEST_LENGTH])
+{
+    if (_ctx->cbTotal <= XXH3_MIDSIZE_MAX)
+    {
+        storeBE64(_out, xxh3HashShort(_ctx->buffer, (size_t)_ctx->cbTotal));
+        return;
+    }
+
+    XXH3_CTX ctx = *_ctx;
+    uint8_t lastStripe[XXH3_STRIPE_LENGTH];
+    const uint8_t *pLast = lastStripe;
+
+    if (ctx.cbBuffer >= XXH3_STRIPE_LENGTH)
+    {
+        xxh3ConsumeStripes(&ctx, ctx.buffer, (ctx.cbBuffer - 1) / XXH3_STRIPE_LENGTH);
+        pLast = ctx.buffer + ctx.cbBuffer - XXH3_STRIPE_LENGTH;
+    }
+    else
+    {
+        // the last stripe reaches back into data that was already consumed
+        size_t cbCatchup = XXH3_STRIPE_LENGTH - ctx.cbBuffer;
+        memcpy(lastStripe, ctx.lastStripe + XXH3_STRIPE_LENGTH - cbCatchup, cbCatchup);
+        memcpy(lastStripe + cbCatchup, ctx.buffer, ctx.cbBuffer);
+    }
+
+    pfnAccumulate(ctx.acc, pLast, XXH3_SECRET + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH - XXH3_SECRET_LASTACC_START, 1);
+
+    uint64_t result = ctx.cbTotal * XXH_PRIME64_1;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint8_t *secret = XXH3_SECRET + XXH3_SECRET_MERGEACCS_START + 16 * i;
+        result += mul128Fold64(ctx.acc[2 * i] ^ loadLE64(secret), ctx.acc[2 * i + 1] ^ loadLE64(secret + 8));
+    }
+
+    storeBE64(_out, xxh3Avalanche(result));
+}
+
+/* ==== CRC32C ==== */
+
+void crc32cInit(CRC32C_CTX *_ctx)
+{
+    if (!pfnCrc32c) checksumSelectEngine(CHECKSUM_ENGINE_AUTO);
+
+    _ctx->crc = 0xFFFFFFFF;
+}
+
+void crc32cUpdate(CRC32C_CTX *_ctx, const void *_data, size_t _cbData)
+{
+    _ctx->crc = pfnCrc32c(_ctx->crc, (const uint8_t *)_data, _cbData);
+}
+
+/*
+ * the digest is the inverted crc-register, big-endian.
+ */
+void crc32cFinal(const CRC32C_CTX *_ctx, uint8_t _out[CRC32C_DIGEST_LENGTH])
+{
+    uint32_t crc = ~_ctx->crc;
+
+    _out[0] = (uint8_t)(crc >> 24);
+    _out[1] = (uint8_t)(crc >> 16);
+    _out[2] = (uint8_t)(crc >> 8);
+    _out[3] = (uint8_t)crc;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_checksum.h - in-tree engines for the non-cryptographic checksums
+ *                      XXH3 (64 bit) and CRC32C.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_CHECKSUM_H
+#define _HASHSUM_CHECKSUM_H
+
+#include "hashsum_cpu.h"
+
+#define XXH3_DIGEST_LENGTH 8
+#define CRC32C_DIGEST_LENGTH 4
+
+// the input is buffered until more than this is known, short inputs use other formulas
+#define XXH3_BUFFER_SIZE 256
+#define XXH3_STRIPE_LENGTH 64
+
+/*
+ * implementations of the checksums, from slowest to fastest.
+ * XXH3 vectorizes its accumulators, CRC32C uses the crc32-instruction
+ * of SSE4.2 on three streams at once and combines them with PCLMUL.
+ */
+typedef enum CHECKSUM_ENGINE {
+    CHECKSUM_ENGINE_AUTO = 0,
+    CHECKSUM_ENGINE_SCALAR,
+    CHECKSUM_ENGINE_SSE,        // XXH3: SSE2, CRC32C: SSE4.2
+    CHECKSUM_ENGINE_AVX2        // XXH3: AVX2, CRC32C: SSE4.2
+} CHECKSUM_ENGINE;
+
+typedef struct XXH3_CTX {
+    uint64_t acc[8];
+    uint64_t cbTotal;
+    size_t cStripes;
+    uint8_t buffer[XXH3_BUFFER_SIZE];
+    size_t cbBuffer;
+    uint8_t lastStripe[XXH3_STRIPE_LENGTH];
+} XXH3_CTX;
+
+typedef struct CRC32C_CTX {
+    uint32_t crc;
+} CRC32C_CTX;
+
+CHECKSUM_ENGINE checksumSelectEngine(CHECKSUM_ENGINE);
+CHECKSUM_ENGINE checksumGetEngine(void);
+const char *checksumEngineName(CHECKSUM_ENGINE);
+
+void xxh3Init(XXH3_CTX *);
+void xxh3Update(XXH3_CTX *, const void *, size_t);
+void xxh3Final(const XXH3_CTX *, uint8_t[XXH3_DIGEST_LENGTH]);
+
+void crc32cInit(CRC32C_CTX *);
+void crc32cUpdate(CRC32C_CTX *, const void *, size_t);
+void crc32cFinal(const CRC32C_CTX *, uint8_t[CRC32C_DIGEST_LENGTH]);
+
+#endif // _HASHSUM_CHECKSUM_H
\ No newline at end of file
@@ -0,0 +1,113 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_cpu.c - runtime detection of cpu-features for the in-tree
+ *                 hash-engines.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_cpu.h"
+
+static CPU_FEATURES features;
+static volatile bool bFeaturesDetected = false;
+
+/*
+ * detects the features of the cpu the application is running on.
+ * ---------------------------------------------------------------
+ * the detection runs only once, later calls return the cached
+ * result. AVX and AVX-512 are only reported if the operating
+ * system also saves the corresponding register-states.
+ * ---------------------------------------------------------------
+ * 
+ * _RETURNS: a pointer to the detected features
+ */
+const CPU_FEATURES *getCpuFeatures(void)
+{
+    if (bFeaturesDetected) return &features;
+
+#if TT_ARCH_X86
+    uint32_t regs[4] = {0};
+    CPU_FEATURES detected = {0};
+
+    cpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+
+    if (maxLeaf >= 1)
+    {
+        cpuid(1, 0, regs);
+        detected.sse2 = (regs[3] >> 26) & 1;
+        detected.pclmul = (regs[2] >> 1) & 1;
+        detected.ssse3 = (regs[2] >> 9) & 1;
+        detected.sse41 = (regs[2] >> 19) & 1;
+        detected.sse42 = (regs[2] >> 20) & 1;
+
+        bool avx = (regs[2] >> 28) & 1;
+        uint64_t xcr0 = xgetbv0();
+        bool osYmm = (xcr0 & TT_XCR0_YMM) == TT_XCR0_YMM;
+        bool osZmm = (xcr0 & TT_XCR0_ZMM) == TT_XCR0_ZMM;
+
+        detected.avx = avx && osYmm;
+
+        if (maxLeaf >= 7)
+        {
+            cpuid(7, 0, regs);
+            detected.avx2 = detected.avx && ((regs[1] >> 5) & 1);
+            detected.bmi2 = (regs[1] >> 8) & 1;
+            detected.avx512f = osZmm && ((regs[1] >> 16) & 1);
+            detected.sha = (regs[1] >> 29) & 1;
+            detected.avx512bw = detected.avx512f && ((regs[1] >> 30) & 1);
+            detected.avx512vl = detected.avx512f && ((regs[1] >> 31) & 1);
+        }
+    }
+
+    features = detected;
+#endif
+
+    bFeaturesDetected = true;
+
+    return &features;
+}
+
+/*
+ * reads the time-stamp counter of the cpu. it ticks at the nominal
+ * clock-rate, so it counts cycles as long as the clock is not boosted
+ * or throttled.
+ * 
+ * _RETURNS: the counter, 0 on other architectures
+ */
+uint64_t readCycleCounter(void)
+{
+#if TT_ARCH_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
\ No newline at end of file
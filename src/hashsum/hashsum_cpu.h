@@ -0,0 +1,71 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_cpu.h - runtime detection of cpu-features for the in-tree
+ *                 hash-engines.
+ * 
+ * this header (and the engines using it) does not depend on windows.h,
+ * so the engines can also be built with GCC/Clang on other platforms.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_CPU_H
+#define _HASHSUM_CPU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tt_cpu.h"
+
+#if TT_ARCH_X86
+    #include <immintrin.h>
+#endif
+
+typedef struct CPU_FEATURES {
+    bool sse2;
+    bool ssse3;
+    bool sse41;
+    bool sse42;
+    bool pclmul;
+    bool avx;
+    bool avx2;
+    bool bmi2;
+    bool avx512f;
+    bool avx512bw;
+    bool avx512vl;
+    bool sha;
+} CPU_FEATURES;
+
+const CPU_FEATURES *getCpuFeatures(void);
+uint64_t readCycleCounter(void);
+
+#endif // _HASHSUM_CPU_H
\ No newline at end of file
@@ -0,0 +1,340 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_dupes.c - narrows a list of files down to candidates for duplicates.
+ * 
+ * files can only be duplicates if they have the same size, most of them
+ * are ruled out without reading a byte. of the rest only the first
+ * DUPES_PREFIX_SIZE bytes are read and compared, which rules out most
+ * files of the same size (e.g. archives with the same header are
+ * still different a few KB in). only the remaining candidates are
+ * hashed in full.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_dupes.h"
+
+#include <stdlib.h>
+#include <wchar.h>
+
+/*
+ * shared state of the threads reading the prefixes. a file that could
+ * not be read gets the size 0, empty files are never candidates.
+ */
+typedef struct PREFIX_JOB {
+    DUPE_FILE *pFiles;
+    SIZE_T cFiles;
+    volatile LONG nNext;
+    DUPES_ERROR_CALLBACK pfnError;
+} PREFIX_JOB;
+
+static DWORD readPrefix(DUPE_FILE *_file)
+{
+    BYTE data[DUPES_PREFIX_SIZE];
+    DWORD cbRead = 0;
+
+    HANDLE hFile = CreateFileW(_file->pszPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return GetLastError();
+
+    bool bRead = ReadFile(hFile, data, DUPES_PREFIX_SIZE, &cbRead, NULL);
+    DWORD dwError = bRead ? ERROR_SUCCESS : GetLastError();
+
+    CloseHandle(hFile);
+
+    if (bRead)
+    {
+        XXH3_CTX ctx;
+
+        xxh3Init(&ctx);
+        xxh3Update(&ctx, data, cbRead);
+        xxh3Final(&ctx, _file->prefix);
+    }
+
+    return dwError;
+}
+
+static DWORD WINAPI prefixWorker(LPVOID _param)
+{
+    PREFIX_JOB *job = (PREFIX_JOB *)_param;
+
+    for (;;)
+    {
+        LONG i = InterlockedIncrement(&job->nNext) - 1;
+        if (i >= (LONG)job->cFiles) break;
+
+        DUPE_FILE *file = &job->pFiles[i];
+
+        // smaller files are hashed in full, that costs the same as reading the prefix
+        if (file->cbFile <= DUPES_PREFIX_SIZE) continue;
+
+        DWORD dwError = readPrefix(file);
+        if (dwError != ERROR_SUCCESS)
+        {
+            if (job->pfnError) job->pfnError(file->pszPath, dwError);
+            file->cbFile = 0;
+        }
+    }
+
+    return 0;
+}
+
+static int compareFiles(const DUPE_FILE *_a, const DUPE_FILE *_b, DUPES_STAGE _stage)
+{
+    // the largest files first, they waste the most space
+    if (_a->cbFile != _b->cbFile)
+        return _a->cbFile > _b->cbFile ? -1 : 1;
+
+    if (_stage >= DUPES_BY_PREFIX)
+    {
+        int cmp = memcmp(_a->prefix, _b->prefix, XXH3_DIGEST_LENGTH);
+        if (cmp) return cmp;
+    }
+
+    if (_stage >= DUPES_BY_DIGEST && _a->pszDigests != _b->pszDigests)
+    {
+        if (!_a->pszDigests) return 1;
+        if (!_b->pszDigests) return -1;
+
+        int cmp = wcscmp(_a->pszDigests, _b->pszDigests);
+        if (cmp) return cmp;
+    }
+
+    return _a->index < _b->index ? -1 : _a->index > _b->index;
+}
+
+static int compareByIdentity(const void *_a, const void *_b)
+{
+    const DUPE_FILE *a = _a, *b = _b;
+
+    if (a->dwVolume != b->dwVolume) return a->dwVolume < b->dwVolume ? -1 : 1;
+    if (a->fileIndex != b->fileIndex) return a->fileIndex < b->fileIndex ? -1 : 1;
+
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static int compareBySize(const void *_a, const void *_b)
+{
+    return compareFiles(_a, _b, DUPES_BY_SIZE);
+}
+
+static int compareByPrefix(const void *_a, const void *_b)
+{
+    return compareFiles(_a, _b, DUPES_BY_PREFIX);
+}
+
+static int compareByDigest(const void *_a, const void *_b)
+{
+    return compareFiles(_a, _b, DUPES_BY_DIGEST);
+}
+
+/*
+ * queries the size and the identity of every file without reading it.
+ * --------------------------------------------------------------------
+ * empty files and files that could not be queried are left out. a file
+ * given more than once, by the same path or by another hardlink, is
+ * kept only once, at its first position: deleting one of its paths
+ * would free nothing. the identity is the one of /CACHE, the volume
+ * serial number and the file-index.
+ * --------------------------------------------------------------------
+ * 
+ * _IN:
+ *      _pvFileNames: the names/paths of the files, they have to outlive _pFiles
+ *      _cvFileNames: the size of the _pvFileNames vector
+ *      _pfnError: called for every file that could not be queried, or NULL
+ * 
+ * _OUT:
+ *      _pFiles: room for _cvFileNames files
+ * 
+ * _RETURNS: the number of files in _pFiles
+ */
+SIZE_T dupesQuerySizes(DUPE_FILE *_pFiles, LPWSTR *_pvFileNames, SIZE_T _cvFileNames, DUPES_ERROR_CALLBACK _pfnError)
+{
+    SIZE_T cFiles = 0;
+
+    for (SIZE_T i = 0; i < _cvFileNames; ++i)
+    {
+        BY_HANDLE_FILE_INFORMATION info;
+
+        HANDLE hFile = CreateFileW(_pvFileNames[i], FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    NULL, OPEN_EXISTING, 0, NULL);
+        bool bQueried = hFile != INVALID_HANDLE_VALUE && GetFileInformationByHandle(hFile, &info);
+        DWORD dwError = bQueried ? ERROR_SUCCESS : GetLastError();
+
+        if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+
+        if (!bQueried)
+        {
+            if (_pfnError) _pfnError(_pvFileNames[i], dwError);
+            continue;
+        }
+
+        DUPE_FILE *file = &_pFiles[cFiles];
+
+        ZeroMemory(file, sizeof(DUPE_FILE));
+        file->pszPath = _pvFileNames[i];
+        file->index = i;
+        file->dwVolume = info.dwVolumeSerialNumber;
+        file->fileIndex = ((ULONGLONG)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+        file->cbFile = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+
+        if (file->cbFile > 0) ++cFiles;
+    }
+
+    // the first path of every file is kept, dupesKeepDuplicates() restores the order
+    qsort(_pFiles, cFiles, sizeof(DUPE_FILE), compareByIdentity);
+
+    SIZE_T cUnique = 0;
+    for (SIZE_T i = 0; i < cFiles; ++i)
+    {
+        if (i > 0 && _pFiles[i].dwVolume == _pFiles[i-1].dwVolume && _pFiles[i].fileIndex == _pFiles[i-1].fileIndex)
+            continue;
+
+        _pFiles[cUnique++] = _pFiles[i];
+    }
+
+    return cUnique;
+}
+
+/*
+ * reads the prefix of every file larger than DUPES_PREFIX_SIZE.
+ * files that could not be read are left out.
+ * 
+ * _IN:
+ *      _cThreads: the number of reading threads
+ *      _pfnError: called for every file that could not be read, or NULL
+ * 
+ * _IN_OUT:
+ *      _pFiles: the files
+ *      _cFiles: the number of files
+ * 
+ * _RETURNS: the number of files left in _pFiles
+ */
+SIZE_T dupesHashPrefixes(DUPE_FILE *_pFiles, SIZE_T _cFiles, DWORD _cThreads, DUPES_ERROR_CALLBACK _pfnError)
+{
+    PREFIX_JOB job = {
+        .pFiles = _pFiles,
+        .cFiles = _cFiles,
+        .nNext = 0,
+        .pfnError = _pfnError
+    };
+
+    if (_cThreads > _cFiles) _cThreads = (DWORD)_cFiles;
+
+    HANDLE *phThreads = _cThreads > 1 ? HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HANDLE) * (_cThreads - 1)) : NULL;
+    DWORD cStarted = 0;
+
+    for (; phThreads && cStarted < _cThreads - 1; ++cStarted)
+    {
+        if (! (phThreads[cStarted] = CreateThread(NULL, 0, prefixWorker, &job, 0, NULL)))
+            break;
+    }
+
+    prefixWorker(&job);
+
+    for (DWORD i = 0; i < cStarted; ++i)
+    {
+        WaitForSingleObject(phThreads[i], INFINITE);
+        CloseHandle(phThreads[i]);
+    }
+
+    if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+
+    SIZE_T cFiles = 0;
+    for (SIZE_T i = 0; i < _cFiles; ++i)
+    {
+        if (_pFiles[i].cbFile > 0) _pFiles[cFiles++] = _pFiles[i];
+    }
+
+    return cFiles;
+}
+
+/*
+ * checks if two files are in the same group after a stage.
+ * 
+ * _IN:
+ *      _a, _b: the files
+ *      _stage: the keys to compare
+ * 
+ * _RETURNS: true if all keys of the stage are equal
+ */
+bool dupesSameGroup(const DUPE_FILE *_a, const DUPE_FILE *_b, DUPES_STAGE _stage)
+{
+    if (_a->cbFile != _b->cbFile) return false;
+
+    if (_stage >= DUPES_BY_PREFIX && memcmp(_a->prefix, _b->prefix, XXH3_DIGEST_LENGTH) != 0)
+        return false;
+
+    if (_stage >= DUPES_BY_DIGEST &&
+        (!_a->pszDigests || !_b->pszDigests || wcscmp(_a->pszDigests, _b->pszDigests) != 0))
+        return false;
+
+    return true;
+}
+
+/*
+ * groups the files by the keys of a stage and leaves out every file
+ * that is alone in its group.
+ * -------------------------------------------------------------
+ * the groups are sorted by size, largest first, the files of a group
+ * keep the order of the list. the digests of files left out are freed.
+ * -------------------------------------------------------------
+ * 
+ * _IN:
+ *      _stage: the keys to compare
+ * 
+ * _IN_OUT:
+ *      _pFiles: the files
+ *      _cFiles: the number of files
+ * 
+ * _RETURNS: the number of files left in _pFiles
+ */
+SIZE_T dupesKeepDuplicates(DUPE_FILE *_pFiles, SIZE_T _cFiles, DUPES_STAGE _stage)
+{
+    static int (*const COMPARE[])(const void *, const void *) = { compareBySize, compareByPrefix, compareByDigest };
+
+    qsort(_pFiles, _cFiles, sizeof(DUPE_FILE), COMPARE[_stage]);
+
+    SIZE_T cFiles = 0;
+    for (SIZE_T i = 0; i < _cFiles; ++i)
+    {
+        bool bDuplicate = (i > 0 && dupesSameGroup(&_pFiles[i-1], &_pFiles[i], _stage)) ||
+                          (i + 1 < _cFiles && dupesSameGroup(&_pFiles[i], &_pFiles[i+1], _stage));
+
+        if (bDuplicate)
+            _pFiles[cFiles++] = _pFiles[i];
+        else if (_pFiles[i].pszDigests)
+            HeapFree(GetProcessHeap(), 0, _pFiles[i].pszDigests);
+    }
+
+    return cFiles;
+}
\ No newline at end of file
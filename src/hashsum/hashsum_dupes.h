@@ -0,0 +1,88 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_dupes.h - narrows a list of files down to candidates for duplicates.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_DUPES_H
+#define _HASHSUM_DUPES_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+#include "hashsum_checksum.h"
+
+// number of bytes at the start of a file compared before the whole file is hashed
+#define DUPES_PREFIX_SIZE (4 * 1024)
+
+// the prefixes are read by this many threads, the reads wait on the disk, not the cpu
+#define DUPES_THREADS 8
+
+/*
+ * the stages of the search, every stage compares one more key:
+ * the size, the XXH3 of the prefix and the digest of the whole file.
+ */
+typedef enum DUPES_STAGE {
+    DUPES_BY_SIZE = 0,
+    DUPES_BY_PREFIX,
+    DUPES_BY_DIGEST
+} DUPES_STAGE;
+
+typedef struct DUPE_FILE {
+    LPWSTR pszPath;
+    SIZE_T index;       // position in the list of files, keeps the groups in walk-order
+    DWORD dwVolume;     // volume serial number and file-index, the identity of the file
+    ULONGLONG fileIndex;
+    ULONGLONG cbFile;
+    BYTE prefix[XXH3_DIGEST_LENGTH];
+    LPWSTR pszDigests;  // as returned by formatDigests(), NULL until hashed
+} DUPE_FILE;
+
+// called for every file that could not be read
+typedef void (*DUPES_ERROR_CALLBACK)(LPCWSTR, DWORD);
+
+SIZE_T dupesQuerySizes(DUPE_FILE *, LPWSTR *, SIZE_T, DUPES_ERROR_CALLBACK);
+SIZE_T dupesHashPrefixes(DUPE_FILE *, SIZE_T, DWORD, DUPES_ERROR_CALLBACK);
+SIZE_T dupesKeepDuplicates(DUPE_FILE *, SIZE_T, DUPES_STAGE);
+bool dupesSameGroup(const DUPE_FILE *, const DUPE_FILE *, DUPES_STAGE);
+
+#endif // _HASHSUM_DUPES_H
\ No newline at end of file
@@ -0,0 +1,573 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_hash.c - streaming hashes of all algorithms (hashsum-library).
+ * 
+ * the algorithms are calculated by the in-tree engines where there
+ * are some (SHA1, SHA256, BLAKE3, XXH3 and CRC32C) and by the Windows
+ * Crypto-API (CNG) otherwise, behind one interface of HASH_STATEs.
+ * together with the engines and the reader this module is built as a
+ * static library, so other tools can hash data or whole files without
+ * starting hashsum.exe. it prints nothing but errors of the Crypto-API.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_hash.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+#pragma comment(lib, "bcrypt.lib")
+
+// smaller spans are hashed by BLAKE3 on the calling thread only
+#define BLAKE3_PARALLEL_THRESHOLD (1024 * 1024)
+
+/*
+ * the subtrees of one span of a BLAKE3-hash, hashed by the calling
+ * thread and the threads of the default thread-pool.
+ */
+typedef struct TREE_JOB {
+    BLAKE3_SUBTREE *pTasks;
+    SIZE_T cTasks;
+    volatile LONG nNext;
+    volatile LONG *pbFault;
+} TREE_JOB;
+
+const LPCWSTR ALL_ALGORITHMS[MAX_HASHES] = {
+    BCRYPT_MD5_ALGORITHM,
+    BCRYPT_SHA1_ALGORITHM,
+    BCRYPT_SHA256_ALGORITHM,
+    BCRYPT_SHA384_ALGORITHM,
+    BCRYPT_SHA512_ALGORITHM,
+    BLAKE3_ALGORITHM,
+    XXH3_ALGORITHM,
+    CRC32C_ALGORITHM
+};
+
+static void runBlake3Subtrees(BLAKE3_SUBTREE *, size_t, void *);
+static VOID CALLBACK treeJobCallback(PTP_CALLBACK_INSTANCE, PVOID, PTP_WORK);
+static void runTreeJob(TREE_JOB *);
+
+/*
+ * prepares a HASH_STATE for one algorithm: opens the provider, creates
+ * the hash-object and begins a hash. BLAKE3 hashes large spans with one
+ * thread per logical processor, set cTreeThreads to 1 to stay on the
+ * calling thread.
+ * 
+ * _IN:
+ *      _pszAlgId: the name of the algorithm, see ALL_ALGORITHMS (case is ignored)
+ * 
+ * _OUT:
+ *      _state: the HASH_STATE, released with hashFree()
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes),
+ *          STATUS_UNSUCCESSFUL for an unknown algorithm
+ */
+NTSTATUS hashInit(HASH_STATE *_state, LPCWSTR _pszAlgId)
+{
+    NTSTATUS status;
+
+    ZeroMemory(_state, sizeof(HASH_STATE));
+
+    if (! (_state->pszAlgId = findAlgorithm(_pszAlgId)))
+        return STATUS_UNSUCCESSFUL;
+
+    if ((status = openHashAlgorithm(_state)) || (status = createHashObject(_state)))
+    {
+        hashFree(_state);
+        return status;
+    }
+
+    hashBegin(_state);
+
+    return STATUS_SUCCESSFUL;
+}
+
+/*
+ * releases a HASH_STATE of hashInit(): the hash-object, the digest and
+ * the algorithm provider.
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE
+ */
+void hashFree(HASH_STATE *_state)
+{
+    destroyHashObject(_state);
+
+    if (_state->hAlg)
+        BCryptCloseAlgorithmProvider(_state->hAlg, 0);
+
+    _state->hAlg = NULL;
+}
+
+/*
+ * opens the algorithm provider and queries the sizes of the hash-object
+ * and the digest.
+ * 
+ * SHA1, SHA256, BLAKE3, XXH3 and CRC32C are calculated by the in-tree
+ * engines, so only the length of the digest is set for them. BLAKE3
+ * hashes large spans with one thread per logical processor.
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ */
+NTSTATUS openHashAlgorithm(HASH_STATE *_state)
+{
+    if ((_state->nativeAlg = getNativeAlgorithm(_state->pszAlgId)) != NATIVE_NONE)
+    {
+        _state->cbHash = getDigestLength(_state->pszAlgId);
+        _state->cTreeThreads = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+        return STATUS_SUCCESSFUL;
+    }
+
+    return openCngAlgorithm(_state);
+}
+
+/*
+ * opens the Crypto-API provider of an algorithm, even if it is also
+ * calculated in-tree (/BENCH compares both).
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ */
+NTSTATUS openCngAlgorithm(HASH_STATE *_state)
+{
+    NTSTATUS status;
+    DWORD cbData = 0;
+
+    _state->nativeAlg = NATIVE_NONE;
+
+    if((status = BCryptOpenAlgorithmProvider(&_state->hAlg, _state->pszAlgId, NULL, BCRYPT_HASH_REUSABLE_FLAG)))
+    {
+        fwprintf(stderr, L"* Error: open algorythm provider failed with status: 0x%x\n", status);
+        return status;
+    }
+
+    // calculate size of buffer for the hash
+    if((status = BCryptGetProperty(_state->hAlg, BCRYPT_OBJECT_LENGTH, (PBYTE)&_state->cbHashObject, sizeof(DWORD), &cbData, 0)))
+    {
+        fwprintf(stderr, L"* Error: getting crypto properties failed with status: 0x%x\n", status);
+        return status;
+    }
+
+   // calculate length of hash
+    if((status = BCryptGetProperty(_state->hAlg, BCRYPT_HASH_LENGTH, (PBYTE)&_state->cbHash, sizeof(DWORD), &cbData, 0)))
+    {
+        fwprintf(stderr, L"* Error: getting crypto properties failed with status: 0x%x\n", status);
+        return status;
+    }
+
+    return STATUS_SUCCESSFUL;
+}
+
+/*
+ * creates the hash-object and the digest-buffer for an already opened
+ * algorithm. every thread calculating hashes needs its own hash-object,
+ * while the algorithm provider can be shared.
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ */
+NTSTATUS createHashObject(HASH_STATE *_state)
+{
+    NTSTATUS status;
+
+    _state->hHash = NULL;
+    _state->pbHashObject = NULL;
+
+    _state->pbHash = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(PBYTE) * _state->cbHash);
+    if(!_state->pbHash)
+    {
+        status = STATUS_UNSUCCESSFUL;
+        fwprintf(stderr, L"* Error: allocating memory for hash failed with status: 0x%x\n", status);
+        return status;
+    }
+
+    if (_state->nativeAlg != NATIVE_NONE) return STATUS_SUCCESSFUL;
+
+    _state->pbHashObject = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(BYTE) * _state->cbHashObject);
+    if(!_state->pbHashObject)
+    {
+        status = STATUS_UNSUCCESSFUL;
+        fwprintf(stderr, L"* Error: allocating memory for hash object failed with status: 0x%x\n", status);
+        return status;
+    }
+
+    if((status = BCryptCreateHash(_state->hAlg, &_state->hHash, _state->pbHashObject, _state->cbHashObject, NULL, 0, 0)))
+    {
+        fwprintf(stderr, L"* Error: creating pbHash failed with status: 0x%x\n", status);
+        return status;
+    }
+
+    return STATUS_SUCCESSFUL;
+}
+
+/*
+ * destroys the hash-object and frees the digest-buffer created by
+ * createHashObject(). the algorithm provider stays open.
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE owned by the calling thread
+ */
+void destroyHashObject(HASH_STATE *_state)
+{
+    if (_state->hHash)    
+        BCryptDestroyHash(_state->hHash);
+
+    if(_state->pbHashObject)
+        HeapFree(GetProcessHeap(), 0, _state->pbHashObject);
+
+    if(_state->pbHash)
+        HeapFree(GetProcessHeap(), 0, _state->pbHash);
+
+    _state->hHash = NULL;
+    _state->pbHashObject = NULL;
+    _state->pbHash = NULL;
+}
+
+/*
+ * resets the state of the in-tree engine before a new file is hashed.
+ * the CNG-hash is reusable and resets itself in BCryptFinishHash().
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ */
+void hashBegin(HASH_STATE *_state)
+{
+    switch (_state->nativeAlg)
+    {
+        case NATIVE_SHA1: sha1Init(&_state->native.sha1); break;
+        case NATIVE_SHA256: sha256Init(&_state->native.sha256); break;
+        case NATIVE_BLAKE3: blake3Init(&_state->native.blake3); break;
+        case NATIVE_XXH3: xxh3Init(&_state->native.xxh3); break;
+        case NATIVE_CRC32C: crc32cInit(&_state->native.crc32c); break;
+        default: break;
+    }
+}
+
+/*
+ * feeds a block of data into a hash.
+ * ----------------------------------
+ * large blocks are split into subtrees by BLAKE3 and hashed on
+ * _state->cTreeThreads threads.
+ * ----------------------------------
+ * 
+ * _IN:
+ *      _data: the data to hash
+ *      _cbData: the size of _data in bytes
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes),
+ *          STATUS_IN_PAGE_ERROR if a thread of the pool could not read _data
+ */
+NTSTATUS hashData(HASH_STATE *_state, const BYTE *_data, DWORD _cbData)
+{
+    volatile LONG bFault = 0;
+
+    switch (_state->nativeAlg)
+    {
+        case NATIVE_SHA1:
+            sha1Update(&_state->native.sha1, _data, _cbData);
+            break;
+        case NATIVE_SHA256:
+            sha256Update(&_state->native.sha256, _data, _cbData);
+            break;
+        case NATIVE_BLAKE3:
+            if (_state->cTreeThreads > 1 && _cbData >= BLAKE3_PARALLEL_THRESHOLD)
+                blake3UpdateParallel(&_state->native.blake3, _data, _cbData, _state->cTreeThreads,
+                                    runBlake3Subtrees, (void *)&bFault);
+            else
+                blake3Update(&_state->native.blake3, _data, _cbData);
+            break;
+        case NATIVE_XXH3:
+            xxh3Update(&_state->native.xxh3, _data, _cbData);
+            break;
+        case NATIVE_CRC32C:
+            crc32cUpdate(&_state->native.crc32c, _data, _cbData);
+            break;
+        default:
+            return BCryptHashData(_state->hHash, (PUCHAR)_data, _cbData, 0);
+    }
+
+    return bFault ? STATUS_IN_PAGE_ERROR : STATUS_SUCCESSFUL;
+}
+
+/*
+ * finishes a hash and writes the digest to _state->pbHash.
+ * 
+ * _IN_OUT:
+ *      _state: the HASH_STATE of the algorithm
+ * 
+ * _RETURNS: 0x00000000 on success, errorcode on failure (NT Error-Codes)
+ */
+NTSTATUS hashFinish(HASH_STATE *_state)
+{
+    switch (_state->nativeAlg)
+    {
+        case NATIVE_SHA1: sha1Final(&_state->native.sha1, _state->pbHash); break;
+        case NATIVE_SHA256: sha256Final(&_state->native.sha256, _state->pbHash); break;
+        case NATIVE_BLAKE3: blake3Final(&_state->native.blake3, _state->pbHash); break;
+        case NATIVE_XXH3: xxh3Final(&_state->native.xxh3, _state->pbHash); break;
+        case NATIVE_CRC32C: crc32cFinal(&_state->native.crc32c, _state->pbHash); break;
+        default: return BCryptFinishHash(_state->hHash, _state->pbHash, _state->cbHash, 0);
+    }
+
+    return STATUS_SUCCESSFUL;
+}
+
+/*
+ * hashes a whole file with one or more algorithms.
+ * ------------------------------------------------
+ * the fast path for whole files: the file is read once through the
+ * reader, mapped or with overlapped block-reads, and every span is
+ * fed to all hashes before the next one is read. an I/O-error on a
+ * mapped view is caught and returned as ERROR_READ_FAULT.
+ * ------------------------------------------------
+ * 
+ * _IN:
+ *      _cStates: the number of HASH_STATEs
+ *      _fileName: the name/path of the file
+ * 
+ * _IN_OUT:
+ *      _states: the HASH_STATEs of the algorithms, with a hash-object
+ *              each, the digests are written to their pbHash
+ *      _reader: a reader prepared with readerInit()
+ * 
+ * _RETURNS: ERROR_SUCCESS, the win32 error-code of opening or reading
+ *          the file, or ERROR_INVALID_FUNCTION if a hash failed
+ */
+DWORD hashWholeFile(HASH_STATE *_states, SIZE_T _cStates, FILE_READER *_reader, LPCWSTR _fileName)
+{
+    for (SIZE_T i = 0; i < _cStates; ++i)
+        hashBegin(&_states[i]);
+
+    DWORD dwError = readerOpen(_reader, _fileName, 0);
+    if (dwError != ERROR_SUCCESS)
+        return dwError;
+
+    NTSTATUS status = STATUS_SUCCESSFUL;
+    const BYTE *pbData;
+    SIZE_T cbData;
+
+    __try
+    {
+        while (status == STATUS_SUCCESSFUL && readerNext(_reader, &pbData, &cbData))
+        {
+            for (SIZE_T i = 0; i < _cStates && status == STATUS_SUCCESSFUL; ++i)
+                status = hashData(&_states[i], pbData, (DWORD)cbData);
+        }
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        status = STATUS_IN_PAGE_ERROR;
+    }
+
+    dwError = _reader->dwError;
+    readerClose(_reader);
+
+    // a helper-thread of BLAKE3 could not read the view either
+    if (status == STATUS_IN_PAGE_ERROR)
+        return ERROR_READ_FAULT;
+    if (status != STATUS_SUCCESSFUL)
+        return ERROR_INVALID_FUNCTION;
+    if (dwError != ERROR_SUCCESS)
+        return dwError;
+
+    for (SIZE_T i = 0; i < _cStates; ++i)
+    {
+        if (hashFinish(&_states[i]) != STATUS_SUCCESSFUL)
+            return ERROR_INVALID_FUNCTION;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/*
+ * resolves the tag of a "TAG (file) = hash"-line.
+ * 
+ * _IN:
+ *      _tag: the tag as written in the hash-file
+ * 
+ * _RETURNS: the constant name of the algorithm, or NULL if the tag
+ *          names no supported algorithm
+ */
+LPCWSTR findAlgorithm(LPCWSTR _tag)
+{
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+    {
+        if (_wcsicmp(_tag, ALL_ALGORITHMS[i]) == 0)
+            return ALL_ALGORITHMS[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * checks if an algorithm is calculated by an in-tree engine.
+ * 
+ * _IN:
+ *      _pszAlgId: the name of the algorithm
+ * 
+ * _RETURNS: the in-tree engine, NATIVE_NONE for the Crypto-API
+ */
+NATIVE_ALG getNativeAlgorithm(LPCWSTR _pszAlgId)
+{
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA1_ALGORITHM) == 0) return NATIVE_SHA1;
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA256_ALGORITHM) == 0) return NATIVE_SHA256;
+    if (_wcsicmp(_pszAlgId, BLAKE3_ALGORITHM) == 0) return NATIVE_BLAKE3;
+    if (_wcsicmp(_pszAlgId, XXH3_ALGORITHM) == 0) return NATIVE_XXH3;
+    if (_wcsicmp(_pszAlgId, CRC32C_ALGORITHM) == 0) return NATIVE_CRC32C;
+
+    return NATIVE_NONE;
+}
+
+/*
+ * returns the length of the digest of an algorithm in bytes.
+ * 
+ * _IN:
+ *      _pszAlgId: the name of the algorithm
+ * 
+ * _RETURNS: the length in bytes, 0 for unknown algorithms
+ */
+DWORD getDigestLength(LPCWSTR _pszAlgId)
+{
+    if (_wcsicmp(_pszAlgId, BCRYPT_MD5_ALGORITHM) == 0) return 16;
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA1_ALGORITHM) == 0) return SHA1_DIGEST_LENGTH;
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA256_ALGORITHM) == 0) return SHA256_DIGEST_LENGTH;
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA384_ALGORITHM) == 0) return 48;
+    if (_wcsicmp(_pszAlgId, BCRYPT_SHA512_ALGORITHM) == 0) return 64;
+    if (_wcsicmp(_pszAlgId, BLAKE3_ALGORITHM) == 0) return BLAKE3_DIGEST_LENGTH;
+    if (_wcsicmp(_pszAlgId, XXH3_ALGORITHM) == 0) return XXH3_DIGEST_LENGTH;
+    if (_wcsicmp(_pszAlgId, CRC32C_ALGORITHM) == 0) return CRC32C_DIGEST_LENGTH;
+
+    return 0;
+}
+
+/*
+ * checks if the digests of an algorithm are written with a tag,
+ * because their length alone is ambiguous.
+ * 
+ * _IN:
+ *      _pszAlgId: the name of the algorithm
+ * 
+ * _RETURNS: true for the in-tree BLAKE3, XXH3 and CRC32C, otherwise false
+ */
+bool isTaggedAlgorithm(LPCWSTR _pszAlgId)
+{
+    NATIVE_ALG nativeAlg = getNativeAlgorithm(_pszAlgId);
+
+    return nativeAlg == NATIVE_BLAKE3 || nativeAlg == NATIVE_XXH3 || nativeAlg == NATIVE_CRC32C;
+}
+
+/*
+ * hashes the subtrees of a BLAKE3-span on the default thread-pool.
+ * ----------------------------------------------------------------
+ * called by blake3UpdateParallel(). the calling thread takes part
+ * and the function returns when all subtrees are done.
+ * ----------------------------------------------------------------
+ * 
+ * _IN:
+ *      _cTasks: the number of subtrees
+ * 
+ * _IN_OUT:
+ *      _tasks: the subtrees, their chaining values are filled in
+ *      _pvFault: a volatile LONG, set to 1 if reading the span failed
+ */
+static void runBlake3Subtrees(BLAKE3_SUBTREE *_tasks, size_t _cTasks, void *_pvFault)
+{
+    TREE_JOB job = {
+        .pTasks = _tasks,
+        .cTasks = _cTasks,
+        .nNext = 0,
+        .pbFault = (volatile LONG *)_pvFault
+    };
+
+    // without a work-object the calling thread hashes all subtrees
+    PTP_WORK work = CreateThreadpoolWork(treeJobCallback, &job, NULL);
+    if (work)
+    {
+        for (SIZE_T i = 1; i < _cTasks; ++i)
+            SubmitThreadpoolWork(work);
+    }
+
+    runTreeJob(&job);
+
+    if (work)
+    {
+        WaitForThreadpoolWorkCallbacks(work, FALSE);
+        CloseThreadpoolWork(work);
+    }
+}
+
+/*
+ * callback of the thread-pool, see runBlake3Subtrees().
+ */
+static VOID CALLBACK treeJobCallback(PTP_CALLBACK_INSTANCE _instance, PVOID _context, PTP_WORK _work)
+{
+    UNREFERENCED_PARAMETER(_instance);
+    UNREFERENCED_PARAMETER(_work);
+
+    runTreeJob((TREE_JOB *)_context);
+}
+
+/*
+ * takes subtrees from a TREE_JOB until none are left. an I/O-error
+ * on a mapped view is only recorded, the thread-pool must not see it.
+ * 
+ * _IN_OUT:
+ *      _job: the TREE_JOB
+ */
+static void runTreeJob(TREE_JOB *_job)
+{
+    for (;;)
+    {
+        LONG i = InterlockedIncrement(&_job->nNext) - 1;
+        if (i >= (LONG)_job->cTasks) break;
+
+        __try
+        {
+            blake3HashSubtree(&_job->pTasks[i]);
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            InterlockedExchange(_job->pbFault, 1);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_hash.h - streaming hashes of all algorithms (hashsum-library).
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_HASH_H
+#define _HASHSUM_HASH_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <bcrypt.h>
+#include <stdbool.h>
+
+#include "hashsum_sha.h"
+#include "hashsum_blake3.h"
+#include "hashsum_checksum.h"
+#include "hashsum_reader.h"
+
+#define STATUS_SUCCESSFUL 0x00000000L
+#define STATUS_UNSUCCESSFUL 0xC0000001L
+
+// number of supported algorithms, all of them can be calculated at once
+#define MAX_HASHES 8
+
+// name of the in-tree BLAKE3, CNG has no provider for it
+#define BLAKE3_ALGORITHM L"BLAKE3"
+
+// names of the in-tree checksums, they are not cryptographic
+#define XXH3_ALGORITHM L"XXH3"
+#define CRC32C_ALGORITHM L"CRC32C"
+
+// the longest digest of all algorithms (SHA512)
+#define MAX_DIGEST_LENGTH 64
+
+/*
+ * state of the in-tree engines, used instead of the Crypto-API
+ * for SHA1 and SHA256 and for the algorithms CNG does not provide.
+ */
+typedef union NATIVE_HASH {
+    SHA1_CTX sha1;
+    SHA256_CTX sha256;
+    BLAKE3_CTX blake3;
+    XXH3_CTX xxh3;
+    CRC32C_CTX crc32c;
+} NATIVE_HASH;
+
+typedef enum NATIVE_ALG {
+    NATIVE_NONE = 0,    // calculated by the Crypto-API
+    NATIVE_SHA1,
+    NATIVE_SHA256,
+    NATIVE_BLAKE3,
+    NATIVE_XXH3,
+    NATIVE_CRC32C
+} NATIVE_ALG;
+
+// the algorithms selected by /ALL, in the order their digests are printed
+extern const LPCWSTR ALL_ALGORITHMS[MAX_HASHES];
+
+/*
+ * state of one hash-algorithm. the algorithm provider is opened once
+ * and shared, every thread needs its own hash-object and digest.
+ * 
+ * a single state is set up with hashInit() and released with
+ * hashFree(). states sharing a provider are opened once with
+ * openHashAlgorithm(), every copy then gets its own hash-object with
+ * createHashObject() and drops it with destroyHashObject().
+ * 
+ * a message is hashed with hashBegin(), any number of hashData() and
+ * hashFinish(), which writes the digest to pbHash.
+ */
+typedef struct HASH_STATE {
+    LPCWSTR pszAlgId;
+    BCRYPT_ALG_HANDLE hAlg;
+    BCRYPT_HASH_HANDLE hHash;
+    DWORD cbHash;
+    DWORD cbHashObject;
+    PBYTE pbHashObject;
+    PBYTE pbHash;
+    NATIVE_ALG nativeAlg;
+    NATIVE_HASH native;
+    DWORD cTreeThreads;     // threads BLAKE3 hashes large spans with
+} HASH_STATE;
+
+NTSTATUS hashInit(HASH_STATE *, LPCWSTR);
+void hashFree(HASH_STATE *);
+NTSTATUS openHashAlgorithm(HASH_STATE *);
+NTSTATUS openCngAlgorithm(HASH_STATE *);
+NTSTATUS createHashObject(HASH_STATE *);
+void destroyHashObject(HASH_STATE *);
+void hashBegin(HASH_STATE *);
+NTSTATUS hashData(HASH_STATE *, const BYTE *, DWORD);
+NTSTATUS hashFinish(HASH_STATE *);
+DWORD hashWholeFile(HASH_STATE *, SIZE_T, FILE_READER *, LPCWSTR);
+LPCWSTR findAlgorithm(LPCWSTR);
+NATIVE_ALG getNativeAlgorithm(LPCWSTR);
+DWORD getDigestLength(LPCWSTR);
+bool isTaggedAlgorithm(LPCWSTR);
+
+#endif // _HASHSUM_HASH_H
\ No newline at end of file
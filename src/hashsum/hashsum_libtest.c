@@ -0,0 +1,375 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_libtest.c - tests of the hashsum-library.
+ * 
+ * hashes a file with every algorithm through the streaming API, fed in
+ * spans of odd sizes, and through hashWholeFile() in every mode of the
+ * reader, and compares the digests with the known ones of test.txt.
+ * with /BENCH the throughput of the streaming API is measured as well.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_hash.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+// the spans the streaming API is fed with, around the block-sizes of the algorithms
+static const DWORD SPAN_SIZES[] = { 1, 7, 63, 64, 65, 127, 128, 129, 1000, 4096 };
+
+// megabytes hashed per algorithm with /BENCH
+#define BENCH_SIZE 256
+
+// BLAKE3 hashes spans of this size on several threads
+#define TREE_TEST_SIZE (4 * 1024 * 1024)
+
+/*
+ * the digests of etc/test-files/test.txt (with CRLF line-endings)
+ */
+typedef struct KNOWN_DIGEST {
+    LPCWSTR pszAlgId;
+    LPCWSTR pszDigest;
+} KNOWN_DIGEST;
+
+static const KNOWN_DIGEST KNOWN_DIGESTS[MAX_HASHES] = {
+    { BCRYPT_MD5_ALGORITHM, L"65174B22ED8F86E613B853A713952773" },
+    { BCRYPT_SHA1_ALGORITHM, L"CE9824D25131EE1FEB395C4C443A3C94073296A8" },
+    { BCRYPT_SHA256_ALGORITHM, L"79EC4FE42FC34C3F23B0B8921359F8E3663D254288E1817BDA6C3FB9E83C1B7C" },
+    { BCRYPT_SHA384_ALGORITHM, L"F810FB42951EF4881A5A20CF0EF98F9A1B328CB9134FABC8036FDDFE2B3B1FF6C528AF703FAACC74F48EC3F1348D259A" },
+    { BCRYPT_SHA512_ALGORITHM, L"9934A08BEFB1033EC85834032B2AFD1D91D921D1ADF877BA6F792FF2DD6B170186CFF1DB44061322A91674AA0ACE469C8CC555E243FA4FC02D4EF486700D05A7" },
+    { BLAKE3_ALGORITHM, L"8CF05B4F036F0B100B300E1227995EF1207B6FC51632EBAD8C028084D294A815" },
+    { XXH3_ALGORITHM, L"3843CDC22170FA4E" },
+    { CRC32C_ALGORITHM, L"7F1A742C" }
+};
+
+static SIZE_T g_cPassed = 0;
+static SIZE_T g_cFailed = 0;
+
+bool readTestFile(LPCWSTR, PBYTE *, DWORD *);
+void testStreaming(const KNOWN_DIGEST *, const BYTE *, DWORD);
+void testWholeFile(LPCWSTR);
+void testTreeThreads(void);
+void benchStreaming(void);
+bool checkDigest(const HASH_STATE *, LPCWSTR, LPCWSTR);
+
+int wmain(int argc, LPWSTR *argv)
+{
+    if (argc < 2)
+    {
+        fwprintf_s(stderr, L"Usage: HASHSUM_LIBTEST.EXE <test.txt> [/BENCH]\n");
+        return EXIT_FAILURE;
+    }
+
+    PBYTE pbData;
+    DWORD cbData;
+    if (!readTestFile(argv[1], &pbData, &cbData))
+        return EXIT_FAILURE;
+
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+        testStreaming(&KNOWN_DIGESTS[i], pbData, cbData);
+
+    HeapFree(GetProcessHeap(), 0, pbData);
+
+    testWholeFile(argv[1]);
+    testTreeThreads();
+
+    if (argc > 2 && _wcsicmp(argv[2], L"/BENCH") == 0)
+        benchStreaming();
+
+    wprintf(L"%zu passed, %zu failed\n", g_cPassed, g_cFailed);
+
+    return g_cFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * reads the test-file into memory.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file
+ * 
+ * _OUT:
+ *      _ppbData: the content of the file, freed with HeapFree()
+ *      _pcbData: the size of the file in bytes
+ * 
+ * _RETURNS: true on success, false on error (the error is printed)
+ */
+bool readTestFile(LPCWSTR _fileName, PBYTE *_ppbData, DWORD *_pcbData)
+{
+    HANDLE hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        fwprintf_s(stderr, L"* ERROR: opening %s failed with error %lu\n", _fileName, GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER cbFile;
+    bool bRead = GetFileSizeEx(hFile, &cbFile) && cbFile.QuadPart < MAXDWORD &&
+                (*_ppbData = HeapAlloc(GetProcessHeap(), 0, (SIZE_T)cbFile.QuadPart + 1)) != NULL;
+
+    if (bRead && !(ReadFile(hFile, *_ppbData, (DWORD)cbFile.QuadPart, _pcbData, NULL) && *_pcbData == cbFile.QuadPart))
+    {
+        HeapFree(GetProcessHeap(), 0, *_ppbData);
+        bRead = false;
+    }
+
+    if (!bRead)
+        fwprintf_s(stderr, L"* ERROR: reading %s failed with error %lu\n", _fileName, GetLastError());
+
+    CloseHandle(hFile);
+
+    return bRead;
+}
+
+/*
+ * hashes the data with hashInit(), hashData() and hashFinish(), once per
+ * size of SPAN_SIZES, reusing the state after every digest.
+ * 
+ * _IN:
+ *      _known: the algorithm and the digest of the data
+ *      _pbData: the data
+ *      _cbData: the size of _pbData in bytes
+ */
+void testStreaming(const KNOWN_DIGEST *_known, const BYTE *_pbData, DWORD _cbData)
+{
+    HASH_STATE state;
+    NTSTATUS status = hashInit(&state, _known->pszAlgId);
+
+    if (status != STATUS_SUCCESSFUL)
+    {
+        wprintf(L"* FAILED: %s: hashInit() returned 0x%x\n", _known->pszAlgId, status);
+        ++g_cFailed;
+        return;
+    }
+
+    for (SIZE_T i = 0; i < _countof(SPAN_SIZES); ++i)
+    {
+        WCHAR szTest[64];
+        swprintf_s(szTest, _countof(szTest), L"spans of %lu bytes", SPAN_SIZES[i]);
+
+        if (i > 0) hashBegin(&state);
+
+        for (DWORD offset = 0; offset < _cbData && status == STATUS_SUCCESSFUL; offset += SPAN_SIZES[i])
+            status = hashData(&state, &_pbData[offset], min(SPAN_SIZES[i], _cbData - offset));
+
+        if (status == STATUS_SUCCESSFUL)
+            status = hashFinish(&state);
+
+        if (status != STATUS_SUCCESSFUL)
+        {
+            wprintf(L"* FAILED: %s, %s: status 0x%x\n", _known->pszAlgId, szTest, status);
+            ++g_cFailed;
+            break;
+        }
+
+        checkDigest(&state, _known->pszDigest, szTest);
+    }
+
+    hashFree(&state);
+}
+
+/*
+ * hashes the file with all algorithms at once with hashWholeFile(), in
+ * every mode of the reader.
+ * 
+ * _IN:
+ *      _fileName: the name/path of test.txt
+ */
+void testWholeFile(LPCWSTR _fileName)
+{
+    static const READER_MODE modes[] = { READER_AUTO, READER_MAP, READER_BLOCK, READER_NOCACHE };
+    static const LPCWSTR modeNames[] = { L"whole file, AUTO", L"whole file, MAP", L"whole file, BLOCK", L"whole file, NOCACHE" };
+
+    HASH_STATE states[MAX_HASHES];
+    SIZE_T cStates = 0;
+
+    for (; cStates < MAX_HASHES; ++cStates)
+    {
+        if (hashInit(&states[cStates], KNOWN_DIGESTS[cStates].pszAlgId) != STATUS_SUCCESSFUL)
+        {
+            wprintf(L"* FAILED: %s: hashInit() failed\n", KNOWN_DIGESTS[cStates].pszAlgId);
+            ++g_cFailed;
+            break;
+        }
+    }
+
+    for (SIZE_T m = 0; m < _countof(modes) && cStates == MAX_HASHES; ++m)
+    {
+        FILE_READER reader;
+        if (!readerInit(&reader, modes[m]))
+        {
+            wprintf(L"* FAILED: %s: readerInit() failed\n", modeNames[m]);
+            ++g_cFailed;
+            continue;
+        }
+
+        DWORD dwError = hashWholeFile(states, cStates, &reader, _fileName);
+        readerFree(&reader);
+
+        if (dwError != ERROR_SUCCESS)
+        {
+            wprintf(L"* FAILED: %s: error %lu\n", modeNames[m], dwError);
+            ++g_cFailed;
+            continue;
+        }
+
+        for (SIZE_T i = 0; i < cStates; ++i)
+            checkDigest(&states[i], KNOWN_DIGESTS[i].pszDigest, modeNames[m]);
+    }
+
+    for (SIZE_T i = 0; i < cStates; ++i)
+        hashFree(&states[i]);
+}
+
+/*
+ * BLAKE3 has to calculate the same digest whether large spans are
+ * hashed on the calling thread or on the thread-pool.
+ */
+void testTreeThreads(void)
+{
+    PBYTE pbData = HeapAlloc(GetProcessHeap(), 0, TREE_TEST_SIZE);
+    HASH_STATE single, parallel;
+    WCHAR szDigest[BLAKE3_DIGEST_LENGTH * 2 + 1];
+
+    bool bSingle = pbData && hashInit(&single, BLAKE3_ALGORITHM) == STATUS_SUCCESSFUL;
+    bool bParallel = bSingle && hashInit(&parallel, BLAKE3_ALGORITHM) == STATUS_SUCCESSFUL;
+
+    if (!bParallel)
+    {
+        wprintf(L"* FAILED: BLAKE3, threads: setup failed\n");
+        ++g_cFailed;
+        if (bSingle) hashFree(&single);
+        if (pbData) HeapFree(GetProcessHeap(), 0, pbData);
+        return;
+    }
+
+    for (DWORD i = 0; i < TREE_TEST_SIZE; ++i)
+        pbData[i] = (BYTE)(i * 31 + (i >> 11));
+
+    single.cTreeThreads = 1;
+    parallel.cTreeThreads = max(parallel.cTreeThreads, 2);
+
+    hashData(&single, pbData, TREE_TEST_SIZE);
+    hashFinish(&single);
+    hashData(&parallel, pbData, TREE_TEST_SIZE);
+    hashFinish(&parallel);
+
+    for (DWORD i = 0; i < BLAKE3_DIGEST_LENGTH; ++i)
+        swprintf_s(&szDigest[i * 2], 3, L"%02X", single.pbHash[i]);
+
+    checkDigest(&parallel, szDigest, L"threads");
+
+    hashFree(&single);
+    hashFree(&parallel);
+    HeapFree(GetProcessHeap(), 0, pbData);
+}
+
+/*
+ * measures the throughput of the streaming API, in spans of 1 MB on
+ * one thread. the numbers are printed only, /BENCH of hashsum.exe
+ * compares the engines.
+ */
+void benchStreaming(void)
+{
+    SIZE_T cbData = (SIZE_T)BENCH_SIZE * 1024 * 1024;
+    PBYTE pbData = VirtualAlloc(NULL, cbData, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+    if (!pbData)
+    {
+        wprintf(L"* FAILED: throughput: allocating %u MB failed\n", BENCH_SIZE);
+        ++g_cFailed;
+        return;
+    }
+
+    for (SIZE_T i = 0; i < cbData; ++i)
+        pbData[i] = (BYTE)(i * 131 + (i >> 13));
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    for (SIZE_T i = 0; i < MAX_HASHES; ++i)
+    {
+        HASH_STATE state;
+        if (hashInit(&state, ALL_ALGORITHMS[i]) != STATUS_SUCCESSFUL)
+        {
+            wprintf(L"* FAILED: throughput: hashInit(%s) failed\n", ALL_ALGORITHMS[i]);
+            ++g_cFailed;
+            continue;
+        }
+
+        state.cTreeThreads = 1;
+
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+
+        for (SIZE_T offset = 0; offset < cbData; offset += 1024 * 1024)
+            hashData(&state, &pbData[offset], 1024 * 1024);
+
+        hashFinish(&state);
+        QueryPerformanceCounter(&end);
+
+        double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+        wprintf(L"%-8s %10.2f MB/s\n", ALL_ALGORITHMS[i], seconds > 0.0 ? BENCH_SIZE / seconds : 0.0);
+
+        hashFree(&state);
+    }
+
+    VirtualFree(pbData, 0, MEM_RELEASE);
+}
+
+/*
+ * compares the digest of a HASH_STATE with the expected one and counts
+ * the result.
+ * 
+ * _IN:
+ *      _state: the HASH_STATE after hashFinish()
+ *      _pszExpected: the expected digest in upper-case hex-digits
+ *      _pszTest: the name of the test
+ * 
+ * _RETURNS: true if the digests are the same
+ */
+bool checkDigest(const HASH_STATE *_state, LPCWSTR _pszExpected, LPCWSTR _pszTest)
+{
+    WCHAR szDigest[MAX_DIGEST_LENGTH * 2 + 1] = L"";
+
+    for (DWORD i = 0; i < _state->cbHash && i < MAX_DIGEST_LENGTH; ++i)
+        swprintf_s(&szDigest[i * 2], 3, L"%02X", _state->pbHash[i]);
+
+    if (wcscmp(szDigest, _pszExpected) != 0)
+    {
+        wprintf(L"* FAILED: %s, %s: %s, expected %s\n", _state->pszAlgId, _pszTest, szDigest, _pszExpected);
+        ++g_cFailed;
+        return false;
+    }
+
+    ++g_cPassed;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,420 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_manifest.c - streaming parser for hash-files (manifests).
+ * 
+ * the manifest is memory-mapped in views of MANIFEST_VIEW_SIZE and
+ * parsed line by line into a batch: the lines are converted to UTF-16
+ * one after the other into a single text-buffer, the entries point
+ * into it. when the batch is full it is handed to the verification and
+ * then reused for the next lines, so the first results appear at once
+ * and memory stays bounded, no matter how many lines a manifest has.
+ * 
+ * manifests are read as UTF-8 (lines that are no valid UTF-8 in the
+ * ANSI code-page), or as UTF-16 if they start with its byte-order-mark.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_manifest.h"
+#include "hashsum_output.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+typedef enum LINE_TYPE {
+    LINE_ENTRY = 0,
+    LINE_SKIP,          // empty lines and comments
+    LINE_MALFORMED
+} LINE_TYPE;
+
+static DWORD allocationGranularity(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwAllocationGranularity;
+}
+
+/*
+ * maps the view that starts at or just before _offset.
+ */
+static bool mapView(MANIFEST_READER *_reader, ULONGLONG _offset)
+{
+    if (_reader->pbView) UnmapViewOfFile(_reader->pbView);
+
+    ULONGLONG start = _offset - _offset % allocationGranularity();
+    ULONGLONG cbLeft = _reader->cbFile - start;
+    SIZE_T cbView = cbLeft < MANIFEST_VIEW_SIZE ? (SIZE_T)cbLeft : MANIFEST_VIEW_SIZE;
+
+    _reader->pbView = MapViewOfFile(_reader->hMapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, cbView);
+    if (!_reader->pbView)
+    {
+        _reader->dwError = GetLastError();
+        return false;
+    }
+
+    _reader->viewOffset = start;
+    _reader->cbView = cbView;
+
+    return true;
+}
+
+/*
+ * returns the next line without its line-break. the line stays valid
+ * until the next call.
+ * 
+ * _RETURNS: false at the end of the manifest or on error
+ */
+static bool nextLine(MANIFEST_READER *_reader, const BYTE **_ppLine, SIZE_T *_pcbLine)
+{
+    SIZE_T cbUnit = _reader->bUtf16 ? sizeof(WCHAR) : 1;
+
+    while (_reader->offset < _reader->cbFile)
+    {
+        if (!_reader->pbView || _reader->offset < _reader->viewOffset ||
+            _reader->offset >= _reader->viewOffset + _reader->cbView)
+        {
+            if (!mapView(_reader, _reader->offset)) return false;
+        }
+
+        const BYTE *pbLine = _reader->pbView + (SIZE_T)(_reader->offset - _reader->viewOffset);
+        SIZE_T cbLeft = (SIZE_T)(_reader->viewOffset + _reader->cbView - _reader->offset);
+        const BYTE *pbEnd = NULL;
+
+        if (_reader->bUtf16)
+            pbEnd = (const BYTE *)wmemchr((const WCHAR *)pbLine, L'\n', cbLeft / sizeof(WCHAR));
+        else
+            pbEnd = memchr(pbLine, '\n', cbLeft);
+
+        bool bLastView = _reader->viewOffset + _reader->cbView >= _reader->cbFile;
+
+        if (pbEnd || bLastView)
+        {
+            *_ppLine = pbLine;
+            *_pcbLine = pbEnd ? (SIZE_T)(pbEnd - pbLine) : cbLeft;
+
+            _reader->offset += *_pcbLine + (pbEnd ? cbUnit : 0);
+            ++_reader->line;
+
+            return true;
+        }
+
+        // the line reaches into the next view, which then has to start with it
+        ULONGLONG viewOffset = _reader->viewOffset;
+        if (!mapView(_reader, _reader->offset)) return false;
+
+        if (_reader->viewOffset == viewOffset)
+        {
+            _reader->dwError = ERROR_INVALID_DATA;
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * converts a line to UTF-16 at the end of the text of the batch.
+ * 
+ * _RETURNS: the converted, terminated line or NULL if it does not fit
+ */
+static LPWSTR appendLine(const MANIFEST_READER *_reader, MANIFEST_BATCH *_batch, const BYTE *_pbLine, SIZE_T _cbLine)
+{
+    SIZE_T cchRoom = MANIFEST_BATCH_TEXT - _batch->cchText;
+    LPWSTR pwLine = _batch->pwText + _batch->cchText;
+    SIZE_T cchLine;
+
+    if (_reader->bUtf16)
+    {
+        cchLine = _cbLine / sizeof(WCHAR);
+        if (cchLine >= cchRoom) return NULL;
+
+        memcpy(pwLine, _pbLine, cchLine * sizeof(WCHAR));
+    }
+    else
+    {
+        // a byte never becomes more than one UTF-16 character
+        if (_cbLine >= cchRoom) return NULL;
+
+        cchLine = _cbLine == 0 ? 0 : (SIZE_T)MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, (LPCSTR)_pbLine,
+                                                                (int)_cbLine, pwLine, (int)cchRoom);
+        if (cchLine == 0 && _cbLine > 0)
+            cchLine = (SIZE_T)MultiByteToWideChar(CP_ACP, 0, (LPCSTR)_pbLine, (int)_cbLine, pwLine, (int)cchRoom);
+    }
+
+    if (cchLine > 0 && pwLine[cchLine - 1] == L'\r') --cchLine;
+
+    pwLine[cchLine] = L'\0';
+    _batch->cchText += cchLine + 1;
+
+    return pwLine;
+}
+
+/*
+ * splits a line into its parts. besides "hash  file"-lines (with an
+ * optional '*' in front of binary files), tagged lines in the form
+ * "TAG (file) = hash" are understood. the file-name of a tagged line
+ * ends at the last ") = ". comments are skipped unless _bComments
+ * is set.
+ */
+static LINE_TYPE parseLine(LPWSTR _line, MANIFEST_ENTRY *_entry, bool _bComments)
+{
+    LPWSTR p = _line;
+    while (iswspace(*p)) ++p;
+
+    if (*p == L'\0' || (*p == L'#' && !_bComments)) return LINE_SKIP;
+
+    if (*p == L'#')
+    {
+        _entry->pszFile = _entry->pszHash = _entry->pszTag = NULL;
+        _entry->pszComment = p + 1;
+        return LINE_ENTRY;
+    }
+
+    _entry->pszComment = NULL;
+
+    LPWSTR pbOpen = wcsstr(_line, L" (");
+    LPWSTR pbClose = NULL;
+
+    for (LPWSTR pbNext = pbOpen; pbNext && (pbNext = wcsstr(pbNext + 1, L") = ")); )
+        pbClose = pbNext;
+
+    if (pbOpen && pbClose && pbClose > pbOpen)
+    {
+        *pbOpen = L'\0';
+        *pbClose = L'\0';
+
+        _entry->pszTag = _line;
+        _entry->pszFile = pbOpen + 2;
+
+        for (p = pbClose + 4; iswspace(*p); ++p);
+        _entry->pszHash = p;
+
+        while (*p && !iswspace(*p)) ++p;
+        *p = L'\0';
+
+        return *_entry->pszTag && *_entry->pszHash ? LINE_ENTRY : LINE_MALFORMED;
+    }
+
+    _entry->pszTag = NULL;
+    _entry->pszHash = _line;
+
+    for (p = _line; *p && *p != L' ' && *p != L'\t'; ++p);
+    if (*p == L'\0') return LINE_MALFORMED;
+
+    for (*p++ = L'\0'; *p == L' ' || *p == L'\t'; ++p);
+    if (*p == L'*') ++p;
+
+    _entry->pszFile = p;
+
+    return *_entry->pszFile ? LINE_ENTRY : LINE_MALFORMED;
+}
+
+/*
+ * opens a manifest for reading.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the manifest
+ * 
+ * _OUT:
+ *      _reader: the reader
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD manifestOpen(MANIFEST_READER *_reader, LPCWSTR _fileName)
+{
+    ZeroMemory(_reader, sizeof(MANIFEST_READER));
+
+    _reader->pszFileName = _fileName;
+    _reader->hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (_reader->hFile == INVALID_HANDLE_VALUE)
+        return GetLastError();
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_reader->hFile, &size))
+    {
+        DWORD dwError = GetLastError();
+        manifestClose(_reader);
+        return dwError;
+    }
+
+    // an empty file can not be mapped, it just has no lines
+    if ((_reader->cbFile = (ULONGLONG)size.QuadPart) == 0)
+        return ERROR_SUCCESS;
+
+    if (! (_reader->hMapping = CreateFileMappingW(_reader->hFile, NULL, PAGE_READONLY, 0, 0, NULL)) ||
+        !mapView(_reader, 0))
+    {
+        DWORD dwError = _reader->dwError ? _reader->dwError : GetLastError();
+        manifestClose(_reader);
+        return dwError;
+    }
+
+    __try
+    {
+        if (_reader->cbFile >= 3 && memcmp(_reader->pbView, "\xEF\xBB\xBF", 3) == 0)
+            _reader->offset = 3;
+        else if (_reader->cbFile >= 2 && memcmp(_reader->pbView, "\xFF\xFE", 2) == 0)
+        {
+            _reader->offset = 2;
+            _reader->bUtf16 = true;
+        }
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        manifestClose(_reader);
+        return ERROR_READ_FAULT;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/*
+ * allocates the arena of a batch.
+ * 
+ * _OUT:
+ *      _batch: the batch
+ * 
+ * _RETURNS: true on success, false if memory could not be allocated
+ */
+bool manifestBatchInit(MANIFEST_BATCH *_batch)
+{
+    ZeroMemory(_batch, sizeof(MANIFEST_BATCH));
+
+    _batch->pEntries = HeapAlloc(GetProcessHeap(), 0, sizeof(MANIFEST_ENTRY) * MANIFEST_BATCH_ENTRIES);
+    _batch->pwText = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * MANIFEST_BATCH_TEXT);
+
+    return _batch->pEntries && _batch->pwText;
+}
+
+/*
+ * parses the next lines of a manifest.
+ * ------------------------------------
+ * the previous content of the batch is discarded. malformed lines are
+ * reported and skipped.
+ * ------------------------------------
+ * 
+ * _IN_OUT:
+ *      _reader: an opened manifest
+ *      _batch: the batch to fill
+ * 
+ * _RETURNS: true if the batch contains entries, false at the end of the
+ *          manifest or on error (_reader->dwError is set)
+ */
+bool manifestRead(MANIFEST_READER *_reader, MANIFEST_BATCH *_batch)
+{
+    _batch->cEntries = 0;
+    _batch->cchText = 0;
+
+    __try
+    {
+        while (_batch->cEntries < MANIFEST_BATCH_ENTRIES)
+        {
+            ULONGLONG offset = _reader->offset;
+            const BYTE *pbLine;
+            SIZE_T cbLine;
+
+            if (!nextLine(_reader, &pbLine, &cbLine)) break;
+
+            LPWSTR pwLine = appendLine(_reader, _batch, pbLine, cbLine);
+            if (!pwLine)
+            {
+                if (_batch->cEntries > 0)
+                {
+                    // the line is parsed again for the next batch
+                    _reader->offset = offset;
+                    --_reader->line;
+                    break;
+                }
+
+                outputPrintf(L"* WARNING: %s: Line %zu is too long\n", _reader->pszFileName, _reader->line);
+                continue;
+            }
+
+            MANIFEST_ENTRY *entry = &_batch->pEntries[_batch->cEntries];
+            entry->line = _reader->line;
+
+            switch (parseLine(pwLine, entry, _reader->bComments))
+            {
+                case LINE_ENTRY:
+                    ++_batch->cEntries;
+                    break;
+                case LINE_MALFORMED:
+                    outputPrintf(L"* WARNING: %s: Maleformatted Line: %zu\n", _reader->pszFileName, _reader->line);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        // I/O-error while accessing a mapped view of the manifest
+        _reader->dwError = ERROR_READ_FAULT;
+        _reader->offset = _reader->cbFile;
+    }
+
+    return _batch->cEntries > 0;
+}
+
+/*
+ * closes a manifest.
+ * 
+ * _IN_OUT:
+ *      _reader: the reader
+ */
+void manifestClose(MANIFEST_READER *_reader)
+{
+    if (_reader->pbView) UnmapViewOfFile(_reader->pbView);
+    if (_reader->hMapping) CloseHandle(_reader->hMapping);
+    if (_reader->hFile != INVALID_HANDLE_VALUE && _reader->hFile) CloseHandle(_reader->hFile);
+
+    _reader->pbView = NULL;
+    _reader->hMapping = NULL;
+    _reader->hFile = INVALID_HANDLE_VALUE;
+}
+
+/*
+ * frees the arena of a batch.
+ * 
+ * _IN_OUT:
+ *      _batch: the batch
+ */
+void manifestBatchFree(MANIFEST_BATCH *_batch)
+{
+    if (_batch->pEntries) HeapFree(GetProcessHeap(), 0, _batch->pEntries);
+    if (_batch->pwText) HeapFree(GetProcessHeap(), 0, _batch->pwText);
+
+    _batch->pEntries = NULL;
+    _batch->pwText = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_manifest.h - streaming parser for hash-files (manifests).
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_MANIFEST_H
+#define _HASHSUM_MANIFEST_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+// size of one mapped view of the manifest, a multiple of the allocation granularity
+#define MANIFEST_VIEW_SIZE (64 * 1024 * 1024)
+
+// a batch ends after this many entries ...
+#define MANIFEST_BATCH_ENTRIES 4096
+
+// ... or when its text does not fit into this many characters
+#define MANIFEST_BATCH_TEXT (1024 * 1024)
+
+/*
+ * one line of a manifest, either "hash  file" or "TAG (file) = hash".
+ * the strings point into the text of the batch. if the reader keeps
+ * comments, they are returned as entries with only pszComment set.
+ */
+typedef struct MANIFEST_ENTRY {
+    LPWSTR pszFile;
+    LPWSTR pszHash;
+    LPWSTR pszTag;      // NULL for untagged lines
+    LPWSTR pszComment;  // the text behind '#', NULL for all other lines
+    SIZE_T line;
+} MANIFEST_ENTRY;
+
+/*
+ * the arena the entries are parsed into. it is reused for every batch,
+ * so the memory needed does not depend on the size of the manifest.
+ */
+typedef struct MANIFEST_BATCH {
+    MANIFEST_ENTRY *pEntries;
+    SIZE_T cEntries;
+    LPWSTR pwText;
+    SIZE_T cchText;
+} MANIFEST_BATCH;
+
+typedef struct MANIFEST_READER {
+    LPCWSTR pszFileName;
+    HANDLE hFile;
+    HANDLE hMapping;
+    const BYTE *pbView;
+    ULONGLONG cbFile;
+    ULONGLONG viewOffset;
+    SIZE_T cbView;
+    ULONGLONG offset;
+    SIZE_T line;
+    bool bUtf16;
+    bool bComments;     // return comment-lines as entries, set after manifestOpen()
+    DWORD dwError;
+} MANIFEST_READER;
+
+DWORD manifestOpen(MANIFEST_READER *, LPCWSTR);
+bool manifestBatchInit(MANIFEST_BATCH *);
+bool manifestRead(MANIFEST_READER *, MANIFEST_BATCH *);
+void manifestClose(MANIFEST_READER *);
+void manifestBatchFree(MANIFEST_BATCH *);
+
+#endif // _HASHSUM_MANIFEST_H
\ No newline at end of file
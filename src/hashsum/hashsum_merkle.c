@@ -0,0 +1,426 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_merkle.c - rolls the digests of a directory-tree up into a root-hash.
+ * 
+ * the digest of a directory is the SHA256 of the records of its files
+ * and subdirectories in the order of the walk, each record being the
+ * type ('F' or 'D'), the length of the name in bytes, the name (UTF-16)
+ * and the digest. only names below the root are hashed, so two copies
+ * of a tree have the same root-hash no matter where they are stored.
+ * directories without files are not part of the tree.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_merkle.h"
+#include "hashsum_manifest.h"
+#include "hashsum_walk.h"
+#include "hashsum_output.h"
+
+#include <stdlib.h>
+#include <wchar.h>
+#include <wctype.h>
+
+// a directory that is still collecting the records of its content
+typedef struct MERKLE_LEVEL {
+    SHA256_CTX ctx;
+    LPCWSTR pszPath;
+    SIZE_T cchPath;     // including the trailing separator
+} MERKLE_LEVEL;
+
+static void addRecord(SHA256_CTX *_ctx, char _type, LPCWSTR _name, SIZE_T _cchName, const BYTE *_digest)
+{
+    uint8_t header[5];
+    uint32_t cbName = (uint32_t)(_cchName * sizeof(WCHAR));
+
+    header[0] = (uint8_t)_type;
+    header[1] = (uint8_t)cbName;
+    header[2] = (uint8_t)(cbName >> 8);
+    header[3] = (uint8_t)(cbName >> 16);
+    header[4] = (uint8_t)(cbName >> 24);
+
+    sha256Update(_ctx, header, sizeof(header));
+    sha256Update(_ctx, _name, cbName);
+    sha256Update(_ctx, _digest, MERKLE_DIGEST_LENGTH);
+}
+
+static bool pushLevel(MERKLE_LEVEL **_ppLevels, SIZE_T *_cCapacity, SIZE_T _iLevel, LPCWSTR _pszPath, SIZE_T _cchPath)
+{
+    if (_iLevel >= *_cCapacity)
+    {
+        SIZE_T cCapacity = *_cCapacity ? *_cCapacity * 2 : 16;
+        MERKLE_LEVEL *pLevels = *_ppLevels
+            ? HeapReAlloc(GetProcessHeap(), 0, *_ppLevels, sizeof(MERKLE_LEVEL) * cCapacity)
+            : HeapAlloc(GetProcessHeap(), 0, sizeof(MERKLE_LEVEL) * cCapacity);
+
+        if (!pLevels) return false;
+
+        *_ppLevels = pLevels;
+        *_cCapacity = cCapacity;
+    }
+
+    MERKLE_LEVEL *level = &(*_ppLevels)[_iLevel];
+
+    sha256Init(&level->ctx);
+    level->pszPath = _pszPath;
+    level->cchPath = _cchPath;
+
+    return true;
+}
+
+/*
+ * finishes the innermost directory and adds its record to its parent.
+ */
+static void popLevel(MERKLE_LEVEL *_pLevels, SIZE_T *_iLevel, MERKLE_CALLBACK _pfnVisit, void *_context)
+{
+    MERKLE_LEVEL *level = &_pLevels[*_iLevel];
+    MERKLE_LEVEL *parent = &_pLevels[--(*_iLevel)];
+    BYTE digest[MERKLE_DIGEST_LENGTH];
+
+    sha256Final(&level->ctx, digest);
+
+    if (_pfnVisit) _pfnVisit(_context, level->pszPath, level->cchPath, digest, NULL);
+
+    addRecord(&parent->ctx, 'D', level->pszPath + parent->cchPath, level->cchPath - parent->cchPath - 1, digest);
+}
+
+/*
+ * queries the metadata of a file without opening it.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file, it has to outlive _file
+ * 
+ * _OUT:
+ *      _file: the file, its digest is not set yet
+ * 
+ * _RETURNS: true on success, false on error (GetLastError() tells why)
+ */
+bool merkleQueryFile(LPWSTR _fileName, MERKLE_FILE *_file)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    ZeroMemory(_file, sizeof(MERKLE_FILE));
+    _file->pszPath = _fileName;
+
+    if (!GetFileAttributesExW(_fileName, GetFileExInfoStandard, &data))
+        return false;
+
+    _file->cbFile = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    _file->ftLastWrite = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+    return true;
+}
+
+/*
+ * calculates the root-hash of a tree.
+ * -----------------------------------
+ * the files have to be sorted in the order of the walk (see
+ * walkComparePaths()), so the files of a directory are next to each
+ * other. files that were not hashed are left out.
+ * -----------------------------------
+ * 
+ * _IN:
+ *      _root: the name/path of the directory the tree was walked from
+ *      _pFiles: the files of the tree
+ *      _cFiles: the number of files
+ *      _pfnVisit: called for every file and directory in the order of
+ *              a manifest, or NULL
+ *      _context: passed to _pfnVisit
+ * 
+ * _OUT:
+ *      _digest: the root-hash
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool merkleRollup(LPCWSTR _root, const MERKLE_FILE *_pFiles, SIZE_T _cFiles, BYTE _digest[MERKLE_DIGEST_LENGTH],
+                    MERKLE_CALLBACK _pfnVisit, void *_context)
+{
+    SIZE_T cchRoot = wcslen(_root);
+    bool bSeparator = cchRoot > 0 && (_root[cchRoot-1] == L'\\' || _root[cchRoot-1] == L'/');
+
+    MERKLE_LEVEL *pLevels = NULL;
+    SIZE_T cCapacity = 0;
+    SIZE_T iLevel = 0;
+
+    // the paths of the walk always have a separator behind the root
+    if (!pushLevel(&pLevels, &cCapacity, 0, _root, cchRoot + (bSeparator ? 0 : 1)))
+        return false;
+
+    for (SIZE_T i = 0; i < _cFiles; ++i)
+    {
+        const MERKLE_FILE *file = &_pFiles[i];
+        LPCWSTR pszPath = file->pszPath;
+
+        if (!file->bHashed) continue;
+
+        // close the directories the file is not part of
+        while (iLevel > 0 && wcsncmp(pLevels[iLevel].pszPath, pszPath, pLevels[iLevel].cchPath) != 0)
+            popLevel(pLevels, &iLevel, _pfnVisit, _context);
+
+        // open the directories between the innermost one and the file
+        LPCWSTR name = pszPath + pLevels[iLevel].cchPath;
+        for (LPCWSTR pbSeparator; (pbSeparator = wcschr(name, L'\\')); name = pbSeparator + 1)
+        {
+            if (!pushLevel(&pLevels, &cCapacity, iLevel + 1, pszPath, (SIZE_T)(pbSeparator - pszPath) + 1))
+            {
+                HeapFree(GetProcessHeap(), 0, pLevels);
+                return false;
+            }
+
+            ++iLevel;
+        }
+
+        addRecord(&pLevels[iLevel].ctx, 'F', name, wcslen(name), file->digest);
+
+        if (_pfnVisit) _pfnVisit(_context, pszPath, wcslen(pszPath), file->digest, file);
+    }
+
+    while (iLevel > 0)
+        popLevel(pLevels, &iLevel, _pfnVisit, _context);
+
+    sha256Final(&pLevels[0].ctx, _digest);
+    HeapFree(GetProcessHeap(), 0, pLevels);
+
+    return true;
+}
+
+/*
+ * converts a digest from hex.
+ * 
+ * _IN:
+ *      _hex: the digest as hex-string, upper- or lowercase
+ * 
+ * _OUT:
+ *      _digest: the digest
+ * 
+ * _RETURNS: true on success, false if _hex is no SHA256-digest
+ */
+bool merkleParseDigest(LPCWSTR _hex, BYTE _digest[MERKLE_DIGEST_LENGTH])
+{
+    for (SIZE_T i = 0; i < MERKLE_DIGEST_LENGTH * 2; ++i)
+    {
+        if (!iswxdigit(_hex[i])) return false;
+    }
+
+    if (_hex[MERKLE_DIGEST_LENGTH * 2] != L'\0' && !iswspace(_hex[MERKLE_DIGEST_LENGTH * 2]))
+        return false;
+
+    for (SIZE_T i = 0; i < MERKLE_DIGEST_LENGTH; ++i)
+    {
+        WCHAR byte[3] = { _hex[i * 2], _hex[i * 2 + 1], L'\0' };
+        _digest[i] = (BYTE)wcstoul(byte, NULL, 16);
+    }
+
+    return true;
+}
+
+static LPWSTR copyString(LPCWSTR _string)
+{
+    SIZE_T cchString = wcslen(_string);
+    LPWSTR pszCopy = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * (cchString + 1));
+
+    if (pszCopy) wmemcpy(pszCopy, _string, cchString + 1);
+
+    return pszCopy;
+}
+
+static bool reserve(void **_ppItems, SIZE_T *_cCapacity, SIZE_T _cItems, SIZE_T _cbItem)
+{
+    if (_cItems < *_cCapacity) return true;
+
+    SIZE_T cCapacity = *_cCapacity ? *_cCapacity * 2 : 256;
+    void *pItems = *_ppItems
+        ? HeapReAlloc(GetProcessHeap(), 0, *_ppItems, _cbItem * cCapacity)
+        : HeapAlloc(GetProcessHeap(), 0, _cbItem * cCapacity);
+
+    if (!pItems) return false;
+
+    *_ppItems = pItems;
+    *_cCapacity = cCapacity;
+
+    return true;
+}
+
+/*
+ * reads a manifest written with /MERKLE.
+ * --------------------------------------
+ * "#M size write-time" in front of a file-line holds the metadata of
+ * the file, "#R digest  path" ends a tree. the "#D"-lines of the
+ * directories are only informative, they are calculated again.
+ * --------------------------------------
+ * 
+ * _IN:
+ *      _fileName: the name/path of the manifest
+ * 
+ * _OUT:
+ *      _manifest: the trees and their files, free it with
+ *              merkleFreeManifest()
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD merkleLoadManifest(LPCWSTR _fileName, MERKLE_MANIFEST *_manifest)
+{
+    ZeroMemory(_manifest, sizeof(MERKLE_MANIFEST));
+
+    MANIFEST_READER reader;
+    MANIFEST_BATCH batch;
+
+    DWORD dwError = manifestOpen(&reader, _fileName);
+    if (dwError != ERROR_SUCCESS)
+        return dwError;
+
+    if (!manifestBatchInit(&batch))
+    {
+        manifestBatchFree(&batch);
+        manifestClose(&reader);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    reader.bComments = true;
+
+    ULONGLONG cbFile = 0;
+    ULONGLONG ftLastWrite = 0;
+    SIZE_T iFirst = 0;
+
+    while (dwError == ERROR_SUCCESS && manifestRead(&reader, &batch))
+    {
+        for (SIZE_T i = 0; i < batch.cEntries && dwError == ERROR_SUCCESS; ++i)
+        {
+            const MANIFEST_ENTRY *entry = &batch.pEntries[i];
+            LPWSTR p = entry->pszComment;
+
+            if (p && p[0] == L'M' && p[1] == L' ')
+            {
+                cbFile = wcstoull(p + 1, &p, 10);
+                ftLastWrite = wcstoull(p, NULL, 16);
+            }
+            else if (p && p[0] == L'R' && p[1] == L' ')
+            {
+                if (!reserve((void **)&_manifest->pRoots, &_manifest->cRootCapacity, _manifest->cRoots, sizeof(MERKLE_ROOT)))
+                {
+                    dwError = ERROR_NOT_ENOUGH_MEMORY;
+                    break;
+                }
+
+                MERKLE_ROOT *root = &_manifest->pRoots[_manifest->cRoots];
+
+                for (++p; iswspace(*p); ++p);
+                if (!merkleParseDigest(p, root->digest))
+                {
+                    outputPrintf(L"* WARNING: %s: Maleformatted Line: %zu\n", _fileName, entry->line);
+                    continue;
+                }
+
+                for (p += MERKLE_DIGEST_LENGTH * 2; iswspace(*p); ++p);
+                if (! (root->pszPath = copyString(p)))
+                {
+                    dwError = ERROR_NOT_ENOUGH_MEMORY;
+                    break;
+                }
+
+                root->iFirst = iFirst;
+                root->cFiles = _manifest->cFiles - iFirst;
+                iFirst = _manifest->cFiles;
+                ++_manifest->cRoots;
+            }
+            else if (!p && (!entry->pszTag || _wcsicmp(entry->pszTag, L"SHA256") == 0))
+            {
+                if (!reserve((void **)&_manifest->pFiles, &_manifest->cCapacity, _manifest->cFiles, sizeof(MERKLE_FILE)))
+                {
+                    dwError = ERROR_NOT_ENOUGH_MEMORY;
+                    break;
+                }
+
+                MERKLE_FILE *file = &_manifest->pFiles[_manifest->cFiles];
+
+                file->cbFile = cbFile;
+                file->ftLastWrite = ftLastWrite;
+                file->bHashed = merkleParseDigest(entry->pszHash, file->digest);
+
+                if (! (file->pszPath = copyString(entry->pszFile)))
+                {
+                    dwError = ERROR_NOT_ENOUGH_MEMORY;
+                    break;
+                }
+
+                ++_manifest->cFiles;
+
+                // a line without metadata is always read again
+                cbFile = ftLastWrite = 0;
+            }
+        }
+    }
+
+    if (dwError == ERROR_SUCCESS)
+        dwError = reader.dwError;
+
+    manifestBatchFree(&batch);
+    manifestClose(&reader);
+
+    return dwError;
+}
+
+static int compareFiles(const void *_a, const void *_b)
+{
+    return walkComparePaths(((const MERKLE_FILE *)_a)->pszPath, ((const MERKLE_FILE *)_b)->pszPath);
+}
+
+/*
+ * sorts files in the order of the walk.
+ * 
+ * _IN_OUT:
+ *      _pFiles: the files
+ *      _cFiles: the number of files
+ */
+void merkleSortFiles(MERKLE_FILE *_pFiles, SIZE_T _cFiles)
+{
+    qsort(_pFiles, _cFiles, sizeof(MERKLE_FILE), compareFiles);
+}
+
+/*
+ * frees a manifest loaded with merkleLoadManifest().
+ * 
+ * _IN_OUT:
+ *      _manifest: the manifest
+ */
+void merkleFreeManifest(MERKLE_MANIFEST *_manifest)
+{
+    for (SIZE_T i = 0; i < _manifest->cFiles; ++i)
+        HeapFree(GetProcessHeap(), 0, _manifest->pFiles[i].pszPath);
+
+    for (SIZE_T i = 0; i < _manifest->cRoots; ++i)
+        HeapFree(GetProcessHeap(), 0, _manifest->pRoots[i].pszPath);
+
+    if (_manifest->pFiles) HeapFree(GetProcessHeap(), 0, _manifest->pFiles);
+    if (_manifest->pRoots) HeapFree(GetProcessHeap(), 0, _manifest->pRoots);
+
+    ZeroMemory(_manifest, sizeof(MERKLE_MANIFEST));
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_merkle.h - rolls the digests of a directory-tree up into a root-hash.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_MERKLE_H
+#define _HASHSUM_MERKLE_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+#include "hashsum_sha.h"
+
+// the files and directories of a tree are hashed with SHA256
+#define MERKLE_DIGEST_LENGTH SHA256_DIGEST_LENGTH
+
+/*
+ * a file of a tree, its digest and the metadata that tells if it
+ * has to be read again.
+ */
+typedef struct MERKLE_FILE {
+    LPWSTR pszPath;
+    ULONGLONG cbFile;
+    ULONGLONG ftLastWrite;
+    BYTE digest[MERKLE_DIGEST_LENGTH];
+    bool bHashed;       // false if the file could not be read, it is not part of the tree
+} MERKLE_FILE;
+
+/*
+ * a tree of a manifest and its files, which are the entries
+ * pFiles[iFirst] to pFiles[iFirst + cFiles - 1] of the manifest.
+ */
+typedef struct MERKLE_ROOT {
+    LPWSTR pszPath;
+    BYTE digest[MERKLE_DIGEST_LENGTH];
+    SIZE_T iFirst;
+    SIZE_T cFiles;
+} MERKLE_ROOT;
+
+typedef struct MERKLE_MANIFEST {
+    MERKLE_FILE *pFiles;
+    SIZE_T cFiles;
+    SIZE_T cCapacity;
+    MERKLE_ROOT *pRoots;
+    SIZE_T cRoots;
+    SIZE_T cRootCapacity;
+} MERKLE_MANIFEST;
+
+/*
+ * called by merkleRollup() for every file (_file is set) and, after
+ * all of its content, for every directory below the root. the path
+ * is not terminated, it is _cchPath characters long.
+ */
+typedef void (*MERKLE_CALLBACK)(void *, LPCWSTR, SIZE_T, const BYTE *, const MERKLE_FILE *);
+
+bool merkleQueryFile(LPWSTR, MERKLE_FILE *);
+bool merkleRollup(LPCWSTR, const MERKLE_FILE *, SIZE_T, BYTE[MERKLE_DIGEST_LENGTH], MERKLE_CALLBACK, void *);
+bool merkleParseDigest(LPCWSTR, BYTE[MERKLE_DIGEST_LENGTH]);
+DWORD merkleLoadManifest(LPCWSTR, MERKLE_MANIFEST *);
+void merkleSortFiles(MERKLE_FILE *, SIZE_T);
+void merkleFreeManifest(MERKLE_MANIFEST *);
+
+#endif // _HASHSUM_MERKLE_H
\ No newline at end of file
@@ -0,0 +1,238 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_output.c - block-buffered writer for the results on stdout.
+ * 
+ * a run over millions of files prints millions of lines. the CRT
+ * converts every character of wprintf() on its own and writes the
+ * small buffer of stdout often, so the results are converted to UTF-8
+ * in one go per string and written to stdout in blocks of
+ * OUTPUT_BUFFER_SIZE bytes instead. the writer is used by the
+ * main-thread only.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_output.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <wchar.h>
+
+// a string converted at once fits into the empty buffer, a character takes up to 3 bytes in UTF-8
+#define OUTPUT_CHUNK_CCH (OUTPUT_BUFFER_SIZE / 3)
+
+static OUTPUT_WRITER g_output = { .hOutput = NULL, .pbBuffer = NULL };
+
+/*
+ * prepares the writer for stdout.
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool outputInit(void)
+{
+    DWORD dwMode;
+
+    g_output.hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    g_output.bConsole = GetConsoleMode(g_output.hOutput, &dwMode) != 0;
+    g_output.cbBuffer = 0;
+    g_output.dwError = ERROR_SUCCESS;
+
+    return (g_output.pbBuffer = HeapAlloc(GetProcessHeap(), 0, OUTPUT_BUFFER_SIZE)) != NULL;
+}
+
+/*
+ * appends a line of UTF-16 to the buffer of a console.
+ */
+static void appendWide(LPCWSTR _string, SIZE_T _cch)
+{
+    while (_cch > 0)
+    {
+        if (g_output.cbBuffer == OUTPUT_BUFFER_SIZE)
+            outputFlush();
+
+        SIZE_T cchCopy = (OUTPUT_BUFFER_SIZE - g_output.cbBuffer) / sizeof(WCHAR);
+        if (cchCopy > _cch) cchCopy = _cch;
+
+        CopyMemory(g_output.pbBuffer + g_output.cbBuffer, _string, sizeof(WCHAR) * cchCopy);
+        g_output.cbBuffer += sizeof(WCHAR) * cchCopy;
+
+        _string += cchCopy;
+        _cch -= cchCopy;
+    }
+}
+
+/*
+ * appends a line as UTF-8 to the buffer, without the line-ending.
+ */
+static void appendUtf8(LPCWSTR _string, SIZE_T _cch)
+{
+    while (_cch > 0)
+    {
+        SIZE_T cchChunk = _cch;
+        if (cchChunk > OUTPUT_CHUNK_CCH)
+        {
+            // a surrogate-pair is converted as a whole
+            cchChunk = OUTPUT_CHUNK_CCH;
+            if (IS_HIGH_SURROGATE(_string[cchChunk - 1])) --cchChunk;
+        }
+
+        if (g_output.cbBuffer + cchChunk * 3 > OUTPUT_BUFFER_SIZE)
+            outputFlush();
+
+        g_output.cbBuffer += WideCharToMultiByte(CP_UTF8, 0, _string, (int)cchChunk,
+                                                (LPSTR)g_output.pbBuffer + g_output.cbBuffer,
+                                                (int)(OUTPUT_BUFFER_SIZE - g_output.cbBuffer), NULL, NULL);
+
+        _string += cchChunk;
+        _cch -= cchChunk;
+    }
+}
+
+/*
+ * writes a string to stdout. line-endings are written as CRLF, a
+ * console is flushed at the end of every line.
+ * 
+ * _IN:
+ *      _string: the string to write, it does not have to be terminated
+ *      _cch: the number of characters to write
+ */
+void outputWrite(LPCWSTR _string, SIZE_T _cch)
+{
+    if (!g_output.pbBuffer) return;
+
+    if (g_output.bConsole)
+    {
+        appendWide(_string, _cch);
+
+        if (wmemchr(_string, L'\n', _cch)) outputFlush();
+
+        return;
+    }
+
+    while (_cch > 0)
+    {
+        LPCWSTR pszEnd = wmemchr(_string, L'\n', _cch);
+        SIZE_T cchLine = pszEnd ? (SIZE_T)(pszEnd - _string) : _cch;
+
+        appendUtf8(_string, cchLine);
+
+        if (pszEnd)
+        {
+            if (g_output.cbBuffer + 2 > OUTPUT_BUFFER_SIZE)
+                outputFlush();
+
+            g_output.pbBuffer[g_output.cbBuffer++] = '\r';
+            g_output.pbBuffer[g_output.cbBuffer++] = '\n';
+            ++cchLine;
+        }
+
+        _string += cchLine;
+        _cch -= cchLine;
+    }
+}
+
+void outputString(LPCWSTR _string)
+{
+    outputWrite(_string, wcslen(_string));
+}
+
+/*
+ * writes a formatted string to stdout, see wprintf().
+ */
+void outputPrintf(LPCWSTR _format, ...)
+{
+    WCHAR pszLine[512];
+    va_list args;
+
+    va_start(args, _format);
+    int cchLine = _vsnwprintf_s(pszLine, _countof(pszLine), _TRUNCATE, _format, args);
+    va_end(args);
+
+    if (cchLine >= 0)
+    {
+        outputWrite(pszLine, cchLine);
+        return;
+    }
+
+    // the line did not fit, e.g. because of a long path
+    va_start(args, _format);
+    cchLine = _vscwprintf(_format, args);
+    va_end(args);
+
+    LPWSTR pszLong;
+    if (cchLine < 0 || ! (pszLong = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * (cchLine + 1))))
+        return;
+
+    va_start(args, _format);
+    _vsnwprintf_s(pszLong, cchLine + 1, _TRUNCATE, _format, args);
+    va_end(args);
+
+    outputWrite(pszLong, cchLine);
+    HeapFree(GetProcessHeap(), 0, pszLong);
+}
+
+/*
+ * writes the buffer to stdout. after an error the output is dropped.
+ * 
+ * _RETURNS: ERROR_SUCCESS or the first win32 error-code writing to stdout
+ */
+DWORD outputFlush(void)
+{
+    if (g_output.cbBuffer > 0 && g_output.dwError == ERROR_SUCCESS)
+    {
+        DWORD cWritten = 0;
+        BOOL bWritten = g_output.bConsole
+                        ? WriteConsoleW(g_output.hOutput, g_output.pbBuffer, (DWORD)(g_output.cbBuffer / sizeof(WCHAR)), &cWritten, NULL)
+                        : WriteFile(g_output.hOutput, g_output.pbBuffer, (DWORD)g_output.cbBuffer, &cWritten, NULL);
+
+        if (!bWritten)
+            g_output.dwError = GetLastError();
+    }
+
+    g_output.cbBuffer = 0;
+
+    return g_output.dwError;
+}
+
+/*
+ * flushes and releases the writer.
+ * 
+ * _RETURNS: ERROR_SUCCESS or the first win32 error-code writing to stdout
+ */
+DWORD outputFree(void)
+{
+    DWORD dwError = outputFlush();
+
+    if (g_output.pbBuffer) HeapFree(GetProcessHeap(), 0, g_output.pbBuffer);
+    g_output.pbBuffer = NULL;
+
+    return dwError;
+}
\ No newline at end of file
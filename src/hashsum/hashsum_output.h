@@ -0,0 +1,75 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_output.h - block-buffered writer for the results on stdout.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_OUTPUT_H
+#define _HASHSUM_OUTPUT_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+// size of the buffer, it is written to stdout when full
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/*
+ * the results are collected as UTF-8 with CRLF line-endings, like the
+ * text-mode of the CRT writes them. a console gets UTF-16 and is
+ * written line by line, so results show up as they are calculated.
+ */
+typedef struct OUTPUT_WRITER {
+    HANDLE hOutput;
+    bool bConsole;
+    PBYTE pbBuffer;
+    SIZE_T cbBuffer;        // bytes in pbBuffer
+    DWORD dwError;          // the first error writing to stdout
+} OUTPUT_WRITER;
+
+bool outputInit(void);
+void outputWrite(LPCWSTR, SIZE_T);
+void outputString(LPCWSTR);
+void outputPrintf(LPCWSTR, ...);
+DWORD outputFlush(void);
+DWORD outputFree(void);
+
+#endif // _HASHSUM_OUTPUT_H
\ No newline at end of file
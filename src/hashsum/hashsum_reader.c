@@ -0,0 +1,540 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_reader.c - reads files in large contiguous spans for hashing.
+ * 
+ * regular files are memory-mapped in views of READER_VIEW_SIZE, so the
+ * hash-functions see the whole view at once without copying it. while
+ * a view is hashed, the next one is already mapped and read ahead by
+ * the memory-manager. files that are not mapped are read with
+ * overlapped I/O: READER_QUEUE_DEPTH block-reads are kept in flight, so
+ * the disk reads the following blocks while one block is hashed. pipes
+ * and devices are read with plain blocking reads.
+ * 
+ * sparse files are not mapped, the block-reads only read the ranges
+ * that are allocated on disk. the holes between them are handed to
+ * the hash-functions as a buffer of zeros, without any I/O. with
+ * READER_NOCACHE the block-reads bypass the page-cache, so hashing a
+ * backup does not evict the working set of other programs.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_reader.h"
+
+static void resetOverlapped(READER_SLOT *_slot, ULONGLONG _offset)
+{
+    HANDLE hEvent = _slot->overlapped.hEvent;
+    ZeroMemory(&_slot->overlapped, sizeof(OVERLAPPED));
+
+    _slot->overlapped.hEvent = hEvent;
+    _slot->overlapped.Offset = (DWORD)_offset;
+    _slot->overlapped.OffsetHigh = (DWORD)(_offset >> 32);
+}
+
+/*
+ * queries the next allocated ranges of a sparse file, starting at
+ * _reader->readOffset. the event of the slot is used to wait for the
+ * query, no read of the slot may be in flight.
+ * 
+ * _RETURNS: true on success, false on error (_reader->dwError is set)
+ */
+static bool queryRanges(FILE_READER *_reader, READER_SLOT *_slot)
+{
+    FILE_ALLOCATED_RANGE_BUFFER query;
+    query.FileOffset.QuadPart = (LONGLONG)_reader->readOffset;
+    query.Length.QuadPart = (LONGLONG)(_reader->cbFile - _reader->readOffset);
+
+    resetOverlapped(_slot, 0);
+
+    DWORD cbReturned = 0;
+    bool bDone = DeviceIoControl(_reader->hFile, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query),
+                                _reader->ranges, sizeof(_reader->ranges), NULL, &_slot->overlapped);
+    DWORD dwError = bDone ? ERROR_SUCCESS : GetLastError();
+
+    if (bDone || dwError == ERROR_IO_PENDING || dwError == ERROR_MORE_DATA)
+    {
+        bDone = GetOverlappedResult(_reader->hFile, &_slot->overlapped, &cbReturned, TRUE);
+        dwError = bDone ? ERROR_SUCCESS : GetLastError();
+    }
+
+    // ERROR_MORE_DATA: the rest is queried when these ranges are used up
+    if (dwError != ERROR_SUCCESS && dwError != ERROR_MORE_DATA)
+    {
+        _reader->dwError = dwError;
+        return false;
+    }
+
+    _reader->cRanges = cbReturned / sizeof(FILE_ALLOCATED_RANGE_BUFFER);
+    _reader->iRange = 0;
+
+    // nothing is allocated up to the end of the file, an empty range there ends the last hole
+    if (_reader->cRanges == 0)
+    {
+        _reader->ranges[0].FileOffset.QuadPart = (LONGLONG)_reader->cbFile;
+        _reader->ranges[0].Length.QuadPart = 0;
+        _reader->cRanges = 1;
+    }
+
+    return true;
+}
+
+/*
+ * starts the asynchronous read of the next block into a slot. blocks
+ * past the size of the file (at open) are not requested. in a sparse
+ * file a block ends at the next boundary of a hole, a block in a hole
+ * is not read at all.
+ * 
+ * _RETURNS: true if a read was started, false at the end of the file
+ *          or on error (_reader->dwError is set)
+ */
+static bool queueRead(FILE_READER *_reader, READER_SLOT *_slot)
+{
+    if (_reader->readOffset >= _reader->cbFile) return false;
+
+    _slot->cbRequest = READER_BLOCK_SIZE;
+    _slot->bHole = false;
+
+    if (_reader->bSparse)
+    {
+        const FILE_ALLOCATED_RANGE_BUFFER *range;
+
+        // skip the ranges that were read already
+        for (;;)
+        {
+            if (_reader->iRange == _reader->cRanges && !queryRanges(_reader, _slot)) return false;
+
+            range = &_reader->ranges[_reader->iRange];
+            if ((ULONGLONG)(range->FileOffset.QuadPart + range->Length.QuadPart) > _reader->readOffset) break;
+
+            ++_reader->iRange;
+        }
+
+        ULONGLONG rangeStart = (ULONGLONG)range->FileOffset.QuadPart;
+        ULONGLONG cbSpan = rangeStart > _reader->readOffset
+                            ? rangeStart - _reader->readOffset
+                            : rangeStart + (ULONGLONG)range->Length.QuadPart - _reader->readOffset;
+
+        _slot->bHole = rangeStart > _reader->readOffset;
+        if (cbSpan < READER_BLOCK_SIZE) _slot->cbRequest = (DWORD)cbSpan;
+    }
+
+    if (_slot->bHole)
+    {
+        _slot->bPending = true;
+        _reader->readOffset += _slot->cbRequest;
+
+        return true;
+    }
+
+    resetOverlapped(_slot, _reader->readOffset);
+
+    if (!ReadFile(_reader->hFile, _slot->pbData, _slot->cbRequest, NULL, &_slot->overlapped))
+    {
+        DWORD dwError = GetLastError();
+
+        if (dwError != ERROR_IO_PENDING)
+        {
+            if (dwError != ERROR_HANDLE_EOF) _reader->dwError = dwError;
+            return false;
+        }
+    }
+
+    _slot->bPending = true;
+    _reader->readOffset += _slot->cbRequest;
+
+    return true;
+}
+
+/*
+ * waits for all reads still in flight, their buffers are reused
+ * afterwards.
+ */
+static void cancelReads(FILE_READER *_reader)
+{
+    for (DWORD i = 0; i < READER_QUEUE_DEPTH; ++i)
+    {
+        READER_SLOT *slot = &_reader->slots[i];
+        DWORD cbRead;
+
+        if (!slot->bPending) continue;
+
+        if (slot->bHole)
+        {
+            slot->bPending = false;
+            continue;
+        }
+
+        CancelIoEx(_reader->hFile, &slot->overlapped);
+        GetOverlappedResult(_reader->hFile, &slot->overlapped, &cbRead, TRUE);
+        slot->bPending = false;
+    }
+}
+
+/*
+ * maps the view at _reader->offset and lets the memory-manager read
+ * it ahead with large I/Os.
+ * 
+ * _RETURNS: true if a view was mapped, false at the end of the file
+ *          or on error (_reader->dwError is set)
+ */
+static bool mapNextView(FILE_READER *_reader)
+{
+    if (_reader->offset >= _reader->cbFile) return false;
+
+    ULONGLONG cbLeft = _reader->cbFile - _reader->offset;
+    SIZE_T cbView = cbLeft < READER_VIEW_SIZE ? (SIZE_T)cbLeft : READER_VIEW_SIZE;
+
+    _reader->pbNextView = MapViewOfFile(_reader->hMapping, FILE_MAP_READ, (DWORD)(_reader->offset >> 32),
+                                        (DWORD)_reader->offset, cbView);
+    if (!_reader->pbNextView)
+    {
+        _reader->dwError = GetLastError();
+        return false;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range = { .VirtualAddress = _reader->pbNextView, .NumberOfBytes = cbView };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+
+    _reader->offset += cbView;
+    _reader->cbNextView = cbView;
+
+    return true;
+}
+
+/*
+ * prepares a reader for use. the buffer for block-reads and the events
+ * of the asynchronous reads are created once here and reused for every
+ * file opened with this reader.
+ * 
+ * _IN:
+ *      _mode: how files should be read
+ * 
+ * _OUT:
+ *      _reader: the reader to initialize
+ * 
+ * _RETURNS: true on success, false if the buffer could not be allocated
+ */
+bool readerInit(FILE_READER *_reader, READER_MODE _mode)
+{
+    ZeroMemory(_reader, sizeof(FILE_READER));
+
+    _reader->mode = _mode;
+    _reader->hFile = INVALID_HANDLE_VALUE;
+    _reader->cbBuffer = READER_BLOCK_SIZE * READER_QUEUE_DEPTH;
+
+    // VirtualAlloc() returns page-aligned memory, and zeroed memory for the holes of sparse files
+    _reader->pbBuffer = VirtualAlloc(NULL, _reader->cbBuffer, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    _reader->pbZeros = VirtualAlloc(NULL, READER_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READONLY);
+    if (!_reader->pbBuffer || !_reader->pbZeros) return false;
+
+    for (DWORD i = 0; i < READER_QUEUE_DEPTH; ++i)
+    {
+        READER_SLOT *slot = &_reader->slots[i];
+
+        slot->pbData = _reader->pbBuffer + (SIZE_T)i * READER_BLOCK_SIZE;
+        if (! (slot->overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * opens a file for reading.
+ * -------------------------
+ * regular files at least READER_MAP_THRESHOLD bytes large are mapped
+ * (READER_AUTO), all others are read in blocks. if mapping fails the
+ * reader silently falls back to block-reads. block-reads of regular
+ * files are started right away, so they are in flight before the
+ * first call to readerNext(). a regular file can be read from an
+ * offset, it is only mapped if the offset is a multiple of
+ * READER_BLOCK_SIZE. sparse files are read in blocks, unless the
+ * mode is READER_MAP. with READER_NOCACHE the file is opened without
+ * buffering, an offset that is not a multiple of READER_SECTOR_SIZE
+ * is read through the page-cache.
+ * -------------------------
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file
+ *      _offset: the first byte to read, 0 for pipes and devices
+ * 
+ * _IN_OUT:
+ *      _reader: an initialized reader
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD readerOpen(FILE_READER *_reader, LPCWSTR _fileName, ULONGLONG _offset)
+{
+    _reader->hMapping = NULL;
+    _reader->pbView = NULL;
+    _reader->pbNextView = NULL;
+    _reader->bMapped = false;
+    _reader->bOverlapped = false;
+    _reader->iSlot = 0;
+    _reader->bSlotInUse = false;
+    _reader->readOffset = 0;
+    _reader->cbFile = 0;
+    _reader->offset = 0;
+    _reader->dwError = ERROR_SUCCESS;
+    _reader->bSparse = false;
+    _reader->cRanges = 0;
+    _reader->iRange = 0;
+
+    // unbuffered reads have to start at a multiple of the sector-size
+    DWORD dwCache = _reader->mode == READER_NOCACHE && _offset % READER_SECTOR_SIZE == 0
+                    ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+
+    _reader->hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, dwCache | FILE_FLAG_OVERLAPPED, NULL);
+    if (_reader->hFile == INVALID_HANDLE_VALUE)
+        return (_reader->dwError = GetLastError());
+
+    LARGE_INTEGER size;
+    bool bDisk = GetFileType(_reader->hFile) == FILE_TYPE_DISK && GetFileSizeEx(_reader->hFile, &size);
+
+    if (!bDisk && _offset > 0)
+    {
+        readerClose(_reader);
+        return (_reader->dwError = ERROR_SEEK_ON_DEVICE);
+    }
+
+    if (!bDisk)
+    {
+        // pipes and devices are read with blocking reads, which need a handle without FILE_FLAG_OVERLAPPED
+        CloseHandle(_reader->hFile);
+
+        _reader->hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (_reader->hFile == INVALID_HANDLE_VALUE)
+            return (_reader->dwError = GetLastError());
+
+        return ERROR_SUCCESS;
+    }
+
+    _reader->cbFile = (ULONGLONG)size.QuadPart;
+
+    if (_offset > _reader->cbFile)
+    {
+        readerClose(_reader);
+        return (_reader->dwError = ERROR_NEGATIVE_SEEK);
+    }
+
+    _reader->readOffset = _offset;
+    _reader->offset = _offset;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    _reader->bSparse = GetFileInformationByHandle(_reader->hFile, &info) &&
+                        (info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE);
+
+    // views start at a multiple of the allocation granularity
+    if ((_reader->mode == READER_MAP || (_reader->mode == READER_AUTO && !_reader->bSparse)) &&
+        _reader->cbFile > _offset && _offset % READER_BLOCK_SIZE == 0 &&
+        (_reader->mode == READER_MAP || _reader->cbFile >= READER_MAP_THRESHOLD))
+    {
+        _reader->hMapping = CreateFileMappingW(_reader->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        _reader->bMapped = _reader->hMapping != NULL;
+    }
+
+    if (!_reader->bMapped)
+    {
+        _reader->bOverlapped = true;
+
+        for (DWORD i = 0; i < READER_QUEUE_DEPTH && queueRead(_reader, &_reader->slots[i]); ++i);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/*
+ * returns the next span of the file.
+ * ----------------------------------
+ * for mapped files the span is a view into the file and stays valid
+ * until the next call, otherwise it points into the reader's buffer.
+ * the block returned by the previous call is handed back to the disk
+ * for the next read, then the oldest read in flight is waited for.
+ * ----------------------------------
+ * 
+ * _IN_OUT:
+ *      _reader: an opened reader
+ * 
+ * _OUT:
+ *      _ppData: start of the span
+ *      _pcbData: length of the span in bytes, always > 0
+ * 
+ * _RETURNS: true if a span was returned, false at the end of the file
+ *          or on error (_reader->dwError is set)
+ */
+bool readerNext(FILE_READER *_reader, const BYTE **_ppData, SIZE_T *_pcbData)
+{
+    if (_reader->bMapped)
+    {
+        if (_reader->pbView)
+        {
+            UnmapViewOfFile(_reader->pbView);
+            _reader->pbView = NULL;
+        }
+
+        if (!_reader->pbNextView && !mapNextView(_reader)) return false;
+
+        _reader->pbView = _reader->pbNextView;
+        _reader->pbNextView = NULL;
+
+        *_ppData = _reader->pbView;
+        *_pcbData = _reader->cbNextView;
+
+        // the following view is read while this one is hashed, an error is reported by the next call
+        mapNextView(_reader);
+
+        return true;
+    }
+
+    if (_reader->bOverlapped)
+    {
+        if (_reader->bSlotInUse)
+        {
+            // the block returned last time is free again, 1 block behind the oldest read in flight
+            DWORD iFree = (_reader->iSlot + READER_QUEUE_DEPTH - 1) % READER_QUEUE_DEPTH;
+            _reader->bSlotInUse = false;
+
+            if (_reader->dwError == ERROR_SUCCESS) queueRead(_reader, &_reader->slots[iFree]);
+        }
+
+        READER_SLOT *slot = &_reader->slots[_reader->iSlot];
+        if (!slot->bPending || _reader->dwError != ERROR_SUCCESS) return false;
+
+        if (slot->bHole)
+        {
+            slot->bPending = false;
+
+            _reader->iSlot = (_reader->iSlot + 1) % READER_QUEUE_DEPTH;
+            _reader->bSlotInUse = true;
+            _reader->offset += slot->cbRequest;
+
+            *_ppData = _reader->pbZeros;
+            *_pcbData = slot->cbRequest;
+
+            return true;
+        }
+
+        DWORD cbRead = 0;
+        BOOL bRead = GetOverlappedResult(_reader->hFile, &slot->overlapped, &cbRead, TRUE);
+        slot->bPending = false;
+
+        if (!bRead)
+        {
+            DWORD dwError = GetLastError();
+            if (dwError != ERROR_HANDLE_EOF) _reader->dwError = dwError;
+
+            return false;
+        }
+
+        if (cbRead == 0) return false;
+
+        // the file was truncated while it was read, the reads behind this one find nothing
+        if (cbRead < slot->cbRequest) _reader->readOffset = _reader->cbFile;
+
+        _reader->iSlot = (_reader->iSlot + 1) % READER_QUEUE_DEPTH;
+        _reader->bSlotInUse = true;
+        _reader->offset += cbRead;
+
+        *_ppData = slot->pbData;
+        *_pcbData = cbRead;
+
+        return true;
+    }
+
+    DWORD cbRead = 0;
+    if (!ReadFile(_reader->hFile, _reader->pbBuffer, READER_BLOCK_SIZE, &cbRead, NULL))
+    {
+        DWORD dwError = GetLastError();
+
+        // the writing end of a pipe was closed, so this is the end of the data
+        if (dwError != ERROR_BROKEN_PIPE && dwError != ERROR_HANDLE_EOF)
+            _reader->dwError = dwError;
+
+        return false;
+    }
+
+    if (cbRead == 0) return false;
+
+    _reader->offset += cbRead;
+    *_ppData = _reader->pbBuffer;
+    *_pcbData = cbRead;
+
+    return true;
+}
+
+/*
+ * closes the file opened with readerOpen(). reads still in flight are
+ * cancelled. the reader can be used for the next file afterwards.
+ * 
+ * _IN_OUT:
+ *      _reader: the reader
+ */
+void readerClose(FILE_READER *_reader)
+{
+    if (_reader->bOverlapped) cancelReads(_reader);
+
+    if (_reader->pbView) UnmapViewOfFile(_reader->pbView);
+    if (_reader->pbNextView) UnmapViewOfFile(_reader->pbNextView);
+    if (_reader->hMapping) CloseHandle(_reader->hMapping);
+    if (_reader->hFile != INVALID_HANDLE_VALUE) CloseHandle(_reader->hFile);
+
+    _reader->pbView = NULL;
+    _reader->pbNextView = NULL;
+    _reader->hMapping = NULL;
+    _reader->hFile = INVALID_HANDLE_VALUE;
+    _reader->bMapped = false;
+    _reader->bOverlapped = false;
+}
+
+/*
+ * closes any open file and frees the buffer and the events of the reader.
+ * 
+ * _IN_OUT:
+ *      _reader: the reader
+ */
+void readerFree(FILE_READER *_reader)
+{
+    readerClose(_reader);
+
+    for (DWORD i = 0; i < READER_QUEUE_DEPTH; ++i)
+    {
+        if (_reader->slots[i].overlapped.hEvent) CloseHandle(_reader->slots[i].overlapped.hEvent);
+        _reader->slots[i].overlapped.hEvent = NULL;
+    }
+
+    if (_reader->pbBuffer) VirtualFree(_reader->pbBuffer, 0, MEM_RELEASE);
+    if (_reader->pbZeros) VirtualFree(_reader->pbZeros, 0, MEM_RELEASE);
+
+    _reader->pbBuffer = NULL;
+    _reader->pbZeros = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_reader.h - reads files in large contiguous spans for hashing.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_READER_H
+#define _HASHSUM_READER_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <winioctl.h>
+#include <stdbool.h>
+
+// size of one mapped view, a multiple of the allocation granularity
+#define READER_VIEW_SIZE (64 * 1024 * 1024)
+
+// size of one block-read, a multiple of the sector-size
+#define READER_BLOCK_SIZE (1024 * 1024)
+
+// number of block-reads kept in flight while the data of another one is hashed
+#define READER_QUEUE_DEPTH 4
+
+// smaller files are read with a single block-read instead of being mapped
+#define READER_MAP_THRESHOLD (1024 * 1024)
+
+// alignment of offsets, sizes and buffers of reads bypassing the page-cache
+#define READER_SECTOR_SIZE 4096
+
+// number of allocated ranges of a sparse file queried at once
+#define READER_MAX_RANGES 64
+
+typedef enum READER_MODE {
+    READER_AUTO = 0,    // map regular files, block-reads for everything else
+    READER_MAP,         // always try to map, fall back to block-reads
+    READER_BLOCK,       // always use block-reads
+    READER_NOCACHE      // block-reads bypassing the page-cache (/NOCACHE)
+} READER_MODE;
+
+/*
+ * one asynchronous block-read and the part of the buffer it reads into.
+ * a block in a hole of a sparse file is not read, its data are zeros.
+ */
+typedef struct READER_SLOT {
+    OVERLAPPED overlapped;
+    PBYTE pbData;
+    DWORD cbRequest;
+    bool bPending;
+    bool bHole;
+} READER_SLOT;
+
+/*
+ * a reader is created once per thread with readerInit() and then
+ * used for any number of files with readerOpen()/readerClose().
+ */
+typedef struct FILE_READER {
+    READER_MODE mode;
+    HANDLE hFile;
+    HANDLE hMapping;
+    PBYTE pbView;
+    PBYTE pbNextView;
+    SIZE_T cbNextView;
+    PBYTE pbBuffer;
+    DWORD cbBuffer;
+    PBYTE pbZeros;
+    bool bMapped;
+    bool bOverlapped;
+    bool bSparse;
+    FILE_ALLOCATED_RANGE_BUFFER ranges[READER_MAX_RANGES];
+    DWORD cRanges;
+    DWORD iRange;
+    READER_SLOT slots[READER_QUEUE_DEPTH];
+    DWORD iSlot;
+    bool bSlotInUse;
+    ULONGLONG readOffset;
+    ULONGLONG cbFile;
+    ULONGLONG offset;
+    DWORD dwError;
+} FILE_READER;
+
+bool readerInit(FILE_READER *, READER_MODE);
+DWORD readerOpen(FILE_READER *, LPCWSTR, ULONGLONG);
+bool readerNext(FILE_READER *, const BYTE **, SIZE_T *);
+void readerClose(FILE_READER *);
+void readerFree(FILE_READER *);
+
+#endif // _HASHSUM_READER_H
\ No newline at end of file
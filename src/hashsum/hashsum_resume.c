@@ -0,0 +1,270 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_resume.c - checkpoints of the file being hashed, to resume after a crash.
+ * 
+ * while a file is hashed, the states of the in-tree hash-engines and the
+ * number of bytes they were fed are written to the state-file every
+ * RESUME_INTERVAL milliseconds. the engines keep their whole state in
+ * plain structs, so a checkpoint is a copy of them. if hashsum is run
+ * again after a crash or Ctrl-C, a file with the same identity as the
+ * one in the state-file (see cacheQueryFile()) is read from the offset
+ * of the checkpoint instead of from the start.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_resume.h"
+#include "hashsum_checksum.h"
+
+#include <wchar.h>
+
+static bool readAll(HANDLE _hFile, void *_data, DWORD _cbData)
+{
+    DWORD cbRead;
+
+    return ReadFile(_hFile, _data, _cbData, &cbRead, NULL) && cbRead == _cbData;
+}
+
+static bool writeAll(HANDLE _hFile, const void *_data, DWORD _cbData)
+{
+    DWORD cbWritten;
+
+    return WriteFile(_hFile, _data, _cbData, &cbWritten, NULL) && cbWritten == _cbData;
+}
+
+/*
+ * reads the checkpoint of a state-file.
+ * 
+ * _RETURNS: true if the checkpoint is valid
+ */
+static bool loadStateFile(RESUME_STATE *_resume, HANDLE _hFile)
+{
+    RESUME_HEADER *header = &_resume->header;
+
+    if (!readAll(_hFile, header, sizeof(RESUME_HEADER)) ||
+        memcmp(header->magic, RESUME_MAGIC, sizeof(header->magic)) != 0 ||
+        header->cchPath == 0 || header->cchPath > 0xFFFF || header->cbStates > 0x100000 ||
+        header->offset > header->cbFile)
+        return false;
+
+    if (! (_resume->pszPath = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * header->cchPath)) ||
+        ! (_resume->pbStates = HeapAlloc(GetProcessHeap(), 0, header->cbStates + 1)))
+        return false;
+
+    if (!readAll(_hFile, _resume->pszPath, sizeof(WCHAR) * header->cchPath) ||
+        !readAll(_hFile, _resume->pbStates, header->cbStates))
+        return false;
+
+    CRC32C_CTX crc;
+    crc32cInit(&crc);
+    crc32cUpdate(&crc, _resume->pszPath, sizeof(WCHAR) * header->cchPath);
+    crc32cUpdate(&crc, _resume->pbStates, header->cbStates);
+
+    return ~crc.crc == header->crcData;
+}
+
+/*
+ * prepares the checkpoints of a run. if the state-file exists and is
+ * valid, its checkpoint is kept for resumeFind(), a missing or damaged
+ * state-file is ignored.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the state-file
+ * 
+ * _OUT:
+ *      _resume: the state, release it with resumeFree()
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool resumeOpen(RESUME_STATE *_resume, LPCWSTR _fileName)
+{
+    ZeroMemory(_resume, sizeof(RESUME_STATE));
+
+    SIZE_T cchFileName = wcslen(_fileName) + 1;
+    if (! (_resume->pszFileName = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * cchFileName)))
+        return false;
+
+    wcscpy_s(_resume->pszFileName, cchFileName, _fileName);
+
+    // the first checkpoint is written one interval after the start
+    _resume->lastSave = GetTickCount64();
+
+    HANDLE hFile = CreateFileW(_fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return true;
+
+    if (!loadStateFile(_resume, hFile))
+    {
+        if (_resume->pszPath) HeapFree(GetProcessHeap(), 0, _resume->pszPath);
+        if (_resume->pbStates) HeapFree(GetProcessHeap(), 0, _resume->pbStates);
+
+        _resume->pszPath = NULL;
+        _resume->pbStates = NULL;
+    }
+
+    CloseHandle(hFile);
+
+    return true;
+}
+
+/*
+ * looks for the checkpoint of a file.
+ * 
+ * _IN:
+ *      _resume: the state
+ *      _key: the identity of the file
+ *      _cbStates: the size of the states the caller expects
+ * 
+ * _OUT:
+ *      _pbStates: the states of the checkpoint, unchanged if there is none
+ * 
+ * _RETURNS: the number of bytes hashed into the states, 0 if there is
+ *          no checkpoint of this file
+ */
+ULONGLONG resumeFind(const RESUME_STATE *_resume, const CACHE_KEY *_key, PBYTE _pbStates, DWORD _cbStates)
+{
+    const RESUME_HEADER *header = &_resume->header;
+
+    if (!_resume->pszPath || header->dwVolume != _key->dwVolume || header->fileIndex != _key->fileIndex ||
+        header->cbFile != _key->cbFile || header->mtime != _key->mtime || header->cbStates != _cbStates ||
+        header->cchPath != _key->cchPath ||
+        CompareStringOrdinal(_resume->pszPath, header->cchPath, _key->pszPath, _key->cchPath, TRUE) != CSTR_EQUAL)
+        return 0;
+
+    memcpy(_pbStates, _resume->pbStates, _cbStates);
+
+    return header->offset;
+}
+
+/*
+ * checks if the next checkpoint is due.
+ * 
+ * _RETURNS: true if the last one was written RESUME_INTERVAL or more ago
+ */
+bool resumeDue(const RESUME_STATE *_resume)
+{
+    return GetTickCount64() - _resume->lastSave >= RESUME_INTERVAL;
+}
+
+/*
+ * writes a checkpoint to a temporary file next to the state-file, which
+ * then replaces it. a crash while writing leaves the last checkpoint.
+ * 
+ * _IN:
+ *      _key: the identity of the file being hashed
+ *      _offset: the number of bytes hashed into the states
+ *      _pbStates: the states of the hashes
+ *      _cbStates: the size of _pbStates in bytes
+ * 
+ * _IN_OUT:
+ *      _resume: the state
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD resumeSave(RESUME_STATE *_resume, const CACHE_KEY *_key, ULONGLONG _offset, const BYTE *_pbStates, DWORD _cbStates)
+{
+    _resume->lastSave = GetTickCount64();
+
+    SIZE_T cchTemp = wcslen(_resume->pszFileName) + 5;
+    LPWSTR pszTemp = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * cchTemp);
+    if (!pszTemp) return ERROR_NOT_ENOUGH_MEMORY;
+
+    swprintf_s(pszTemp, cchTemp, L"%s.tmp", _resume->pszFileName);
+
+    RESUME_HEADER header = {
+        .dwVolume = _key->dwVolume,
+        .cchPath = _key->cchPath,
+        .fileIndex = _key->fileIndex,
+        .cbFile = _key->cbFile,
+        .mtime = _key->mtime,
+        .offset = _offset,
+        .cbStates = _cbStates
+    };
+    memcpy(header.magic, RESUME_MAGIC, sizeof(header.magic));
+
+    CRC32C_CTX crc;
+    crc32cInit(&crc);
+    crc32cUpdate(&crc, _key->pszPath, sizeof(WCHAR) * _key->cchPath);
+    crc32cUpdate(&crc, _pbStates, _cbStates);
+    header.crcData = ~crc.crc;
+
+    DWORD dwError = ERROR_SUCCESS;
+    HANDLE hTemp = CreateFileW(pszTemp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (hTemp == INVALID_HANDLE_VALUE)
+        dwError = GetLastError();
+    else
+    {
+        if (!writeAll(hTemp, &header, sizeof(header)) ||
+            !writeAll(hTemp, _key->pszPath, sizeof(WCHAR) * _key->cchPath) ||
+            !writeAll(hTemp, _pbStates, _cbStates) ||
+            !FlushFileBuffers(hTemp))
+            dwError = GetLastError();
+
+        CloseHandle(hTemp);
+    }
+
+    if (dwError == ERROR_SUCCESS &&
+        !MoveFileExW(pszTemp, _resume->pszFileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        dwError = GetLastError();
+
+    if (dwError != ERROR_SUCCESS)
+        DeleteFileW(pszTemp);
+
+    HeapFree(GetProcessHeap(), 0, pszTemp);
+
+    return dwError;
+}
+
+/*
+ * deletes the state-file after all files were hashed.
+ * 
+ * _IN_OUT:
+ *      _resume: the state
+ * 
+ * _RETURNS: ERROR_SUCCESS or the win32 error-code
+ */
+DWORD resumeClear(RESUME_STATE *_resume)
+{
+    if (!DeleteFileW(_resume->pszFileName) && GetLastError() != ERROR_FILE_NOT_FOUND)
+        return GetLastError();
+
+    return ERROR_SUCCESS;
+}
+
+void resumeFree(RESUME_STATE *_resume)
+{
+    if (_resume->pszFileName) HeapFree(GetProcessHeap(), 0, _resume->pszFileName);
+    if (_resume->pszPath) HeapFree(GetProcessHeap(), 0, _resume->pszPath);
+    if (_resume->pbStates) HeapFree(GetProcessHeap(), 0, _resume->pbStates);
+
+    ZeroMemory(_resume, sizeof(RESUME_STATE));
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_resume.h - checkpoints of the file being hashed, to resume after a crash.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_RESUME_H
+#define _HASHSUM_RESUME_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+#include "hashsum_cache.h"
+
+// first bytes of a state-file, the last character is the version of the format
+#define RESUME_MAGIC "HSRESUM1"
+
+// milliseconds between two checkpoints of the file being hashed
+#define RESUME_INTERVAL (10 * 1000)
+
+/*
+ * a state-file is a RESUME_HEADER followed by the full path of the file
+ * (UTF-16, not terminated) and the states of its hashes, as written by
+ * the caller. a damaged state-file must not produce wrong digests, so
+ * path and states are protected by a CRC32C.
+ */
+typedef struct RESUME_HEADER {
+    char magic[8];
+    DWORD dwVolume;
+    DWORD cchPath;
+    ULONGLONG fileIndex;
+    ULONGLONG cbFile;
+    ULONGLONG mtime;
+    ULONGLONG offset;
+    DWORD cbStates;
+    DWORD crcData;
+} RESUME_HEADER;
+
+/*
+ * the checkpoint read from the state-file when it was opened, and the
+ * time of the last one written since.
+ */
+typedef struct RESUME_STATE {
+    LPWSTR pszFileName;
+    RESUME_HEADER header;
+    LPWSTR pszPath;         // NULL if there is no valid checkpoint
+    PBYTE pbStates;
+    ULONGLONG lastSave;
+} RESUME_STATE;
+
+bool resumeOpen(RESUME_STATE *, LPCWSTR);
+ULONGLONG resumeFind(const RESUME_STATE *, const CACHE_KEY *, PBYTE, DWORD);
+bool resumeDue(const RESUME_STATE *);
+DWORD resumeSave(RESUME_STATE *, const CACHE_KEY *, ULONGLONG, const BYTE *, DWORD);
+DWORD resumeClear(RESUME_STATE *);
+void resumeFree(RESUME_STATE *);
+
+#endif // _HASHSUM_RESUME_H
\ No newline at end of file
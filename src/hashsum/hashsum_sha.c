@@ -0,0 +1,1199 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_sha.c - in-tree SHA-1 and SHA-256 engine.
+ * 
+ * every algorithm has four implementations of the block-function:
+ * 
+ *      scalar  - portable C, used on every platform
+ *      sse4    - message schedule computed 4 words at a time (SSSE3/SSE4.1),
+ *                rounds in scalar code
+ *      avx2    - message schedules of two blocks computed at once, one
+ *                block in each 128-bit lane, rounds in scalar code
+ *      shani   - rounds and schedule with the Intel SHA-Extensions
+ * 
+ * the fastest one supported by the cpu is selected at runtime.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_sha.h"
+
+#include <string.h>
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define SHA_CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define SHA_PARITY(x, y, z) ((x) ^ (y) ^ (z))
+#define SHA_MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+#define SHA256_BSIG0(x) (ROR32(x, 2) ^ ROR32(x, 13) ^ ROR32(x, 22))
+#define SHA256_BSIG1(x) (ROR32(x, 6) ^ ROR32(x, 11) ^ ROR32(x, 25))
+#define SHA256_SSIG0(x) (ROR32(x, 7) ^ ROR32(x, 18) ^ ((x) >> 3))
+#define SHA256_SSIG1(x) (ROR32(x, 17) ^ ROR32(x, 19) ^ ((x) >> 10))
+
+#define SHA1_K0 0x5A827999
+#define SHA1_K1 0x6ED9EBA1
+#define SHA1_K2 0x8F1BBCDC
+#define SHA1_K3 0xCA62C1D6
+
+typedef void (*SHA_BLOCKS_FN)(uint32_t *, const uint8_t *, size_t);
+
+// one block of every lane, the state is transposed: _state[word][lane]
+typedef void (*SHA256_MULTI_FN)(uint32_t _state[8][SHA256_MAX_LANES], const uint8_t *const *);
+
+static TT_ALIGN(16) const uint32_t K256[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static const uint32_t K1[4] = { SHA1_K0, SHA1_K1, SHA1_K2, SHA1_K3 };
+
+static SHA_ENGINE activeEngine = SHA_ENGINE_AUTO;
+static SHA_BLOCKS_FN pfnSha1Blocks = NULL;
+static SHA_BLOCKS_FN pfnSha256Blocks = NULL;
+static SHA256_MULTI_FN pfnSha256Multi = NULL;
+static size_t cSha256Lanes = 1;
+
+static uint32_t loadBE32(const uint8_t *_p)
+{
+    return ((uint32_t)_p[0] << 24) | ((uint32_t)_p[1] << 16) | ((uint32_t)_p[2] << 8) | (uint32_t)_p[3];
+}
+
+static void storeBE32(uint8_t *_p, uint32_t _v)
+{
+    _p[0] = (uint8_t)(_v >> 24);
+    _p[1] = (uint8_t)(_v >> 16);
+    _p[2] = (uint8_t)(_v >> 8);
+    _p[3] = (uint8_t)_v;
+}
+
+/* ==== scalar rounds ==== */
+
+/*
+ * runs the 80 rounds of SHA-1 over a message schedule that
+ * already has the round-constants added (W[t] + K[t]).
+ */
+static void sha1Rounds(uint32_t _state[5], const uint32_t _wk[80])
+{
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3], e = _state[4], tmp;
+    int t = 0;
+
+    for (; t < 20; ++t)
+    {
+        tmp = ROL32(a, 5) + SHA_CH(b, c, d) + e + _wk[t];
+        e = d; d = c; c = ROL32(b, 30); b = a; a = tmp;
+    }
+
+    for (; t < 40; ++t)
+    {
+        tmp = ROL32(a, 5) + SHA_PARITY(b, c, d) + e + _wk[t];
+        e = d; d = c; c = ROL32(b, 30); b = a; a = tmp;
+    }
+
+    for (; t < 60; ++t)
+    {
+        tmp = ROL32(a, 5) + SHA_MAJ(b, c, d) + e + _wk[t];
+        e = d; d = c; c = ROL32(b, 30); b = a; a = tmp;
+    }
+
+    for (; t < 80; ++t)
+    {
+        tmp = ROL32(a, 5) + SHA_PARITY(b, c, d) + e + _wk[t];
+        e = d; d = c; c = ROL32(b, 30); b = a; a = tmp;
+    }
+
+    _state[0] += a;
+    _state[1] += b;
+    _state[2] += c;
+    _state[3] += d;
+    _state[4] += e;
+}
+
+/*
+ * runs the 64 rounds of SHA-256 over a message schedule that
+ * already has the round-constants added (W[t] + K[t]).
+ */
+static void sha256Rounds(uint32_t _state[8], const uint32_t _wk[64])
+{
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+    uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+
+    for (int t = 0; t < 64; ++t)
+    {
+        uint32_t t1 = h + SHA256_BSIG1(e) + SHA_CH(e, f, g) + _wk[t];
+        uint32_t t2 = SHA256_BSIG0(a) + SHA_MAJ(a, b, c);
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    _state[0] += a;
+    _state[1] += b;
+    _state[2] += c;
+    _state[3] += d;
+    _state[4] += e;
+    _state[5] += f;
+    _state[6] += g;
+    _state[7] += h;
+}
+
+/* ==== scalar engine ==== */
+
+static void sha1BlocksScalar(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    uint32_t w[80];
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        for (int t = 0; t < 16; ++t)
+            w[t] = loadBE32(&_data[t * 4]);
+
+        for (int t = 16; t < 80; ++t)
+            w[t] = ROL32(w[t-3] ^ w[t-8] ^ w[t-14] ^ w[t-16], 1);
+
+        for (int t = 0; t < 80; ++t)
+            w[t] += K1[t / 20];
+
+        sha1Rounds(_state, w);
+    }
+}
+
+static void sha256BlocksScalar(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    uint32_t w[64];
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        for (int t = 0; t < 16; ++t)
+            w[t] = loadBE32(&_data[t * 4]);
+
+        for (int t = 16; t < 64; ++t)
+            w[t] = SHA256_SSIG1(w[t-2]) + w[t-7] + SHA256_SSIG0(w[t-15]) + w[t-16];
+
+        for (int t = 0; t < 64; ++t)
+            w[t] += K256[t];
+
+        sha256Rounds(_state, w);
+    }
+}
+
+#if TT_ARCH_X86
+
+/* ==== sse4 engine ==== */
+
+#define SSE_ROL32(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define SSE_ROR32(x, n) _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+
+#define SSE_SSIG0(x) _mm_xor_si128(_mm_xor_si128(SSE_ROR32(x, 7), SSE_ROR32(x, 18)), _mm_srli_epi32(x, 3))
+#define SSE_SSIG1(x) _mm_xor_si128(_mm_xor_si128(SSE_ROR32(x, 17), SSE_ROR32(x, 19)), _mm_srli_epi32(x, 10))
+
+/*
+ * computes W[t..t+3] of SHA-1 from the previous 16 words in x0..x3.
+ * W[t+3] depends on W[t], so the last lane gets fixed up afterwards.
+ */
+TT_TARGET("ssse3,sse4.1")
+static inline __m128i sha1ScheduleSse4(__m128i _x0, __m128i _x1, __m128i _x2, __m128i _x3)
+{
+    __m128i w3 = _mm_srli_si128(_x3, 4);
+    __m128i w14 = _mm_alignr_epi8(_x1, _x0, 8);
+    __m128i x = _mm_xor_si128(_mm_xor_si128(w3, _x2), _mm_xor_si128(w14, _x0));
+    __m128i r = SSE_ROL32(x, 1);
+    __m128i fix = _mm_slli_si128(x, 12);
+
+    return _mm_xor_si128(r, SSE_ROL32(fix, 2));
+}
+
+/*
+ * computes W[t..t+3] of SHA-256 from the previous 16 words in x0..x3.
+ * sigma1 of the lanes 2 and 3 depends on the lanes 0 and 1, so it is
+ * done in two steps.
+ */
+TT_TARGET("ssse3,sse4.1")
+static inline __m128i sha256ScheduleSse4(__m128i _x0, __m128i _x1, __m128i _x2, __m128i _x3)
+{
+    __m128i w15 = _mm_alignr_epi8(_x1, _x0, 4);
+    __m128i w7 = _mm_alignr_epi8(_x3, _x2, 4);
+    __m128i w2 = _mm_srli_si128(_x3, 8);
+    __m128i s = _mm_add_epi32(_mm_add_epi32(_x0, SSE_SSIG0(w15)), w7);
+
+    s = _mm_add_epi32(s, SSE_SSIG1(w2));
+    w2 = _mm_slli_si128(s, 8);
+
+    return _mm_add_epi32(s, SSE_SSIG1(w2));
+}
+
+TT_TARGET("ssse3,sse4.1")
+static void sha1BlocksSse4(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    TT_ALIGN(16) uint32_t wk[80];
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        __m128i k = _mm_set1_epi32(SHA1_K0);
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[0]), bswap);
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[16]), bswap);
+        __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[32]), bswap);
+        __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[48]), bswap);
+
+        _mm_store_si128((__m128i *)&wk[0], _mm_add_epi32(x0, k));
+        _mm_store_si128((__m128i *)&wk[4], _mm_add_epi32(x1, k));
+        _mm_store_si128((__m128i *)&wk[8], _mm_add_epi32(x2, k));
+        _mm_store_si128((__m128i *)&wk[12], _mm_add_epi32(x3, k));
+
+        for (int t = 16; t < 80; t += 4)
+        {
+            __m128i s = sha1ScheduleSse4(x0, x1, x2, x3);
+            x0 = x1; x1 = x2; x2 = x3; x3 = s;
+
+            k = _mm_set1_epi32(K1[t / 20]);
+            _mm_store_si128((__m128i *)&wk[t], _mm_add_epi32(s, k));
+        }
+
+        sha1Rounds(_state, wk);
+    }
+}
+
+TT_TARGET("ssse3,sse4.1")
+static void sha256BlocksSse4(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    TT_ALIGN(16) uint32_t wk[64];
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[0]), bswap);
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[16]), bswap);
+        __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[32]), bswap);
+        __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[48]), bswap);
+
+        _mm_store_si128((__m128i *)&wk[0], _mm_add_epi32(x0, _mm_load_si128((const __m128i *)&K256[0])));
+        _mm_store_si128((__m128i *)&wk[4], _mm_add_epi32(x1, _mm_load_si128((const __m128i *)&K256[4])));
+        _mm_store_si128((__m128i *)&wk[8], _mm_add_epi32(x2, _mm_load_si128((const __m128i *)&K256[8])));
+        _mm_store_si128((__m128i *)&wk[12], _mm_add_epi32(x3, _mm_load_si128((const __m128i *)&K256[12])));
+
+        for (int t = 16; t < 64; t += 4)
+        {
+            __m128i s = sha256ScheduleSse4(x0, x1, x2, x3);
+            x0 = x1; x1 = x2; x2 = x3; x3 = s;
+
+            _mm_store_si128((__m128i *)&wk[t], _mm_add_epi32(s, _mm_load_si128((const __m128i *)&K256[t])));
+        }
+
+        sha256Rounds(_state, wk);
+    }
+}
+
+/* ==== avx2 engine ==== */
+
+#define AVX_ROL32(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+#define AVX_ROR32(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+#define AVX_SSIG0(x) _mm256_xor_si256(_mm256_xor_si256(AVX_ROR32(x, 7), AVX_ROR32(x, 18)), _mm256_srli_epi32(x, 3))
+#define AVX_SSIG1(x) _mm256_xor_si256(_mm256_xor_si256(AVX_ROR32(x, 17), AVX_ROR32(x, 19)), _mm256_srli_epi32(x, 10))
+
+/*
+ * loads 16 bytes of two consecutive blocks into the two 128-bit lanes
+ * and converts them to big-endian words.
+ */
+TT_TARGET("avx2")
+static inline __m256i loadBlockPairAvx2(const uint8_t *_data, int _offset, __m256i _bswap)
+{
+    __m128i lo = _mm_loadu_si128((const __m128i *)&_data[_offset]);
+    __m128i hi = _mm_loadu_si128((const __m128i *)&_data[_offset + SHA_BLOCK_LENGTH]);
+
+    return _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), _bswap);
+}
+
+/*
+ * splits the two lanes of a vector into the schedules of the two blocks.
+ */
+TT_TARGET("avx2")
+static inline void storeBlockPairAvx2(uint32_t *_wk0, uint32_t *_wk1, __m256i _v)
+{
+    _mm_store_si128((__m128i *)_wk0, _mm256_castsi256_si128(_v));
+    _mm_store_si128((__m128i *)_wk1, _mm256_extracti128_si256(_v, 1));
+}
+
+TT_TARGET("avx2")
+static inline __m256i sha1ScheduleAvx2(__m256i _x0, __m256i _x1, __m256i _x2, __m256i _x3)
+{
+    __m256i w3 = _mm256_srli_si256(_x3, 4);
+    __m256i w14 = _mm256_alignr_epi8(_x1, _x0, 8);
+    __m256i x = _mm256_xor_si256(_mm256_xor_si256(w3, _x2), _mm256_xor_si256(w14, _x0));
+    __m256i r = AVX_ROL32(x, 1);
+    __m256i fix = _mm256_slli_si256(x, 12);
+
+    return _mm256_xor_si256(r, AVX_ROL32(fix, 2));
+}
+
+TT_TARGET("avx2")
+static inline __m256i sha256ScheduleAvx2(__m256i _x0, __m256i _x1, __m256i _x2, __m256i _x3)
+{
+    __m256i w15 = _mm256_alignr_epi8(_x1, _x0, 4);
+    __m256i w7 = _mm256_alignr_epi8(_x3, _x2, 4);
+    __m256i w2 = _mm256_srli_si256(_x3, 8);
+    __m256i s = _mm256_add_epi32(_mm256_add_epi32(_x0, AVX_SSIG0(w15)), w7);
+
+    s = _mm256_add_epi32(s, AVX_SSIG1(w2));
+    w2 = _mm256_slli_si256(s, 8);
+
+    return _mm256_add_epi32(s, AVX_SSIG1(w2));
+}
+
+TT_TARGET("avx2")
+static void sha1BlocksAvx2(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    TT_ALIGN(16) uint32_t wk0[80];
+    TT_ALIGN(16) uint32_t wk1[80];
+
+    for (; _nBlocks >= 2; _nBlocks -= 2, _data += 2 * SHA_BLOCK_LENGTH)
+    {
+        __m256i k = _mm256_set1_epi32(SHA1_K0);
+        __m256i x0 = loadBlockPairAvx2(_data, 0, bswap);
+        __m256i x1 = loadBlockPairAvx2(_data, 16, bswap);
+        __m256i x2 = loadBlockPairAvx2(_data, 32, bswap);
+        __m256i x3 = loadBlockPairAvx2(_data, 48, bswap);
+
+        storeBlockPairAvx2(&wk0[0], &wk1[0], _mm256_add_epi32(x0, k));
+        storeBlockPairAvx2(&wk0[4], &wk1[4], _mm256_add_epi32(x1, k));
+        storeBlockPairAvx2(&wk0[8], &wk1[8], _mm256_add_epi32(x2, k));
+        storeBlockPairAvx2(&wk0[12], &wk1[12], _mm256_add_epi32(x3, k));
+
+        for (int t = 16; t < 80; t += 4)
+        {
+            __m256i s = sha1ScheduleAvx2(x0, x1, x2, x3);
+            x0 = x1; x1 = x2; x2 = x3; x3 = s;
+
+            k = _mm256_set1_epi32(K1[t / 20]);
+            storeBlockPairAvx2(&wk0[t], &wk1[t], _mm256_add_epi32(s, k));
+        }
+
+        sha1Rounds(_state, wk0);
+        sha1Rounds(_state, wk1);
+    }
+
+    if (_nBlocks) sha1BlocksSse4(_state, _data, _nBlocks);
+}
+
+TT_TARGET("avx2")
+static void sha256BlocksAvx2(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    TT_ALIGN(16) uint32_t wk0[64];
+    TT_ALIGN(16) uint32_t wk1[64];
+
+    for (; _nBlocks >= 2; _nBlocks -= 2, _data += 2 * SHA_BLOCK_LENGTH)
+    {
+        __m256i x[4];
+
+        for (int i = 0; i < 4; ++i)
+        {
+            x[i] = loadBlockPairAvx2(_data, i * 16, bswap);
+            __m256i k = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)&K256[i * 4]));
+            storeBlockPairAvx2(&wk0[i * 4], &wk1[i * 4], _mm256_add_epi32(x[i], k));
+        }
+
+        __m256i x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+
+        for (int t = 16; t < 64; t += 4)
+        {
+            __m256i s = sha256ScheduleAvx2(x0, x1, x2, x3);
+            x0 = x1; x1 = x2; x2 = x3; x3 = s;
+
+            __m256i k = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)&K256[t]));
+            storeBlockPairAvx2(&wk0[t], &wk1[t], _mm256_add_epi32(s, k));
+        }
+
+        sha256Rounds(_state, wk0);
+        sha256Rounds(_state, wk1);
+    }
+
+    if (_nBlocks) sha256BlocksSse4(_state, _data, _nBlocks);
+}
+
+/* ==== shani engine ==== */
+
+/*
+ * one group of 4 SHA-1 rounds. _e is the E-value for this group, _eNext
+ * receives the value for the following one.
+ */
+#define SHA1NI_ROUNDS(_e, _eNext, _msg, _func) \
+    _e = _mm_sha1nexte_epu32(_e, _msg); \
+    _eNext = abcd; \
+    abcd = _mm_sha1rnds4_epu32(abcd, _e, _func)
+
+TT_TARGET("sha,ssse3,sse4.1")
+static void sha1BlocksShani(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)_state), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)_state[4], 0, 0, 0);
+    __m128i e1;
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+        __m128i m0, m1, m2, m3;
+
+        /* rounds 0-3 */
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[0]), bswap);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        /* rounds 4-7 */
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[16]), bswap);
+        SHA1NI_ROUNDS(e1, e0, m1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        /* rounds 8-11 */
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[32]), bswap);
+        SHA1NI_ROUNDS(e0, e1, m2, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        /* rounds 12-15 */
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[48]), bswap);
+        m0 = _mm_sha1msg2_epu32(m0, m3);
+        SHA1NI_ROUNDS(e1, e0, m3, 0);
+        m2 = _mm_sha1msg1_epu32(m2, m3);
+        m1 = _mm_xor_si128(m1, m3);
+
+        /* rounds 16-63: the message-schedule is in steady state */
+#define SHA1NI_STEP(_e, _eNext, _mCur, _mNext, _mPrev, _mNext2, _func) \
+        _mNext = _mm_sha1msg2_epu32(_mNext, _mCur); \
+        SHA1NI_ROUNDS(_e, _eNext, _mCur, _func); \
+        _mPrev = _mm_sha1msg1_epu32(_mPrev, _mCur); \
+        _mNext2 = _mm_xor_si128(_mNext2, _mCur)
+
+        SHA1NI_STEP(e0, e1, m0, m1, m3, m2, 0);     /* 16-19 */
+        SHA1NI_STEP(e1, e0, m1, m2, m0, m3, 1);     /* 20-23 */
+        SHA1NI_STEP(e0, e1, m2, m3, m1, m0, 1);     /* 24-27 */
+        SHA1NI_STEP(e1, e0, m3, m0, m2, m1, 1);     /* 28-31 */
+        SHA1NI_STEP(e0, e1, m0, m1, m3, m2, 1);     /* 32-35 */
+        SHA1NI_STEP(e1, e0, m1, m2, m0, m3, 1);     /* 36-39 */
+        SHA1NI_STEP(e0, e1, m2, m3, m1, m0, 2);     /* 40-43 */
+        SHA1NI_STEP(e1, e0, m3, m0, m2, m1, 2);     /* 44-47 */
+        SHA1NI_STEP(e0, e1, m0, m1, m3, m2, 2);     /* 48-51 */
+        SHA1NI_STEP(e1, e0, m1, m2, m0, m3, 2);     /* 52-55 */
+        SHA1NI_STEP(e0, e1, m2, m3, m1, m0, 2);     /* 56-59 */
+        SHA1NI_STEP(e1, e0, m3, m0, m2, m1, 3);     /* 60-63 */
+        SHA1NI_STEP(e0, e1, m0, m1, m3, m2, 3);     /* 64-67 */
+#undef SHA1NI_STEP
+
+        /* rounds 68-71 */
+        m2 = _mm_sha1msg2_epu32(m2, m1);
+        SHA1NI_ROUNDS(e1, e0, m1, 3);
+        m3 = _mm_xor_si128(m3, m1);
+
+        /* rounds 72-75 */
+        m3 = _mm_sha1msg2_epu32(m3, m2);
+        SHA1NI_ROUNDS(e0, e1, m2, 3);
+
+        /* rounds 76-79 */
+        SHA1NI_ROUNDS(e1, e0, m3, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    abcd = _mm_shuffle_epi32(abcd, 0x1B);
+    _mm_storeu_si128((__m128i *)_state, abcd);
+    _state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#undef SHA1NI_ROUNDS
+
+/*
+ * four SHA-256 rounds with the message-words in _msg.
+ */
+#define SHA256NI_ROUNDS(_msg, _t) \
+    tmp = _mm_add_epi32(_msg, _mm_load_si128((const __m128i *)&K256[_t])); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+    tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, tmp)
+
+/*
+ * four SHA-256 rounds while computing the next message-words.
+ */
+#define SHA256NI_STEP(_mCur, _mNext, _mPrev, _t) \
+    tmp = _mm_add_epi32(_mCur, _mm_load_si128((const __m128i *)&K256[_t])); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+    _mNext = _mm_add_epi32(_mNext, _mm_alignr_epi8(_mCur, _mPrev, 4)); \
+    _mNext = _mm_sha256msg2_epu32(_mNext, _mCur); \
+    tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, tmp)
+
+TT_TARGET("sha,ssse3,sse4.1")
+static void sha256BlocksShani(uint32_t *_state, const uint8_t *_data, size_t _nBlocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+    __m128i tmp, state0, state1;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&_state[0]), 0xB1);    /* CDAB */
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&_state[4]), 0x1B); /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);                                       /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                                    /* CDGH */
+
+    for (; _nBlocks; --_nBlocks, _data += SHA_BLOCK_LENGTH)
+    {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i m0, m1, m2, m3;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[0]), bswap);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[16]), bswap);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[32]), bswap);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&_data[48]), bswap);
+
+        SHA256NI_ROUNDS(m0, 0);
+        SHA256NI_ROUNDS(m1, 4);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHA256NI_ROUNDS(m2, 8);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+
+        SHA256NI_STEP(m3, m0, m2, 12);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHA256NI_STEP(m0, m1, m3, 16);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA256NI_STEP(m1, m2, m0, 20);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHA256NI_STEP(m2, m3, m1, 24);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHA256NI_STEP(m3, m0, m2, 28);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHA256NI_STEP(m0, m1, m3, 32);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA256NI_STEP(m1, m2, m0, 36);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHA256NI_STEP(m2, m3, m1, 40);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHA256NI_STEP(m3, m0, m2, 44);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+        SHA256NI_STEP(m0, m1, m3, 48);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA256NI_STEP(m1, m2, m0, 52);
+        SHA256NI_STEP(m2, m3, m1, 56);
+        SHA256NI_ROUNDS(m3, 60);
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    /* HGFE */
+
+    _mm_storeu_si128((__m128i *)&_state[0], state0);
+    _mm_storeu_si128((__m128i *)&_state[4], state1);
+}
+
+#undef SHA256NI_ROUNDS
+#undef SHA256NI_STEP
+
+/* ==== multi-buffer engines ==== */
+
+/*
+ * the multi-buffer engines hash one block of 8 (avx2) or 16 (avx-512)
+ * independent messages at once, one message per 32-bit lane. every
+ * lane runs the plain SHA-256 rounds, there is no dependency between
+ * the lanes, so a small message costs a fraction of a single-buffer
+ * block-function.
+ */
+
+#define AVX_BSIG0(x) _mm256_xor_si256(_mm256_xor_si256(AVX_ROR32(x, 2), AVX_ROR32(x, 13)), AVX_ROR32(x, 22))
+#define AVX_BSIG1(x) _mm256_xor_si256(_mm256_xor_si256(AVX_ROR32(x, 6), AVX_ROR32(x, 11)), AVX_ROR32(x, 25))
+#define AVX_CH(x, y, z) _mm256_xor_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define AVX_MAJ(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+
+/*
+ * transposes 8 rows of 8 words, afterwards _rows[i] holds word i of
+ * every row.
+ */
+TT_TARGET("avx2")
+static inline void transpose8x8Avx2(__m256i _rows[8])
+{
+    __m256i t0 = _mm256_unpacklo_epi32(_rows[0], _rows[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(_rows[0], _rows[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(_rows[2], _rows[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(_rows[2], _rows[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(_rows[4], _rows[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(_rows[4], _rows[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(_rows[6], _rows[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(_rows[6], _rows[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    _rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    _rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    _rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    _rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    _rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    _rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    _rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    _rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+/*
+ * loads the message-words of one block of 8 lanes, _w[t] holds word t
+ * of every lane as big-endian.
+ */
+TT_TARGET("avx2")
+static inline void loadLanesAvx2(__m256i _w[16], const uint8_t *const *_blocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (int half = 0; half < 2; ++half)
+    {
+        __m256i *rows = &_w[half * 8];
+
+        for (int i = 0; i < 8; ++i)
+            rows[i] = _mm256_loadu_si256((const __m256i *)&_blocks[i][half * 32]);
+
+        transpose8x8Avx2(rows);
+
+        for (int i = 0; i < 8; ++i)
+            rows[i] = _mm256_shuffle_epi8(rows[i], bswap);
+    }
+}
+
+TT_TARGET("avx2")
+static void sha256MultiAvx2(uint32_t _state[8][SHA256_MAX_LANES], const uint8_t *const *_blocks)
+{
+    __m256i w[16];
+    __m256i v[8];
+
+    loadLanesAvx2(w, _blocks);
+
+    for (int i = 0; i < 8; ++i)
+        v[i] = _mm256_load_si256((const __m256i *)_state[i]);
+
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int t = 0; t < 64; ++t)
+    {
+        if (t >= 16)
+        {
+            w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(AVX_SSIG1(w[(t - 2) & 15]), w[(t - 7) & 15]),
+                                         _mm256_add_epi32(AVX_SSIG0(w[(t - 15) & 15]), w[t & 15]));
+        }
+
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, AVX_BSIG1(e)),
+                                      _mm256_add_epi32(AVX_CH(e, f, g), _mm256_set1_epi32(K256[t])));
+        t1 = _mm256_add_epi32(t1, w[t & 15]);
+        __m256i t2 = _mm256_add_epi32(AVX_BSIG0(a), AVX_MAJ(a, b, c));
+
+        h = g; g = f; f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    v[0] = _mm256_add_epi32(v[0], a); v[1] = _mm256_add_epi32(v[1], b);
+    v[2] = _mm256_add_epi32(v[2], c); v[3] = _mm256_add_epi32(v[3], d);
+    v[4] = _mm256_add_epi32(v[4], e); v[5] = _mm256_add_epi32(v[5], f);
+    v[6] = _mm256_add_epi32(v[6], g); v[7] = _mm256_add_epi32(v[7], h);
+
+    for (int i = 0; i < 8; ++i)
+        _mm256_store_si256((__m256i *)_state[i], v[i]);
+}
+
+#define AVX512_BSIG0(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 2), _mm512_ror_epi32(x, 13), _mm512_ror_epi32(x, 22), 0x96)
+#define AVX512_BSIG1(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 6), _mm512_ror_epi32(x, 11), _mm512_ror_epi32(x, 25), 0x96)
+#define AVX512_SSIG0(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 7), _mm512_ror_epi32(x, 18), _mm512_srli_epi32(x, 3), 0x96)
+#define AVX512_SSIG1(x) _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 17), _mm512_ror_epi32(x, 19), _mm512_srli_epi32(x, 10), 0x96)
+
+// x ? y : z and the majority of x, y and z in one instruction each
+#define AVX512_CH(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define AVX512_MAJ(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE8)
+
+TT_TARGET("avx512f,avx2")
+static void sha256MultiAvx512(uint32_t _state[8][SHA256_MAX_LANES], const uint8_t *const *_blocks)
+{
+    __m256i lo[16];
+    __m256i hi[16];
+    __m512i w[16];
+    __m512i v[8];
+
+    // lanes 0-7 go into the lower, lanes 8-15 into the upper half of every vector
+    loadLanesAvx2(lo, _blocks);
+    loadLanesAvx2(hi, _blocks + 8);
+
+    for (int t = 0; t < 16; ++t)
+        w[t] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[t]), hi[t], 1);
+
+    for (int i = 0; i < 8; ++i)
+        v[i] = _mm512_load_si512((const void *)_state[i]);
+
+    __m512i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int t = 0; t < 64; ++t)
+    {
+        if (t >= 16)
+        {
+            w[t & 15] = _mm512_add_epi32(_mm512_add_epi32(AVX512_SSIG1(w[(t - 2) & 15]), w[(t - 7) & 15]),
+                                         _mm512_add_epi32(AVX512_SSIG0(w[(t - 15) & 15]), w[t & 15]));
+        }
+
+        __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, AVX512_BSIG1(e)),
+                                      _mm512_add_epi32(AVX512_CH(e, f, g), _mm512_set1_epi32(K256[t])));
+        t1 = _mm512_add_epi32(t1, w[t & 15]);
+        __m512i t2 = _mm512_add_epi32(AVX512_BSIG0(a), AVX512_MAJ(a, b, c));
+
+        h = g; g = f; f = e;
+        e = _mm512_add_epi32(d, t1);
+        d = c; c = b; b = a;
+        a = _mm512_add_epi32(t1, t2);
+    }
+
+    v[0] = _mm512_add_epi32(v[0], a); v[1] = _mm512_add_epi32(v[1], b);
+    v[2] = _mm512_add_epi32(v[2], c); v[3] = _mm512_add_epi32(v[3], d);
+    v[4] = _mm512_add_epi32(v[4], e); v[5] = _mm512_add_epi32(v[5], f);
+    v[6] = _mm512_add_epi32(v[6], g); v[7] = _mm512_add_epi32(v[7], h);
+
+    for (int i = 0; i < 8; ++i)
+        _mm512_store_si512((void *)_state[i], v[i]);
+}
+
+#endif // TT_ARCH_X86
+
+/* ==== engine selection ==== */
+
+/*
+ * checks if an engine can run on this cpu.
+ * 
+ * _IN:
+ *      _engine: the engine to check
+ * 
+ * _RETURNS: true if supported, otherwise false
+ */
+bool shaIsEngineSupported(SHA_ENGINE _engine)
+{
+    const CPU_FEATURES *cpu = getCpuFeatures();
+
+    switch (_engine)
+    {
+        case SHA_ENGINE_AUTO:
+        case SHA_ENGINE_SCALAR:
+            return true;
+#if TT_ARCH_X86
+        case SHA_ENGINE_SSE4:
+            return cpu->ssse3 && cpu->sse41;
+        case SHA_ENGINE_AVX2:
+            return cpu->ssse3 && cpu->sse41 && cpu->avx2;
+        case SHA_ENGINE_SHANI:
+            return cpu->ssse3 && cpu->sse41 && cpu->sha;
+#endif
+        default:
+            (void)cpu;
+            return false;
+    }
+}
+
+/*
+ * selects the block-functions used by all SHA-1 and SHA-256 contexts.
+ * ---------------------------------------------------------------------
+ * SHA_ENGINE_AUTO, or an engine not supported by the cpu, selects the
+ * fastest available one. must be called before any hashing is done in
+ * other threads.
+ * ---------------------------------------------------------------------
+ * 
+ * _IN:
+ *      _engine: the wanted engine
+ * 
+ * _RETURNS: the engine which is actually used
+ */
+SHA_ENGINE shaSelectEngine(SHA_ENGINE _engine)
+{
+    bool bAuto = _engine == SHA_ENGINE_AUTO || !shaIsEngineSupported(_engine);
+
+    if (bAuto)
+    {
+        if (shaIsEngineSupported(SHA_ENGINE_SHANI)) _engine = SHA_ENGINE_SHANI;
+        else if (shaIsEngineSupported(SHA_ENGINE_AVX2)) _engine = SHA_ENGINE_AVX2;
+        else if (shaIsEngineSupported(SHA_ENGINE_SSE4)) _engine = SHA_ENGINE_SSE4;
+        else _engine = SHA_ENGINE_SCALAR;
+    }
+
+    switch (_engine)
+    {
+#if TT_ARCH_X86
+        case SHA_ENGINE_SHANI:
+            pfnSha1Blocks = sha1BlocksShani;
+            pfnSha256Blocks = sha256BlocksShani;
+            break;
+        case SHA_ENGINE_AVX2:
+            pfnSha1Blocks = sha1BlocksAvx2;
+            pfnSha256Blocks = sha256BlocksAvx2;
+            break;
+        case SHA_ENGINE_SSE4:
+            pfnSha1Blocks = sha1BlocksSse4;
+            pfnSha256Blocks = sha256BlocksSse4;
+            break;
+#endif
+        default:
+            _engine = SHA_ENGINE_SCALAR;
+            pfnSha1Blocks = sha1BlocksScalar;
+            pfnSha256Blocks = sha256BlocksScalar;
+            break;
+    }
+
+    /*
+     * the multi-buffer engines are used for AUTO and AVX2, the others hash
+     * one message after the other. 16 lanes of AVX-512 beat the
+     * SHA-extensions, 8 lanes of AVX2 do not.
+     */
+    pfnSha256Multi = NULL;
+    cSha256Lanes = 1;
+
+#if TT_ARCH_X86
+    const CPU_FEATURES *cpu = getCpuFeatures();
+
+    if (bAuto && cpu->avx512f && cpu->avx2)
+    {
+        pfnSha256Multi = sha256MultiAvx512;
+        cSha256Lanes = 16;
+    }
+    else if (((bAuto && _engine != SHA_ENGINE_SHANI) || _engine == SHA_ENGINE_AVX2) && cpu->avx2)
+    {
+        pfnSha256Multi = sha256MultiAvx2;
+        cSha256Lanes = 8;
+    }
+#endif
+
+    return (activeEngine = _engine);
+}
+
+/*
+ * returns the currently used engine.
+ */
+SHA_ENGINE shaGetEngine(void)
+{
+    if (activeEngine == SHA_ENGINE_AUTO) shaSelectEngine(SHA_ENGINE_AUTO);
+
+    return activeEngine;
+}
+
+/*
+ * returns a printable name for an engine.
+ */
+const char *shaEngineName(SHA_ENGINE _engine)
+{
+    switch (_engine)
+    {
+        case SHA_ENGINE_SCALAR: return "scalar";
+        case SHA_ENGINE_SSE4: return "sse4";
+        case SHA_ENGINE_AVX2: return "avx2";
+        case SHA_ENGINE_SHANI: return "shani";
+        default: return "auto";
+    }
+}
+
+/* ==== streaming interface ==== */
+
+/*
+ * feeds data into a block-buffer and runs the block-function over every
+ * complete block. complete blocks in the input are processed directly
+ * without copying them.
+ */
+static void shaUpdate(uint32_t *_state, uint8_t *_buffer, size_t *_cbBuffer, SHA_BLOCKS_FN _pfnBlocks,
+                      const uint8_t *_data, size_t _cbData)
+{
+    if (*_cbBuffer)
+    {
+        size_t cbFill = SHA_BLOCK_LENGTH - *_cbBuffer;
+        if (cbFill > _cbData) cbFill = _cbData;
+
+        memcpy(&_buffer[*_cbBuffer], _data, cbFill);
+        *_cbBuffer += cbFill;
+        _data += cbFill;
+        _cbData -= cbFill;
+
+        if (*_cbBuffer < SHA_BLOCK_LENGTH) return;
+
+        _pfnBlocks(_state, _buffer, 1);
+        *_cbBuffer = 0;
+    }
+
+    if (_cbData >= SHA_BLOCK_LENGTH)
+    {
+        size_t nBlocks = _cbData / SHA_BLOCK_LENGTH;
+
+        _pfnBlocks(_state, _data, nBlocks);
+        _data += nBlocks * SHA_BLOCK_LENGTH;
+        _cbData -= nBlocks * SHA_BLOCK_LENGTH;
+    }
+
+    if (_cbData)
+    {
+        memcpy(_buffer, _data, _cbData);
+        *_cbBuffer = _cbData;
+    }
+}
+
+/*
+ * appends the padding and the message-length (in bits, big-endian)
+ * and processes the final block(s).
+ */
+static void shaPad(uint32_t *_state, uint8_t *_buffer, size_t _cbBuffer, SHA_BLOCKS_FN _pfnBlocks, uint64_t _cbTotal)
+{
+    uint64_t cBits = _cbTotal * 8;
+
+    _buffer[_cbBuffer++] = 0x80;
+
+    if (_cbBuffer > SHA_BLOCK_LENGTH - 8)
+    {
+        memset(&_buffer[_cbBuffer], 0, SHA_BLOCK_LENGTH - _cbBuffer);
+        _pfnBlocks(_state, _buffer, 1);
+        _cbBuffer = 0;
+    }
+
+    memset(&_buffer[_cbBuffer], 0, SHA_BLOCK_LENGTH - 8 - _cbBuffer);
+    storeBE32(&_buffer[SHA_BLOCK_LENGTH - 8], (uint32_t)(cBits >> 32));
+    storeBE32(&_buffer[SHA_BLOCK_LENGTH - 4], (uint32_t)cBits);
+    _pfnBlocks(_state, _buffer, 1);
+}
+
+void sha1Init(SHA1_CTX *_ctx)
+{
+    if (!pfnSha1Blocks) shaSelectEngine(SHA_ENGINE_AUTO);
+
+    _ctx->state[0] = 0x67452301;
+    _ctx->state[1] = 0xEFCDAB89;
+    _ctx->state[2] = 0x98BADCFE;
+    _ctx->state[3] = 0x10325476;
+    _ctx->state[4] = 0xC3D2E1F0;
+    _ctx->cbTotal = 0;
+    _ctx->cbBuffer = 0;
+}
+
+void sha1Update(SHA1_CTX *_ctx, const void *_data, size_t _cbData)
+{
+    _ctx->cbTotal += _cbData;
+    shaUpdate(_ctx->state, _ctx->buffer, &_ctx->cbBuffer, pfnSha1Blocks, (const uint8_t *)_data, _cbData);
+}
+
+void sha1Final(SHA1_CTX *_ctx, uint8_t _digest[SHA1_DIGEST_LENGTH])
+{
+    shaPad(_ctx->state, _ctx->buffer, _ctx->cbBuffer, pfnSha1Blocks, _ctx->cbTotal);
+
+    for (int i = 0; i < 5; ++i)
+        storeBE32(&_digest[i * 4], _ctx->state[i]);
+}
+
+void sha256Init(SHA256_CTX *_ctx)
+{
+    if (!pfnSha256Blocks) shaSelectEngine(SHA_ENGINE_AUTO);
+
+    _ctx->state[0] = 0x6A09E667;
+    _ctx->state[1] = 0xBB67AE85;
+    _ctx->state[2] = 0x3C6EF372;
+    _ctx->state[3] = 0xA54FF53A;
+    _ctx->state[4] = 0x510E527F;
+    _ctx->state[5] = 0x9B05688C;
+    _ctx->state[6] = 0x1F83D9AB;
+    _ctx->state[7] = 0x5BE0CD19;
+    _ctx->cbTotal = 0;
+    _ctx->cbBuffer = 0;
+}
+
+void sha256Update(SHA256_CTX *_ctx, const void *_data, size_t _cbData)
+{
+    _ctx->cbTotal += _cbData;
+    shaUpdate(_ctx->state, _ctx->buffer, &_ctx->cbBuffer, pfnSha256Blocks, (const uint8_t *)_data, _cbData);
+}
+
+void sha256Final(SHA256_CTX *_ctx, uint8_t _digest[SHA256_DIGEST_LENGTH])
+{
+    shaPad(_ctx->state, _ctx->buffer, _ctx->cbBuffer, pfnSha256Blocks, _ctx->cbTotal);
+
+    for (int i = 0; i < 8; ++i)
+        storeBE32(&_digest[i * 4], _ctx->state[i]);
+}
+
+/* ==== multi-buffer interface ==== */
+
+/*
+ * returns the number of messages sha256Multi() hashes at once with the
+ * selected engine, 1 if there is no multi-buffer engine.
+ */
+size_t sha256MultiLanes(void)
+{
+    if (!pfnSha256Blocks) shaSelectEngine(SHA_ENGINE_AUTO);
+
+    return cSha256Lanes;
+}
+
+/*
+ * builds the last block(s) of a message: the bytes behind the last
+ * complete block, the padding and the message-length.
+ * 
+ * _RETURNS: the number of blocks in _tail, 1 or 2
+ */
+static size_t buildTail(uint8_t _tail[2 * SHA_BLOCK_LENGTH], const uint8_t *_data, size_t _cbData)
+{
+    size_t cbRest = _cbData % SHA_BLOCK_LENGTH;
+    size_t nBlocks = cbRest + 1 + 8 > SHA_BLOCK_LENGTH ? 2 : 1;
+    uint64_t cBits = (uint64_t)_cbData * 8;
+
+    memcpy(_tail, _data + _cbData - cbRest, cbRest);
+    _tail[cbRest] = 0x80;
+    memset(&_tail[cbRest + 1], 0, nBlocks * SHA_BLOCK_LENGTH - cbRest - 1);
+
+    storeBE32(&_tail[nBlocks * SHA_BLOCK_LENGTH - 8], (uint32_t)(cBits >> 32));
+    storeBE32(&_tail[nBlocks * SHA_BLOCK_LENGTH - 4], (uint32_t)cBits);
+
+    return nBlocks;
+}
+
+/*
+ * calculates the SHA-256 digests of many complete messages.
+ * ---------------------------------------------------------
+ * with a multi-buffer engine every lane hashes one message. when a
+ * message is done, its lane takes the next one, so messages of
+ * different length do not leave lanes idle. lanes without a message
+ * hash a block of zeros, their state is discarded.
+ * ---------------------------------------------------------
+ * 
+ * _IN:
+ *      _ppData: the messages
+ *      _pcbData: the length of every message in bytes
+ *      _cMessages: the number of messages
+ * 
+ * _OUT:
+ *      _digests: the digest of every message
+ */
+void sha256Multi(const uint8_t *const *_ppData, const size_t *_pcbData, size_t _cMessages,
+                 uint8_t _digests[][SHA256_DIGEST_LENGTH])
+{
+    size_t cLanes = sha256MultiLanes();
+
+    if (cLanes == 1 || !pfnSha256Multi)
+    {
+        for (size_t i = 0; i < _cMessages; ++i)
+        {
+            SHA256_CTX ctx;
+
+            sha256Init(&ctx);
+            sha256Update(&ctx, _ppData[i], _pcbData[i]);
+            sha256Final(&ctx, _digests[i]);
+        }
+
+        return;
+    }
+
+    static const uint8_t ZERO_BLOCK[SHA_BLOCK_LENGTH] = { 0 };
+    static const uint32_t IV[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+
+    TT_ALIGN(64) uint32_t state[8][SHA256_MAX_LANES];
+    uint8_t tails[SHA256_MAX_LANES][2 * SHA_BLOCK_LENGTH];
+    const uint8_t *blocks[SHA256_MAX_LANES];
+    size_t message[SHA256_MAX_LANES];
+    size_t nBlock[SHA256_MAX_LANES];
+    size_t nFull[SHA256_MAX_LANES];
+    size_t nTotal[SHA256_MAX_LANES];
+    size_t nNext = 0;
+    size_t cActive = 0;
+
+    for (size_t lane = 0; lane < cLanes; ++lane)
+    {
+        nTotal[lane] = 0;
+        nBlock[lane] = 0;
+    }
+
+    for (;;)
+    {
+        // give every idle lane the next message
+        for (size_t lane = 0; lane < cLanes; ++lane)
+        {
+            if (nBlock[lane] < nTotal[lane] || nNext >= _cMessages) continue;
+
+            message[lane] = nNext++;
+            nFull[lane] = _pcbData[message[lane]] / SHA_BLOCK_LENGTH;
+            nTotal[lane] = nFull[lane] + buildTail(tails[lane], _ppData[message[lane]], _pcbData[message[lane]]);
+            nBlock[lane] = 0;
+            ++cActive;
+
+            for (int i = 0; i < 8; ++i)
+                state[i][lane] = IV[i];
+        }
+
+        if (cActive == 0) break;
+
+        for (size_t lane = 0; lane < cLanes; ++lane)
+        {
+            if (nBlock[lane] >= nTotal[lane])
+                blocks[lane] = ZERO_BLOCK;
+            else if (nBlock[lane] < nFull[lane])
+                blocks[lane] = _ppData[message[lane]] + nBlock[lane] * SHA_BLOCK_LENGTH;
+            else
+                blocks[lane] = tails[lane] + (nBlock[lane] - nFull[lane]) * SHA_BLOCK_LENGTH;
+        }
+
+        pfnSha256Multi(state, blocks);
+
+        for (size_t lane = 0; lane < cLanes; ++lane)
+        {
+            if (nBlock[lane] >= nTotal[lane]) continue;
+
+            if (++nBlock[lane] == nTotal[lane])
+            {
+                for (int i = 0; i < 8; ++i)
+                    storeBE32(&_digests[message[lane]][i * 4], state[i][lane]);
+
+                --cActive;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_sha.h - in-tree SHA-1 and SHA-256 engine.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_SHA_H
+#define _HASHSUM_SHA_H
+
+#include "hashsum_cpu.h"
+
+#define SHA_BLOCK_LENGTH 64
+#define SHA1_DIGEST_LENGTH 20
+#define SHA256_DIGEST_LENGTH 32
+
+// number of messages the widest multi-buffer engine hashes at once
+#define SHA256_MAX_LANES 16
+
+/*
+ * implementations of the block-functions, from slowest to fastest.
+ * SHA_ENGINE_AUTO picks the fastest one supported by the cpu.
+ */
+typedef enum SHA_ENGINE {
+    SHA_ENGINE_AUTO = 0,
+    SHA_ENGINE_SCALAR,
+    SHA_ENGINE_SSE4,
+    SHA_ENGINE_AVX2,
+    SHA_ENGINE_SHANI
+} SHA_ENGINE;
+
+typedef struct SHA1_CTX {
+    uint32_t state[5];
+    uint64_t cbTotal;
+    uint8_t buffer[SHA_BLOCK_LENGTH];
+    size_t cbBuffer;
+} SHA1_CTX;
+
+typedef struct SHA256_CTX {
+    uint32_t state[8];
+    uint64_t cbTotal;
+    uint8_t buffer[SHA_BLOCK_LENGTH];
+    size_t cbBuffer;
+} SHA256_CTX;
+
+SHA_ENGINE shaSelectEngine(SHA_ENGINE);
+SHA_ENGINE shaGetEngine(void);
+bool shaIsEngineSupported(SHA_ENGINE);
+const char *shaEngineName(SHA_ENGINE);
+
+void sha1Init(SHA1_CTX *);
+void sha1Update(SHA1_CTX *, const void *, size_t);
+void sha1Final(SHA1_CTX *, uint8_t[SHA1_DIGEST_LENGTH]);
+
+void sha256Init(SHA256_CTX *);
+void sha256Update(SHA256_CTX *, const void *, size_t);
+void sha256Final(SHA256_CTX *, uint8_t[SHA256_DIGEST_LENGTH]);
+
+size_t sha256MultiLanes(void);
+void sha256Multi(const uint8_t *const *, const size_t *, size_t, uint8_t[][SHA256_DIGEST_LENGTH]);
+
+#endif // _HASHSUM_SHA_H
\ No newline at end of file
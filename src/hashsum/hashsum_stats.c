@@ -0,0 +1,173 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_stats.c - throughput statistics of the hashed files, JSON output.
+ * 
+ * for every file the bytes hashed, the time from opening it to its
+ * digests and how much of that was spent waiting for reads and feeding
+ * the hashes are recorded. if the waiting outweighs the hashing, more or
+ * faster threads will not make the run faster, faster storage will.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_stats.h"
+#include "hashsum_output.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+static LONGLONG g_frequency = 0;
+
+/*
+ * _RETURNS: the current value of the performance-counter
+ */
+LONGLONG statsNow(void)
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    return now.QuadPart;
+}
+
+/*
+ * converts ticks of the performance-counter to seconds.
+ */
+double statsSeconds(LONGLONG _ticks)
+{
+    if (!g_frequency)
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        g_frequency = frequency.QuadPart;
+    }
+
+    return (double)_ticks / (double)g_frequency;
+}
+
+/*
+ * _RETURNS: the throughput in MB/s, 0 if no time passed
+ */
+double statsThroughput(ULONGLONG _cbData, LONGLONG _ticks)
+{
+    double seconds = statsSeconds(_ticks);
+
+    return seconds > 0.0 ? (double)_cbData / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+/*
+ * adds the statistics of a file to the ones of the run.
+ * 
+ * _IN:
+ *      _stats: the statistics of the file, NULL if they were not recorded
+ *      _bFailed: true if the file could not be hashed
+ * 
+ * _IN_OUT:
+ *      _run: the statistics of the run
+ */
+void statsAdd(RUN_STATS *_run, const FILE_STATS *_stats, bool _bFailed)
+{
+    ++_run->cFiles;
+    if (_bFailed) ++_run->cFailed;
+
+    if (!_stats) return;
+
+    _run->total.cbRead += _stats->cbRead;
+    _run->total.wallTicks += _stats->wallTicks;
+    _run->total.ioTicks += _stats->ioTicks;
+    _run->total.hashTicks += _stats->hashTicks;
+}
+
+/*
+ * prints the statistics of a file to stderr, below its digests.
+ */
+void statsPrintFile(LPCWSTR _fileName, const FILE_STATS *_stats)
+{
+    fwprintf_s(stderr, L"* STATS: %s: %llu bytes in %.3f s (%.2f MB/s), io %.3f s, hash %.3f s\n",
+                _fileName, _stats->cbRead, statsSeconds(_stats->wallTicks),
+                statsThroughput(_stats->cbRead, _stats->wallTicks),
+                statsSeconds(_stats->ioTicks), statsSeconds(_stats->hashTicks));
+}
+
+/*
+ * prints the summary of a run. the times of io and hashing are summed
+ * over all threads, the throughput is the one of the whole run.
+ */
+void statsPrintRun(const RUN_STATS *_run)
+{
+    LONGLONG wallTicks = statsNow() - _run->startTicks;
+
+    fwprintf_s(stderr, L"* STATS: %zu files (%zu failed), %llu bytes in %.3f s (%.2f MB/s), io %.3f s, hash %.3f s, %s\n",
+                _run->cFiles, _run->cFailed, _run->total.cbRead, statsSeconds(wallTicks),
+                statsThroughput(_run->total.cbRead, wallTicks),
+                statsSeconds(_run->total.ioTicks), statsSeconds(_run->total.hashTicks),
+                _run->total.ioTicks > _run->total.hashTicks ? L"io-bound" : L"cpu-bound");
+}
+
+/*
+ * prints a string as a JSON string, including the quotes. the runs of
+ * characters that need no escape are written as they are.
+ */
+void jsonPrintString(LPCWSTR _string)
+{
+    outputWrite(L"\"", 1);
+
+    LPCWSTR run = _string;
+    for (LPCWSTR c = _string; ; ++c)
+    {
+        if (*c >= 0x20 && *c != L'"' && *c != L'\\')
+            continue;
+
+        outputWrite(run, c - run);
+        run = c + 1;
+
+        switch (*c)
+        {
+            case L'\0': outputWrite(L"\"", 1); return;
+            case L'"':  outputWrite(L"\\\"", 2); break;
+            case L'\\': outputWrite(L"\\\\", 2); break;
+            case L'\n': outputWrite(L"\\n", 2); break;
+            case L'\r': outputWrite(L"\\r", 2); break;
+            case L'\t': outputWrite(L"\\t", 2); break;
+            default: outputPrintf(L"\\u%04x", (unsigned)*c); break;
+        }
+    }
+}
+
+/*
+ * prints the statistics of a file as the members of a JSON object,
+ * without the braces.
+ */
+void jsonPrintStats(const FILE_STATS *_stats)
+{
+    outputPrintf(L"\"bytes\": %llu, \"seconds\": %.6f, \"io_seconds\": %.6f, \"hash_seconds\": %.6f, \"mb_per_s\": %.2f",
+                _stats->cbRead, statsSeconds(_stats->wallTicks), statsSeconds(_stats->ioTicks),
+                statsSeconds(_stats->hashTicks), statsThroughput(_stats->cbRead, _stats->wallTicks));
+}
\ No newline at end of file
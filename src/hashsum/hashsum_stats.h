@@ -0,0 +1,82 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_stats.h - throughput statistics of the hashed files, JSON output.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_STATS_H
+#define _HASHSUM_STATS_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+/*
+ * the statistics of one file. the times are ticks of the
+ * performance-counter, see statsNow().
+ */
+typedef struct FILE_STATS {
+    ULONGLONG cbRead;       // bytes read and hashed, 0 if the digests came from the cache
+    LONGLONG wallTicks;     // from opening the file to its digests
+    LONGLONG ioTicks;       // waiting for reads to complete
+    LONGLONG hashTicks;     // feeding the hashes
+} FILE_STATS;
+
+/*
+ * the statistics of a whole run, summed up as the results are printed.
+ */
+typedef struct RUN_STATS {
+    FILE_STATS total;
+    SIZE_T cFiles;
+    SIZE_T cFailed;
+    LONGLONG startTicks;
+} RUN_STATS;
+
+LONGLONG statsNow(void);
+double statsSeconds(LONGLONG);
+double statsThroughput(ULONGLONG, LONGLONG);
+void statsAdd(RUN_STATS *, const FILE_STATS *, bool);
+void statsPrintFile(LPCWSTR, const FILE_STATS *);
+void statsPrintRun(const RUN_STATS *);
+void jsonPrintString(LPCWSTR);
+void jsonPrintStats(const FILE_STATS *);
+
+#endif // _HASHSUM_STATS_H
\ No newline at end of file
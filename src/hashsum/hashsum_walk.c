@@ -0,0 +1,510 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_walk.c - walks directory-trees for /R.
+ * 
+ * the directories of a tree are scanned by several threads at once,
+ * each one takes the next directory from a shared stack, lists it with
+ * FindFirstFileExW() (basic info, large fetches) and pushes the sub-
+ * directories it found back onto the stack. the paths of a directory
+ * are collected in blocks owned by the scanning thread and are handed
+ * over as a whole, so the shared lock is taken once per directory.
+ * when the stack is empty and no thread is busy, the files of the tree
+ * are sorted.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#include "hashsum_walk.h"
+
+#include <stdlib.h>
+#include <wchar.h>
+#include <wctype.h>
+
+/*
+ * the paths and sub-directories found in one directory.
+ */
+typedef struct WALK_RESULT {
+    LPWSTR *pvFileNames;
+    SIZE_T cFileNames;
+    SIZE_T cCapacity;
+    WALK_BLOCK *pBlocks;
+    WALK_DIR *pDirs;
+    bool bOutOfMemory;
+} WALK_RESULT;
+
+static bool isSeparator(WCHAR _ch)
+{
+    return _ch == L'\\' || _ch == L'/' || _ch == L':';
+}
+
+/*
+ * allocates a path of _cchPath characters (plus the terminator) from
+ * the blocks of _result, paths never move.
+ */
+static LPWSTR allocPath(WALK_RESULT *_result, SIZE_T _cchPath)
+{
+    WALK_BLOCK *block = _result->pBlocks;
+
+    if (!block || block->cchBlock - block->cchUsed < _cchPath + 1)
+    {
+        SIZE_T cchBlock = _cchPath + 1 > WALK_BLOCK_SIZE ? _cchPath + 1 : WALK_BLOCK_SIZE;
+
+        if (! (block = HeapAlloc(GetProcessHeap(), 0, sizeof(WALK_BLOCK) + sizeof(WCHAR) * cchBlock)))
+            return NULL;
+
+        block->pNext = _result->pBlocks;
+        block->cchUsed = 0;
+        block->cchBlock = cchBlock;
+        _result->pBlocks = block;
+    }
+
+    LPWSTR pszPath = block->data + block->cchUsed;
+    block->cchUsed += _cchPath + 1;
+
+    return pszPath;
+}
+
+/*
+ * makes room for _cNew more entries in a vector of file-names.
+ */
+static bool reserveFileNames(LPWSTR **_pvFileNames, SIZE_T *_cCapacity, SIZE_T _cFileNames, SIZE_T _cNew)
+{
+    if (_cFileNames + _cNew <= *_cCapacity) return true;
+
+    SIZE_T cCapacity = *_cCapacity ? *_cCapacity * 2 : 256;
+    while (cCapacity < _cFileNames + _cNew) cCapacity *= 2;
+
+    LPWSTR *pvFileNames = *_pvFileNames
+        ? HeapReAlloc(GetProcessHeap(), 0, *_pvFileNames, sizeof(LPWSTR) * cCapacity)
+        : HeapAlloc(GetProcessHeap(), 0, sizeof(LPWSTR) * cCapacity);
+
+    if (!pvFileNames) return false;
+
+    *_pvFileNames = pvFileNames;
+    *_cCapacity = cCapacity;
+
+    return true;
+}
+
+static int comparePaths(const void *_a, const void *_b)
+{
+    return walkComparePaths(*(LPCWSTR const *)_a, *(LPCWSTR const *)_b);
+}
+
+static bool isExcluded(const WALK_FILTER *_filter, LPCWSTR _name)
+{
+    for (SIZE_T i = 0; _filter && i < _filter->cExclude; ++i)
+    {
+        if (matchPattern(_filter->ppszExclude[i], _name))
+            return true;
+    }
+
+    return false;
+}
+
+static bool isIncluded(const WALK_FILTER *_filter, LPCWSTR _name)
+{
+    if (!_filter || _filter->cInclude == 0) return true;
+
+    for (SIZE_T i = 0; i < _filter->cInclude; ++i)
+    {
+        if (matchPattern(_filter->ppszInclude[i], _name))
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * lists one directory into _result.
+ * ---------------------------------
+ * junctions and symbolic links to directories are not followed, they
+ * could lead back into the tree.
+ * ---------------------------------
+ */
+static void scanDirectory(const TREE_WALK *_walk, LPCWSTR _pszDir, WALK_RESULT *_result)
+{
+    SIZE_T cchDir = wcslen(_pszDir);
+    bool bSeparator = cchDir > 0 && isSeparator(_pszDir[cchDir-1]);
+    SIZE_T cchPrefix = cchDir + (bSeparator ? 0 : 1);
+
+    LPWSTR pszPattern = HeapAlloc(GetProcessHeap(), 0, sizeof(WCHAR) * (cchPrefix + 2));
+    if (!pszPattern)
+    {
+        (*_result).bOutOfMemory = true;
+        return;
+    }
+
+    wmemcpy(pszPattern, _pszDir, cchDir);
+    if (!bSeparator) pszPattern[cchDir] = L'\\';
+    pszPattern[cchPrefix] = L'*';
+    pszPattern[cchPrefix+1] = L'\0';
+
+    WIN32_FIND_DATAW data;
+    HANDLE hFind = FindFirstFileExW(pszPattern, FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+                                    FIND_FIRST_EX_LARGE_FETCH);
+
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        DWORD dwError = GetLastError();
+        if (dwError != ERROR_FILE_NOT_FOUND && _walk->pfnError) _walk->pfnError(_pszDir, dwError);
+
+        HeapFree(GetProcessHeap(), 0, pszPattern);
+        return;
+    }
+
+    do
+    {
+        LPCWSTR name = data.cFileName;
+        bool bDir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+        if (bDir && (wcscmp(name, L".") == 0 || wcscmp(name, L"..") == 0)) continue;
+        if (bDir && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) continue;
+        if (isExcluded(_walk->pFilter, name)) continue;
+        if (!bDir && !isIncluded(_walk->pFilter, name)) continue;
+
+        SIZE_T cchName = wcslen(name);
+        SIZE_T cchPath = cchPrefix + cchName;
+
+        if (bDir)
+        {
+            WALK_DIR *dir = HeapAlloc(GetProcessHeap(), 0, sizeof(WALK_DIR) + sizeof(WCHAR) * (cchPath + 1));
+            if (!dir)
+            {
+                (*_result).bOutOfMemory = true;
+                break;
+            }
+
+            wmemcpy(dir->szPath, pszPattern, cchPrefix);
+            wmemcpy(dir->szPath + cchPrefix, name, cchName + 1);
+
+            dir->pNext = _result->pDirs;
+            (*_result).pDirs = dir;
+        }
+        else
+        {
+            LPWSTR pszPath = allocPath(_result, cchPath);
+            if (!pszPath || !reserveFileNames(&_result->pvFileNames, &_result->cCapacity, _result->cFileNames, 1))
+            {
+                (*_result).bOutOfMemory = true;
+                break;
+            }
+
+            wmemcpy(pszPath, pszPattern, cchPrefix);
+            wmemcpy(pszPath + cchPrefix, name, cchName + 1);
+
+            (*_result).pvFileNames[(*_result).cFileNames++] = pszPath;
+        }
+    } while (FindNextFileW(hFind, &data));
+
+    DWORD dwError = GetLastError();
+    if (!_result->bOutOfMemory && dwError != ERROR_NO_MORE_FILES && _walk->pfnError)
+        _walk->pfnError(_pszDir, dwError);
+
+    FindClose(hFind);
+    HeapFree(GetProcessHeap(), 0, pszPattern);
+}
+
+/*
+ * hands the result of a directory over to the walk, called with the
+ * lock held. the blocks of the result now belong to the walk.
+ */
+static void mergeResult(TREE_WALK *_walk, WALK_RESULT *_result)
+{
+    if (_result->bOutOfMemory ||
+        !reserveFileNames(&_walk->pvFileNames, &_walk->cCapacity, _walk->cFileNames, _result->cFileNames))
+        (*_walk).bOutOfMemory = true;
+    else
+    {
+        memcpy(_walk->pvFileNames + _walk->cFileNames, _result->pvFileNames, sizeof(LPWSTR) * _result->cFileNames);
+        (*_walk).cFileNames += _result->cFileNames;
+    }
+
+    while (_result->pBlocks)
+    {
+        WALK_BLOCK *block = _result->pBlocks;
+        (*_result).pBlocks = block->pNext;
+
+        block->pNext = _walk->pBlocks;
+        (*_walk).pBlocks = block;
+    }
+
+    while (_result->pDirs)
+    {
+        WALK_DIR *dir = _result->pDirs;
+        (*_result).pDirs = dir->pNext;
+
+        // after running out of memory the walk only drains the stack
+        if (_walk->bOutOfMemory)
+        {
+            HeapFree(GetProcessHeap(), 0, dir);
+            continue;
+        }
+
+        dir->pNext = _walk->pPending;
+        (*_walk).pPending = dir;
+    }
+
+    (*_result).cFileNames = 0;
+    (*_result).bOutOfMemory = false;
+}
+
+/*
+ * scanning-thread of walkTree(), also run by the calling thread.
+ * takes directories from the stack until it is empty and no other
+ * thread can push new ones.
+ */
+static DWORD WINAPI scanWorker(LPVOID _param)
+{
+    TREE_WALK *walk = (TREE_WALK *)_param;
+    WALK_RESULT result = { 0 };
+
+    AcquireSRWLockExclusive(&walk->lock);
+
+    for (;;)
+    {
+        while (!walk->pPending && walk->cBusy > 0)
+            SleepConditionVariableSRW(&walk->cvWork, &walk->lock, INFINITE, 0);
+
+        if (!walk->pPending) break;
+
+        WALK_DIR *dir = walk->pPending;
+        (*walk).pPending = dir->pNext;
+        ++(*walk).cBusy;
+
+        ReleaseSRWLockExclusive(&walk->lock);
+
+        scanDirectory(walk, dir->szPath, &result);
+        HeapFree(GetProcessHeap(), 0, dir);
+
+        AcquireSRWLockExclusive(&walk->lock);
+
+        mergeResult(walk, &result);
+        --(*walk).cBusy;
+
+        // new directories or the end of the walk
+        WakeAllConditionVariable(&walk->cvWork);
+    }
+
+    ReleaseSRWLockExclusive(&walk->lock);
+
+    if (result.pvFileNames) HeapFree(GetProcessHeap(), 0, result.pvFileNames);
+
+    return 0;
+}
+
+/*
+ * prepares a walk.
+ * 
+ * _IN:
+ *      _filter: the include- and exclude-patterns, or NULL
+ *      _pfnError: called for every directory that could not be read, or NULL
+ * 
+ * _OUT:
+ *      _walk: the walk to initialize
+ */
+void walkInit(TREE_WALK *_walk, const WALK_FILTER *_filter, WALK_ERROR_CALLBACK _pfnError)
+{
+    ZeroMemory(_walk, sizeof(TREE_WALK));
+
+    _walk->pFilter = _filter;
+    _walk->pfnError = _pfnError;
+
+    InitializeSRWLock(&_walk->lock);
+    InitializeConditionVariable(&_walk->cvWork);
+}
+
+/*
+ * appends a single file to the list, the filters do not apply to it.
+ * 
+ * _IN:
+ *      _fileName: the name/path of the file, it has to outlive the walk
+ * 
+ * _IN_OUT:
+ *      _walk: an initialized walk
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool walkAddFile(TREE_WALK *_walk, LPWSTR _fileName)
+{
+    if (!reserveFileNames(&_walk->pvFileNames, &_walk->cCapacity, _walk->cFileNames, 1))
+        return !((*_walk).bOutOfMemory = true);
+
+    (*_walk).pvFileNames[(*_walk).cFileNames++] = _fileName;
+
+    return true;
+}
+
+/*
+ * appends all files of a directory-tree to the list.
+ * --------------------------------------------------
+ * the tree is scanned by _cThreads threads (the calling thread is one
+ * of them), then its files are sorted ordinal by path. directories
+ * that can not be read are reported and skipped.
+ * --------------------------------------------------
+ * 
+ * _IN:
+ *      _root: the name/path of the directory
+ *      _cThreads: the number of scanning threads
+ * 
+ * _IN_OUT:
+ *      _walk: an initialized walk
+ * 
+ * _RETURNS: true on success, false if memory ran out
+ */
+bool walkTree(TREE_WALK *_walk, LPCWSTR _root, DWORD _cThreads)
+{
+    SIZE_T iFirst = _walk->cFileNames;
+    SIZE_T cchRoot = wcslen(_root);
+
+    WALK_DIR *dir = HeapAlloc(GetProcessHeap(), 0, sizeof(WALK_DIR) + sizeof(WCHAR) * (cchRoot + 1));
+    if (!dir)
+        return !((*_walk).bOutOfMemory = true);
+
+    wmemcpy(dir->szPath, _root, cchRoot + 1);
+    dir->pNext = NULL;
+
+    (*_walk).pPending = dir;
+    (*_walk).cBusy = 0;
+
+    HANDLE *phThreads = _cThreads > 1 ? HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(HANDLE) * (_cThreads - 1)) : NULL;
+    DWORD cStarted = 0;
+
+    for (; phThreads && cStarted < _cThreads - 1; ++cStarted)
+    {
+        if (! (phThreads[cStarted] = CreateThread(NULL, 0, scanWorker, _walk, 0, NULL)))
+            break;
+    }
+
+    scanWorker(_walk);
+
+    for (DWORD i = 0; i < cStarted; ++i)
+    {
+        WaitForSingleObject(phThreads[i], INFINITE);
+        CloseHandle(phThreads[i]);
+    }
+
+    if (phThreads) HeapFree(GetProcessHeap(), 0, phThreads);
+
+    qsort(_walk->pvFileNames + iFirst, _walk->cFileNames - iFirst, sizeof(LPWSTR), comparePaths);
+
+    return !_walk->bOutOfMemory;
+}
+
+/*
+ * frees the list and all paths found by the walk.
+ * 
+ * _IN_OUT:
+ *      _walk: the walk
+ */
+void walkFree(TREE_WALK *_walk)
+{
+    while (_walk->pBlocks)
+    {
+        WALK_BLOCK *block = _walk->pBlocks;
+        (*_walk).pBlocks = block->pNext;
+        HeapFree(GetProcessHeap(), 0, block);
+    }
+
+    if (_walk->pvFileNames) HeapFree(GetProcessHeap(), 0, _walk->pvFileNames);
+
+    (*_walk).pvFileNames = NULL;
+    (*_walk).cFileNames = 0;
+    (*_walk).cCapacity = 0;
+}
+
+/*
+ * matches a name against a pattern, case-insensitive.
+ * 
+ * _IN:
+ *      _pattern: the pattern, '*' matches any number of characters
+ *              and '?' a single one
+ *      _name: the name of a file or directory
+ * 
+ * _RETURNS: true if the name matches the pattern
+ */
+bool matchPattern(LPCWSTR _pattern, LPCWSTR _name)
+{
+    LPCWSTR pStar = NULL;
+    LPCWSTR pResume = NULL;
+
+    while (*_name)
+    {
+        if (*_pattern == L'*')
+        {
+            pStar = ++_pattern;
+            pResume = _name;
+        }
+        else if (*_pattern && (*_pattern == L'?' || towupper(*_pattern) == towupper(*_name)))
+        {
+            ++_pattern;
+            ++_name;
+        }
+        else if (pStar)
+        {
+            // let the last '*' swallow one more character
+            _pattern = pStar;
+            _name = ++pResume;
+        }
+        else
+            return false;
+    }
+
+    while (*_pattern == L'*') ++_pattern;
+
+    return *_pattern == L'\0';
+}
+
+/*
+ * compares two paths in the order of the walk.
+ * --------------------------------------------
+ * a separator sorts before every other character, so the files of a
+ * directory come before those of "directory-2" and "directory.old",
+ * and all files of a directory are next to each other.
+ * --------------------------------------------
+ * 
+ * _IN:
+ *      _a, _b: the paths to compare
+ * 
+ * _RETURNS: <0, 0 or >0 like wcscmp()
+ */
+int walkComparePaths(LPCWSTR _a, LPCWSTR _b)
+{
+    LPCWSTR a = _a;
+    LPCWSTR b = _b;
+
+    for (; *a && *a == *b; ++a, ++b);
+
+    int chA = *a == L'\\' ? 1 : (int)*a;
+    int chB = *b == L'\\' ? 1 : (int)*b;
+
+    return chA - chB;
+}
\ No newline at end of file
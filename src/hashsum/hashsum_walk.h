@@ -0,0 +1,116 @@
+/* -----------------------------------------------------------------------
+ * This is free and unencumbered software released into the public domain.
+ * 
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ * 
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ * For more information, please refer to <https://unlicense.org>
+ * -----------------------------------------------------------------------
+ * 
+ * hashsum_walk.h - walks directory-trees for /R.
+ * 
+ * Author: Holger Dörner <holger.doerner@gmail.com>
+ * 
+ * This application is part of the 'TermTools'-project.
+ * GitHub: https://GitHub.com/HolgerDoerner/TermTools
+ */
+
+#ifndef _HASHSUM_WALK_H
+#define _HASHSUM_WALK_H
+
+#ifndef UNICODE
+    #define UNICODE
+#endif
+
+#ifndef _UNICODE
+    #define _UNICODE
+#endif
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <windows.h>
+#include <stdbool.h>
+
+// maximum number of /INCLUDE and of /EXCLUDE patterns
+#define WALK_MAX_PATTERNS 32
+
+// directories are scanned by this many threads, the scan waits on the disk, not the cpu
+#define WALK_THREADS 8
+
+// size (in characters) of the blocks the paths are allocated from
+#define WALK_BLOCK_SIZE (64 * 1024)
+
+/*
+ * the patterns are matched against the name of a file or directory,
+ * '*' matches any number of characters and '?' a single one.
+ * excluded directories are not entered, the include-patterns only
+ * apply to files. without include-patterns every file is included.
+ */
+typedef struct WALK_FILTER {
+    LPCWSTR ppszInclude[WALK_MAX_PATTERNS];
+    SIZE_T cInclude;
+    LPCWSTR ppszExclude[WALK_MAX_PATTERNS];
+    SIZE_T cExclude;
+} WALK_FILTER;
+
+// a directory waiting to be scanned
+typedef struct WALK_DIR {
+    struct WALK_DIR *pNext;
+    WCHAR szPath[];
+} WALK_DIR;
+
+typedef struct WALK_BLOCK {
+    struct WALK_BLOCK *pNext;
+    SIZE_T cchUsed;
+    SIZE_T cchBlock;
+    WCHAR data[];
+} WALK_BLOCK;
+
+// called for every directory that could not be read
+typedef void (*WALK_ERROR_CALLBACK)(LPCWSTR, DWORD);
+
+/*
+ * collects the files of any number of directory-trees and single
+ * files in pvFileNames. the files of every tree are sorted, so the
+ * list does not depend on the order the threads found them in.
+ */
+typedef struct TREE_WALK {
+    const WALK_FILTER *pFilter;
+    WALK_ERROR_CALLBACK pfnError;
+    LPWSTR *pvFileNames;
+    SIZE_T cFileNames;
+    SIZE_T cCapacity;
+    WALK_BLOCK *pBlocks;
+    WALK_DIR *pPending;
+    LONG cBusy;
+    bool bOutOfMemory;
+    SRWLOCK lock;
+    CONDITION_VARIABLE cvWork;
+} TREE_WALK;
+
+void walkInit(TREE_WALK *, const WALK_FILTER *, WALK_ERROR_CALLBACK);
+bool walkAddFile(TREE_WALK *, LPWSTR);
+bool walkTree(TREE_WALK *, LPCWSTR, DWORD);
+void walkFree(TREE_WALK *);
+bool matchPattern(LPCWSTR, LPCWSTR);
+int walkComparePaths(LPCWSTR, LPCWSTR);
+
+#endif // _HASHSUM_WALK_H
\ No newline at end of file